@@ -0,0 +1,92 @@
+//***************************************************************************************
+// ClusterBenchmark.cpp
+//
+// Times ClusteredLightBuilder::Build against the number of lights, on the calling
+// thread and on a ThreadPool.  The lights are random point lights scattered in front
+// of a camera set up like the demos' (45 degree fov, 16:9, near 1, far 1000).
+//***************************************************************************************
+
+#include "../../Common/ClusteredLighting.h"
+#include "../../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const int Repeats = 50;
+
+	std::vector<BoundingSphere> MakeLights(std::uint32_t count)
+	{
+		// Fixed seed so runs are comparable.
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> xy(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> z(0.0f, 400.0f);
+		std::uniform_real_distribution<float> falloff(5.0f, 25.0f);
+
+		std::vector<BoundingSphere> lights(count);
+		for(auto& light : lights)
+		{
+			light.Center = XMFLOAT3(xy(rng), 0.25f*xy(rng), z(rng));
+			light.Radius = falloff(rng);
+		}
+
+		return lights;
+	}
+
+	// Average milliseconds per Build over Repeats runs, after one warm up run.
+	double TimeBuild(ClusteredLightBuilder& builder, FXMMATRIX view,
+		const std::vector<BoundingSphere>& lights)
+	{
+		builder.Build(view, lights.data(), (std::uint32_t)lights.size());
+
+		auto start = std::chrono::steady_clock::now();
+		for(int i = 0; i < Repeats; ++i)
+			builder.Build(view, lights.data(), (std::uint32_t)lights.size());
+		auto end = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<double, std::milli>(end - start).count() / Repeats;
+	}
+}
+
+int main()
+{
+	const float fovY = 0.25f*XM_PI;
+	const float aspect = 16.0f / 9.0f;
+
+	XMMATRIX view = XMMatrixLookAtLH(
+		XMVectorSet(0.0f, 20.0f, -50.0f, 1.0f),
+		XMVectorSet(0.0f, 0.0f, 100.0f, 1.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+	ThreadPool threadPool;
+
+	ClusteredLightBuilder serialBuilder(nullptr);
+	ClusteredLightBuilder parallelBuilder(&threadPool);
+	serialBuilder.SetLens(fovY, aspect, 1.0f, 1000.0f);
+	parallelBuilder.SetLens(fovY, aspect, 1.0f, 1000.0f);
+
+	std::printf("%u clusters (%u x %u x %u), %u worker threads\n\n",
+		serialBuilder.GetClusterCount(), serialBuilder.GetTilesX(), serialBuilder.GetTilesY(),
+		serialBuilder.GetSliceCount(), threadPool.GetWorkerCount());
+	std::printf("%8s %12s %12s %12s %10s\n", "lights", "indices", "serial ms", "parallel ms", "speedup");
+
+	for(std::uint32_t lightCount = 64; lightCount <= 8192; lightCount *= 2)
+	{
+		std::vector<BoundingSphere> lights = MakeLights(lightCount);
+
+		double serialMs = TimeBuild(serialBuilder, view, lights);
+		double parallelMs = TimeBuild(parallelBuilder, view, lights);
+
+		std::printf("%8u %12u %12.3f %12.3f %9.2fx\n", lightCount,
+			(std::uint32_t)parallelBuilder.GetLightIndices().size(),
+			serialMs, parallelMs, serialMs / std::max(parallelMs, 1e-6));
+	}
+
+	return 0;
+}
@@ -0,0 +1,468 @@
+//***************************************************************************************
+// CoreBenchmark.cpp
+//
+// Times the CPU hot paths of the samples without a window or a device, so it builds
+// with CMake on Linux as well (see CMakeLists.txt):
+//
+//     Waves::Update, GeometryGenerator::Create*, SkinnedData::GetFinalTransforms,
+//     M3DLoader::LoadM3d, LoadTextModel (SsaoApp::BuildSkullGeometry), CullInstances
+//     (InstancingAndCullingApp::UpdateInstanceData) and
+//     MathHelper::IntersectRayTriangles (PickingApp::Pick).
+//
+// Inputs come from fixed seeds and the models in the book's directories, so the
+// checksums only change when the results do.  The results are written as JSON for
+// tracking regressions:
+//
+//     CoreBenchmark [results.json [book directory]]
+//
+// With no arguments the JSON goes to stdout.  A result may carry a "note" on how it
+// was measured, e.g. that Waves::Update ran serially.
+//***************************************************************************************
+
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/MathHelper.h"
+#include "../../Common/TextModel.h"
+#include "../../Chapter 8 Lighting/LitWaves/Waves.h"
+#include "../../Chapter 16 Instancing and Frustum Culling/InstancingAndCulling/CoherentFrustumCuller.h"
+#include "../../Chapter 23 Character Animation/SkinnedMesh/LoadM3d.h"
+
+#include <DirectXCollision.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+#ifndef CORE_BENCHMARK_BOOK_DIR
+#define CORE_BENCHMARK_BOOK_DIR "../.."
+#endif
+
+namespace
+{
+	struct BenchmarkResult
+	{
+		std::string Name;
+		int Iterations = 0;
+		double MinMs = 0.0;
+		double MedianMs = 0.0;
+		double MeanMs = 0.0;
+
+		// Sum of what every iteration returned; the same on every run unless the
+		// results change.
+		double Checksum = 0.0;
+
+		// Anything that makes the timing not comparable across platforms.
+		std::string Note;
+	};
+
+	// Runs func once to warm up, then iterations times, timing each run.  func returns
+	// a value derived from its results, which keeps the work from being optimized away.
+	template<typename Func>
+	BenchmarkResult RunBenchmark(const std::string& name, int iterations, Func func)
+	{
+		BenchmarkResult result;
+		result.Name = name;
+		result.Iterations = iterations;
+
+		func();
+
+		std::vector<double> ms(iterations);
+		for(int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			result.Checksum += func();
+			auto end = std::chrono::steady_clock::now();
+
+			ms[i] = std::chrono::duration<double, std::milli>(end - start).count();
+		}
+
+		std::vector<double> sorted = ms;
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for(double t : ms)
+			total += t;
+
+		result.MinMs = sorted.front();
+		result.MedianMs = sorted[sorted.size() / 2];
+		result.MeanMs = total / iterations;
+
+		return result;
+	}
+
+	double MeshChecksum(const GeometryGenerator::MeshData& mesh)
+	{
+		double sum = double(mesh.Vertices.size() + mesh.Indices32.size());
+		for(const auto& v : mesh.Vertices)
+			sum += v.Position.x + v.Normal.y + v.TexC.x;
+
+		return sum;
+	}
+
+	void BenchmarkWaves(std::vector<BenchmarkResult>& results)
+	{
+		// LitWaves' constants on a bigger grid.
+		const float timeStep = 0.03f;
+		Waves waves(256, 256, 1.0f, timeStep, 4.0f, 0.2f);
+
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<int> row(4, waves.RowCount() - 5);
+		std::uniform_int_distribution<int> column(4, waves.ColumnCount() - 5);
+		std::uniform_real_distribution<float> magnitude(0.2f, 0.5f);
+
+		// One disturbance and one simulation step per iteration.
+		results.push_back(RunBenchmark("Waves::Update 256x256", 500, [&]()
+		{
+			waves.Disturb(row(rng), column(rng), magnitude(rng));
+			waves.Update(timeStep);
+
+			int center = (waves.RowCount() / 2) * waves.ColumnCount() + waves.ColumnCount() / 2;
+			return double(waves.Position(center).y + waves.Normal(center).x);
+		}));
+
+#if !defined(_WIN32)
+		// Waves spreads its rows over concurrency::parallel_for, which only Windows has.
+		results.back().Note = "rows updated serially; parallel only on Windows";
+#endif
+	}
+
+	void BenchmarkGeometryGenerator(std::vector<BenchmarkResult>& results)
+	{
+		GeometryGenerator geoGen;
+
+		// The shapes and sizes the demos use, plus a finer sphere and geosphere.
+		results.push_back(RunBenchmark("GeometryGenerator::CreateBox", 2000, [&]()
+		{
+			return MeshChecksum(geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateSphere 20x20", 2000, [&]()
+		{
+			return MeshChecksum(geoGen.CreateSphere(0.5f, 20, 20));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateSphere 128x128", 200, [&]()
+		{
+			return MeshChecksum(geoGen.CreateSphere(0.5f, 128, 128));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateGeosphere 3", 1000, [&]()
+		{
+			return MeshChecksum(geoGen.CreateGeosphere(0.5f, 3));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateGeosphere 5", 100, [&]()
+		{
+			return MeshChecksum(geoGen.CreateGeosphere(0.5f, 5));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateCylinder 20x20", 2000, [&]()
+		{
+			return MeshChecksum(geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateGrid 160x160", 200, [&]()
+		{
+			return MeshChecksum(geoGen.CreateGrid(160.0f, 160.0f, 160, 160));
+		}));
+		results.push_back(RunBenchmark("GeometryGenerator::CreateQuad", 10000, [&]()
+		{
+			return MeshChecksum(geoGen.CreateQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.0f));
+		}));
+	}
+
+	bool BenchmarkSkinnedMesh(const std::string& bookDir, std::vector<BenchmarkResult>& results)
+	{
+		const std::string filename = bookDir + "/Chapter 23 Character Animation/SkinnedMesh/Models/soldier.m3d";
+
+		std::vector<M3DLoader::SkinnedVertex> vertices;
+		std::vector<std::uint16_t> indices;
+		std::vector<M3DLoader::Subset> subsets;
+		std::vector<M3DLoader::M3dMaterial> mats;
+		SkinnedData skinInfo;
+
+		M3DLoader loader;
+		if(!loader.LoadM3d(filename, vertices, indices, subsets, mats, skinInfo) || skinInfo.BoneCount() == 0)
+		{
+			std::fprintf(stderr, "%s not found.\n", filename.c_str());
+			return false;
+		}
+
+		results.push_back(RunBenchmark("M3DLoader::LoadM3d soldier", 20, [&]()
+		{
+			std::vector<M3DLoader::SkinnedVertex> loadedVertices;
+			std::vector<std::uint16_t> loadedIndices;
+			std::vector<M3DLoader::Subset> loadedSubsets;
+			std::vector<M3DLoader::M3dMaterial> loadedMats;
+			SkinnedData loadedSkinInfo;
+
+			M3DLoader m3dLoader;
+			m3dLoader.LoadM3d(filename, loadedVertices, loadedIndices, loadedSubsets, loadedMats, loadedSkinInfo);
+
+			return double(loadedVertices.size() + loadedIndices.size() + loadedSkinInfo.BoneCount());
+		}));
+
+		// SkinnedMeshApp evaluates "Take1" once per frame; 100 evaluations spread over
+		// the clip make one iteration.
+		const std::string clipName = "Take1";
+		const float startTime = skinInfo.GetClipStartTime(clipName);
+		const float endTime = skinInfo.GetClipEndTime(clipName);
+		std::vector<XMFLOAT4X4> finalTransforms(skinInfo.BoneCount());
+
+		results.push_back(RunBenchmark("SkinnedData::GetFinalTransforms x100", 200, [&]()
+		{
+			double sum = 0.0;
+			for(int i = 0; i < 100; ++i)
+			{
+				float timePos = startTime + (endTime - startTime)*(i / 100.0f);
+				skinInfo.GetFinalTransforms(clipName, timePos, finalTransforms);
+
+				for(const auto& transform : finalTransforms)
+					sum += transform._11 + transform._41;
+			}
+			return sum;
+		}));
+
+		return true;
+	}
+
+	// CullInstances as InstancingAndCullingApp::UpdateInstanceData calls it, over the
+	// demo's grid of skulls with 16 instead of 5 per side, while the camera turns on
+	// the spot.  Every instance gets the exact test, then only those the
+	// CoherentFrustumCuller cannot answer do.
+	void BenchmarkFrustumCulling(const TextModel& skull, std::vector<BenchmarkResult>& results)
+	{
+		const int n = 16;
+		const std::uint32_t instanceCount = n*n*n;
+
+		std::vector<XMFLOAT4X4> worlds(instanceCount);
+
+		float width = 200.0f;
+		float height = 200.0f;
+		float depth = 200.0f;
+
+		float x = -0.5f*width;
+		float y = -0.5f*height;
+		float z = -0.5f*depth;
+		float dx = width / (n - 1);
+		float dy = height / (n - 1);
+		float dz = depth / (n - 1);
+		for(int k = 0; k < n; ++k)
+		{
+			for(int i = 0; i < n; ++i)
+			{
+				for(int j = 0; j < n; ++j)
+				{
+					int index = k*n*n + i*n + j;
+					worlds[index] = XMFLOAT4X4(
+						1.0f, 0.0f, 0.0f, 0.0f,
+						0.0f, 1.0f, 0.0f, 0.0f,
+						0.0f, 0.0f, 1.0f, 0.0f,
+						x + j*dx, y + i*dy, z + k*dz, 1.0f);
+				}
+			}
+		}
+
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, 800.0f / 600.0f, 1.0f, 1000.0f);
+
+		BoundingFrustum camFrustum;
+		BoundingFrustum::CreateFromMatrix(camFrustum, proj);
+
+		// Half a degree a frame, from the demo's starting position.
+		auto getView = [](int frame)
+		{
+			float yaw = XMConvertToRadians(0.5f*frame);
+			XMVECTOR pos = XMVectorSet(0.0f, 2.0f, -15.0f, 1.0f);
+			XMVECTOR look = XMVectorSet(sinf(yaw), 0.0f, cosf(yaw), 0.0f);
+			return XMMatrixLookToLH(pos, look, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		};
+
+		auto getWorld = [&](std::uint32_t i) -> const XMFLOAT4X4& { return worlds[i]; };
+
+		std::vector<std::uint32_t> visibleInstances;
+		visibleInstances.reserve(instanceCount);
+
+		int frame = 0;
+		results.push_back(RunBenchmark("UpdateInstanceData frustum loop 4096", 200, [&]()
+		{
+			XMMATRIX view = getView(frame++);
+			XMVECTOR viewDet = XMMatrixDeterminant(view);
+			XMMATRIX invView = XMMatrixInverse(&viewDet, view);
+
+			CullInstances(nullptr, camFrustum, invView, skull.Bounds, instanceCount, getWorld, visibleInstances);
+
+			return double(visibleInstances.size());
+		}));
+
+		BoundingSphere localSphere;
+		BoundingSphere::CreateFromBoundingBox(localSphere, skull.Bounds);
+
+		CoherentFrustumCuller culler;
+		culler.Reset(instanceCount);
+		for(std::uint32_t i = 0; i < instanceCount; ++i)
+		{
+			BoundingSphere worldSphere;
+			localSphere.Transform(worldSphere, XMLoadFloat4x4(&worlds[i]));
+			culler.SetInstanceBounds(i, worldSphere);
+		}
+
+		frame = 0;
+		results.push_back(RunBenchmark("UpdateInstanceData frustum loop 4096, coherent", 200, [&]()
+		{
+			XMMATRIX view = getView(frame++);
+			XMVECTOR viewDet = XMMatrixDeterminant(view);
+			XMMATRIX invView = XMMatrixInverse(&viewDet, view);
+
+			culler.BeginFrame(view, proj);
+			CullInstances(&culler, camFrustum, invView, skull.Bounds, instanceCount, getWorld, visibleInstances);
+
+			return double(visibleInstances.size());
+		}));
+	}
+
+	// PickingApp::Pick's ray/triangle test on the demo's car, for 64 fixed-seed clicks
+	// around the middle of an 800x600 client area.
+	void BenchmarkPicking(const TextModel& car, std::vector<BenchmarkResult>& results)
+	{
+		const float clientWidth = 800.0f;
+		const float clientHeight = 600.0f;
+
+		XMFLOAT4X4 P;
+		XMStoreFloat4x4(&P, XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, clientWidth / clientHeight, 1.0f, 1000.0f));
+
+		XMMATRIX V = XMMatrixLookAtLH(
+			XMVectorSet(5.0f, 4.0f, -15.0f, 1.0f),
+			XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f),
+			XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMVECTOR VDet = XMMatrixDeterminant(V);
+		XMMATRIX invView = XMMatrixInverse(&VDet, V);
+
+		XMMATRIX W = XMMatrixTranslation(0.0f, 1.0f, 0.0f);
+		XMVECTOR WDet = XMMatrixDeterminant(W);
+		XMMATRIX invWorld = XMMatrixInverse(&WDet, W);
+		XMMATRIX toLocal = XMMatrixMultiply(invView, invWorld);
+
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<int> sxDist(250, 550);
+		std::uniform_int_distribution<int> syDist(200, 400);
+
+		std::vector<XMFLOAT2> clicks(64);
+		for(auto& click : clicks)
+			click = XMFLOAT2((float)sxDist(rng), (float)syDist(rng));
+
+		const std::uint32_t triCount = (std::uint32_t)car.Indices.size() / 3;
+		const std::uint32_t* indices = (const std::uint32_t*)car.Indices.data();
+
+		results.push_back(RunBenchmark("PickingApp::Pick triangle loop x64", 100, [&]()
+		{
+			double sum = 0.0;
+			for(const auto& click : clicks)
+			{
+				// Compute picking ray in view space.
+				float vx = (+2.0f*click.x / clientWidth - 1.0f) / P(0, 0);
+				float vy = (-2.0f*click.y / clientHeight + 1.0f) / P(1, 1);
+
+				XMVECTOR rayOrigin = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+				XMVECTOR rayDir = XMVectorSet(vx, vy, 1.0f, 0.0f);
+
+				rayOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
+				rayDir = XMVector3TransformNormal(rayDir, toLocal);
+				rayDir = XMVector3Normalize(rayDir);
+
+				float tmin = 0.0f;
+				if(!car.Bounds.Intersects(rayOrigin, rayDir, tmin))
+					continue;
+
+				// Find the nearest ray/triangle intersection.
+				std::uint32_t pickedTriangle = 0;
+				if(MathHelper::IntersectRayTriangles(rayOrigin, rayDir, car.Vertices.data(),
+					sizeof(TextModelVertex), indices, triCount, pickedTriangle, tmin))
+					sum += pickedTriangle;
+			}
+			return sum;
+		}));
+	}
+
+	void WriteJson(std::ostream& out, const std::vector<BenchmarkResult>& results)
+	{
+		out << "{\n  \"benchmarks\": [";
+		const char* separator = "\n";
+		for(const auto& result : results)
+		{
+			char line[512];
+			std::snprintf(line, sizeof(line),
+				"    {\"name\": \"%s\", \"iterations\": %d, \"min_ms\": %.6f, \"median_ms\": %.6f, "
+				"\"mean_ms\": %.6f, \"checksum\": %.9g}",
+				result.Name.c_str(), result.Iterations, result.MinMs, result.MedianMs, result.MeanMs,
+				result.Checksum);
+
+			std::string entry = line;
+			if(!result.Note.empty())
+				entry.insert(entry.size() - 1, ", \"note\": \"" + result.Note + "\"");
+
+			out << separator << entry;
+			separator = ",\n";
+		}
+		out << "\n  ]\n}\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string bookDir = argc > 2 ? argv[2] : CORE_BENCHMARK_BOOK_DIR;
+
+	TextModel skull;
+	const std::string skullFilename = bookDir + "/Chapter 21 Ambient Occlusion/Ssao/Models/skull.txt";
+	if(!LoadTextModel(skullFilename, skull))
+	{
+		std::fprintf(stderr, "%s not found.\n", skullFilename.c_str());
+		return 1;
+	}
+
+	TextModel car;
+	const std::string carFilename = bookDir + "/Chapter 17 Picking/Picking/Models/car.txt";
+	if(!LoadTextModel(carFilename, car))
+	{
+		std::fprintf(stderr, "%s not found.\n", carFilename.c_str());
+		return 1;
+	}
+
+	std::vector<BenchmarkResult> results;
+
+	BenchmarkWaves(results);
+	BenchmarkGeometryGenerator(results);
+	if(!BenchmarkSkinnedMesh(bookDir, results))
+		return 1;
+
+	results.push_back(RunBenchmark("SsaoApp skull text parse", 20, [&]()
+	{
+		TextModel model;
+		LoadTextModel(skullFilename, model);
+		return double(model.Vertices.size() + model.Indices.size());
+	}));
+
+	BenchmarkFrustumCulling(skull, results);
+	BenchmarkPicking(car, results);
+
+	if(argc > 1)
+	{
+		std::ofstream file(argv[1], std::ios::trunc);
+		if(!file)
+		{
+			std::fprintf(stderr, "Could not write %s.\n", argv[1]);
+			return 1;
+		}
+		WriteJson(file, results);
+
+		for(const auto& result : results)
+		{
+			std::printf("%-48s %10.4f ms median %10.4f ms min\n", result.Name.c_str(),
+				result.MedianMs, result.MinMs);
+		}
+	}
+	else
+	{
+		WriteJson(std::cout, results);
+	}
+
+	return 0;
+}
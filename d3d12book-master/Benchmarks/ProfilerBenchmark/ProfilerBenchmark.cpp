@@ -0,0 +1,128 @@
+//***************************************************************************************
+// ProfilerBenchmark.cpp
+//
+// Measures what a PROFILE_SCOPE costs: with no capture running, while capturing on
+// one thread, and while capturing on one thread per core at once.  Two timestamp
+// reads are part of every recorded scope, so their cost is printed too, and so is
+// what a scope costs without them: the profiler's own work, which is what the 50 ns
+// budget is for.  Under a hypervisor that traps rdtsc the timestamps dominate.
+//***************************************************************************************
+
+#define PROFILER_ENABLED 1
+
+#include "../../Common/Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Below Profiler::EventsPerThread, so nothing is dropped.
+	const std::uint32_t ScopeCount = 50000;
+	const int Repeats = 20;
+
+	double TimeTimestamps()
+	{
+		std::uint64_t sum = 0;
+		auto start = std::chrono::steady_clock::now();
+		for(std::uint32_t i = 0; i < ScopeCount; ++i)
+			sum += Profiler::GetTimestamp();
+		auto end = std::chrono::steady_clock::now();
+
+		// Keeps the loop from being optimized away.
+		if(sum == 0)
+			std::printf(" ");
+
+		return std::chrono::duration<double, std::nano>(end - start).count() / ScopeCount;
+	}
+
+	void RunScopes()
+	{
+		for(std::uint32_t i = 0; i < ScopeCount; ++i)
+		{
+			PROFILE_SCOPE("Scope");
+		}
+	}
+
+	// Best nanoseconds per scope over Repeats runs of RunScopes on the calling thread.
+	double TimeScopes(bool capture)
+	{
+		double best = 1e30;
+		for(int i = 0; i < Repeats; ++i)
+		{
+			if(capture)
+				Profiler::BeginCapture();
+
+			auto start = std::chrono::steady_clock::now();
+			RunScopes();
+			auto end = std::chrono::steady_clock::now();
+
+			if(capture)
+				Profiler::EndCapture();
+
+			best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / ScopeCount);
+		}
+
+		return best;
+	}
+
+	// Nanoseconds per scope on the slowest of threadCount threads recording at the same
+	// time, averaged over Repeats runs.
+	double TimeParallelScopes(std::uint32_t threadCount)
+	{
+		double total = 0.0;
+		for(int i = 0; i < Repeats; ++i)
+		{
+			Profiler::BeginCapture();
+
+			std::vector<double> ns(threadCount);
+			std::vector<std::thread> threads;
+			for(std::uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&ns, t]()
+				{
+					auto start = std::chrono::steady_clock::now();
+					RunScopes();
+					auto end = std::chrono::steady_clock::now();
+					ns[t] = std::chrono::duration<double, std::nano>(end - start).count() / ScopeCount;
+				});
+			}
+			for(auto& thread : threads)
+				thread.join();
+
+			Profiler::EndCapture();
+
+			total += *std::max_element(ns.begin(), ns.end());
+		}
+
+		return total / Repeats;
+	}
+}
+
+int main()
+{
+	PROFILE_THREAD_NAME("Main");
+
+	std::uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	double timestampNs = TimeTimestamps();
+	double idleNs = TimeScopes(false);
+	double captureNs = TimeScopes(true);
+	double parallelNs = TimeParallelScopes(threadCount);
+
+	ProfilerStats stats = Profiler::GetStats();
+
+	std::printf("%u scopes per thread, %u threads\n\n", ScopeCount, threadCount);
+	std::printf("%-28s %8.1f ns\n", "timestamp", timestampNs);
+	std::printf("%-28s %8.1f ns\n", "scope, not capturing", idleNs);
+	std::printf("%-28s %8.1f ns\n", "scope, capturing", captureNs);
+	std::printf("%-28s %8.1f ns\n", "  less two timestamps", std::max(0.0, captureNs - 2.0*timestampNs));
+	std::printf("%-28s %8.1f ns\n\n", "scope, capturing on all", parallelNs);
+	std::printf("last capture: %u threads, %llu events, %llu dropped\n", stats.ThreadCount,
+		(unsigned long long)stats.EventCount, (unsigned long long)stats.DroppedCount);
+
+	return Profiler::SaveChromeTrace("ProfilerBenchmark.json") ? 0 : 1;
+}
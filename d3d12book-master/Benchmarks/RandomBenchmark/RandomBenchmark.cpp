@@ -0,0 +1,278 @@
+//***************************************************************************************
+// RandomBenchmark.cpp
+//
+// Compares Random with rand(), which MathHelper's Rand* functions used before: single
+// floats, batches of 8, unit and hemisphere vectors against the old rejection loops,
+// and every core drawing floats at once, where rand() shares its state between
+// threads (behind a lock in the Microsoft CRT).
+//***************************************************************************************
+
+#include "../../Common/MathHelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t Count = 1 << 20;
+	const int Repeats = 10;
+
+	// The sums keep the loops from being optimized away.
+	volatile float Sink;
+
+	float RandFloat()
+	{
+		return (float)(rand()) / (float)RAND_MAX;
+	}
+
+	// MathHelper::RandUnitVec3 and RandHemisphereUnitVec3 as they were.
+	XMVECTOR RandUnitVec3Rejection()
+	{
+		XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
+		while(true)
+		{
+			XMVECTOR v = XMVectorSet(-1.0f + 2.0f*RandFloat(), -1.0f + 2.0f*RandFloat(), -1.0f + 2.0f*RandFloat(), 0.0f);
+			if(XMVector3Greater(XMVector3LengthSq(v), One))
+				continue;
+
+			return XMVector3Normalize(v);
+		}
+	}
+
+	XMVECTOR RandHemisphereUnitVec3Rejection(FXMVECTOR n)
+	{
+		XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
+		XMVECTOR Zero = XMVectorZero();
+		while(true)
+		{
+			XMVECTOR v = XMVectorSet(-1.0f + 2.0f*RandFloat(), -1.0f + 2.0f*RandFloat(), -1.0f + 2.0f*RandFloat(), 0.0f);
+			if(XMVector3Greater(XMVector3LengthSq(v), One))
+				continue;
+			if(XMVector3Less(XMVector3Dot(n, v), Zero))
+				continue;
+
+			return XMVector3Normalize(v);
+		}
+	}
+
+	// Best nanoseconds per value over Repeats runs of f, which produces Count values.
+	template<typename F>
+	double Time(F f)
+	{
+		double best = 1e30;
+		for(int i = 0; i < Repeats; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			Sink = f();
+			auto end = std::chrono::steady_clock::now();
+
+			best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / Count);
+		}
+
+		return best;
+	}
+
+	// Nanoseconds per value on the slowest of threadCount threads running f at the same
+	// time, averaged over Repeats runs.
+	template<typename F>
+	double TimeParallel(std::uint32_t threadCount, F f)
+	{
+		double total = 0.0;
+		for(int i = 0; i < Repeats; ++i)
+		{
+			std::vector<double> ns(threadCount);
+			std::vector<std::thread> threads;
+			for(std::uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&ns, &f, t]()
+				{
+					auto start = std::chrono::steady_clock::now();
+					Sink = f();
+					auto end = std::chrono::steady_clock::now();
+					ns[t] = std::chrono::duration<double, std::nano>(end - start).count() / Count;
+				});
+			}
+			for(auto& thread : threads)
+				thread.join();
+
+			total += *std::max_element(ns.begin(), ns.end());
+		}
+
+		return total / Repeats;
+	}
+
+	void Print(const char* name, double ns, double baselineNs)
+	{
+		std::printf("%-32s %8.2f ns %8.1fx\n", name, ns, baselineNs / ns);
+	}
+}
+
+int main()
+{
+	std::uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	Random random;
+	XMVECTOR n = XMVector3Normalize(XMVectorSet(1.0f, 2.0f, 3.0f, 0.0f));
+
+	//
+	// Floats.
+	//
+
+	double randNs = Time([]()
+	{
+		float sum = 0.0f;
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum += RandFloat();
+		return sum;
+	});
+
+	double mtNs = Time([]()
+	{
+		static std::mt19937 engine;
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+		float sum = 0.0f;
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum += distribution(engine);
+		return sum;
+	});
+
+	double floatNs = Time([&random]()
+	{
+		float sum = 0.0f;
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum += random.NextFloat();
+		return sum;
+	});
+
+	double floatx8Ns = Time([&random]()
+	{
+		float sum = 0.0f;
+		float v[Random::BatchSize];
+		for(std::uint32_t i = 0; i < Count; i += Random::BatchSize)
+		{
+			random.NextFloatx8(v);
+			for(std::uint32_t j = 0; j < Random::BatchSize; ++j)
+				sum += v[j];
+		}
+		return sum;
+	});
+
+	double randFNs = Time([]()
+	{
+		float sum = 0.0f;
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum += MathHelper::RandF();
+		return sum;
+	});
+
+	//
+	// Unit vectors.
+	//
+
+	double unitRejectionNs = Time([]()
+	{
+		XMVECTOR sum = XMVectorZero();
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum = XMVectorAdd(sum, RandUnitVec3Rejection());
+		return XMVectorGetX(sum);
+	});
+
+	double unitNs = Time([&random]()
+	{
+		XMVECTOR sum = XMVectorZero();
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum = XMVectorAdd(sum, random.NextUnitVec3());
+		return XMVectorGetX(sum);
+	});
+
+	double unitx8Ns = Time([&random]()
+	{
+		float sum = 0.0f;
+		XMFLOAT3 v[Random::BatchSize];
+		for(std::uint32_t i = 0; i < Count; i += Random::BatchSize)
+		{
+			random.NextUnitVec3x8(v);
+			for(std::uint32_t j = 0; j < Random::BatchSize; ++j)
+				sum += v[j].x;
+		}
+		return sum;
+	});
+
+	double hemisphereRejectionNs = Time([n]()
+	{
+		XMVECTOR sum = XMVectorZero();
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum = XMVectorAdd(sum, RandHemisphereUnitVec3Rejection(n));
+		return XMVectorGetX(sum);
+	});
+
+	double hemisphereNs = Time([&random, n]()
+	{
+		XMVECTOR sum = XMVectorZero();
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum = XMVectorAdd(sum, random.NextHemisphereUnitVec3(n));
+		return XMVectorGetX(sum);
+	});
+
+	double hemispherex8Ns = Time([&random, n]()
+	{
+		float sum = 0.0f;
+		XMFLOAT3 v[Random::BatchSize];
+		for(std::uint32_t i = 0; i < Count; i += Random::BatchSize)
+		{
+			random.NextHemisphereUnitVec3x8(n, v);
+			for(std::uint32_t j = 0; j < Random::BatchSize; ++j)
+				sum += v[j].x;
+		}
+		return sum;
+	});
+
+	//
+	// All threads at once.
+	//
+
+	double randParallelNs = TimeParallel(threadCount, []()
+	{
+		float sum = 0.0f;
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum += RandFloat();
+		return sum;
+	});
+
+	double threadLocalParallelNs = TimeParallel(threadCount, []()
+	{
+		float sum = 0.0f;
+		for(std::uint32_t i = 0; i < Count; ++i)
+			sum += MathHelper::RandF();
+		return sum;
+	});
+
+	std::printf("%u values per run, %u threads\n\n", Count, threadCount);
+	std::printf("%-32s %11s %9s\n", "per float", "", "vs rand");
+	Print("rand()", randNs, randNs);
+	Print("std::mt19937", mtNs, randNs);
+	Print("Random::NextFloat", floatNs, randNs);
+	Print("Random::NextFloatx8", floatx8Ns, randNs);
+	Print("MathHelper::RandF", randFNs, randNs);
+	std::printf("\n%-32s %11s %9s\n", "per unit vector", "", "vs old");
+	Print("rejection, rand()", unitRejectionNs, unitRejectionNs);
+	Print("Random::NextUnitVec3", unitNs, unitRejectionNs);
+	Print("Random::NextUnitVec3x8", unitx8Ns, unitRejectionNs);
+	std::printf("\n%-32s %11s %9s\n", "per hemisphere vector", "", "vs old");
+	Print("rejection, rand()", hemisphereRejectionNs, hemisphereRejectionNs);
+	Print("Random::NextHemisphereUnitVec3", hemisphereNs, hemisphereRejectionNs);
+	Print("Random::NextHemisphereUnitVec3x8", hemispherex8Ns, hemisphereRejectionNs);
+	std::printf("\n%-32s %11s %9s\n", "per float, all threads", "", "vs rand");
+	Print("rand()", randParallelNs, randParallelNs);
+	Print("MathHelper::RandF", threadLocalParallelNs, randParallelNs);
+
+	return 0;
+}
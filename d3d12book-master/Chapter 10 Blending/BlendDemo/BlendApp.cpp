@@ -134,6 +134,7 @@ private:
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
 	std::unique_ptr<Waves> mWaves;
+	std::vector<Vertex> mWavesVertices;
 
     PassConstants mMainPassCB;
 
@@ -239,13 +240,7 @@ void BlendApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
@@ -514,11 +509,12 @@ void BlendApp::UpdateWaves(const GameTimer& gt)
 	// Update the wave simulation.
 	mWaves->Update(gt.DeltaTime());
 
-	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	// Update the wave vertex buffer with the new solution.  The vertices are built in
+	// system memory and streamed to the upload buffer in one copy.
+	mWavesVertices.resize(mWaves->VertexCount());
 	for(int i = 0; i < mWaves->VertexCount(); ++i)
 	{
-		Vertex v;
+		Vertex& v = mWavesVertices[i];
 
 		v.Pos = mWaves->Position(i);
 		v.Normal = mWaves->Normal(i);
@@ -527,10 +523,11 @@ void BlendApp::UpdateWaves(const GameTimer& gt)
 		// mapping [-w/2,w/2] --> [0,1]
 		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
 		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
-
-		currWavesVB->CopyData(i, v);
 	}
 
+	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	currWavesVB->CopyData(0, mWavesVertices.data(), (UINT)mWavesVertices.size());
+
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
@@ -6,6 +6,8 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/ResourceStateTracker.h"
+#include "../../Common/StateTrackedCommandList.h"
 #include "FrameResource.h"
 #include "Waves.h"
 #include "BlurFilter.h"
@@ -80,6 +82,8 @@ private:
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
 
+    void RegisterResourceStates();
+
     void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
@@ -137,9 +141,15 @@ private:
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
 	std::unique_ptr<Waves> mWaves;
+	std::vector<Vertex> mWavesVertices;
 
 	std::unique_ptr<BlurFilter> mBlurFilter;
 
+	// Tracks the back buffers and blur maps across frames, so Draw only names the
+	// state each one is needed in.
+	ResourceStateTracker mStateTracker;
+	StateTrackedCommandList mTrackedCommandList{ mStateTracker };
+
     PassConstants mMainPassCB;
 
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
@@ -225,6 +235,8 @@ bool BlurApp::Initialize()
     // Wait until initialization is complete.
     FlushCommandQueue();
 
+	RegisterResourceStates();
+
     return true;
 }
  
@@ -239,9 +251,22 @@ void BlurApp::OnResize()
 	if(mBlurFilter != nullptr)
 	{
 		mBlurFilter->OnResize(mClientWidth, mClientHeight);
+		RegisterResourceStates();
 	}
 }
 
+void BlurApp::RegisterResourceStates()
+{
+	// The swap chain buffers and blur maps were just (re)created, so whatever was
+	// tracked before refers to released resources.
+	mStateTracker.Clear();
+
+	for(int i = 0; i < SwapChainBufferCount; ++i)
+		mStateTracker.Register(mSwapChainBuffer[i].Get(), 1, D3D12_RESOURCE_STATE_PRESENT);
+
+	mBlurFilter->RegisterStates(mStateTracker);
+}
+
 void BlurApp::Update(const GameTimer& gt)
 {
     OnKeyboardInput(gt);
@@ -253,13 +278,7 @@ void BlurApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
@@ -283,13 +302,14 @@ void BlurApp::Draw(const GameTimer& gt)
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
+	mTrackedCommandList.SetCommandList(mCommandList.Get());
+
     // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	mTrackedCommandList.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET);
 
     // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
-    mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    mTrackedCommandList.ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor);
+    mTrackedCommandList.ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0);
 
     // Specify the buffers we are going to render to.
     mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
@@ -310,18 +330,18 @@ void BlurApp::Draw(const GameTimer& gt)
 	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
 	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
 
-	mBlurFilter->Execute(mCommandList.Get(), mPostProcessRootSignature.Get(), 
+	mBlurFilter->Execute(mTrackedCommandList, mPostProcessRootSignature.Get(), 
 		mPSOs["horzBlur"].Get(), mPSOs["vertBlur"].Get(), CurrentBackBuffer(), 4);
 
 	// Prepare to copy blurred output to the back buffer.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+	mTrackedCommandList.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_COPY_DEST);
+	mTrackedCommandList.Transition(mBlurFilter->Output(), D3D12_RESOURCE_STATE_COPY_SOURCE);
 
-	mCommandList->CopyResource(CurrentBackBuffer(), mBlurFilter->Output());
+	mTrackedCommandList.CopyResource(CurrentBackBuffer(), mBlurFilter->Output());
 
     // Transition to PRESENT state.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PRESENT));
+	mTrackedCommandList.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT);
+	mTrackedCommandList.FlushBarriers();
 
     // Done recording commands.
     ThrowIfFailed(mCommandList->Close());
@@ -536,11 +556,12 @@ void BlurApp::UpdateWaves(const GameTimer& gt)
 	// Update the wave simulation.
 	mWaves->Update(gt.DeltaTime());
 
-	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	// Update the wave vertex buffer with the new solution.  The vertices are built in
+	// system memory and streamed to the upload buffer in one copy.
+	mWavesVertices.resize(mWaves->VertexCount());
 	for(int i = 0; i < mWaves->VertexCount(); ++i)
 	{
-		Vertex v;
+		Vertex& v = mWavesVertices[i];
 
 		v.Pos = mWaves->Position(i);
 		v.Normal = mWaves->Normal(i);
@@ -549,10 +570,11 @@ void BlurApp::UpdateWaves(const GameTimer& gt)
 		// mapping [-w/2,w/2] --> [0,1]
 		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
 		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
-
-		currWavesVB->CopyData(i, v);
 	}
 
+	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	currWavesVB->CopyData(0, mWavesVertices.data(), (UINT)mWavesVertices.size());
+
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
@@ -54,7 +54,13 @@ void BlurFilter::OnResize(UINT newWidth, UINT newHeight)
 	}
 }
  
-void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList, 
+void BlurFilter::RegisterStates(ResourceStateTracker& tracker)
+{
+	tracker.Register(mBlurMap0.Get(), 1, D3D12_RESOURCE_STATE_COMMON);
+	tracker.Register(mBlurMap1.Get(), 1, D3D12_RESOURCE_STATE_COMMON);
+}
+
+void BlurFilter::Execute(StateTrackedCommandList& cmdList, 
 	                     ID3D12RootSignature* rootSig,
 	                     ID3D12PipelineState* horzBlurPSO,
 	                     ID3D12PipelineState* vertBlurPSO,
@@ -69,20 +75,14 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
 	cmdList->SetComputeRoot32BitConstants(0, 1, &blurRadius, 0);
 	cmdList->SetComputeRoot32BitConstants(0, (UINT)weights.size(), weights.data(), 1);
 
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(input,
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE));
-
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	cmdList.Transition(input, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	cmdList.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
 
 	// Copy the input (back-buffer in this example) to BlurMap0.
-	cmdList->CopyResource(mBlurMap0.Get(), input);
+	cmdList.CopyResource(mBlurMap0.Get(), input);
 	
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
-
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap1.Get(),
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	cmdList.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+	cmdList.Transition(mBlurMap1.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
  
 	for(int i = 0; i < blurCount; ++i)
 	{
@@ -98,13 +98,10 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
 		// How many groups do we need to dispatch to cover a row of pixels, where each
 		// group covers 256 pixels (the 256 is defined in the ComputeShader).
 		UINT numGroupsX = (UINT)ceilf(mWidth / 256.0f);
-		cmdList->Dispatch(numGroupsX, mHeight, 1);
-
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		cmdList.Dispatch(numGroupsX, mHeight, 1);
 
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap1.Get(),
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_GENERIC_READ));
+		cmdList.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		cmdList.Transition(mBlurMap1.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
 
 		//
 		// Vertical Blur pass.
@@ -118,14 +115,14 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
 		// How many groups do we need to dispatch to cover a column of pixels, where each
 		// group covers 256 pixels  (the 256 is defined in the ComputeShader).
 		UINT numGroupsY = (UINT)ceilf(mHeight / 256.0f);
-		cmdList->Dispatch(mWidth, numGroupsY, 1);
+		cmdList.Dispatch(mWidth, numGroupsY, 1);
 
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_GENERIC_READ));
-
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap1.Get(),
-			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		cmdList.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+		cmdList.Transition(mBlurMap1.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 	}
+
+	// The last pair of transitions is only recorded; it is issued (or cancelled) with
+	// whatever the caller does with the blur maps next.
 }
  
 std::vector<float> BlurFilter::CalcGaussWeights(float sigma)
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "../../Common/d3dUtil.h"
+#include "../../Common/StateTrackedCommandList.h"
 
 class BlurFilter
 {
@@ -33,10 +34,16 @@ public:
 	void OnResize(UINT newWidth, UINT newHeight);
 
 	///<summary>
-	/// Blurs the input texture blurCount times.
+	/// Registers the blur maps with tracker.  Call again after OnResize.
+	///</summary>
+	void RegisterStates(ResourceStateTracker& tracker);
+
+	///<summary>
+	/// Blurs the input texture blurCount times.  The input must be registered with
+	/// the tracker cmdList records through; it is left in COPY_SOURCE.
 	///</summary>
 	void Execute(
-		ID3D12GraphicsCommandList* cmdList, 
+		StateTrackedCommandList& cmdList, 
 		ID3D12RootSignature* rootSig,
 		ID3D12PipelineState* horzBlurPSO,
 		ID3D12PipelineState* vertBlurPSO,
@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/DirtySet.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -32,11 +33,8 @@ struct RenderItem
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
+	// After changing World or TexTransform, mark ObjCBIndex in the app's object DirtySet
+	// so that every frame resource gets the update.
 
 	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
 	UINT ObjCBIndex = -1;
@@ -117,6 +115,16 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mOpaqueRitems;
 
+	// Materials by MatCBIndex.
+	std::vector<Material*> mMaterialsByIndex;
+
+	// Which object constants and materials each frame resource still has to update,
+	// and the system memory copies written to the upload buffers range by range.
+	std::unique_ptr<DirtySet> mObjectDirtySet;
+	std::unique_ptr<DirtySet> mMaterialDirtySet;
+	std::vector<ObjectConstants> mObjectStaging;
+	std::vector<MaterialData> mMaterialStaging;
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -210,13 +218,7 @@ void CameraAndDynamicIndexingApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
@@ -350,52 +352,52 @@ void CameraAndDynamicIndexingApp::AnimateMaterials(const GameTimer& gt)
 void CameraAndDynamicIndexingApp::UpdateObjectCBs(const GameTimer& gt)
 {
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for(auto& e : mAllRitems)
+
+	// Only update the cbuffer data of the objects that changed since this frame
+	// resource was last updated, one contiguous range at a time.
+	for(const DirtyRange& range : mObjectDirtySet->CollectDirtyRanges(mCurrFrameResourceIndex))
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
+		mObjectStaging.resize(range.Count);
+		for(UINT i = 0; i < range.Count; ++i)
 		{
+			const RenderItem* e = mAllRitems[range.First + i].get();
+
 			XMMATRIX world = XMLoadFloat4x4(&e->World);
 			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
 
-			ObjectConstants objConstants;
+			ObjectConstants& objConstants = mObjectStaging[i];
 			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
 			objConstants.MaterialIndex = e->Mat->MatCBIndex;
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
 		}
+
+		currObjectCB->CopyData(range.First, mObjectStaging.data(), range.Count);
 	}
 }
 
 void CameraAndDynamicIndexingApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
-	for(auto& e : mMaterials)
+
+	// Materials are tracked by mMaterialDirtySet instead of Material::NumFramesDirty.
+	for(const DirtyRange& range : mMaterialDirtySet->CollectDirtyRanges(mCurrFrameResourceIndex))
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
+		mMaterialStaging.resize(range.Count);
+		for(UINT i = 0; i < range.Count; ++i)
 		{
+			const Material* mat = mMaterialsByIndex[range.First + i];
+
 			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
 
-			MaterialData matData;
+			MaterialData& matData = mMaterialStaging[i];
 			matData.DiffuseAlbedo = mat->DiffuseAlbedo;
 			matData.FresnelR0 = mat->FresnelR0;
 			matData.Roughness = mat->Roughness;
 			XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
 			matData.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
-
-			currMaterialBuffer->CopyData(mat->MatCBIndex, matData);
-
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
 		}
+
+		currMaterialBuffer->CopyData(range.First, mMaterialStaging.data(), range.Count);
 	}
 }
 
@@ -746,6 +748,10 @@ void CameraAndDynamicIndexingApp::BuildFrameResources()
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
             1, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
     }
+
+    // Everything starts out dirty in every frame resource.
+    mObjectDirtySet = std::make_unique<DirtySet>((UINT)mAllRitems.size(), gNumFrameResources);
+    mMaterialDirtySet = std::make_unique<DirtySet>((UINT)mMaterials.size(), gNumFrameResources);
 }
 
 void CameraAndDynamicIndexingApp::BuildMaterials()
@@ -786,6 +792,10 @@ void CameraAndDynamicIndexingApp::BuildMaterials()
 	mMaterials["stone0"] = std::move(stone0);
 	mMaterials["tile0"] = std::move(tile0);
 	mMaterials["crate0"] = std::move(crate0);
+
+	mMaterialsByIndex.resize(mMaterials.size());
+	for(auto& e : mMaterials)
+		mMaterialsByIndex[e.second->MatCBIndex] = e.second.get();
 }
 
 void CameraAndDynamicIndexingApp::BuildRenderItems()
@@ -0,0 +1,164 @@
+//***************************************************************************************
+// CoherentFrustumCuller.cpp
+//***************************************************************************************
+
+#include "CoherentFrustumCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+void CoherentFrustumCuller::Reset(std::uint32_t instanceCount)
+{
+	mInstances.assign(instanceCount, InstanceState());
+	mStats = CoherentCullingStats();
+}
+
+void CoherentFrustumCuller::Invalidate()
+{
+	for(auto& instance : mInstances)
+		instance.Result = Classification::Unknown;
+}
+
+void CoherentFrustumCuller::SetInstanceBounds(std::uint32_t index, const BoundingSphere& worldSphere)
+{
+	mInstances[index].Sphere = worldSphere;
+	mInstances[index].Result = Classification::Unknown;
+}
+
+std::uint32_t CoherentFrustumCuller::GetInstanceCount()const
+{
+	return (std::uint32_t)mInstances.size();
+}
+
+const CoherentCullingStats& CoherentFrustumCuller::GetStats()const
+{
+	return mStats;
+}
+
+void CoherentFrustumCuller::BeginFrame(FXMMATRIX view, CXMMATRIX proj)
+{
+	++mFrame;
+	mStats = CoherentCullingStats();
+
+	XMVECTOR det = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&det, view);
+
+	// Bound the camera motion since last frame.  A translation moves every plane by at
+	// most its length; a rotation by angle a moves a point at distance d from the eye
+	// by at most d*a relative to the planes.
+	if(mHasPrevView)
+	{
+		XMMATRIX prevInvView = XMLoadFloat4x4(&mPrevInvView);
+
+		mTranslation += XMVectorGetX(XMVector3Length(XMVectorSubtract(invView.r[3], prevInvView.r[3])));
+
+		// Angle of the relative rotation from the trace of prevBasis^T * currBasis.
+		float trace =
+			XMVectorGetX(XMVector3Dot(invView.r[0], prevInvView.r[0])) +
+			XMVectorGetX(XMVector3Dot(invView.r[1], prevInvView.r[1])) +
+			XMVectorGetX(XMVector3Dot(invView.r[2], prevInvView.r[2]));
+		float cosAngle = std::max(-1.0f, std::min(1.0f, 0.5f*(trace - 1.0f)));
+
+		mRotation += std::acos(cosAngle);
+	}
+
+	XMStoreFloat4x4(&mPrevInvView, invView);
+	XMStoreFloat3(&mEyePos, invView.r[3]);
+	mHasPrevView = true;
+
+	// Planes of the view-projection frustum (Gribb/Hartmann); the clip space z range
+	// is [0, w] in Direct3D.
+	XMMATRIX T = XMMatrixTranspose(XMMatrixMultiply(view, proj));
+
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(T.r[3], T.r[0]),      // left
+		XMVectorSubtract(T.r[3], T.r[0]), // right
+		XMVectorAdd(T.r[3], T.r[1]),      // bottom
+		XMVectorSubtract(T.r[3], T.r[1]), // top
+		T.r[2],                           // near
+		XMVectorSubtract(T.r[3], T.r[2])  // far
+	};
+
+	for(int i = 0; i < 6; ++i)
+		XMStoreFloat4(&mPlanes[i], XMPlaneNormalize(planes[i]));
+}
+
+CoherentFrustumCuller::Classification CoherentFrustumCuller::Classify(std::uint32_t index)
+{
+	InstanceState& s = mInstances[index];
+
+	if(s.Result == Classification::Inside || s.Result == Classification::Outside)
+	{
+		double dT = mTranslation - s.TranslationAtTest;
+		double dR = mRotation - s.RotationAtTest;
+		double slack = dT + (s.EyeDistance + dT + s.Sphere.Radius)*dR;
+
+		if(slack < s.Margin && mFrame - s.FrameAtTest < MaxSkipFrames)
+		{
+			++mStats.Skipped;
+			return s.Result;
+		}
+	}
+
+	++mStats.Tested;
+
+	XMVECTOR center = XMLoadFloat3(&s.Sphere.Center);
+	center = XMVectorSetW(center, 1.0f);
+
+	// Smallest distance the sphere is inside any plane, and largest distance it is
+	// outside any plane.
+	float minInside = FLT_MAX;
+	float maxOutside = -FLT_MAX;
+	for(int i = 0; i < 6; ++i)
+	{
+		float d = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&mPlanes[i]), center));
+		minInside = std::min(minInside, d - s.Sphere.Radius);
+		maxOutside = std::max(maxOutside, -d - s.Sphere.Radius);
+	}
+
+	if(maxOutside > 0.0f)
+	{
+		s.Result = Classification::Outside;
+		s.Margin = maxOutside;
+	}
+	else if(minInside >= 0.0f)
+	{
+		s.Result = Classification::Inside;
+		s.Margin = minInside;
+	}
+	else
+	{
+		s.Result = Classification::Intersecting;
+		s.Margin = 0.0f;
+	}
+
+	s.EyeDistance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&mEyePos))));
+	s.TranslationAtTest = mTranslation;
+	s.RotationAtTest = mRotation;
+	s.FrameAtTest = mFrame;
+
+	return s.Result;
+}
+
+bool IsInstanceInFrustum(const BoundingFrustum& viewFrustum, FXMMATRIX invView,
+	const XMFLOAT4X4& world, const BoundingBox& localBounds)
+{
+	XMMATRIX W = XMLoadFloat4x4(&world);
+
+	XMVECTOR worldDet = XMMatrixDeterminant(W);
+	XMMATRIX invWorld = XMMatrixInverse(&worldDet, W);
+
+	// View space to the object's local space.
+	XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
+
+	// Transform the camera frustum from view space to the object's local space.
+	BoundingFrustum localSpaceFrustum;
+	viewFrustum.Transform(localSpaceFrustum, viewToLocal);
+
+	// Perform the box/frustum intersection test in local space.
+	return localSpaceFrustum.Contains(localBounds) != DirectX::DISJOINT;
+}
@@ -0,0 +1,148 @@
+//***************************************************************************************
+// CoherentFrustumCuller.h
+//
+// Temporal coherence layer for per-instance frustum culling.  Each instance keeps the
+// result of its last test together with the distance (margin) by which its bounding
+// sphere was inside or outside the frustum.  The camera motion since that test is
+// accumulated as an upper bound on how far the frustum planes could have moved past
+// the sphere; while that bound stays below the margin the cached result is reused.
+// Only instances straddling a plane, or whose margin has been used up, are re-tested.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+struct CoherentCullingStats
+{
+	std::uint32_t Tested = 0;   // Instances whose sphere was tested against the planes this frame.
+	std::uint32_t Skipped = 0;  // Instances answered from the previous result.
+	std::uint32_t Visible = 0;
+};
+
+class CoherentFrustumCuller
+{
+public:
+	// Cached results are re-tested at least this often, even if the margin is left.
+	static const std::uint32_t MaxSkipFrames = 8;
+
+	CoherentFrustumCuller() = default;
+	CoherentFrustumCuller(const CoherentFrustumCuller& rhs) = delete;
+	CoherentFrustumCuller& operator=(const CoherentFrustumCuller& rhs) = delete;
+	~CoherentFrustumCuller() = default;
+
+	// Sizes the cache and forgets every previous result.
+	void Reset(std::uint32_t instanceCount);
+
+	// Forgets the previous results, e.g. after the projection changed.
+	void Invalidate();
+
+	// World space bounding sphere of an instance.  Call again whenever the instance moves.
+	void SetInstanceBounds(std::uint32_t index, const DirectX::BoundingSphere& worldSphere);
+
+	std::uint32_t GetInstanceCount()const;
+
+	// Extracts the world space frustum planes and accumulates the camera motion
+	// since the previous frame.
+	void BeginFrame(DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj);
+
+	// Returns whether instance index is visible.  exactTest() is only invoked for
+	// instances whose sphere straddles a frustum plane; it should run the precise
+	// bounds test and return true if the instance is visible.
+	template<typename ExactTest>
+	bool IsVisible(std::uint32_t index, ExactTest&& exactTest)
+	{
+		Classification c = Classify(index);
+
+		bool visible = c == Classification::Inside ||
+			(c == Classification::Intersecting && exactTest());
+
+		if(visible)
+			++mStats.Visible;
+
+		return visible;
+	}
+
+	const CoherentCullingStats& GetStats()const;
+
+private:
+	enum class Classification : std::uint8_t
+	{
+		Unknown,
+		Inside,
+		Outside,
+		Intersecting
+	};
+
+	struct InstanceState
+	{
+		DirectX::BoundingSphere Sphere;
+		Classification Result = Classification::Unknown;
+
+		// Distance the sphere was inside (or outside) every (or some) plane at test time.
+		float Margin = 0.0f;
+
+		// Eye to sphere center distance at test time, for the rotation bound.
+		float EyeDistance = 0.0f;
+
+		// Accumulated camera motion when the test was done.
+		double TranslationAtTest = 0.0;
+		double RotationAtTest = 0.0;
+		std::uint32_t FrameAtTest = 0;
+	};
+
+	Classification Classify(std::uint32_t index);
+
+private:
+	std::vector<InstanceState> mInstances;
+
+	// Frustum planes in world space with normals pointing inside.
+	DirectX::XMFLOAT4 mPlanes[6];
+
+	DirectX::XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4X4 mPrevInvView;
+	bool mHasPrevView = false;
+
+	// Sum of eye translation lengths and rotation angles (radians) over all frames.
+	// Kept in double so the differences stay precise over long sessions.
+	double mTranslation = 0.0;
+	double mRotation = 0.0;
+	std::uint32_t mFrame = 0;
+
+	CoherentCullingStats mStats;
+};
+
+// The exact test of InstancingAndCullingApp::UpdateInstanceData: the camera frustum
+// (viewFrustum, in view space) is taken to the instance's local space through invView
+// and the inverse of world, and tested against localBounds there.
+bool IsInstanceInFrustum(const DirectX::BoundingFrustum& viewFrustum, DirectX::FXMMATRIX invView,
+	const DirectX::XMFLOAT4X4& world, const DirectX::BoundingBox& localBounds);
+
+// UpdateInstanceData's culling loop: visibleInstances gets the indices of the visible
+// ones of count instances sharing localBounds.  getWorld(i) returns instance i's world
+// matrix.  culler, if not null, has begun the frame and answers what it can; without
+// it every instance gets the exact test.
+template<typename GetWorld>
+void CullInstances(CoherentFrustumCuller* culler, const DirectX::BoundingFrustum& viewFrustum,
+	DirectX::FXMMATRIX invView, const DirectX::BoundingBox& localBounds, std::uint32_t count,
+	GetWorld&& getWorld, std::vector<std::uint32_t>& visibleInstances)
+{
+	visibleInstances.clear();
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		auto exactTest = [&]()
+		{
+			return IsInstanceInFrustum(viewFrustum, invView, getWorld(i), localBounds);
+		};
+
+		// Only instances near a frustum plane get the exact box test; the others reuse
+		// their last result until the camera has moved far enough.
+		bool visible = culler != nullptr ? culler->IsVisible(i, exactTest) : exactTest();
+		if(visible)
+			visibleInstances.push_back(i);
+	}
+}
@@ -7,7 +7,10 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/ThreadPool.h"
 #include "FrameResource.h"
+#include "CoherentFrustumCuller.h"
+#include "OcclusionCuller.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -18,6 +21,11 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// The closest gMaxOccluders frustum visible skulls are rasterized as boxes scaled by
+// gOccluderBoxScale, which keeps the box inside the skull mesh.
+const UINT gMaxOccluders = 16;
+const float gOccluderBoxScale = 0.5f;
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -50,6 +58,9 @@ struct RenderItem
 	BoundingBox Bounds;
 	std::vector<InstanceData> Instances;
 
+	// Frustum culling results of the instances, reused while the camera moves little.
+	CoherentFrustumCuller FrustumCache;
+
     // DrawIndexedInstanced parameters.
     UINT IndexCount = 0;
 	UINT InstanceCount = 0;
@@ -79,6 +90,7 @@ private:
     void OnKeyboardInput(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateInstanceData(const GameTimer& gt);
+	void CullOccludedInstances(const RenderItem* ri, DirectX::FXMMATRIX viewProj, DirectX::FXMVECTOR eyePos);
 	void UpdateMaterialBuffer(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 
@@ -124,9 +136,19 @@ private:
 	UINT mInstanceCount = 0;
 
 	bool mFrustumCullingEnabled = true;
+	bool mOcclusionCullingEnabled = true;
 
 	BoundingFrustum mCamFrustum;
 
+	std::unique_ptr<ThreadPool> mThreadPool;
+	std::unique_ptr<OcclusionCuller> mOcclusionCuller;
+
+	// Per frame scratch: indices of the instances that survived culling so far.
+	std::vector<UINT> mVisibleInstances;
+	std::vector<UINT> mOccluderInstances;
+	std::vector<XMFLOAT4X4> mCandidateWorlds;
+	std::vector<std::uint8_t> mCandidateVisible;
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -181,6 +203,9 @@ bool InstancingAndCullingApp::Initialize()
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 	mCamera.SetPosition(0.0f, 2.0f, -15.0f);
+
+	mThreadPool = std::make_unique<ThreadPool>();
+	mOcclusionCuller = std::make_unique<OcclusionCuller>(mThreadPool.get());
  
 	LoadTextures();
     BuildRootSignature();
@@ -210,6 +235,10 @@ void InstancingAndCullingApp::OnResize()
 	mCamera.SetLens(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
 
 	BoundingFrustum::CreateFromMatrix(mCamFrustum, mCamera.GetProj());
+
+	// Cached culling results are relative to the old projection.
+	for(auto& e : mAllRitems)
+		e->FrustumCache.Invalidate();
 }
 
 void InstancingAndCullingApp::Update(const GameTimer& gt)
@@ -222,13 +251,7 @@ void InstancingAndCullingApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateInstanceData(gt);
@@ -355,6 +378,12 @@ void InstancingAndCullingApp::OnKeyboardInput(const GameTimer& gt)
 	if(GetAsyncKeyState('2') & 0x8000)
 		mFrustumCullingEnabled = false;
 
+	if(GetAsyncKeyState('3') & 0x8000)
+		mOcclusionCullingEnabled = true;
+
+	if(GetAsyncKeyState('4') & 0x8000)
+		mOcclusionCullingEnabled = false;
+
 	mCamera.UpdateViewMatrix();
 }
  
@@ -365,56 +394,130 @@ void InstancingAndCullingApp::AnimateMaterials(const GameTimer& gt)
 
 void InstancingAndCullingApp::UpdateInstanceData(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+	XMMATRIX proj = mCamera.GetProj();
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
 
 	auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer.get();
 	for(auto& e : mAllRitems)
 	{
 		const auto& instanceData = e->Instances;
+		auto& frustumCache = e->FrustumCache;
 
-		int visibleInstanceCount = 0;
+		if(mFrustumCullingEnabled)
+		{
+			frustumCache.BeginFrame(view, proj);
 
-		for(UINT i = 0; i < (UINT)instanceData.size(); ++i)
+			// Shared with CoreBenchmark, which times this loop.
+			CullInstances(&frustumCache, mCamFrustum, invView, e->Bounds, (UINT)instanceData.size(),
+				[&](UINT i) -> const XMFLOAT4X4& { return instanceData[i].World; }, mVisibleInstances);
+		}
+		else
 		{
-			XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
+			mVisibleInstances.clear();
+			for(UINT i = 0; i < (UINT)instanceData.size(); ++i)
+				mVisibleInstances.push_back(i);
 
-			XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
+			// The camera motion is not tracked while culling is off.
+			frustumCache.Invalidate();
+		}
 
-			// View space to the object's local space.
-			XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
- 
-			// Transform the camera frustum from view space to the object's local space.
-			BoundingFrustum localSpaceFrustum;
-			mCamFrustum.Transform(localSpaceFrustum, viewToLocal);
+		UINT frustumVisibleCount = (UINT)mVisibleInstances.size();
 
-			// Perform the box/frustum intersection test in local space.
-			if((localSpaceFrustum.Contains(e->Bounds) != DirectX::DISJOINT) || (mFrustumCullingEnabled==false))
-			{
-				InstanceData data;
-				XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
-				XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
-				data.MaterialIndex = instanceData[i].MaterialIndex;
+		// Drop the instances hidden behind the closest ones.
+		if(mOcclusionCullingEnabled && !mVisibleInstances.empty())
+			CullOccludedInstances(e.get(), viewProj, mCamera.GetPosition());
 
-				// Write the instance data to structured buffer for the visible objects.
-				currInstanceBuffer->CopyData(visibleInstanceCount++, data);
-			}
+		// Write the instance data to structured buffer for the visible objects, directly
+		// into the mapped buffer instead of through a temporary.
+		auto cursor = currInstanceBuffer->GetWriteCursor(0);
+
+		for(UINT i : mVisibleInstances)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
+
+			InstanceData* data = cursor.Next();
+			XMStoreFloat4x4(&data->World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&data->TexTransform, XMMatrixTranspose(texTransform));
+			data->MaterialIndex = instanceData[i].MaterialIndex;
 		}
 
-		e->InstanceCount = visibleInstanceCount;
+		e->InstanceCount = (UINT)mVisibleInstances.size();
 
 		std::wostringstream outs;
 		outs.precision(6);
 		outs << L"Instancing and Culling Demo" <<
 			L"    " << e->InstanceCount <<
-			L" objects visible out of " << e->Instances.size();
+			L" objects visible out of " << e->Instances.size() <<
+			L"    " << (frustumVisibleCount - e->InstanceCount) << L" occluded";
+
+		if(mFrustumCullingEnabled)
+		{
+			const auto& stats = frustumCache.GetStats();
+			outs << L"    frustum tested: " << stats.Tested <<
+				L" skipped: " << stats.Skipped <<
+				L" visible: " << stats.Visible;
+		}
+
 		mMainWndCaption = outs.str();
 	}
 }
 
+void InstancingAndCullingApp::CullOccludedInstances(const RenderItem* ri, FXMMATRIX viewProj, FXMVECTOR eyePos)
+{
+	const auto& instanceData = ri->Instances;
+
+	auto distanceSq = [&](UINT i)
+	{
+		XMVECTOR pos = XMVectorSet(instanceData[i].World._41, instanceData[i].World._42, instanceData[i].World._43, 1.0f);
+		return XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(pos, eyePos)));
+	};
+
+	// The closest instances cover the most screen area, so they make the best occluders.
+	mOccluderInstances = mVisibleInstances;
+	UINT occluderCount = std::min(gMaxOccluders, (UINT)mOccluderInstances.size());
+	std::partial_sort(mOccluderInstances.begin(), mOccluderInstances.begin() + occluderCount,
+		mOccluderInstances.end(), [&](UINT a, UINT b) { return distanceSq(a) < distanceSq(b); });
+
+	BoundingBox occluderBox = ri->Bounds;
+	occluderBox.Extents.x *= gOccluderBoxScale;
+	occluderBox.Extents.y *= gOccluderBoxScale;
+	occluderBox.Extents.z *= gOccluderBoxScale;
+
+	mOcclusionCuller->BeginFrame(viewProj);
+	for(UINT i = 0; i < occluderCount; ++i)
+	{
+		UINT index = mOccluderInstances[i];
+		mOcclusionCuller->AddOccluderBox(occluderBox, XMLoadFloat4x4(&instanceData[index].World));
+	}
+	mOcclusionCuller->RasterizeOccluders();
+
+	// Test the full bounds of every frustum visible instance against the Hi-Z buffer.
+	mCandidateWorlds.resize(mVisibleInstances.size());
+	mCandidateVisible.resize(mVisibleInstances.size());
+	for(size_t i = 0; i < mVisibleInstances.size(); ++i)
+		mCandidateWorlds[i] = instanceData[mVisibleInstances[i]].World;
+
+	mOcclusionCuller->TestObjects(ri->Bounds, mCandidateWorlds.data(),
+		(UINT)mCandidateWorlds.size(), mCandidateVisible.data());
+
+	size_t visibleCount = 0;
+	for(size_t i = 0; i < mVisibleInstances.size(); ++i)
+	{
+		if(mCandidateVisible[i])
+			mVisibleInstances[visibleCount++] = mVisibleInstances[i];
+	}
+	mVisibleInstances.resize(visibleCount);
+}
+
 void InstancingAndCullingApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -442,6 +545,8 @@ void InstancingAndCullingApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void InstancingAndCullingApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -939,6 +1044,18 @@ void InstancingAndCullingApp::BuildRenderItems()
 	}
 
 
+	// World space bounding spheres for the frustum coherence cache.
+	BoundingSphere localSphere;
+	BoundingSphere::CreateFromBoundingBox(localSphere, skullRitem->Bounds);
+
+	skullRitem->FrustumCache.Reset(mInstanceCount);
+	for(UINT i = 0; i < mInstanceCount; ++i)
+	{
+		BoundingSphere worldSphere;
+		localSphere.Transform(worldSphere, XMLoadFloat4x4(&skullRitem->Instances[i].World));
+		skullRitem->FrustumCache.SetInstanceBounds(i, worldSphere);
+	}
+
 	mAllRitems.push_back(std::move(skullRitem));
 	
 	// All the render items are opaque.
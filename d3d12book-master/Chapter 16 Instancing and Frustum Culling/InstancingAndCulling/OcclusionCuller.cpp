@@ -0,0 +1,436 @@
+//***************************************************************************************
+// OcclusionCuller.cpp
+//***************************************************************************************
+
+#include "OcclusionCuller.h"
+#include "../../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Corner order matches BoundingBox::GetCorners.
+	const std::uint32_t gBoxIndices[36] =
+	{
+		0, 1, 2,  0, 2, 3, // +z
+		4, 6, 5,  4, 7, 6, // -z
+		4, 0, 3,  4, 3, 7, // -x
+		1, 5, 6,  1, 6, 2, // +x
+		3, 2, 6,  3, 6, 7, // +y
+		4, 5, 1,  4, 1, 0  // -y
+	};
+
+	// Clip space w below this is treated as touching the eye.
+	const float gMinClipW = 1e-5f;
+}
+
+OcclusionCuller::OcclusionCuller(ThreadPool* threadPool, std::uint32_t width, std::uint32_t height) :
+	mThreadPool(threadPool),
+	mWidth(width),
+	mHeight(height)
+{
+	assert(width % TileWidth == 0 && height % TileHeight == 0);
+
+	mTilesX = mWidth / TileWidth;
+	mTilesY = mHeight / TileHeight;
+	mTileBins.resize(mTilesX * mTilesY);
+
+	XMStoreFloat4x4(&mViewProj, XMMatrixIdentity());
+
+	// Allocate the whole mip chain up front so BuildHiZ never allocates.
+	std::uint32_t w = mWidth;
+	std::uint32_t h = mHeight;
+	for(;;)
+	{
+		HiZLevel level;
+		level.Width = w;
+		level.Height = h;
+		level.Depth.assign(w * h, 1.0f);
+		mHiZ.push_back(std::move(level));
+
+		if(w == 1 && h == 1)
+			break;
+
+		w = std::max(1u, (w + 1) / 2);
+		h = std::max(1u, (h + 1) / 2);
+	}
+}
+
+std::uint32_t OcclusionCuller::GetWidth()const
+{
+	return mWidth;
+}
+
+std::uint32_t OcclusionCuller::GetHeight()const
+{
+	return mHeight;
+}
+
+std::uint32_t OcclusionCuller::GetHiZLevelCount()const
+{
+	return (std::uint32_t)mHiZ.size();
+}
+
+const float* OcclusionCuller::GetDepth(std::uint32_t level)const
+{
+	return mHiZ[level].Depth.data();
+}
+
+const OcclusionStats& OcclusionCuller::GetStats()const
+{
+	return mStats;
+}
+
+void OcclusionCuller::BeginFrame(FXMMATRIX viewProj)
+{
+	XMStoreFloat4x4(&mViewProj, viewProj);
+
+	mTriangles.clear();
+	for(auto& bin : mTileBins)
+		bin.clear();
+
+	mStats = OcclusionStats();
+}
+
+void OcclusionCuller::AddOccluderBox(const BoundingBox& localBox, FXMMATRIX world)
+{
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	localBox.GetCorners(corners);
+
+	AddOccluderMesh(corners, BoundingBox::CORNER_COUNT, gBoxIndices,
+		sizeof(gBoxIndices)/sizeof(gBoxIndices[0]), world);
+}
+
+void OcclusionCuller::AddOccluderMesh(const XMFLOAT3* positions, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::uint32_t indexCount, FXMMATRIX world)
+{
+	XMMATRIX worldViewProj = XMMatrixMultiply(world, XMLoadFloat4x4(&mViewProj));
+
+	mClipVerts.resize(vertexCount);
+	XMVector3TransformStream(mClipVerts.data(), sizeof(XMFLOAT4), positions, sizeof(XMFLOAT3),
+		vertexCount, worldViewProj);
+
+	const float halfWidth = 0.5f*mWidth;
+	const float halfHeight = 0.5f*mHeight;
+
+	for(std::uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		ScreenTriangle tri;
+
+		bool rejected = false;
+		for(int k = 0; k < 3; ++k)
+		{
+			const XMFLOAT4& v = mClipVerts[indices[i + k]];
+
+			// Clipping against the near plane is not worth it for occluders: dropping the
+			// triangle only makes the culler more conservative.
+			if(v.w < gMinClipW || v.z < 0.0f)
+			{
+				rejected = true;
+				break;
+			}
+
+			float invW = 1.0f / v.w;
+			tri.X[k] = (v.x*invW + 1.0f)*halfWidth;
+			tri.Y[k] = (1.0f - v.y*invW)*halfHeight;
+			tri.Z[k] = v.z*invW;
+		}
+
+		if(!rejected)
+		{
+			float minX = std::min(tri.X[0], std::min(tri.X[1], tri.X[2]));
+			float maxX = std::max(tri.X[0], std::max(tri.X[1], tri.X[2]));
+			float minY = std::min(tri.Y[0], std::min(tri.Y[1], tri.Y[2]));
+			float maxY = std::max(tri.Y[0], std::max(tri.Y[1], tri.Y[2]));
+
+			// Pixel centers sit at +0.5, so these are the pixels whose centers can be covered.
+			tri.MinX = std::max(0, (std::int32_t)std::ceil(minX - 0.5f));
+			tri.MaxX = std::min((std::int32_t)mWidth - 1, (std::int32_t)std::floor(maxX - 0.5f));
+			tri.MinY = std::max(0, (std::int32_t)std::ceil(minY - 0.5f));
+			tri.MaxY = std::min((std::int32_t)mHeight - 1, (std::int32_t)std::floor(maxY - 0.5f));
+
+			float area = (tri.X[1] - tri.X[0])*(tri.Y[2] - tri.Y[0]) - (tri.X[2] - tri.X[0])*(tri.Y[1] - tri.Y[0]);
+
+			rejected = tri.MinX > tri.MaxX || tri.MinY > tri.MaxY || std::fabs(area) < 1e-6f;
+		}
+
+		if(rejected)
+		{
+			++mStats.RejectedTriangles;
+			continue;
+		}
+
+		mTriangles.push_back(tri);
+		++mStats.OccluderTriangles;
+	}
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+	// Bin every triangle into the tiles its screen bounds overlap.
+	for(std::uint32_t i = 0; i < (std::uint32_t)mTriangles.size(); ++i)
+	{
+		const ScreenTriangle& tri = mTriangles[i];
+
+		std::uint32_t tx0 = tri.MinX / TileWidth;
+		std::uint32_t tx1 = tri.MaxX / TileWidth;
+		std::uint32_t ty0 = tri.MinY / TileHeight;
+		std::uint32_t ty1 = tri.MaxY / TileHeight;
+
+		for(std::uint32_t ty = ty0; ty <= ty1; ++ty)
+		{
+			for(std::uint32_t tx = tx0; tx <= tx1; ++tx)
+				mTileBins[ty*mTilesX + tx].push_back(i);
+		}
+	}
+
+	// Tiles own disjoint parts of the depth buffer, so they can be rasterized without locks.
+	const std::uint32_t tileCount = mTilesX*mTilesY;
+	if(mThreadPool != nullptr)
+		mThreadPool->ParallelFor(tileCount, [this](std::uint32_t tile) { RasterizeTile(tile); });
+	else
+	{
+		for(std::uint32_t tile = 0; tile < tileCount; ++tile)
+			RasterizeTile(tile);
+	}
+
+	BuildHiZ();
+}
+
+void OcclusionCuller::RasterizeTile(std::uint32_t tileIndex)
+{
+	const std::int32_t tileX0 = (std::int32_t)((tileIndex % mTilesX)*TileWidth);
+	const std::int32_t tileY0 = (std::int32_t)((tileIndex / mTilesX)*TileHeight);
+	const std::int32_t tileX1 = tileX0 + TileWidth - 1;
+	const std::int32_t tileY1 = tileY0 + TileHeight - 1;
+
+	float* depth = mHiZ[0].Depth.data();
+
+	// Clear this tile to the far plane.
+	for(std::int32_t y = tileY0; y <= tileY1; ++y)
+		std::fill(depth + y*mWidth + tileX0, depth + y*mWidth + tileX1 + 1, 1.0f);
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR zero = XMVectorZero();
+
+	for(std::uint32_t triIndex : mTileBins[tileIndex])
+	{
+		const ScreenTriangle& tri = mTriangles[triIndex];
+
+		// Edge functions E(x,y) = a*x + b*y + c, one per edge, opposite to vertex 0, 1, 2.
+		float a[3], b[3], c[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			int i0 = (k + 1) % 3;
+			int i1 = (k + 2) % 3;
+			a[k] = tri.Y[i0] - tri.Y[i1];
+			b[k] = tri.X[i1] - tri.X[i0];
+			c[k] = tri.X[i0]*tri.Y[i1] - tri.X[i1]*tri.Y[i0];
+		}
+
+		// Accept both windings: flip the edges so the inside is always positive.
+		float area = a[0]*tri.X[0] + b[0]*tri.Y[0] + c[0];
+		if(area < 0.0f)
+		{
+			for(int k = 0; k < 3; ++k)
+			{
+				a[k] = -a[k];
+				b[k] = -b[k];
+				c[k] = -c[k];
+			}
+			area = -area;
+		}
+
+		// Depth is linear in screen space after the perspective divide: z = za*x + zb*y + zc.
+		float invArea = 1.0f / area;
+		float za = (a[0]*tri.Z[0] + a[1]*tri.Z[1] + a[2]*tri.Z[2])*invArea;
+		float zb = (b[0]*tri.Z[0] + b[1]*tri.Z[1] + b[2]*tri.Z[2])*invArea;
+		float zc = (c[0]*tri.Z[0] + c[1]*tri.Z[1] + c[2]*tri.Z[2])*invArea;
+
+		// Tile x origin and width are multiples of 4, so the aligned span stays in the tile.
+		std::int32_t x0 = std::max(tri.MinX, tileX0) & ~3;
+		std::int32_t x1 = std::min(tri.MaxX, tileX1);
+		std::int32_t y0 = std::max(tri.MinY, tileY0);
+		std::int32_t y1 = std::min(tri.MaxY, tileY1);
+		if(x0 > x1 || y0 > y1)
+			continue;
+
+		XMVECTOR a0 = XMVectorReplicate(a[0]);
+		XMVECTOR a1 = XMVectorReplicate(a[1]);
+		XMVECTOR a2 = XMVectorReplicate(a[2]);
+		XMVECTOR zaV = XMVectorReplicate(za);
+
+		for(std::int32_t y = y0; y <= y1; ++y)
+		{
+			float py = (float)y + 0.5f;
+			XMVECTOR row0 = XMVectorReplicate(b[0]*py + c[0]);
+			XMVECTOR row1 = XMVectorReplicate(b[1]*py + c[1]);
+			XMVECTOR row2 = XMVectorReplicate(b[2]*py + c[2]);
+			XMVECTOR rowZ = XMVectorReplicate(zb*py + zc);
+
+			float* depthRow = depth + y*mWidth;
+
+			for(std::int32_t x = x0; x <= x1; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+				XMVECTOR e0 = XMVectorMultiplyAdd(a0, px, row0);
+				XMVECTOR e1 = XMVectorMultiplyAdd(a1, px, row1);
+				XMVECTOR e2 = XMVectorMultiplyAdd(a2, px, row2);
+
+				XMVECTOR inside = XMVectorAndInt(
+					XMVectorAndInt(XMVectorGreaterOrEqual(e0, zero), XMVectorGreaterOrEqual(e1, zero)),
+					XMVectorGreaterOrEqual(e2, zero));
+
+				XMVECTOR z = XMVectorMultiplyAdd(zaV, px, rowZ);
+
+				XMFLOAT4* dst = reinterpret_cast<XMFLOAT4*>(depthRow + x);
+				XMVECTOR oldZ = XMLoadFloat4(dst);
+				XMStoreFloat4(dst, XMVectorSelect(oldZ, XMVectorMin(oldZ, z), inside));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+	// Each texel keeps the farthest depth of the texels it covers, so a box that is
+	// behind a Hi-Z texel is behind every pixel under it.
+	for(std::size_t l = 1; l < mHiZ.size(); ++l)
+	{
+		const HiZLevel& src = mHiZ[l - 1];
+		HiZLevel& dst = mHiZ[l];
+
+		for(std::uint32_t y = 0; y < dst.Height; ++y)
+		{
+			std::uint32_t sy0 = std::min(2*y, src.Height - 1);
+			std::uint32_t sy1 = std::min(2*y + 1, src.Height - 1);
+
+			for(std::uint32_t x = 0; x < dst.Width; ++x)
+			{
+				std::uint32_t sx0 = std::min(2*x, src.Width - 1);
+				std::uint32_t sx1 = std::min(2*x + 1, src.Width - 1);
+
+				float d = std::max(
+					std::max(src.Depth[sy0*src.Width + sx0], src.Depth[sy0*src.Width + sx1]),
+					std::max(src.Depth[sy1*src.Width + sx0], src.Depth[sy1*src.Width + sx1]));
+
+				dst.Depth[y*dst.Width + x] = d;
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsOccluded(const BoundingBox& localBounds, FXMMATRIX world)const
+{
+	XMMATRIX worldViewProj = XMMatrixMultiply(world, XMLoadFloat4x4(&mViewProj));
+
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	localBounds.GetCorners(corners);
+
+	XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for(std::uint32_t i = 0; i < BoundingBox::CORNER_COUNT; ++i)
+	{
+		XMVECTOR p = XMVector3Transform(XMLoadFloat3(&corners[i]), worldViewProj);
+
+		// Boxes touching the near plane cover an unbounded screen area.
+		float w = XMVectorGetW(p);
+		if(w < gMinClipW)
+			return false;
+
+		p = XMVectorDivide(p, XMVectorSplatW(p));
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	XMFLOAT3 ndcMin, ndcMax;
+	XMStoreFloat3(&ndcMin, vMin);
+	XMStoreFloat3(&ndcMax, vMax);
+
+	if(ndcMin.z < 0.0f)
+		return false;
+
+	// NDC to pixels; y is flipped.
+	float sx0 = (ndcMin.x + 1.0f)*0.5f*mWidth;
+	float sx1 = (ndcMax.x + 1.0f)*0.5f*mWidth;
+	float sy0 = (1.0f - ndcMax.y)*0.5f*mHeight;
+	float sy1 = (1.0f - ndcMin.y)*0.5f*mHeight;
+
+	if(sx1 < 0.0f || sy1 < 0.0f || sx0 >= (float)mWidth || sy0 >= (float)mHeight)
+		return false;
+
+	std::int32_t px0 = std::max(0, (std::int32_t)sx0);
+	std::int32_t py0 = std::max(0, (std::int32_t)sy0);
+	std::int32_t px1 = std::min((std::int32_t)mWidth - 1, (std::int32_t)sx1);
+	std::int32_t py1 = std::min((std::int32_t)mHeight - 1, (std::int32_t)sy1);
+
+	// Pick the level where the rectangle spans at most two texels in each direction,
+	// so at most 3x3 texels are read.
+	std::uint32_t size = (std::uint32_t)std::max(px1 - px0, py1 - py0) + 1;
+	std::uint32_t level = 0;
+	while(size > 2 && level + 1 < mHiZ.size())
+	{
+		size = (size + 1) / 2;
+		++level;
+	}
+
+	const HiZLevel& hiz = mHiZ[level];
+	std::uint32_t lx0 = std::min((std::uint32_t)px0 >> level, hiz.Width - 1);
+	std::uint32_t lx1 = std::min((std::uint32_t)px1 >> level, hiz.Width - 1);
+	std::uint32_t ly0 = std::min((std::uint32_t)py0 >> level, hiz.Height - 1);
+	std::uint32_t ly1 = std::min((std::uint32_t)py1 >> level, hiz.Height - 1);
+
+	for(std::uint32_t y = ly0; y <= ly1; ++y)
+	{
+		for(std::uint32_t x = lx0; x <= lx1; ++x)
+		{
+			if(ndcMin.z <= hiz.Depth[y*hiz.Width + x])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void OcclusionCuller::TestObjects(const BoundingBox& localBounds, const XMFLOAT4X4* worlds,
+	std::uint32_t count, std::uint8_t* visible)
+{
+	const std::uint32_t BatchSize = 32;
+	const std::uint32_t batchCount = (count + BatchSize - 1) / BatchSize;
+
+	std::atomic<std::uint32_t> occludedCount(0);
+
+	auto testBatch = [&](std::uint32_t batch)
+	{
+		std::uint32_t begin = batch*BatchSize;
+		std::uint32_t end = std::min(begin + BatchSize, count);
+
+		std::uint32_t occluded = 0;
+		for(std::uint32_t i = begin; i < end; ++i)
+		{
+			bool hidden = IsOccluded(localBounds, XMLoadFloat4x4(&worlds[i]));
+			visible[i] = hidden ? 0 : 1;
+			occluded += hidden ? 1 : 0;
+		}
+
+		occludedCount += occluded;
+	};
+
+	if(mThreadPool != nullptr)
+		mThreadPool->ParallelFor(batchCount, testBatch);
+	else
+	{
+		for(std::uint32_t batch = 0; batch < batchCount; ++batch)
+			testBatch(batch);
+	}
+
+	mStats.TestedObjects += count;
+	mStats.OccludedObjects += occludedCount;
+}
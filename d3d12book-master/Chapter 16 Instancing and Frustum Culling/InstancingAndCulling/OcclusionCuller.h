@@ -0,0 +1,114 @@
+//***************************************************************************************
+// OcclusionCuller.h
+//
+// CPU software occlusion culling.  A handful of cheap occluders (boxes or simplified
+// meshes) are rasterized into a small depth buffer, a hierarchical max-depth (Hi-Z)
+// chain is built from it, and object bounds are then tested against the chain before
+// they are written to the instance buffer.
+//
+// Only DirectXMath/DirectXCollision are used, so the class does not need a device and
+// can be driven from a headless test harness.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+struct OcclusionStats
+{
+	std::uint32_t OccluderTriangles = 0;  // Triangles that made it into the depth buffer.
+	std::uint32_t RejectedTriangles = 0;  // Near plane crossing, off screen or degenerate.
+	std::uint32_t TestedObjects = 0;
+	std::uint32_t OccludedObjects = 0;
+};
+
+class OcclusionCuller
+{
+public:
+	// width must be a multiple of TileWidth and height a multiple of TileHeight.
+	// threadPool may be null, in which case everything runs on the calling thread.
+	OcclusionCuller(ThreadPool* threadPool, std::uint32_t width = 256, std::uint32_t height = 128);
+	OcclusionCuller(const OcclusionCuller& rhs) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller& rhs) = delete;
+	~OcclusionCuller() = default;
+
+	static const std::uint32_t TileWidth = 64;
+	static const std::uint32_t TileHeight = 32;
+
+	std::uint32_t GetWidth()const;
+	std::uint32_t GetHeight()const;
+	std::uint32_t GetHiZLevelCount()const;
+
+	// Depth values of one Hi-Z level (level 0 is the rasterized depth buffer), row major.
+	const float* GetDepth(std::uint32_t level = 0)const;
+
+	const OcclusionStats& GetStats()const;
+
+	// Clears the occluder list and depth buffer and caches the view-projection matrix
+	// used by the rest of the frame.
+	void BeginFrame(DirectX::FXMMATRIX viewProj);
+
+	// Occluders must lie inside the geometry they stand in for, otherwise objects
+	// that are actually visible can be culled.
+	void AddOccluderBox(const DirectX::BoundingBox& localBox, DirectX::FXMMATRIX world);
+	void AddOccluderMesh(const DirectX::XMFLOAT3* positions, std::uint32_t vertexCount,
+		const std::uint32_t* indices, std::uint32_t indexCount, DirectX::FXMMATRIX world);
+
+	// Bins the occluder triangles into screen tiles, rasterizes the tiles in parallel and
+	// builds the Hi-Z chain.  Call once after all occluders were added.
+	void RasterizeOccluders();
+
+	// Returns true if the box is completely hidden behind the rasterized occluders.
+	// Boxes crossing the near plane or lying off screen are never reported as occluded.
+	bool IsOccluded(const DirectX::BoundingBox& localBounds, DirectX::FXMMATRIX world)const;
+
+	// Tests count objects sharing the same local bounds in parallel.  visible[i] is set
+	// to 0 if object i is occluded and 1 otherwise.
+	void TestObjects(const DirectX::BoundingBox& localBounds, const DirectX::XMFLOAT4X4* worlds,
+		std::uint32_t count, std::uint8_t* visible);
+
+private:
+	struct ScreenTriangle
+	{
+		float X[3];
+		float Y[3];
+		float Z[3];
+		std::int32_t MinX, MinY, MaxX, MaxY;
+	};
+
+	struct HiZLevel
+	{
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::vector<float> Depth;
+	};
+
+	void RasterizeTile(std::uint32_t tileIndex);
+	void BuildHiZ();
+
+private:
+	ThreadPool* mThreadPool = nullptr;
+
+	std::uint32_t mWidth = 0;
+	std::uint32_t mHeight = 0;
+	std::uint32_t mTilesX = 0;
+	std::uint32_t mTilesY = 0;
+
+	DirectX::XMFLOAT4X4 mViewProj;
+
+	std::vector<ScreenTriangle> mTriangles;
+	std::vector<std::vector<std::uint32_t>> mTileBins;
+
+	// mHiZ[0] is the full resolution depth buffer.
+	std::vector<HiZLevel> mHiZ;
+
+	// Scratch space for transformed occluder vertices.
+	std::vector<DirectX::XMFLOAT4> mClipVerts;
+
+	OcclusionStats mStats;
+};
@@ -0,0 +1,143 @@
+//***************************************************************************************
+// CubeFaceCuller.cpp
+//***************************************************************************************
+
+#include "CubeFaceCuller.h"
+
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+void CubeFaceCuller::SetCubeCenter(const XMFLOAT3& center, float farZ)
+{
+	mCenter = center;
+	mFarZ = farZ;
+	mAllMoved = true;
+}
+
+void CubeFaceCuller::Reset(std::uint32_t itemCount)
+{
+	mItems.assign(itemCount, ItemState());
+	for(auto& items : mFaceItems)
+		items.clear();
+
+	mAllMoved = true;
+}
+
+void CubeFaceCuller::Invalidate()
+{
+	mAllMoved = true;
+}
+
+void CubeFaceCuller::SetItem(std::uint32_t index, const BoundingBox& localBounds, const XMFLOAT4X4& world)
+{
+	ItemState& item = mItems[index];
+
+	if(std::memcmp(&item.World, &world, sizeof(XMFLOAT4X4)) != 0 ||
+	   std::memcmp(&item.LocalBounds, &localBounds, sizeof(BoundingBox)) != 0)
+	{
+		item.LocalBounds = localBounds;
+		item.World = world;
+		item.Moved = true;
+	}
+}
+
+void CubeFaceCuller::Cull()
+{
+	mStats = CubeFaceCullingStats();
+	mDirtyFaces = mAllMoved ? 0x3f : 0;
+
+	for(auto& item : mItems)
+	{
+		if(!item.Moved && !mAllMoved)
+			continue;
+
+		BoundingSphere localSphere;
+		BoundingSphere::CreateFromBoundingBox(localSphere, item.LocalBounds);
+
+		BoundingSphere worldSphere;
+		localSphere.Transform(worldSphere, XMLoadFloat4x4(&item.World));
+
+		std::uint8_t mask = Classify(worldSphere);
+
+		// The faces the item left and the faces it is now in both change.
+		mDirtyFaces |= item.Mask | mask;
+
+		item.Mask = mask;
+		item.Moved = false;
+		++mStats.Classified;
+	}
+
+	mAllMoved = false;
+
+	for(std::uint32_t face = 0; face < FaceCount; ++face)
+	{
+		if(!IsFaceDirty(face))
+			continue;
+
+		++mStats.DirtyFaces;
+
+		mFaceItems[face].clear();
+		for(std::uint32_t i = 0; i < (std::uint32_t)mItems.size(); ++i)
+		{
+			if(mItems[i].Mask & (1u << face))
+				mFaceItems[face].push_back(i);
+		}
+	}
+}
+
+std::uint8_t CubeFaceCuller::GetFaceMask(std::uint32_t index)const
+{
+	return mItems[index].Mask;
+}
+
+bool CubeFaceCuller::IsFaceDirty(std::uint32_t face)const
+{
+	return (mDirtyFaces & (1u << face)) != 0;
+}
+
+const std::vector<std::uint32_t>& CubeFaceCuller::GetFaceItems(std::uint32_t face)const
+{
+	assert(face < FaceCount);
+	return mFaceItems[face];
+}
+
+const CubeFaceCullingStats& CubeFaceCuller::GetStats()const
+{
+	return mStats;
+}
+
+std::uint8_t CubeFaceCuller::Classify(const BoundingSphere& worldSphere)const
+{
+	float x = worldSphere.Center.x - mCenter.x;
+	float y = worldSphere.Center.y - mCenter.y;
+	float z = worldSphere.Center.z - mCenter.z;
+	float r = worldSphere.Radius;
+
+	// Each face's far plane is perpendicular to its axis, so its corners reach farther
+	// than farZ from the center.  The near plane is ignored; it is so close to the
+	// center that skipping it only keeps a few extra items.
+	float farR = mFarZ + r;
+
+	// Signed distances to the diagonal planes.  Each plane bounds two faces, which see
+	// it from opposite sides.
+	const float s = 0.70710678f;
+	float xmy = (x - y)*s;
+	float xpy = (x + y)*s;
+	float xmz = (x - z)*s;
+	float xpz = (x + z)*s;
+	float ymz = (y - z)*s;
+	float ypz = (y + z)*s;
+
+	std::uint8_t mask = 0;
+
+	if( x <= farR &&  xmy >= -r &&  xpy >= -r &&  xmz >= -r &&  xpz >= -r) mask |= 1 << 0; // +X
+	if(-x <= farR && -xmy >= -r && -xpy >= -r && -xmz >= -r && -xpz >= -r) mask |= 1 << 1; // -X
+	if( y <= farR && -xmy >= -r &&  xpy >= -r &&  ymz >= -r &&  ypz >= -r) mask |= 1 << 2; // +Y
+	if(-y <= farR &&  xmy >= -r && -xpy >= -r && -ymz >= -r && -ypz >= -r) mask |= 1 << 3; // -Y
+	if( z <= farR && -xmz >= -r &&  xpz >= -r && -ymz >= -r &&  ypz >= -r) mask |= 1 << 4; // +Z
+	if(-z <= farR &&  xmz >= -r && -xpz >= -r &&  ymz >= -r && -ypz >= -r) mask |= 1 << 5; // -Z
+
+	return mask;
+}
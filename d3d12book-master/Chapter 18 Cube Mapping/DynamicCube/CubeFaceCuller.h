@@ -0,0 +1,89 @@
+//***************************************************************************************
+// CubeFaceCuller.h
+//
+// Culls render items against the six faces of a dynamic cube map in one pass.  The
+// face cameras all sit at the cube center with a 90 degree field of view, so the side
+// planes of the six frustums are the six diagonal planes x=+-y, x=+-z and y=+-z.
+// Six dot products per bounding sphere therefore classify an item against every face,
+// giving a 6-bit mask.
+//
+// The culler also remembers the world matrix of every item.  A face only needs to be
+// redrawn when an item that is (or was) visible in it moved, so faces whose content is
+// unchanged can keep last frame's image.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+struct CubeFaceCullingStats
+{
+	std::uint32_t Classified = 0;   // Items whose mask was recomputed this frame.
+	std::uint32_t DirtyFaces = 0;   // Faces that have to be redrawn.
+};
+
+class CubeFaceCuller
+{
+public:
+	static const std::uint32_t FaceCount = 6;
+
+	CubeFaceCuller() = default;
+	CubeFaceCuller(const CubeFaceCuller& rhs) = delete;
+	CubeFaceCuller& operator=(const CubeFaceCuller& rhs) = delete;
+	~CubeFaceCuller() = default;
+
+	// Faces are in the order +X, -X, +Y, -Y, +Z, -Z.  Marks every face dirty.
+	void SetCubeCenter(const DirectX::XMFLOAT3& center, float farZ);
+
+	// Sizes the item table and marks every face dirty.
+	void Reset(std::uint32_t itemCount);
+
+	// Forces every face to be redrawn on the next Cull(), e.g. after a material or
+	// lighting change the culler cannot see.
+	void Invalidate();
+
+	// Records the current local bounds and world matrix of an item.
+	void SetItem(std::uint32_t index, const DirectX::BoundingBox& localBounds,
+		const DirectX::XMFLOAT4X4& world);
+
+	// Re-classifies the items that moved since the last call, works out which faces
+	// changed and rebuilds their item lists.
+	void Cull();
+
+	// Bit i is set if the item is visible in face i.
+	std::uint8_t GetFaceMask(std::uint32_t index)const;
+
+	bool IsFaceDirty(std::uint32_t face)const;
+
+	// Items visible in a face.  Only rebuilt for dirty faces.
+	const std::vector<std::uint32_t>& GetFaceItems(std::uint32_t face)const;
+
+	const CubeFaceCullingStats& GetStats()const;
+
+private:
+	std::uint8_t Classify(const DirectX::BoundingSphere& worldSphere)const;
+
+private:
+	struct ItemState
+	{
+		DirectX::BoundingBox LocalBounds;
+		DirectX::XMFLOAT4X4 World;
+		std::uint8_t Mask = 0;
+		bool Moved = true;
+	};
+
+	std::vector<ItemState> mItems;
+	std::vector<std::uint32_t> mFaceItems[FaceCount];
+
+	DirectX::XMFLOAT3 mCenter = { 0.0f, 0.0f, 0.0f };
+	float mFarZ = 1000.0f;
+
+	// Bit i is set if face i must be redrawn.
+	std::uint8_t mDirtyFaces = 0x3f;
+	bool mAllMoved = true;
+
+	CubeFaceCullingStats mStats;
+};
@@ -9,6 +9,7 @@
 #include "../../Common/Camera.h"
 #include "FrameResource.h"
 #include "CubeRenderTarget.h"
+#include "CubeFaceCuller.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -47,6 +48,9 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+    // Local space bounds, used to cull against the cube map faces.
+    BoundingBox Bounds;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -90,6 +94,7 @@ private:
 	void UpdateMaterialBuffer(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateCubeMapFacePassCBs();
+	void UpdateCubeMapFaceDrawLists();
 
 	void LoadTextures();
     void BuildRootSignature();
@@ -142,6 +147,11 @@ private:
 	std::unique_ptr<CubeRenderTarget> mDynamicCubeMap = nullptr;
 	CD3DX12_CPU_DESCRIPTOR_HANDLE mCubeDSV;
 
+	// Opaque items visible in each cube map face.  Faces whose content did not change
+	// are not redrawn and keep last frame's image.
+	CubeFaceCuller mCubeFaceCuller;
+	std::vector<RenderItem*> mCubeFaceRitems[6];
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -211,6 +221,8 @@ bool DynamicCubeMapApp::Initialize()
     BuildFrameResources();
     BuildPSOs();
 
+	mCubeFaceCuller.Reset((UINT)mRitemLayer[(int)RenderLayer::Opaque].size());
+
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
     ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
@@ -276,18 +288,13 @@ void DynamicCubeMapApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
 	UpdateMaterialBuffer(gt);
 	UpdateMainPassCB(gt);
+	UpdateCubeMapFaceDrawLists();
 }
 
 void DynamicCubeMapApp::Draw(const GameTimer& gt)
@@ -558,6 +565,25 @@ void DynamicCubeMapApp::UpdateCubeMapFacePassCBs()
 	}
 }
 
+void DynamicCubeMapApp::UpdateCubeMapFaceDrawLists()
+{
+	const auto& opaqueRitems = mRitemLayer[(int)RenderLayer::Opaque];
+	for(UINT i = 0; i < (UINT)opaqueRitems.size(); ++i)
+		mCubeFaceCuller.SetItem(i, opaqueRitems[i]->Bounds, opaqueRitems[i]->World);
+
+	mCubeFaceCuller.Cull();
+
+	for(UINT face = 0; face < CubeFaceCuller::FaceCount; ++face)
+	{
+		if(!mCubeFaceCuller.IsFaceDirty(face))
+			continue;
+
+		mCubeFaceRitems[face].clear();
+		for(UINT i : mCubeFaceCuller.GetFaceItems(face))
+			mCubeFaceRitems[face].push_back(opaqueRitems[i]);
+	}
+}
+
 void DynamicCubeMapApp::LoadTextures()
 {
     std::vector<std::string> texNames =
@@ -889,21 +915,26 @@ void DynamicCubeMapApp::BuildShapeGeometry()
 	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
 	boxSubmesh.StartIndexLocation = boxIndexOffset;
 	boxSubmesh.BaseVertexLocation = boxVertexOffset;
+	// Bounds follow from the dimensions the shapes were generated with.
+	boxSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry gridSubmesh;
 	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
 	gridSubmesh.StartIndexLocation = gridIndexOffset;
 	gridSubmesh.BaseVertexLocation = gridVertexOffset;
+	gridSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(10.0f, 0.0f, 15.0f));
 
 	SubmeshGeometry sphereSubmesh;
 	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
 	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
 	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
+	sphereSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry cylinderSubmesh;
 	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
+	cylinderSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 1.5f, 0.5f));
 
 	//
 	// Extract the vertex elements we are interested in and pack the
@@ -1111,6 +1142,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 	skyRitem->Geo = mGeometries["shapeGeo"].get();
 	skyRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	skyRitem->IndexCount = skyRitem->Geo->DrawArgs["sphere"].IndexCount;
+	skyRitem->Bounds = skyRitem->Geo->DrawArgs["sphere"].Bounds;
 	skyRitem->StartIndexLocation = skyRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 	skyRitem->BaseVertexLocation = skyRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1125,6 +1157,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 	skullRitem->Geo = mGeometries["skullGeo"].get();
 	skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
+	skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
 	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
 	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
 
@@ -1141,6 +1174,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 	boxRitem->Geo = mGeometries["shapeGeo"].get();
 	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
+	boxRitem->Bounds = boxRitem->Geo->DrawArgs["box"].Bounds;
 	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
 	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
 
@@ -1155,6 +1189,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 	globeRitem->Geo = mGeometries["shapeGeo"].get();
 	globeRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	globeRitem->IndexCount = globeRitem->Geo->DrawArgs["sphere"].IndexCount;
+	globeRitem->Bounds = globeRitem->Geo->DrawArgs["sphere"].Bounds;
 	globeRitem->StartIndexLocation = globeRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 	globeRitem->BaseVertexLocation = globeRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1169,6 +1204,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 	gridRitem->Geo = mGeometries["shapeGeo"].get();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
+    gridRitem->Bounds = gridRitem->Geo->DrawArgs["grid"].Bounds;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
     gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
 
@@ -1197,6 +1233,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
 		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		leftCylRitem->Bounds = leftCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1207,6 +1244,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
 		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		rightCylRitem->Bounds = rightCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1217,6 +1255,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		leftSphereRitem->Bounds = leftSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1227,6 +1266,7 @@ void DynamicCubeMapApp::BuildRenderItems()
 		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		rightSphereRitem->Bounds = rightSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1267,6 +1307,9 @@ void DynamicCubeMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, cons
 
 void DynamicCubeMapApp::DrawSceneToCubeMap()
 {
+	if(mCubeFaceCuller.GetStats().DirtyFaces == 0)
+		return;
+
 	mCommandList->RSSetViewports(1, &mDynamicCubeMap->Viewport());
 	mCommandList->RSSetScissorRects(1, &mDynamicCubeMap->ScissorRect());
 
@@ -1279,6 +1322,10 @@ void DynamicCubeMapApp::DrawSceneToCubeMap()
 	// For each cube map face.
 	for(int i = 0; i < 6; ++i)
 	{
+		// Nothing visible in this face changed; keep last frame's image.
+		if(!mCubeFaceCuller.IsFaceDirty(i))
+			continue;
+
 		// Clear the back buffer and depth buffer.
 		mCommandList->ClearRenderTargetView(mDynamicCubeMap->Rtv(i), Colors::LightSteelBlue, 0, nullptr);
 		mCommandList->ClearDepthStencilView(mCubeDSV, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
@@ -1292,7 +1339,7 @@ void DynamicCubeMapApp::DrawSceneToCubeMap()
 		D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + (1+i)*passCBByteSize;
 		mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
 
-		DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+		DrawRenderItems(mCommandList.Get(), mCubeFaceRitems[i]);
 
 		mCommandList->SetPipelineState(mPSOs["sky"].Get());
 		DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
@@ -1397,4 +1444,6 @@ void DynamicCubeMapApp::BuildCubeFaceCamera(float x, float y, float z)
 		mCubeMapCamera[i].SetLens(0.5f*XM_PI, 1.0f, 0.1f, 1000.0f);
 		mCubeMapCamera[i].UpdateViewMatrix();
 	}
+
+	mCubeFaceCuller.SetCubeCenter(center, 1000.0f);
 }
\ No newline at end of file
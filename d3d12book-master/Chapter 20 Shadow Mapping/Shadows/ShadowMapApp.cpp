@@ -7,6 +7,8 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/ShadowCascades.h"
+#include "../../Common/DescriptorHeap.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 
@@ -42,6 +44,9 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+    // Local space bounds, used to cull shadow casters per cascade.
+    BoundingBox Bounds;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -84,6 +89,7 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialBuffer(const GameTimer& gt);
     void UpdateShadowTransform(const GameTimer& gt);
+    void UpdateShadowCasters();
 	void UpdateMainPassCB(const GameTimer& gt);
     void UpdateShadowPassCB(const GameTimer& gt);
 
@@ -110,7 +116,7 @@ private:
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	std::unique_ptr<DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
@@ -126,6 +132,9 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
+	// Start of the texture table (root parameter 4) in the SRV heap.
+	UINT mTexTableHeapIndex = 0;
+
 	UINT mSkyTexHeapIndex = 0;
     UINT mShadowMapHeapIndex = 0;
 
@@ -135,7 +144,7 @@ private:
     CD3DX12_GPU_DESCRIPTOR_HANDLE mNullSrv;
 
     PassConstants mMainPassCB;  // index 0 of pass cbuffer.
-    PassConstants mShadowPassCB;// index 1 of pass cbuffer.
+    PassConstants mShadowPassCB;// indices [1, 1+MaxCascades) of pass cbuffer.
 
 	Camera mCamera;
 
@@ -143,12 +152,12 @@ private:
 
     DirectX::BoundingSphere mSceneBounds;
 
-    float mLightNearZ = 0.0f;
-    float mLightFarZ = 0.0f;
-    XMFLOAT3 mLightPosW;
-    XMFLOAT4X4 mLightView = MathHelper::Identity4x4();
-    XMFLOAT4X4 mLightProj = MathHelper::Identity4x4();
-    XMFLOAT4X4 mShadowTransform = MathHelper::Identity4x4();
+    // The cascades are packed 2x2 into the shadow map.
+    ShadowCascades mShadowCascades;
+    XMFLOAT4X4 mCascadeShadowTransforms[ShadowCascades::MaxCascades];
+
+    // Opaque items that can cast a shadow into each cascade.
+    std::vector<RenderItem*> mCascadeCasters[ShadowCascades::MaxCascades];
 
     float mLightRotationAngle = 0.0f;
     XMFLOAT3 mBaseLightDirections[3] = {
@@ -214,6 +223,10 @@ bool ShadowMapApp::Initialize()
     mShadowMap = std::make_unique<ShadowMap>(
         md3dDevice.Get(), 2048, 2048);
 
+    // Each cascade gets a quarter of the shadow map.
+    mShadowCascades.SetShadowMapSize(mShadowMap->Width() / 2);
+    mShadowCascades.SetShadowDistance(50.0f);
+
 	LoadTextures();
     BuildRootSignature();
 	BuildDescriptorHeaps();
@@ -274,13 +287,7 @@ void ShadowMapApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
     //
     // Animate the lights (and hence shadows).
@@ -300,6 +307,7 @@ void ShadowMapApp::Update(const GameTimer& gt)
 	UpdateObjectCBs(gt);
 	UpdateMaterialBuffer(gt);
     UpdateShadowTransform(gt);
+    UpdateShadowCasters();
 	UpdateMainPassCB(gt);
     UpdateShadowPassCB(gt);
 }
@@ -316,7 +324,7 @@ void ShadowMapApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
 
-    ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+    ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap->Get() };
     mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
     mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
@@ -332,7 +340,7 @@ void ShadowMapApp::Draw(const GameTimer& gt)
     // Bind all the textures used in this scene.  Observe
     // that we only have to specify the first descriptor in the table.  
     // The root signature knows how many descriptors are expected in the table.
-    mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+    mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGpuHandle(mTexTableHeapIndex));
 
     DrawSceneToShadowMap();
 
@@ -358,8 +366,7 @@ void ShadowMapApp::Draw(const GameTimer& gt)
     // If we wanted to use "local" cube maps, we would have to change them per-object, or dynamically
     // index into an array of cube maps.
 
-    CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvUavDescriptorSize);
+    CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor = mSrvDescriptorHeap->GetGpuHandle(mSkyTexHeapIndex);
     mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
 
     mCommandList->SetPipelineState(mPSOs["opaque"].Get());
@@ -505,40 +512,39 @@ void ShadowMapApp::UpdateShadowTransform(const GameTimer& gt)
 {
     // Only the first "main" light casts a shadow.
     XMVECTOR lightDir = XMLoadFloat3(&mRotatedLightDirections[0]);
-    XMVECTOR lightPos = -2.0f*mSceneBounds.Radius*lightDir;
-    XMVECTOR targetPos = XMLoadFloat3(&mSceneBounds.Center);
-    XMVECTOR lightUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-    XMMATRIX lightView = XMMatrixLookAtLH(lightPos, targetPos, lightUp);
-
-    XMStoreFloat3(&mLightPosW, lightPos);
-
-    // Transform bounding sphere to light space.
-    XMFLOAT3 sphereCenterLS;
-    XMStoreFloat3(&sphereCenterLS, XMVector3TransformCoord(targetPos, lightView));
-
-    // Ortho frustum in light space encloses scene.
-    float l = sphereCenterLS.x - mSceneBounds.Radius;
-    float b = sphereCenterLS.y - mSceneBounds.Radius;
-    float n = sphereCenterLS.z - mSceneBounds.Radius;
-    float r = sphereCenterLS.x + mSceneBounds.Radius;
-    float t = sphereCenterLS.y + mSceneBounds.Radius;
-    float f = sphereCenterLS.z + mSceneBounds.Radius;
-
-    mLightNearZ = n;
-    mLightFarZ = f;
-    XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(l, r, b, t, n, f);
-
-    // Transform NDC space [-1,+1]^2 to texture space [0,1]^2
-    XMMATRIX T(
-        0.5f, 0.0f, 0.0f, 0.0f,
-        0.0f, -0.5f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f, 0.5f, 0.0f, 1.0f);
-
-    XMMATRIX S = lightView*lightProj*T;
-    XMStoreFloat4x4(&mLightView, lightView);
-    XMStoreFloat4x4(&mLightProj, lightProj);
-    XMStoreFloat4x4(&mShadowTransform, S);
+
+    mShadowCascades.Update(mCamera.GetView(), mCamera.GetFovY(), mCamera.GetAspect(),
+        mCamera.GetNearZ(), mCamera.GetFarZ(), lightDir, mSceneBounds);
+
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        // Scale and offset texture space [0,1]^2 into the quarter of the shadow map
+        // the cascade is rendered to.
+        XMMATRIX atlas = XMMatrixScaling(0.5f, 0.5f, 1.0f)*
+            XMMatrixTranslation(0.5f*(i % 2), 0.5f*(i / 2), 0.0f);
+
+        XMMATRIX S = XMLoadFloat4x4(&mShadowCascades.GetCascade(i).ShadowTransform)*atlas;
+        XMStoreFloat4x4(&mCascadeShadowTransforms[i], S);
+    }
+}
+
+void ShadowMapApp::UpdateShadowCasters()
+{
+    for(auto& casters : mCascadeCasters)
+        casters.clear();
+
+    for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+    {
+        BoundingBox worldBounds;
+        ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World));
+
+        UINT mask = mShadowCascades.GetCasterMask(worldBounds);
+        for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+        {
+            if(mask & (1u << i))
+                mCascadeCasters[i].push_back(ri);
+        }
+    }
 }
 
 void ShadowMapApp::UpdateMainPassCB(const GameTimer& gt)
@@ -551,7 +557,7 @@ void ShadowMapApp::UpdateMainPassCB(const GameTimer& gt)
 	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
 	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
 
-    XMMATRIX shadowTransform = XMLoadFloat4x4(&mShadowTransform);
+    XMMATRIX shadowTransform = XMLoadFloat4x4(&mCascadeShadowTransforms[0]);
 
 	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
 	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
@@ -574,6 +580,17 @@ void ShadowMapApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.Lights[1].Strength = { 0.4f, 0.4f, 0.4f };
 	mMainPassCB.Lights[2].Direction = mRotatedLightDirections[2];
 	mMainPassCB.Lights[2].Strength = { 0.2f, 0.2f, 0.2f };
+
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        XMMATRIX S = XMLoadFloat4x4(&mCascadeShadowTransforms[i]);
+        XMStoreFloat4x4(&mMainPassCB.CascadeShadowTransforms[i], XMMatrixTranspose(S));
+    }
+    mMainPassCB.CascadeSplits = XMFLOAT4(
+        mShadowCascades.GetCascade(0).SplitFar,
+        mShadowCascades.GetCascade(1).SplitFar,
+        mShadowCascades.GetCascade(2).SplitFar,
+        mShadowCascades.GetCascade(3).SplitFar);
  
 	auto currPassCB = mCurrFrameResource->PassCB.get();
 	currPassCB->CopyData(0, mMainPassCB);
@@ -581,31 +598,38 @@ void ShadowMapApp::UpdateMainPassCB(const GameTimer& gt)
 
 void ShadowMapApp::UpdateShadowPassCB(const GameTimer& gt)
 {
-    XMMATRIX view = XMLoadFloat4x4(&mLightView);
-    XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
-
-    XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-    UINT w = mShadowMap->Width();
-    UINT h = mShadowMap->Height();
-
-    XMStoreFloat4x4(&mShadowPassCB.View, XMMatrixTranspose(view));
-    XMStoreFloat4x4(&mShadowPassCB.InvView, XMMatrixTranspose(invView));
-    XMStoreFloat4x4(&mShadowPassCB.Proj, XMMatrixTranspose(proj));
-    XMStoreFloat4x4(&mShadowPassCB.InvProj, XMMatrixTranspose(invProj));
-    XMStoreFloat4x4(&mShadowPassCB.ViewProj, XMMatrixTranspose(viewProj));
-    XMStoreFloat4x4(&mShadowPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-    mShadowPassCB.EyePosW = mLightPosW;
-    mShadowPassCB.RenderTargetSize = XMFLOAT2((float)w, (float)h);
-    mShadowPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / w, 1.0f / h);
-    mShadowPassCB.NearZ = mLightNearZ;
-    mShadowPassCB.FarZ = mLightFarZ;
-
     auto currPassCB = mCurrFrameResource->PassCB.get();
-    currPassCB->CopyData(1, mShadowPassCB);
+
+    // Cascade i is rendered with pass constants 1+i.
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        const ShadowCascade& cascade = mShadowCascades.GetCascade(i);
+
+        XMMATRIX view = XMLoadFloat4x4(&cascade.LightView);
+        XMMATRIX proj = XMLoadFloat4x4(&cascade.LightProj);
+
+        XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+        XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+        XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+        XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+        UINT w = mShadowMap->Width() / 2;
+        UINT h = mShadowMap->Height() / 2;
+
+        XMStoreFloat4x4(&mShadowPassCB.View, XMMatrixTranspose(view));
+        XMStoreFloat4x4(&mShadowPassCB.InvView, XMMatrixTranspose(invView));
+        XMStoreFloat4x4(&mShadowPassCB.Proj, XMMatrixTranspose(proj));
+        XMStoreFloat4x4(&mShadowPassCB.InvProj, XMMatrixTranspose(invProj));
+        XMStoreFloat4x4(&mShadowPassCB.ViewProj, XMMatrixTranspose(viewProj));
+        XMStoreFloat4x4(&mShadowPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
+        mShadowPassCB.EyePosW = cascade.LightPosW;
+        mShadowPassCB.RenderTargetSize = XMFLOAT2((float)w, (float)h);
+        mShadowPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / w, 1.0f / h);
+        mShadowPassCB.NearZ = cascade.LightNearZ;
+        mShadowPassCB.FarZ = cascade.LightFarZ;
+
+        currPassCB->CopyData(1 + i, mShadowPassCB);
+    }
 }
 
 void ShadowMapApp::LoadTextures()
@@ -695,16 +719,8 @@ void ShadowMapApp::BuildDescriptorHeaps()
 	//
 	// Create the SRV heap.
 	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 14;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	mSrvDescriptorHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(),
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true, 14);
 
 	std::vector<ComPtr<ID3D12Resource>> tex2DList = 
 	{
@@ -718,6 +734,29 @@ void ShadowMapApp::BuildDescriptorHeaps()
 	
 	auto skyCubeMap = mTextures["skyCubeMap"]->Resource;
 
+	// The root signature's texture table holds 10 SRVs; the cube map table holds the
+	// sky (or null cube) SRV followed by the shadow map (or null texture) SRV.
+	const UINT texTableSize = 10;
+	assert(tex2DList.size() <= texTableSize);
+	DescriptorRange texRange = mSrvDescriptorHeap->AllocatePersistent(texTableSize);
+	DescriptorRange skyShadowRange = mSrvDescriptorHeap->AllocatePersistent(2);
+	DescriptorRange nullRange = mSrvDescriptorHeap->AllocatePersistent(2);
+
+	mTexTableHeapIndex = texRange.Offset;
+	mSkyTexHeapIndex = skyShadowRange.Offset;
+    mShadowMapHeapIndex = mSkyTexHeapIndex + 1;
+
+    mNullCubeSrvIndex = nullRange.Offset;
+    mNullTexSrvIndex = mNullCubeSrvIndex + 1;
+
+	//
+	// Create the texture SRVs in a CPU-only staging heap, as a texture streamed in at
+	// runtime would be, and copy them into the shader-visible heap in one batch.
+	//
+	DescriptorHeap srvStagingHeap(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		false, (UINT)tex2DList.size() + 1);
+	DescriptorRange stagingRange = srvStagingHeap.AllocatePersistent((UINT)tex2DList.size() + 1);
+
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
@@ -728,46 +767,50 @@ void ShadowMapApp::BuildDescriptorHeaps()
 	{
 		srvDesc.Format = tex2DList[i]->GetDesc().Format;
 		srvDesc.Texture2D.MipLevels = tex2DList[i]->GetDesc().MipLevels;
-		md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, hDescriptor);
+		md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc,
+			srvStagingHeap.GetCpuHandle(stagingRange.Offset + i));
 
-		// next descriptor
-		hDescriptor.Offset(1, mCbvSrvUavDescriptorSize);
+		mSrvDescriptorHeap->QueueCopy(srvStagingHeap, stagingRange.Offset + i, texRange.Offset + i, 1);
 	}
 	
+	// The table is bound whole, so the slots no texture uses get null SRVs rather than
+	// whatever the heap held.
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.Texture2D.MipLevels = 1;
+	for(UINT i = (UINT)tex2DList.size(); i < texTableSize; ++i)
+		md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvDescriptorHeap->GetCpuHandle(texRange.Offset + i));
+
+	UINT skyStagingIndex = stagingRange.Offset + (UINT)tex2DList.size();
+
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
 	srvDesc.TextureCube.MostDetailedMip = 0;
 	srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
 	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
 	srvDesc.Format = skyCubeMap->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
-	
-	mSkyTexHeapIndex = (UINT)tex2DList.size();
-    mShadowMapHeapIndex = mSkyTexHeapIndex + 1;
+	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, srvStagingHeap.GetCpuHandle(skyStagingIndex));
 
-    mNullCubeSrvIndex = mShadowMapHeapIndex + 1;
-    mNullTexSrvIndex = mNullCubeSrvIndex + 1;
+	mSrvDescriptorHeap->QueueCopy(srvStagingHeap, skyStagingIndex, mSkyTexHeapIndex, 1);
+	mSrvDescriptorHeap->FlushCopies();
 
-    auto srvCpuStart = mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-    auto srvGpuStart = mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	//
+	// Null SRVs for the shadow pass, and the shadow map's own descriptors.
+	//
     auto dsvCpuStart = mDsvHeap->GetCPUDescriptorHandleForHeapStart();
 
+    mNullSrv = mSrvDescriptorHeap->GetGpuHandle(mNullCubeSrvIndex);
 
-    auto nullSrv = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, mNullCubeSrvIndex, mCbvSrvUavDescriptorSize);
-    mNullSrv = CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, mNullCubeSrvIndex, mCbvSrvUavDescriptorSize);
-
-    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
-    nullSrv.Offset(1, mCbvSrvUavDescriptorSize);
+    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvDescriptorHeap->GetCpuHandle(mNullCubeSrvIndex));
 
     srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
     srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
     srvDesc.Texture2D.MostDetailedMip = 0;
     srvDesc.Texture2D.MipLevels = 1;
     srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
+    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvDescriptorHeap->GetCpuHandle(mNullTexSrvIndex));
     
     mShadowMap->BuildDescriptors(
-        CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, mShadowMapHeapIndex, mCbvSrvUavDescriptorSize),
-        CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, mShadowMapHeapIndex, mCbvSrvUavDescriptorSize),
+        mSrvDescriptorHeap->GetCpuHandle(mShadowMapHeapIndex),
+        mSrvDescriptorHeap->GetGpuHandle(mShadowMapHeapIndex),
         CD3DX12_CPU_DESCRIPTOR_HANDLE(dsvCpuStart, 1, mDsvDescriptorSize));
 }
 
@@ -833,21 +876,26 @@ void ShadowMapApp::BuildShapeGeometry()
 	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
 	boxSubmesh.StartIndexLocation = boxIndexOffset;
 	boxSubmesh.BaseVertexLocation = boxVertexOffset;
+	// Bounds follow from the dimensions the shapes were generated with.
+	boxSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry gridSubmesh;
 	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
 	gridSubmesh.StartIndexLocation = gridIndexOffset;
 	gridSubmesh.BaseVertexLocation = gridVertexOffset;
+	gridSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(10.0f, 0.0f, 15.0f));
 
 	SubmeshGeometry sphereSubmesh;
 	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
 	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
 	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
+	sphereSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry cylinderSubmesh;
 	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
+	cylinderSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 1.5f, 0.5f));
 
     SubmeshGeometry quadSubmesh;
     quadSubmesh.IndexCount = (UINT)quad.Indices32.size();
@@ -1165,7 +1213,7 @@ void ShadowMapApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            2, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
+            1 + ShadowCascades::MaxCascades, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
     }
 }
 
@@ -1233,6 +1281,7 @@ void ShadowMapApp::BuildRenderItems()
 	skyRitem->Geo = mGeometries["shapeGeo"].get();
 	skyRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	skyRitem->IndexCount = skyRitem->Geo->DrawArgs["sphere"].IndexCount;
+	skyRitem->Bounds = skyRitem->Geo->DrawArgs["sphere"].Bounds;
 	skyRitem->StartIndexLocation = skyRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 	skyRitem->BaseVertexLocation = skyRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1247,6 +1296,7 @@ void ShadowMapApp::BuildRenderItems()
     quadRitem->Geo = mGeometries["shapeGeo"].get();
     quadRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     quadRitem->IndexCount = quadRitem->Geo->DrawArgs["quad"].IndexCount;
+    quadRitem->Bounds = quadRitem->Geo->DrawArgs["quad"].Bounds;
     quadRitem->StartIndexLocation = quadRitem->Geo->DrawArgs["quad"].StartIndexLocation;
     quadRitem->BaseVertexLocation = quadRitem->Geo->DrawArgs["quad"].BaseVertexLocation;
 
@@ -1261,6 +1311,7 @@ void ShadowMapApp::BuildRenderItems()
 	boxRitem->Geo = mGeometries["shapeGeo"].get();
 	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
+	boxRitem->Bounds = boxRitem->Geo->DrawArgs["box"].Bounds;
 	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
 	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
 
@@ -1275,6 +1326,7 @@ void ShadowMapApp::BuildRenderItems()
     skullRitem->Geo = mGeometries["skullGeo"].get();
     skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
+    skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
     skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
     skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
 
@@ -1289,6 +1341,7 @@ void ShadowMapApp::BuildRenderItems()
 	gridRitem->Geo = mGeometries["shapeGeo"].get();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
+    gridRitem->Bounds = gridRitem->Geo->DrawArgs["grid"].Bounds;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
     gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
 
@@ -1317,6 +1370,7 @@ void ShadowMapApp::BuildRenderItems()
 		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
 		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		leftCylRitem->Bounds = leftCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1327,6 +1381,7 @@ void ShadowMapApp::BuildRenderItems()
 		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
 		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		rightCylRitem->Bounds = rightCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1337,6 +1392,7 @@ void ShadowMapApp::BuildRenderItems()
 		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		leftSphereRitem->Bounds = leftSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1347,6 +1403,7 @@ void ShadowMapApp::BuildRenderItems()
 		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		rightSphereRitem->Bounds = rightSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1387,16 +1444,11 @@ void ShadowMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std
 
 void ShadowMapApp::DrawSceneToShadowMap()
 {
-    mCommandList->RSSetViewports(1, &mShadowMap->Viewport());
-    mCommandList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
-
     // Change to DEPTH_WRITE.
     mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
         D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
 
-    UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-
-    // Clear the back buffer and depth buffer.
+    // Clear all cascades at once.
     mCommandList->ClearDepthStencilView(mShadowMap->Dsv(), 
         D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
@@ -1405,14 +1457,29 @@ void ShadowMapApp::DrawSceneToShadowMap()
     // Note the active PSO also must specify a render target count of 0.
     mCommandList->OMSetRenderTargets(0, nullptr, false, &mShadowMap->Dsv());
 
-    // Bind the pass constant buffer for the shadow map pass.
+    UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
     auto passCB = mCurrFrameResource->PassCB->Resource();
-    D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + 1*passCBByteSize;
-    mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
 
     mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    // Each cascade renders its casters into its own quarter of the shadow map.
+    UINT cascadeSize = mShadowMap->Width() / 2;
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        D3D12_VIEWPORT viewport = { (float)((i % 2)*cascadeSize), (float)((i / 2)*cascadeSize),
+            (float)cascadeSize, (float)cascadeSize, 0.0f, 1.0f };
+        D3D12_RECT scissorRect = { (LONG)viewport.TopLeftX, (LONG)viewport.TopLeftY,
+            (LONG)(viewport.TopLeftX + cascadeSize), (LONG)(viewport.TopLeftY + cascadeSize) };
+
+        mCommandList->RSSetViewports(1, &viewport);
+        mCommandList->RSSetScissorRects(1, &scissorRect);
+
+        // Bind the pass constant buffer of the cascade.
+        D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + (1 + i)*passCBByteSize;
+        mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
+
+        DrawRenderItems(mCommandList.Get(), mCascadeCasters[i]);
+    }
 
     // Change back to GENERIC_READ so we can read the texture in a shader.
     mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
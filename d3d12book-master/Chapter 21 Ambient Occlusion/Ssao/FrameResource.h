@@ -3,6 +3,7 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/ShadowCascades.h"
 
 struct ObjectConstants
 {
@@ -40,6 +41,12 @@ struct PassConstants
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light Lights[MaxLights];
+
+    // World to shadow map transforms of the cascades, already offset into the quarter
+    // of the shadow map each cascade is rendered to, and the view space depth each
+    // cascade ends at.
+    DirectX::XMFLOAT4X4 CascadeShadowTransforms[ShadowCascades::MaxCascades];
+    DirectX::XMFLOAT4 CascadeSplits = { 0.0f, 0.0f, 0.0f, 0.0f };
 };
 
 struct SsaoConstants
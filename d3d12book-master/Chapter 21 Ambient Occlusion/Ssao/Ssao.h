@@ -36,6 +36,7 @@ public:
 
 	ID3D12Resource* NormalMap();
 	ID3D12Resource* AmbientMap();
+	ID3D12Resource* AmbientBlurMap();
 	
     CD3DX12_CPU_DESCRIPTOR_HANDLE NormalMapRtv()const;
 	CD3DX12_GPU_DESCRIPTOR_HANDLE NormalMapSrv()const;
@@ -63,23 +64,25 @@ public:
     /// quad to kick off the pixel shader to compute the AmbientMap.  We still keep the
     /// main depth buffer binded to the pipeline, but depth buffer read/writes
     /// are disabled, as we do not need the depth buffer computing the Ambient map.
+    /// The AmbientMap must be in RENDER_TARGET and the normal and depth maps readable;
+    /// the caller records the barriers.
     ///</summary>
-	void ComputeSsao(
+	void DrawSsao(
         ID3D12GraphicsCommandList* cmdList, 
-        FrameResource* currFrame, 
-        int blurCount);
- 
+        FrameResource* currFrame);
 
-private:
- 
     ///<summary>
     /// Blurs the ambient map to smooth out the noise caused by only taking a
     /// few random samples per pixel.  We use an edge preserving blur so that 
     /// we do not blur across discontinuities--we want edges to remain edges.
+    /// One call is one direction: the horizontal blur reads the AmbientMap and writes
+    /// the AmbientBlurMap, the vertical blur the other way around.  The map written
+    /// must be in RENDER_TARGET and the one read readable.
     ///</summary>
-    void BlurAmbientMap(ID3D12GraphicsCommandList* cmdList, FrameResource* currFrame, int blurCount);
-	void BlurAmbientMap(ID3D12GraphicsCommandList* cmdList, bool horzBlur);
+    void BlurAmbientMap(ID3D12GraphicsCommandList* cmdList, FrameResource* currFrame, bool horzBlur);
 
+private:
+ 
     void BuildResources();
     void BuildRandomVectorTexture(ID3D12GraphicsCommandList* cmdList);
  
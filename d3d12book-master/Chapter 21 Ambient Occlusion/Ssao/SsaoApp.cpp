@@ -7,6 +7,15 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/ShadowCascades.h"
+#include "../../Common/RenderGraph.h"
+#include "../../Common/D3D12RenderGraph.h"
+#include "../../Common/ThreadPool.h"
+#include "../../Common/TaskGraph.h"
+#include "../../Common/D3D12ShaderCache.h"
+#include "../../Common/D3D12PipelineStateCache.h"
+#include "../../Common/D3D12GpuTimer.h"
+#include "../../Common/TextModel.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -43,6 +52,9 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+    // Local space bounds, used to cull shadow casters per cascade.
+    BoundingBox Bounds;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -79,30 +91,40 @@ private:
     virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
+    virtual void AppendFrameStats(std::wstring& text)override;
 
     void OnKeyboardInput(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialBuffer(const GameTimer& gt);
     void UpdateShadowTransform(const GameTimer& gt);
+    void UpdateShadowCasters();
+    void AddGpuTimingsToFrameStats();
 	void UpdateMainPassCB(const GameTimer& gt);
     void UpdateShadowPassCB(const GameTimer& gt);
     void UpdateSsaoCB(const GameTimer& gt);
 
-	void LoadTextures();
+	std::vector<std::unique_ptr<Texture>> ListTextures();
+    void CreateTextures(std::vector<std::unique_ptr<Texture>>& textures,
+        const std::vector<ComPtr<ID3DBlob>>& textureFiles);
     void BuildRootSignature();
     void BuildSsaoRootSignature();
 	void BuildDescriptorHeaps();
-    void BuildShadersAndInputLayout();
-    void BuildShapeGeometry();
-    void BuildSkullGeometry();
+    void BuildShadersAndInputLayout(ThreadPool* threadPool);
+    std::unique_ptr<MeshGeometry> BuildShapeGeometry();
+    std::unique_ptr<MeshGeometry> BuildSkullGeometry();
+    void UploadGeometry(std::unique_ptr<MeshGeometry> geo);
     void BuildPSOs();
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
+    void ReportInitTimings(const TaskGraph& initGraph);
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+    void BuildRenderGraph();
+    std::uint32_t AddTimedPass(const std::string& name, RenderGraph::ExecuteFunc execute);
     void DrawSceneToShadowMap();
 	void DrawNormalsAndDepth();
+    void DrawMainPass();
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE GetCpuSrv(int index)const;
     CD3DX12_GPU_DESCRIPTOR_HANDLE GetGpuSrv(int index)const;
@@ -126,7 +148,14 @@ private:
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+	std::unique_ptr<D3D12PipelineStateCache> mPsoCache;
+    PipelineStateHandle mOpaquePso = InvalidPipelineStateHandle;
+    PipelineStateHandle mShadowOpaquePso = InvalidPipelineStateHandle;
+    PipelineStateHandle mDebugPso = InvalidPipelineStateHandle;
+    PipelineStateHandle mDrawNormalsPso = InvalidPipelineStateHandle;
+    PipelineStateHandle mSsaoPso = InvalidPipelineStateHandle;
+    PipelineStateHandle mSsaoBlurPso = InvalidPipelineStateHandle;
+    PipelineStateHandle mSkyPso = InvalidPipelineStateHandle;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
  
@@ -148,7 +177,7 @@ private:
     CD3DX12_GPU_DESCRIPTOR_HANDLE mNullSrv;
 
     PassConstants mMainPassCB;  // index 0 of pass cbuffer.
-    PassConstants mShadowPassCB;// index 1 of pass cbuffer.
+    PassConstants mShadowPassCB;// indices [1, 1+MaxCascades) of pass cbuffer.
 
 	Camera mCamera;
 
@@ -156,14 +185,33 @@ private:
 
     std::unique_ptr<Ssao> mSsao;
 
+    // The passes of a frame and the resources they share.  Compiled once; the
+    // resources are rebound every frame since the back buffer changes and the others
+    // are recreated on resize.
+    RenderGraph mRenderGraph;
+    D3D12RenderGraph mD3DRenderGraph;
+    RenderGraphResource mShadowMapResource = InvalidRenderGraphResource;
+    RenderGraphResource mNormalMapResource = InvalidRenderGraphResource;
+    RenderGraphResource mAmbientMapResource = InvalidRenderGraphResource;
+    RenderGraphResource mAmbientBlurMapResource = InvalidRenderGraphResource;
+    RenderGraphResource mDepthStencilResource = InvalidRenderGraphResource;
+    RenderGraphResource mBackBufferResource = InvalidRenderGraphResource;
+
+    // GPU time of every render graph pass, read a few frames late.
+    std::unique_ptr<D3D12GpuTimer> mGpuTimer;
+
+    // mFrameStats series of the GPU frame time and of each pass, by timing index.
+    std::uint32_t mGpuFrameSeries = 0;
+    std::vector<std::uint32_t> mGpuPassSeries;
+
     DirectX::BoundingSphere mSceneBounds;
 
-    float mLightNearZ = 0.0f;
-    float mLightFarZ = 0.0f;
-    XMFLOAT3 mLightPosW;
-    XMFLOAT4X4 mLightView = MathHelper::Identity4x4();
-    XMFLOAT4X4 mLightProj = MathHelper::Identity4x4();
-    XMFLOAT4X4 mShadowTransform = MathHelper::Identity4x4();
+    // The cascades are packed 2x2 into the shadow map.
+    ShadowCascades mShadowCascades;
+    XMFLOAT4X4 mCascadeShadowTransforms[ShadowCascades::MaxCascades];
+
+    // Opaque items that can cast a shadow into each cascade.
+    std::vector<RenderItem*> mCascadeCasters[ShadowCascades::MaxCascades];
 
     float mLightRotationAngle = 0.0f;
     XMFLOAT3 mBaseLightDirections[3] = {
@@ -229,24 +277,118 @@ bool SsaoApp::Initialize()
     mShadowMap = std::make_unique<ShadowMap>(md3dDevice.Get(),
         2048, 2048);
 
+    // Each cascade gets a quarter of the shadow map.
+    mShadowCascades.SetShadowMapSize(mShadowMap->Width() / 2);
+    mShadowCascades.SetShadowDistance(50.0f);
+
+    mPsoCache = std::make_unique<D3D12PipelineStateCache>(md3dDevice.Get(), L"PipelineLibrary.bin");
+
+    // The render graph has 10 passes.
+    mGpuTimer = std::make_unique<D3D12GpuTimer>(md3dDevice.Get(), mCommandQueue.Get(), gNumFrameResources, 16);
+    mGpuFrameSeries = mFrameStats.add_series("gpu_frame");
+
     mSsao = std::make_unique<Ssao>(
         md3dDevice.Get(),
         mCommandList.Get(),
         mClientWidth, mClientHeight);
 
-	LoadTextures();
-    BuildRootSignature();
-    BuildSsaoRootSignature();
-	BuildDescriptorHeaps();
-    BuildShadersAndInputLayout();
-    BuildShapeGeometry();
-    BuildSkullGeometry();
-	BuildMaterials();
-    BuildRenderItems();
-    BuildFrameResources();
-    BuildPSOs();
+    //
+    // The build steps run as a task graph.  Reading files, compiling shaders and
+    // generating geometry go to the thread pool; the steps creating device objects or
+    // recording to mCommandList run on this thread, one at a time.
+    //
+
+    std::vector<std::unique_ptr<Texture>> textures = ListTextures();
+    std::vector<ComPtr<ID3DBlob>> textureFiles(textures.size());
+    std::unique_ptr<MeshGeometry> shapeGeo;
+    std::unique_ptr<MeshGeometry> skullGeo;
+
+    // The shader compiles share this pool with the other tasks.
+    ThreadPool threadPool;
+    TaskGraph initGraph;
+
+    std::vector<std::uint32_t> readTextures;
+    for(size_t i = 0; i < textures.size(); ++i)
+    {
+        readTextures.push_back(initGraph.AddTask("Read " + textures[i]->Name, [&textures, &textureFiles, i]()
+        {
+            textureFiles[i] = d3dUtil::LoadBinary(textures[i]->Filename);
+        }));
+    }
+
+    std::uint32_t createTextures = initGraph.AddTask("Create textures", [&]()
+    {
+        CreateTextures(textures, textureFiles);
+    }, TaskAffinity::MainThread);
+    for(std::uint32_t readTexture : readTextures)
+        initGraph.AddDependency(createTextures, readTexture);
+
+    std::uint32_t rootSignatures = initGraph.AddTask("Root signatures", [this]()
+    {
+        BuildRootSignature();
+        BuildSsaoRootSignature();
+    }, TaskAffinity::MainThread);
+
+    std::uint32_t descriptorHeaps = initGraph.AddTask("Descriptor heaps", [this]()
+    {
+        BuildDescriptorHeaps();
+    }, TaskAffinity::MainThread);
+    initGraph.AddDependency(descriptorHeaps, createTextures);
+
+    std::uint32_t shaders = initGraph.AddTask("Shaders", [this, &threadPool]()
+    {
+        BuildShadersAndInputLayout(&threadPool);
+    });
+
+    std::uint32_t shapeGeometry = initGraph.AddTask("Shape geometry", [&]()
+    {
+        shapeGeo = BuildShapeGeometry();
+    });
+
+    std::uint32_t skullGeometry = initGraph.AddTask("Skull geometry", [&]()
+    {
+        skullGeo = BuildSkullGeometry();
+    });
+
+    std::uint32_t uploadGeometry = initGraph.AddTask("Upload geometry", [&]()
+    {
+        UploadGeometry(std::move(shapeGeo));
+        UploadGeometry(std::move(skullGeo));
+    }, TaskAffinity::MainThread);
+    initGraph.AddDependency(uploadGeometry, shapeGeometry);
+    initGraph.AddDependency(uploadGeometry, skullGeometry);
+
+    std::uint32_t materials = initGraph.AddTask("Materials", [this]()
+    {
+        BuildMaterials();
+    });
 
-    mSsao->SetPSOs(mPSOs["ssao"].Get(), mPSOs["ssaoBlur"].Get());
+    std::uint32_t renderItems = initGraph.AddTask("Render items", [this]()
+    {
+        BuildRenderItems();
+    });
+    initGraph.AddDependency(renderItems, uploadGeometry);
+    initGraph.AddDependency(renderItems, materials);
+
+    std::uint32_t frameResources = initGraph.AddTask("Frame resources", [this]()
+    {
+        BuildFrameResources();
+    }, TaskAffinity::MainThread);
+    initGraph.AddDependency(frameResources, renderItems);
+
+    std::uint32_t psos = initGraph.AddTask("PSOs", [this]()
+    {
+        BuildPSOs();
+        mSsao->SetPSOs(mPsoCache->Get(mSsaoPso), mPsoCache->Get(mSsaoBlurPso));
+    }, TaskAffinity::MainThread);
+    initGraph.AddDependency(psos, shaders);
+    initGraph.AddDependency(psos, rootSignatures);
+
+    initGraph.Run(&threadPool);
+
+    ReportInitTimings(initGraph);
+
+    BuildRenderGraph();
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -305,13 +447,7 @@ void SsaoApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
     //
     // Animate the lights (and hence shadows).
@@ -331,6 +467,7 @@ void SsaoApp::Update(const GameTimer& gt)
 	UpdateObjectCBs(gt);
 	UpdateMaterialBuffer(gt);
     UpdateShadowTransform(gt);
+    UpdateShadowCasters();
 	UpdateMainPassCB(gt);
     UpdateShadowPassCB(gt);
     UpdateSsaoCB(gt);
@@ -346,7 +483,7 @@ void SsaoApp::Draw(const GameTimer& gt)
 
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPsoCache->Get(mOpaquePso)));
 
     ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
     mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
@@ -370,42 +507,60 @@ void SsaoApp::Draw(const GameTimer& gt)
     // The root signature knows how many descriptors are expected in the table.
     mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 
-    DrawSceneToShadowMap();
+    mD3DRenderGraph.Bind(mShadowMapResource, mShadowMap->Resource());
+    mD3DRenderGraph.Bind(mNormalMapResource, mSsao->NormalMap());
+    mD3DRenderGraph.Bind(mAmbientMapResource, mSsao->AmbientMap());
+    mD3DRenderGraph.Bind(mAmbientBlurMapResource, mSsao->AmbientBlurMap());
+    mD3DRenderGraph.Bind(mDepthStencilResource, mDepthStencilBuffer.Get());
+    mD3DRenderGraph.Bind(mBackBufferResource, CurrentBackBuffer());
 
-	//
-	// Normal/depth pass.
-	//
-	
-	DrawNormalsAndDepth();
-	
-	//
-	// Compute SSAO.
-	// 
-	
-    mCommandList->SetGraphicsRootSignature(mSsaoRootSignature.Get());
-    mSsao->ComputeSsao(mCommandList.Get(), mCurrFrameResource, 3);
-	
-	//
-	// Main rendering pass.
-	//
-	
+    // Read the timings of the frames the GPU has finished.  Update() waited for this
+    // frame resource's previous frame, so the timer slot it used is free again.
+    mGpuTimer->Collect(mFenceTracker->GetCompletedValue(0));
+    AddGpuTimingsToFrameStats();
+    mGpuTimer->BeginFrame();
+
+    // Shadow map, normal/depth, SSAO and main passes, with the barriers between them.
+    mD3DRenderGraph.Execute(mRenderGraph, mCommandList.Get());
+
+    mGpuTimer->EndFrame(mCommandList.Get());
+
+    // Done recording commands.
+    ThrowIfFailed(mCommandList->Close());
+
+    // Add the command list to the queue for execution.
+    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+    // Swap the back and front buffers
+    ThrowIfFailed(mSwapChain->Present(0, 0));
+	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+
+    // Advance the fence value to mark commands up to this fence point.
+    mCurrFrameResource->Fence = ++mCurrentFence;
+
+    // Add an instruction to the command queue to set a new fence point. 
+    // Because we are on the GPU timeline, the new fence point won't be 
+    // set until the GPU finishes processing all the commands prior to this Signal().
+    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+    mGpuTimer->SetFrameFence(mCurrentFence);
+}
+
+void SsaoApp::DrawMainPass()
+{
     mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
     // Rebind state whenever graphics root signature changes.
 
     // Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
     // set as a root descriptor.
-    matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
+    auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
     mCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
 
 
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
     // Clear the back buffer.
     mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
 
@@ -432,37 +587,14 @@ void SsaoApp::Draw(const GameTimer& gt)
     skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvUavDescriptorSize);
     mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
 
-    mCommandList->SetPipelineState(mPSOs["opaque"].Get());
+    mCommandList->SetPipelineState(mPsoCache->Get(mOpaquePso));
     DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
 
-    mCommandList->SetPipelineState(mPSOs["debug"].Get());
+    mCommandList->SetPipelineState(mPsoCache->Get(mDebugPso));
     DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Debug]);
 
-	mCommandList->SetPipelineState(mPSOs["sky"].Get());
+	mCommandList->SetPipelineState(mPsoCache->Get(mSkyPso));
 	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
-
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
-
-    // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
-	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
-
-    // Advance the fence value to mark commands up to this fence point.
-    mCurrFrameResource->Fence = ++mCurrentFence;
-
-    // Add an instruction to the command queue to set a new fence point. 
-    // Because we are on the GPU timeline, the new fence point won't be 
-    // set until the GPU finishes processing all the commands prior to this Signal().
-    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
 }
 
 void SsaoApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -493,6 +625,44 @@ void SsaoApp::OnMouseMove(WPARAM btnState, int x, int y)
     mLastMousePos.x = x;
     mLastMousePos.y = y;
 }
+
+void SsaoApp::AppendFrameStats(std::wstring& text)
+{
+    // GPU milliseconds over the interval mFrameStats just closed: the frame's mean and
+    // 99th percentile, then each pass's mean.
+    const GpuTimer& timer = mGpuTimer->GetTimer();
+
+    auto append = [&text](const std::string& name, double ms)
+    {
+        wchar_t buffer[32];
+        swprintf_s(buffer, L"%.2f", ms);
+        text += L"   " + AnsiToWString(name) + L": " + buffer;
+    };
+
+    const frame_time_summary& gpu = mFrameStats.interval_summary(mGpuFrameSeries);
+    append("gpu", gpu.mean_ms);
+    append("gpu p99", gpu.p99_ms);
+    for(std::uint32_t i = 0; i < mGpuPassSeries.size(); ++i)
+        append(timer.GetPassTimings()[i].Name, mFrameStats.interval_summary(mGpuPassSeries[i]).mean_ms);
+}
+
+void SsaoApp::AddGpuTimingsToFrameStats()
+{
+    // Every frame's GPU times go through mFrameStats like the CPU frame time, so they
+    // get the same percentiles and end up in FrameStats.csv and FrameStats.json.
+    const GpuTimer& timer = mGpuTimer->GetTimer();
+
+    const std::vector<GpuPassTiming>& passes = timer.GetPassTimings();
+    while(mGpuPassSeries.size() < passes.size())
+        mGpuPassSeries.push_back(mFrameStats.add_series("gpu_" + passes[mGpuPassSeries.size()].Name));
+
+    for(const GpuTimingSample& sample : timer.GetCollectedSamples())
+    {
+        std::uint32_t series = sample.Timing == GpuTimer::FrameTiming ?
+            mGpuFrameSeries : mGpuPassSeries[sample.Timing];
+        mFrameStats.add_sample(series, sample.Ms / 1000.0);
+    }
+}
  
 void SsaoApp::OnKeyboardInput(const GameTimer& gt)
 {
@@ -520,6 +690,8 @@ void SsaoApp::AnimateMaterials(const GameTimer& gt)
 
 void SsaoApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -545,6 +717,8 @@ void SsaoApp::UpdateObjectCBs(const GameTimer& gt)
 
 void SsaoApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -573,46 +747,51 @@ void SsaoApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void SsaoApp::UpdateShadowTransform(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
     // Only the first "main" light casts a shadow.
     XMVECTOR lightDir = XMLoadFloat3(&mRotatedLightDirections[0]);
-    XMVECTOR lightPos = -2.0f*mSceneBounds.Radius*lightDir;
-    XMVECTOR targetPos = XMLoadFloat3(&mSceneBounds.Center);
-    XMVECTOR lightUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-    XMMATRIX lightView = XMMatrixLookAtLH(lightPos, targetPos, lightUp);
 
-    XMStoreFloat3(&mLightPosW, lightPos);
+    mShadowCascades.Update(mCamera.GetView(), mCamera.GetFovY(), mCamera.GetAspect(),
+        mCamera.GetNearZ(), mCamera.GetFarZ(), lightDir, mSceneBounds);
+
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        // Scale and offset texture space [0,1]^2 into the quarter of the shadow map
+        // the cascade is rendered to.
+        XMMATRIX atlas = XMMatrixScaling(0.5f, 0.5f, 1.0f)*
+            XMMatrixTranslation(0.5f*(i % 2), 0.5f*(i / 2), 0.0f);
 
-    // Transform bounding sphere to light space.
-    XMFLOAT3 sphereCenterLS;
-    XMStoreFloat3(&sphereCenterLS, XMVector3TransformCoord(targetPos, lightView));
+        XMMATRIX S = XMLoadFloat4x4(&mShadowCascades.GetCascade(i).ShadowTransform)*atlas;
+        XMStoreFloat4x4(&mCascadeShadowTransforms[i], S);
+    }
+}
 
-    // Ortho frustum in light space encloses scene.
-    float l = sphereCenterLS.x - mSceneBounds.Radius;
-    float b = sphereCenterLS.y - mSceneBounds.Radius;
-    float n = sphereCenterLS.z - mSceneBounds.Radius;
-    float r = sphereCenterLS.x + mSceneBounds.Radius;
-    float t = sphereCenterLS.y + mSceneBounds.Radius;
-    float f = sphereCenterLS.z + mSceneBounds.Radius;
+void SsaoApp::UpdateShadowCasters()
+{
+	PROFILE_FUNCTION();
 
-    mLightNearZ = n;
-    mLightFarZ = f;
-    XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(l, r, b, t, n, f);
+    for(auto& casters : mCascadeCasters)
+        casters.clear();
 
-    // Transform NDC space [-1,+1]^2 to texture space [0,1]^2
-    XMMATRIX T(
-        0.5f, 0.0f, 0.0f, 0.0f,
-        0.0f, -0.5f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f, 0.5f, 0.0f, 1.0f);
+    for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+    {
+        BoundingBox worldBounds;
+        ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World));
 
-    XMMATRIX S = lightView*lightProj*T;
-    XMStoreFloat4x4(&mLightView, lightView);
-    XMStoreFloat4x4(&mLightProj, lightProj);
-    XMStoreFloat4x4(&mShadowTransform, S);
+        UINT mask = mShadowCascades.GetCasterMask(worldBounds);
+        for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+        {
+            if(mask & (1u << i))
+                mCascadeCasters[i].push_back(ri);
+        }
+    }
 }
 
 void SsaoApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -629,7 +808,7 @@ void SsaoApp::UpdateMainPassCB(const GameTimer& gt)
         0.5f, 0.5f, 0.0f, 1.0f);
 
     XMMATRIX viewProjTex = XMMatrixMultiply(viewProj, T);
-    XMMATRIX shadowTransform = XMLoadFloat4x4(&mShadowTransform);
+    XMMATRIX shadowTransform = XMLoadFloat4x4(&mCascadeShadowTransforms[0]);
 
 	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
 	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
@@ -653,6 +832,17 @@ void SsaoApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.Lights[1].Strength = { 0.1f, 0.1f, 0.1f };
 	mMainPassCB.Lights[2].Direction = mRotatedLightDirections[2];
 	mMainPassCB.Lights[2].Strength = { 0.0f, 0.0f, 0.0f };
+
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        XMMATRIX S = XMLoadFloat4x4(&mCascadeShadowTransforms[i]);
+        XMStoreFloat4x4(&mMainPassCB.CascadeShadowTransforms[i], XMMatrixTranspose(S));
+    }
+    mMainPassCB.CascadeSplits = XMFLOAT4(
+        mShadowCascades.GetCascade(0).SplitFar,
+        mShadowCascades.GetCascade(1).SplitFar,
+        mShadowCascades.GetCascade(2).SplitFar,
+        mShadowCascades.GetCascade(3).SplitFar);
  
 	auto currPassCB = mCurrFrameResource->PassCB.get();
 	currPassCB->CopyData(0, mMainPassCB);
@@ -660,35 +850,46 @@ void SsaoApp::UpdateMainPassCB(const GameTimer& gt)
 
 void SsaoApp::UpdateShadowPassCB(const GameTimer& gt)
 {
-    XMMATRIX view = XMLoadFloat4x4(&mLightView);
-    XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
-
-    XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-    UINT w = mShadowMap->Width();
-    UINT h = mShadowMap->Height();
-
-    XMStoreFloat4x4(&mShadowPassCB.View, XMMatrixTranspose(view));
-    XMStoreFloat4x4(&mShadowPassCB.InvView, XMMatrixTranspose(invView));
-    XMStoreFloat4x4(&mShadowPassCB.Proj, XMMatrixTranspose(proj));
-    XMStoreFloat4x4(&mShadowPassCB.InvProj, XMMatrixTranspose(invProj));
-    XMStoreFloat4x4(&mShadowPassCB.ViewProj, XMMatrixTranspose(viewProj));
-    XMStoreFloat4x4(&mShadowPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-    mShadowPassCB.EyePosW = mLightPosW;
-    mShadowPassCB.RenderTargetSize = XMFLOAT2((float)w, (float)h);
-    mShadowPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / w, 1.0f / h);
-    mShadowPassCB.NearZ = mLightNearZ;
-    mShadowPassCB.FarZ = mLightFarZ;
+	PROFILE_FUNCTION();
 
     auto currPassCB = mCurrFrameResource->PassCB.get();
-    currPassCB->CopyData(1, mShadowPassCB);
+
+    // Cascade i is rendered with pass constants 1+i.
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        const ShadowCascade& cascade = mShadowCascades.GetCascade(i);
+
+        XMMATRIX view = XMLoadFloat4x4(&cascade.LightView);
+        XMMATRIX proj = XMLoadFloat4x4(&cascade.LightProj);
+
+        XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+        XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+        XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+        XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+        UINT w = mShadowMap->Width() / 2;
+        UINT h = mShadowMap->Height() / 2;
+
+        XMStoreFloat4x4(&mShadowPassCB.View, XMMatrixTranspose(view));
+        XMStoreFloat4x4(&mShadowPassCB.InvView, XMMatrixTranspose(invView));
+        XMStoreFloat4x4(&mShadowPassCB.Proj, XMMatrixTranspose(proj));
+        XMStoreFloat4x4(&mShadowPassCB.InvProj, XMMatrixTranspose(invProj));
+        XMStoreFloat4x4(&mShadowPassCB.ViewProj, XMMatrixTranspose(viewProj));
+        XMStoreFloat4x4(&mShadowPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
+        mShadowPassCB.EyePosW = cascade.LightPosW;
+        mShadowPassCB.RenderTargetSize = XMFLOAT2((float)w, (float)h);
+        mShadowPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / w, 1.0f / h);
+        mShadowPassCB.NearZ = cascade.LightNearZ;
+        mShadowPassCB.FarZ = cascade.LightFarZ;
+
+        currPassCB->CopyData(1 + i, mShadowPassCB);
+    }
 }
 
 void SsaoApp::UpdateSsaoCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
     SsaoConstants ssaoCB;
 
     XMMATRIX P = mCamera.GetProj();
@@ -723,7 +924,7 @@ void SsaoApp::UpdateSsaoCB(const GameTimer& gt)
     currSsaoCB->CopyData(0, ssaoCB);
 }
 
-void SsaoApp::LoadTextures()
+std::vector<std::unique_ptr<Texture>> SsaoApp::ListTextures()
 {
 	std::vector<std::string> texNames = 
 	{
@@ -747,17 +948,30 @@ void SsaoApp::LoadTextures()
         L"../../Textures/sunsetcube1024.dds"
     };
 	
+	std::vector<std::unique_ptr<Texture>> textures;
 	for(int i = 0; i < (int)texNames.size(); ++i)
 	{
 		auto texMap = std::make_unique<Texture>();
 		texMap->Name = texNames[i];
 		texMap->Filename = texFilenames[i];
-		ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-			mCommandList.Get(), texMap->Filename.c_str(),
-			texMap->Resource, texMap->UploadHeap));
-			
+		textures.push_back(std::move(texMap));
+	}
+
+	return textures;
+}
+
+void SsaoApp::CreateTextures(std::vector<std::unique_ptr<Texture>>& textures,
+	const std::vector<ComPtr<ID3DBlob>>& textureFiles)
+{
+	for(size_t i = 0; i < textures.size(); ++i)
+	{
+		auto& texMap = textures[i];
+		ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(md3dDevice.Get(),
+			mCommandList.Get(), (const uint8_t*)textureFiles[i]->GetBufferPointer(),
+			textureFiles[i]->GetBufferSize(), texMap->Resource, texMap->UploadHeap));
+
 		mTextures[texMap->Name] = std::move(texMap);
-	}		
+	}
 }
 
 void SsaoApp::BuildRootSignature()
@@ -803,6 +1017,8 @@ void SsaoApp::BuildRootSignature()
         serializedRootSig->GetBufferPointer(),
         serializedRootSig->GetBufferSize(),
         IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+
+    mPsoCache->RegisterRootSignature(mRootSignature.Get(), serializedRootSig.Get());
 }
 
 void SsaoApp::BuildSsaoRootSignature()
@@ -881,6 +1097,8 @@ void SsaoApp::BuildSsaoRootSignature()
         serializedRootSig->GetBufferPointer(),
         serializedRootSig->GetBufferSize(),
         IID_PPV_ARGS(mSsaoRootSignature.GetAddressOf())));
+
+    mPsoCache->RegisterRootSignature(mSsaoRootSignature.Get(), serializedRootSig.Get());
 }
 
 void SsaoApp::BuildDescriptorHeaps()
@@ -972,7 +1190,7 @@ void SsaoApp::BuildDescriptorHeaps()
         mRtvDescriptorSize);
 }
 
-void SsaoApp::BuildShadersAndInputLayout()
+void SsaoApp::BuildShadersAndInputLayout(ThreadPool* threadPool)
 {
 	const D3D_SHADER_MACRO alphaTestDefines[] =
 	{
@@ -980,27 +1198,34 @@ void SsaoApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	// Compiled shaders are kept in a pack next to the sources, so only shaders whose
+	// source (or an include) changed are compiled again, on the workers threadPool has
+	// free.
+	D3D12ShaderCache shaderCache(L"Shaders\\ShaderCache.bin", threadPool);
+
+	shaderCache.Add(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1", mShaders["standardVS"]);
+	shaderCache.Add(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1", mShaders["opaquePS"]);
 
-    mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["shadowOpaquePS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1");
-    mShaders["shadowAlphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
+    shaderCache.Add(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1", mShaders["shadowVS"]);
+    shaderCache.Add(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1", mShaders["shadowOpaquePS"]);
+    shaderCache.Add(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1", mShaders["shadowAlphaTestedPS"]);
 	
-    mShaders["debugVS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["debugPS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1");
+    shaderCache.Add(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1", mShaders["debugVS"]);
+    shaderCache.Add(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1", mShaders["debugPS"]);
 
-    mShaders["drawNormalsVS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["drawNormalsPS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1");
+    shaderCache.Add(L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1", mShaders["drawNormalsVS"]);
+    shaderCache.Add(L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1", mShaders["drawNormalsPS"]);
 
-    mShaders["ssaoVS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoPS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1");
+    shaderCache.Add(L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1", mShaders["ssaoVS"]);
+    shaderCache.Add(L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1", mShaders["ssaoPS"]);
 
-    mShaders["ssaoBlurVS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoBlurPS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1");
+    shaderCache.Add(L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1", mShaders["ssaoBlurVS"]);
+    shaderCache.Add(L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1", mShaders["ssaoBlurPS"]);
 
-	mShaders["skyVS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["skyPS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1");
+	shaderCache.Add(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1", mShaders["skyVS"]);
+	shaderCache.Add(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1", mShaders["skyPS"]);
+
+	shaderCache.CompileAll();
 
     mInputLayout =
     {
@@ -1011,7 +1236,7 @@ void SsaoApp::BuildShadersAndInputLayout()
     };
 }
 
-void SsaoApp::BuildShapeGeometry()
+std::unique_ptr<MeshGeometry> SsaoApp::BuildShapeGeometry()
 {
     GeometryGenerator geoGen;
 	GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
@@ -1043,21 +1268,26 @@ void SsaoApp::BuildShapeGeometry()
 	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
 	boxSubmesh.StartIndexLocation = boxIndexOffset;
 	boxSubmesh.BaseVertexLocation = boxVertexOffset;
+	// Bounds follow from the dimensions the shapes were generated with.
+	boxSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry gridSubmesh;
 	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
 	gridSubmesh.StartIndexLocation = gridIndexOffset;
 	gridSubmesh.BaseVertexLocation = gridVertexOffset;
+	gridSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(10.0f, 0.0f, 15.0f));
 
 	SubmeshGeometry sphereSubmesh;
 	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
 	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
 	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
+	sphereSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry cylinderSubmesh;
 	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
+	cylinderSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 1.5f, 0.5f));
 
     SubmeshGeometry quadSubmesh;
     quadSubmesh.IndexCount = (UINT)quad.Indices32.size();
@@ -1138,12 +1368,6 @@ void SsaoApp::BuildShapeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -1155,81 +1379,29 @@ void SsaoApp::BuildShapeGeometry()
 	geo->DrawArgs["cylinder"] = cylinderSubmesh;
     geo->DrawArgs["quad"] = quadSubmesh;
 
-	mGeometries[geo->Name] = std::move(geo);
+	return geo;
 }
 
-void SsaoApp::BuildSkullGeometry()
+std::unique_ptr<MeshGeometry> SsaoApp::BuildSkullGeometry()
 {
-    std::ifstream fin("Models/skull.txt");
-
-    if (!fin)
+    TextModel skull;
+    if (!LoadTextModel("Models/skull.txt", skull))
     {
         MessageBox(0, L"Models/skull.txt not found.", 0, 0);
-        return;
+        return nullptr;
     }
 
-    UINT vcount = 0;
-    UINT tcount = 0;
-    std::string ignore;
-
-    fin >> ignore >> vcount;
-    fin >> ignore >> tcount;
-    fin >> ignore >> ignore >> ignore >> ignore;
-
-    XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
-    XMFLOAT3 vMaxf3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
-
-    XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-    XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
-
-    std::vector<Vertex> vertices(vcount);
-    for (UINT i = 0; i < vcount; ++i)
+    std::vector<Vertex> vertices(skull.Vertices.size());
+    for (size_t i = 0; i < skull.Vertices.size(); ++i)
     {
-        fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-        fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-
-        vertices[i].TexC = { 0.0f, 0.0f };
-
-        XMVECTOR P = XMLoadFloat3(&vertices[i].Pos);
-
-        XMVECTOR N = XMLoadFloat3(&vertices[i].Normal);
-
-        // Generate a tangent vector so normal mapping works.  We aren't applying
-        // a texture map to the skull, so we just need any tangent vector so that
-        // the math works out to give us the original interpolated vertex normal.
-        XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-        if (fabsf(XMVectorGetX(XMVector3Dot(N, up))) < 1.0f - 0.001f)
-        {
-            XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
-            XMStoreFloat3(&vertices[i].TangentU, T);
-        }
-        else
-        {
-            up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
-            XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, up));
-            XMStoreFloat3(&vertices[i].TangentU, T);
-        }
-
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
-    }
-
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
-
-    fin >> ignore;
-    fin >> ignore;
-    fin >> ignore;
-
-    std::vector<std::int32_t> indices(3 * tcount);
-    for (UINT i = 0; i < tcount; ++i)
-    {
-        fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
+        vertices[i].Pos = skull.Vertices[i].Pos;
+        vertices[i].Normal = skull.Vertices[i].Normal;
+        vertices[i].TexC = skull.Vertices[i].TexC;
+        vertices[i].TangentU = skull.Vertices[i].TangentU;
     }
 
-    fin.close();
+    const BoundingBox& bounds = skull.Bounds;
+    const std::vector<std::int32_t>& indices = skull.Indices;
 
     //
     // Pack the indices of all the meshes into one index buffer.
@@ -1248,12 +1420,6 @@ void SsaoApp::BuildSkullGeometry()
     ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
     CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-        mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-        mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
     geo->IndexFormat = DXGI_FORMAT_R32_UINT;
@@ -1267,6 +1433,20 @@ void SsaoApp::BuildSkullGeometry()
 
     geo->DrawArgs["skull"] = submesh;
 
+    return geo;
+}
+
+void SsaoApp::UploadGeometry(std::unique_ptr<MeshGeometry> geo)
+{
+    if(geo == nullptr)
+        return;
+
+    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+        geo->VertexBufferCPU->GetBufferPointer(), geo->VertexBufferByteSize, geo->VertexBufferUploader);
+
+    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+        geo->IndexBufferCPU->GetBufferPointer(), geo->IndexBufferByteSize, geo->IndexBufferUploader);
+
     mGeometries[geo->Name] = std::move(geo);
 }
 
@@ -1306,7 +1486,7 @@ void SsaoApp::BuildPSOs()
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc = basePsoDesc;
     opaquePsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
     opaquePsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+    mOpaquePso = mPsoCache->Create(opaquePsoDesc);
 
     //
     // PSO for shadow map pass.
@@ -1330,7 +1510,7 @@ void SsaoApp::BuildPSOs()
     // Shadow map pass does not have a render target.
     smapPsoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
     smapPsoDesc.NumRenderTargets = 0;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&smapPsoDesc, IID_PPV_ARGS(&mPSOs["shadow_opaque"])));
+    mShadowOpaquePso = mPsoCache->Create(smapPsoDesc);
 
     //
     // PSO for debug layer.
@@ -1347,7 +1527,7 @@ void SsaoApp::BuildPSOs()
         reinterpret_cast<BYTE*>(mShaders["debugPS"]->GetBufferPointer()),
         mShaders["debugPS"]->GetBufferSize()
     };
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&debugPsoDesc, IID_PPV_ARGS(&mPSOs["debug"])));
+    mDebugPso = mPsoCache->Create(debugPsoDesc);
 
     //
     // PSO for drawing normals.
@@ -1367,7 +1547,7 @@ void SsaoApp::BuildPSOs()
     drawNormalsPsoDesc.SampleDesc.Count = 1;
     drawNormalsPsoDesc.SampleDesc.Quality = 0;
     drawNormalsPsoDesc.DSVFormat = mDepthStencilFormat;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&drawNormalsPsoDesc, IID_PPV_ARGS(&mPSOs["drawNormals"])));
+    mDrawNormalsPso = mPsoCache->Create(drawNormalsPsoDesc);
 
     //
     // PSO for SSAO.
@@ -1393,7 +1573,7 @@ void SsaoApp::BuildPSOs()
     ssaoPsoDesc.SampleDesc.Count = 1;
     ssaoPsoDesc.SampleDesc.Quality = 0;
     ssaoPsoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&ssaoPsoDesc, IID_PPV_ARGS(&mPSOs["ssao"])));
+    mSsaoPso = mPsoCache->Create(ssaoPsoDesc);
 
     //
     // PSO for SSAO blur.
@@ -1409,7 +1589,7 @@ void SsaoApp::BuildPSOs()
         reinterpret_cast<BYTE*>(mShaders["ssaoBlurPS"]->GetBufferPointer()),
         mShaders["ssaoBlurPS"]->GetBufferSize()
     };
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&ssaoBlurPsoDesc, IID_PPV_ARGS(&mPSOs["ssaoBlur"])));
+    mSsaoBlurPso = mPsoCache->Create(ssaoBlurPsoDesc);
 
 	//
 	// PSO for sky.
@@ -1434,8 +1614,9 @@ void SsaoApp::BuildPSOs()
 		reinterpret_cast<BYTE*>(mShaders["skyPS"]->GetBufferPointer()),
 		mShaders["skyPS"]->GetBufferSize()
 	};
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&skyPsoDesc, IID_PPV_ARGS(&mPSOs["sky"])));
+	mSkyPso = mPsoCache->Create(skyPsoDesc);
 
+    mPsoCache->Save();
 }
 
 void SsaoApp::BuildFrameResources()
@@ -1443,7 +1624,7 @@ void SsaoApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            2, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
+            1 + ShadowCascades::MaxCascades, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
     }
 }
 
@@ -1511,6 +1692,7 @@ void SsaoApp::BuildRenderItems()
 	skyRitem->Geo = mGeometries["shapeGeo"].get();
 	skyRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	skyRitem->IndexCount = skyRitem->Geo->DrawArgs["sphere"].IndexCount;
+	skyRitem->Bounds = skyRitem->Geo->DrawArgs["sphere"].Bounds;
 	skyRitem->StartIndexLocation = skyRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 	skyRitem->BaseVertexLocation = skyRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1525,6 +1707,7 @@ void SsaoApp::BuildRenderItems()
     quadRitem->Geo = mGeometries["shapeGeo"].get();
     quadRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     quadRitem->IndexCount = quadRitem->Geo->DrawArgs["quad"].IndexCount;
+    quadRitem->Bounds = quadRitem->Geo->DrawArgs["quad"].Bounds;
     quadRitem->StartIndexLocation = quadRitem->Geo->DrawArgs["quad"].StartIndexLocation;
     quadRitem->BaseVertexLocation = quadRitem->Geo->DrawArgs["quad"].BaseVertexLocation;
 
@@ -1539,6 +1722,7 @@ void SsaoApp::BuildRenderItems()
 	boxRitem->Geo = mGeometries["shapeGeo"].get();
 	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
+	boxRitem->Bounds = boxRitem->Geo->DrawArgs["box"].Bounds;
 	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
 	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
 
@@ -1553,6 +1737,7 @@ void SsaoApp::BuildRenderItems()
     skullRitem->Geo = mGeometries["skullGeo"].get();
     skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
+    skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
     skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
     skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
 
@@ -1567,6 +1752,7 @@ void SsaoApp::BuildRenderItems()
 	gridRitem->Geo = mGeometries["shapeGeo"].get();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
+    gridRitem->Bounds = gridRitem->Geo->DrawArgs["grid"].Bounds;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
     gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
 
@@ -1595,6 +1781,7 @@ void SsaoApp::BuildRenderItems()
 		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
 		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		leftCylRitem->Bounds = leftCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1605,6 +1792,7 @@ void SsaoApp::BuildRenderItems()
 		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
 		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		rightCylRitem->Bounds = rightCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1615,6 +1803,7 @@ void SsaoApp::BuildRenderItems()
 		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		leftSphereRitem->Bounds = leftSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1625,6 +1814,7 @@ void SsaoApp::BuildRenderItems()
 		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		rightSphereRitem->Bounds = rightSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1640,6 +1830,29 @@ void SsaoApp::BuildRenderItems()
 	}
 }
 
+void SsaoApp::ReportInitTimings(const TaskGraph& initGraph)
+{
+    // To the debugger output, and to InitTimings.txt next to the frame stats.
+    std::ofstream fout("InitTimings.txt", std::ios::trunc);
+
+    char line[256];
+    for(std::uint32_t i = 0; i < initGraph.GetTaskCount(); ++i)
+    {
+        const TaskTiming& timing = initGraph.GetTiming(i);
+        sprintf_s(line, "Init: %-28s %8.2f ms - %8.2f ms %s\n", initGraph.GetTaskName(i).c_str(),
+            1000.0*timing.StartSeconds, 1000.0*timing.EndSeconds,
+            timing.RanOnMainThread ? "(main thread)" : "");
+        ::OutputDebugStringA(line);
+        fout << line;
+    }
+
+    sprintf_s(line, "Init: %.2f ms, %.2f ms if run serially, %.2f ms critical path\n",
+        1000.0*initGraph.GetElapsedSeconds(), 1000.0*initGraph.GetSerialSeconds(),
+        1000.0*initGraph.GetCriticalPathSeconds());
+    ::OutputDebugStringA(line);
+    fout << line;
+}
+
 void SsaoApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
@@ -1663,35 +1876,117 @@ void SsaoApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vec
     }
 }
 
-void SsaoApp::DrawSceneToShadowMap()
+void SsaoApp::BuildRenderGraph()
 {
-    mCommandList->RSSetViewports(1, &mShadowMap->Viewport());
-    mCommandList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
+    const std::uint32_t ShaderRead = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+
+    // Every resource starts and ends the frame in the state it was created in.
+    mShadowMapResource = mRenderGraph.ImportResource("ShadowMap",
+        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_GENERIC_READ);
+    mNormalMapResource = mRenderGraph.ImportResource("NormalMap",
+        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_GENERIC_READ);
+    mAmbientMapResource = mRenderGraph.ImportResource("AmbientMap",
+        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_GENERIC_READ);
+    mAmbientBlurMapResource = mRenderGraph.ImportResource("AmbientBlurMap",
+        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_GENERIC_READ);
+    mDepthStencilResource = mRenderGraph.ImportResource("DepthStencil",
+        D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    mBackBufferResource = mRenderGraph.ImportResource("BackBuffer",
+        D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+
+    mRenderGraph.MarkOutput(mBackBufferResource);
+
+    std::uint32_t pass = AddTimedPass("Shadow", [this]() { DrawSceneToShadowMap(); });
+    mRenderGraph.Write(pass, mShadowMapResource, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    pass = AddTimedPass("NormalsAndDepth", [this]() { DrawNormalsAndDepth(); });
+    mRenderGraph.Write(pass, mNormalMapResource, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    mRenderGraph.Write(pass, mDepthStencilResource, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // The SSAO and blur shaders sample the depth buffer, so it has to be in a read
+    // state while they run.
+    pass = AddTimedPass("Ssao", [this]()
+    {
+        mCommandList->SetGraphicsRootSignature(mSsaoRootSignature.Get());
+        mSsao->DrawSsao(mCommandList.Get(), mCurrFrameResource);
+    });
+    mRenderGraph.Read(pass, mNormalMapResource, ShaderRead);
+    mRenderGraph.Read(pass, mDepthStencilResource, D3D12_RESOURCE_STATE_DEPTH_READ | ShaderRead);
+    mRenderGraph.Write(pass, mAmbientMapResource, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    const int blurCount = 3;
+    for(int i = 0; i < blurCount; ++i)
+    {
+        pass = AddTimedPass("SsaoBlurH", [this]() { mSsao->BlurAmbientMap(mCommandList.Get(), mCurrFrameResource, true); });
+        mRenderGraph.Read(pass, mNormalMapResource, ShaderRead);
+        mRenderGraph.Read(pass, mDepthStencilResource, D3D12_RESOURCE_STATE_DEPTH_READ | ShaderRead);
+        mRenderGraph.Read(pass, mAmbientMapResource, ShaderRead);
+        mRenderGraph.Write(pass, mAmbientBlurMapResource, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        pass = AddTimedPass("SsaoBlurV", [this]() { mSsao->BlurAmbientMap(mCommandList.Get(), mCurrFrameResource, false); });
+        mRenderGraph.Read(pass, mNormalMapResource, ShaderRead);
+        mRenderGraph.Read(pass, mDepthStencilResource, D3D12_RESOURCE_STATE_DEPTH_READ | ShaderRead);
+        mRenderGraph.Read(pass, mAmbientBlurMapResource, ShaderRead);
+        mRenderGraph.Write(pass, mAmbientMapResource, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+
+    // The main pass tests against the depth written by the normal/depth pass, and the
+    // sky writes to it.
+    pass = AddTimedPass("Main", [this]() { DrawMainPass(); });
+    mRenderGraph.Read(pass, mShadowMapResource, ShaderRead);
+    mRenderGraph.Read(pass, mAmbientMapResource, ShaderRead);
+    mRenderGraph.Read(pass, mDepthStencilResource, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    mRenderGraph.Write(pass, mDepthStencilResource, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    mRenderGraph.Write(pass, mBackBufferResource, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-    // Change to DEPTH_WRITE.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
-        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+    mRenderGraph.Compile();
+}
 
-    // Clear the back buffer and depth buffer.
+std::uint32_t SsaoApp::AddTimedPass(const std::string& name, RenderGraph::ExecuteFunc execute)
+{
+    // The barriers before a pass are not part of its time.
+    return mRenderGraph.AddPass(name, [this, name, execute]()
+    {
+        UINT query = mGpuTimer->BeginPass(mCommandList.Get(), name);
+        execute();
+        mGpuTimer->EndPass(mCommandList.Get(), query);
+    });
+}
+
+void SsaoApp::DrawSceneToShadowMap()
+{
+    // Clear all cascades at once.
     mCommandList->ClearDepthStencilView(mShadowMap->Dsv(), 
         D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    // Specify the buffers we are going to render to.
+    // Set null render target because we are only going to draw to
+    // depth buffer.  Setting a null render target will disable color writes.
+    // Note the active PSO also must specify a render target count of 0.
     mCommandList->OMSetRenderTargets(0, nullptr, false, &mShadowMap->Dsv());
 
-    // Bind the pass constant buffer for the shadow map pass.
     UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
     auto passCB = mCurrFrameResource->PassCB->Resource();
-    D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + 1*passCBByteSize;
-    mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
 
-    mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
+    mCommandList->SetPipelineState(mPsoCache->Get(mShadowOpaquePso));
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    // Each cascade renders its casters into its own quarter of the shadow map.
+    UINT cascadeSize = mShadowMap->Width() / 2;
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        D3D12_VIEWPORT viewport = { (float)((i % 2)*cascadeSize), (float)((i / 2)*cascadeSize),
+            (float)cascadeSize, (float)cascadeSize, 0.0f, 1.0f };
+        D3D12_RECT scissorRect = { (LONG)viewport.TopLeftX, (LONG)viewport.TopLeftY,
+            (LONG)(viewport.TopLeftX + cascadeSize), (LONG)(viewport.TopLeftY + cascadeSize) };
+
+        mCommandList->RSSetViewports(1, &viewport);
+        mCommandList->RSSetScissorRects(1, &scissorRect);
+
+        // Bind the pass constant buffer of the cascade.
+        D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + (1 + i)*passCBByteSize;
+        mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
 
-    // Change back to GENERIC_READ so we can read the texture in a shader.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
-        D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ));
+        DrawRenderItems(mCommandList.Get(), mCascadeCasters[i]);
+    }
 }
  
 void SsaoApp::DrawNormalsAndDepth()
@@ -1699,13 +1994,8 @@ void SsaoApp::DrawNormalsAndDepth()
 	mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
-	auto normalMap = mSsao->NormalMap();
 	auto normalMapRtv = mSsao->NormalMapRtv();
 	
-    // Change to RENDER_TARGET.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(normalMap,
-        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
 	// Clear the screen normal map and depth buffer.
 	float clearValue[] = {0.0f, 0.0f, 1.0f, 0.0f};
     mCommandList->ClearRenderTargetView(normalMapRtv, clearValue, 0, nullptr);
@@ -1718,13 +2008,9 @@ void SsaoApp::DrawNormalsAndDepth()
     auto passCB = mCurrFrameResource->PassCB->Resource();
     mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
 
-    mCommandList->SetPipelineState(mPSOs["drawNormals"].Get());
+    mCommandList->SetPipelineState(mPsoCache->Get(mDrawNormalsPso));
 
     DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-    // Change back to GENERIC_READ so we can read the texture in a shader.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(normalMap,
-        D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
 }
 
 CD3DX12_CPU_DESCRIPTOR_HANDLE SsaoApp::GetCpuSrv(int index)const
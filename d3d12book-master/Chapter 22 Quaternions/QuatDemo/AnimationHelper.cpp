@@ -54,7 +54,7 @@ void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
 	}
 	else
 	{
-		for(UINT i = 0; i < Keyframes.size()-1; ++i)
+		for(std::uint32_t i = 0; i < Keyframes.size()-1; ++i)
 		{
 			if( t >= Keyframes[i].TimePos && t <= Keyframes[i+1].TimePos )
 			{
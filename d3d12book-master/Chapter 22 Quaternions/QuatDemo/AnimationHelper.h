@@ -7,7 +7,9 @@
 #ifndef ANIMATION_HELPER_H
 #define ANIMATION_HELPER_H
 
-#include "../../Common/d3dUtil.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
 
 ///<summary>
 /// A Keyframe defines the bone transformation at an instant in time.
@@ -1,20 +1,26 @@
 #include "LoadM3d.h"
+#include "../../Common/MappedFile.h"
  
 using namespace DirectX;
 
 bool M3DLoader::LoadM3d(const std::string& filename, 
 						std::vector<Vertex>& vertices,
-						std::vector<USHORT>& indices,
+						std::vector<std::uint16_t>& indices,
 						std::vector<Subset>& subsets,
 						std::vector<M3dMaterial>& mats)
 {
-	std::ifstream fin(filename);
+	// Parsed straight out of a mapping of the file, like the skull in the Ssao demo.
+	MappedFile file;
+	if(!file.Open(filename, MappedFileHint::Sequential))
+		return false;
 
-	UINT numMaterials = 0;
-	UINT numVertices  = 0;
-	UINT numTriangles = 0;
-	UINT numBones     = 0;
-	UINT numAnimationClips = 0;
+	MemoryInputStream fin(file.GetData(), file.GetSize());
+
+	std::uint32_t numMaterials = 0;
+	std::uint32_t numVertices  = 0;
+	std::uint32_t numTriangles = 0;
+	std::uint32_t numBones     = 0;
+	std::uint32_t numAnimationClips = 0;
 
 	std::string ignore;
 
@@ -39,18 +45,22 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 
 bool M3DLoader::LoadM3d(const std::string& filename, 
 						std::vector<SkinnedVertex>& vertices,
-						std::vector<USHORT>& indices,
+						std::vector<std::uint16_t>& indices,
 						std::vector<Subset>& subsets,
 						std::vector<M3dMaterial>& mats,
 						SkinnedData& skinInfo)
 {
-    std::ifstream fin(filename);
+	MappedFile file;
+	if(!file.Open(filename, MappedFileHint::Sequential))
+		return false;
+
+	MemoryInputStream fin(file.GetData(), file.GetSize());
 
-	UINT numMaterials = 0;
-	UINT numVertices  = 0;
-	UINT numTriangles = 0;
-	UINT numBones     = 0;
-	UINT numAnimationClips = 0;
+	std::uint32_t numMaterials = 0;
+	std::uint32_t numVertices  = 0;
+	std::uint32_t numTriangles = 0;
+	std::uint32_t numBones     = 0;
+	std::uint32_t numAnimationClips = 0;
 
 	std::string ignore;
 
@@ -82,7 +92,7 @@ bool M3DLoader::LoadM3d(const std::string& filename,
     return false;
 }
 
-void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats)
+void M3DLoader::ReadMaterials(std::istream& fin, std::uint32_t numMaterials, std::vector<M3dMaterial>& mats)
 {
 	 std::string ignore;
      mats.resize(numMaterials);
@@ -91,7 +101,7 @@ void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector
 	 std::string normalMapName;
 
      fin >> ignore; // materials header text
-	 for(UINT i = 0; i < numMaterials; ++i)
+	 for(std::uint32_t i = 0; i < numMaterials; ++i)
 	 {
          fin >> ignore >> mats[i].Name;
 		 fin >> ignore >> mats[i].DiffuseAlbedo.x  >> mats[i].DiffuseAlbedo.y  >> mats[i].DiffuseAlbedo.z;
@@ -104,13 +114,13 @@ void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector
 		}
 }
 
-void M3DLoader::ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets)
+void M3DLoader::ReadSubsetTable(std::istream& fin, std::uint32_t numSubsets, std::vector<Subset>& subsets)
 {
     std::string ignore;
 	subsets.resize(numSubsets);
 
 	fin >> ignore; // subset header text
-	for(UINT i = 0; i < numSubsets; ++i)
+	for(std::uint32_t i = 0; i < numSubsets; ++i)
 	{
         fin >> ignore >> subsets[i].Id;
 		fin >> ignore >> subsets[i].VertexStart;
@@ -120,13 +130,13 @@ void M3DLoader::ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector
     }
 }
 
-void M3DLoader::ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices)
+void M3DLoader::ReadVertices(std::istream& fin, std::uint32_t numVertices, std::vector<Vertex>& vertices)
 {
 	std::string ignore;
     vertices.resize(numVertices);
 
     fin >> ignore; // vertices header text
-    for(UINT i = 0; i < numVertices; ++i)
+    for(std::uint32_t i = 0; i < numVertices; ++i)
     {
 	    fin >> ignore >> vertices[i].Pos.x      >> vertices[i].Pos.y      >> vertices[i].Pos.z;
 		fin >> ignore >> vertices[i].TangentU.x >> vertices[i].TangentU.y >> vertices[i].TangentU.z >> vertices[i].TangentU.w;
@@ -135,7 +145,7 @@ void M3DLoader::ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<V
     }
 }
 
-void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices)
+void M3DLoader::ReadSkinnedVertices(std::istream& fin, std::uint32_t numVertices, std::vector<SkinnedVertex>& vertices)
 {
 	std::string ignore;
     vertices.resize(numVertices);
@@ -143,7 +153,7 @@ void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::v
     fin >> ignore; // vertices header text
 	int boneIndices[4];
 	float weights[4];
-    for(UINT i = 0; i < numVertices; ++i)
+    for(std::uint32_t i = 0; i < numVertices; ++i)
     {
         float blah;
 	    fin >> ignore >> vertices[i].Pos.x        >> vertices[i].Pos.y          >> vertices[i].Pos.z;
@@ -157,32 +167,32 @@ void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::v
 		vertices[i].BoneWeights.y = weights[1];
 		vertices[i].BoneWeights.z = weights[2];
 
-		vertices[i].BoneIndices[0] = (BYTE)boneIndices[0]; 
-		vertices[i].BoneIndices[1] = (BYTE)boneIndices[1]; 
-		vertices[i].BoneIndices[2] = (BYTE)boneIndices[2]; 
-		vertices[i].BoneIndices[3] = (BYTE)boneIndices[3]; 
+		vertices[i].BoneIndices[0] = (std::uint8_t)boneIndices[0]; 
+		vertices[i].BoneIndices[1] = (std::uint8_t)boneIndices[1]; 
+		vertices[i].BoneIndices[2] = (std::uint8_t)boneIndices[2]; 
+		vertices[i].BoneIndices[3] = (std::uint8_t)boneIndices[3]; 
     }
 }
 
-void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices)
+void M3DLoader::ReadTriangles(std::istream& fin, std::uint32_t numTriangles, std::vector<std::uint16_t>& indices)
 {
 	std::string ignore;
     indices.resize(numTriangles*3);
 
     fin >> ignore; // triangles header text
-    for(UINT i = 0; i < numTriangles; ++i)
+    for(std::uint32_t i = 0; i < numTriangles; ++i)
     {
         fin >> indices[i*3+0] >> indices[i*3+1] >> indices[i*3+2];
     }
 }
  
-void M3DLoader::ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<XMFLOAT4X4>& boneOffsets)
+void M3DLoader::ReadBoneOffsets(std::istream& fin, std::uint32_t numBones, std::vector<XMFLOAT4X4>& boneOffsets)
 {
 	std::string ignore;
     boneOffsets.resize(numBones);
 
     fin >> ignore; // BoneOffsets header text
-    for(UINT i = 0; i < numBones; ++i)
+    for(std::uint32_t i = 0; i < numBones; ++i)
     {
         fin >> ignore >> 
             boneOffsets[i](0,0) >> boneOffsets[i](0,1) >> boneOffsets[i](0,2) >> boneOffsets[i](0,3) >>
@@ -192,24 +202,24 @@ void M3DLoader::ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<X
     }
 }
 
-void M3DLoader::ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex)
+void M3DLoader::ReadBoneHierarchy(std::istream& fin, std::uint32_t numBones, std::vector<int>& boneIndexToParentIndex)
 {
 	std::string ignore;
     boneIndexToParentIndex.resize(numBones);
 
     fin >> ignore; // BoneHierarchy header text
-	for(UINT i = 0; i < numBones; ++i)
+	for(std::uint32_t i = 0; i < numBones; ++i)
 	{
 	    fin >> ignore >> boneIndexToParentIndex[i];
 	}
 }
 
-void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, 
+void M3DLoader::ReadAnimationClips(std::istream& fin, std::uint32_t numBones, std::uint32_t numAnimationClips, 
 								   std::unordered_map<std::string, AnimationClip>& animations)
 {
 	std::string ignore;
     fin >> ignore; // AnimationClips header text
-    for(UINT clipIndex = 0; clipIndex < numAnimationClips; ++clipIndex)
+    for(std::uint32_t clipIndex = 0; clipIndex < numAnimationClips; ++clipIndex)
     {
         std::string clipName;
         fin >> ignore >> clipName;
@@ -218,7 +228,7 @@ void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAn
 		AnimationClip clip;
 		clip.BoneAnimations.resize(numBones);
 
-        for(UINT boneIndex = 0; boneIndex < numBones; ++boneIndex)
+        for(std::uint32_t boneIndex = 0; boneIndex < numBones; ++boneIndex)
         {
             ReadBoneKeyframes(fin, numBones, clip.BoneAnimations[boneIndex]);
         }
@@ -228,15 +238,15 @@ void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAn
     }
 }
 
-void M3DLoader::ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation)
+void M3DLoader::ReadBoneKeyframes(std::istream& fin, std::uint32_t numBones, BoneAnimation& boneAnimation)
 {
 	std::string ignore;
-    UINT numKeyframes = 0;
+    std::uint32_t numKeyframes = 0;
     fin >> ignore >> ignore >> numKeyframes;
     fin >> ignore; // {
 
     boneAnimation.Keyframes.resize(numKeyframes);
-    for(UINT i = 0; i < numKeyframes; ++i)
+    for(std::uint32_t i = 0; i < numKeyframes; ++i)
     {
         float t    = 0.0f;
         XMFLOAT3 p(0.0f, 0.0f, 0.0f);
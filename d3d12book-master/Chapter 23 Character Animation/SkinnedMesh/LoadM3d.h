@@ -2,6 +2,7 @@
 #define LOADM3D_H
 
 #include "SkinnedData.h"
+#include <istream>
 
 
 
@@ -23,16 +24,16 @@ public:
         DirectX::XMFLOAT2 TexC;
         DirectX::XMFLOAT3 TangentU;
         DirectX::XMFLOAT3 BoneWeights;
-        BYTE BoneIndices[4];
+        std::uint8_t BoneIndices[4];
     };
 
     struct Subset
     {
-        UINT Id = -1;
-        UINT VertexStart = 0;
-        UINT VertexCount = 0;
-        UINT FaceStart = 0;
-        UINT FaceCount = 0;
+        std::uint32_t Id = -1;
+        std::uint32_t VertexStart = 0;
+        std::uint32_t VertexCount = 0;
+        std::uint32_t FaceStart = 0;
+        std::uint32_t FaceCount = 0;
     };
 
     struct M3dMaterial
@@ -51,26 +52,26 @@ public:
 
 	bool LoadM3d(const std::string& filename, 
 		std::vector<Vertex>& vertices,
-		std::vector<USHORT>& indices,
+		std::vector<std::uint16_t>& indices,
 		std::vector<Subset>& subsets,
 		std::vector<M3dMaterial>& mats);
 	bool LoadM3d(const std::string& filename, 
 		std::vector<SkinnedVertex>& vertices,
-		std::vector<USHORT>& indices,
+		std::vector<std::uint16_t>& indices,
 		std::vector<Subset>& subsets,
 		std::vector<M3dMaterial>& mats,
 		SkinnedData& skinInfo);
 
 private:
-	void ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats);
-	void ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets);
-	void ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices);
-	void ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
-	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices);
-	void ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
-	void ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
-	void ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
-	void ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation);
+	void ReadMaterials(std::istream& fin, std::uint32_t numMaterials, std::vector<M3dMaterial>& mats);
+	void ReadSubsetTable(std::istream& fin, std::uint32_t numSubsets, std::vector<Subset>& subsets);
+	void ReadVertices(std::istream& fin, std::uint32_t numVertices, std::vector<Vertex>& vertices);
+	void ReadSkinnedVertices(std::istream& fin, std::uint32_t numVertices, std::vector<SkinnedVertex>& vertices);
+	void ReadTriangles(std::istream& fin, std::uint32_t numTriangles, std::vector<std::uint16_t>& indices);
+	void ReadBoneOffsets(std::istream& fin, std::uint32_t numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
+	void ReadBoneHierarchy(std::istream& fin, std::uint32_t numBones, std::vector<int>& boneIndexToParentIndex);
+	void ReadAnimationClips(std::istream& fin, std::uint32_t numBones, std::uint32_t numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
+	void ReadBoneKeyframes(std::istream& fin, std::uint32_t numBones, BoneAnimation& boneAnimation);
 };
 
 
@@ -93,6 +93,10 @@ cbuffer cbPass : register(b2)
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light gLights[MaxLights];
+
+    // Must match ShadowCascades::MaxCascades.
+    float4x4 gCascadeShadowTransforms[4];
+    float4 gCascadeSplits;
 };
 
 //---------------------------------------------------------------------------------------
@@ -153,3 +157,55 @@ float CalcShadowFactor(float4 shadowPosH)
     return percentLit / 9.0f;
 }
 
+//---------------------------------------------------------------------------------------
+// PCF for cascaded shadow mapping.  The cascades are packed 2x2 into gShadowMap; the
+// first cascade whose split lies beyond the pixel is used.
+//---------------------------------------------------------------------------------------
+
+float CalcCascadedShadowFactor(float3 posW)
+{
+    float depthV = mul(float4(posW, 1.0f), gView).z;
+
+    // Nothing is shadowed past the last cascade.
+    if(depthV > gCascadeSplits.w)
+        return 1.0f;
+
+    uint cascade = (depthV > gCascadeSplits.x ? 1 : 0) +
+                   (depthV > gCascadeSplits.y ? 1 : 0) +
+                   (depthV > gCascadeSplits.z ? 1 : 0);
+
+    float4 shadowPosH = mul(float4(posW, 1.0f), gCascadeShadowTransforms[cascade]);
+
+    // Complete projection by doing division by w.
+    shadowPosH.xyz /= shadowPosH.w;
+
+    // Depth in NDC space.
+    float depth = shadowPosH.z;
+
+    uint width, height, numMips;
+    gShadowMap.GetDimensions(0, width, height, numMips);
+
+    // Texel size.
+    float dx = 1.0f / (float)width;
+
+    // Keep the filter taps inside the quarter of the shadow map of this cascade.
+    float2 cellMin = 0.5f*float2(cascade % 2, cascade / 2);
+    float2 texC = clamp(shadowPosH.xy, cellMin + dx, cellMin + 0.5f - dx);
+
+    float percentLit = 0.0f;
+    const float2 offsets[9] =
+    {
+        float2(-dx,  -dx), float2(0.0f,  -dx), float2(dx,  -dx),
+        float2(-dx, 0.0f), float2(0.0f, 0.0f), float2(dx, 0.0f),
+        float2(-dx,  +dx), float2(0.0f,  +dx), float2(dx,  +dx)
+    };
+
+    [unroll]
+    for(int i = 0; i < 9; ++i)
+    {
+        percentLit += gShadowMap.SampleCmpLevelZero(gsamShadow,
+            texC + offsets[i], depth).r;
+    }
+
+    return percentLit / 9.0f;
+}
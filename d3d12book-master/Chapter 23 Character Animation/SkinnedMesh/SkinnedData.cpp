@@ -1,4 +1,5 @@
 #include "SkinnedData.h"
+#include "../../Common/Profiler.h"
 
 using namespace DirectX;
 
@@ -50,7 +51,7 @@ void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
 	}
 	else
 	{
-		for(UINT i = 0; i < Keyframes.size()-1; ++i)
+		for(std::uint32_t i = 0; i < Keyframes.size()-1; ++i)
 		{
 			if( t >= Keyframes[i].TimePos && t <= Keyframes[i+1].TimePos )
 			{
@@ -82,7 +83,7 @@ float AnimationClip::GetClipStartTime()const
 {
 	// Find smallest start time over all bones in this clip.
 	float t = MathHelper::Infinity;
-	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+	for(std::uint32_t i = 0; i < BoneAnimations.size(); ++i)
 	{
 		t = MathHelper::Min(t, BoneAnimations[i].GetStartTime());
 	}
@@ -94,7 +95,7 @@ float AnimationClip::GetClipEndTime()const
 {
 	// Find largest end time over all bones in this clip.
 	float t = 0.0f;
-	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+	for(std::uint32_t i = 0; i < BoneAnimations.size(); ++i)
 	{
 		t = MathHelper::Max(t, BoneAnimations[i].GetEndTime());
 	}
@@ -104,7 +105,7 @@ float AnimationClip::GetClipEndTime()const
 
 void AnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms)const
 {
-	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+	for(std::uint32_t i = 0; i < BoneAnimations.size(); ++i)
 	{
 		BoneAnimations[i].Interpolate(t, boneTransforms[i]);
 	}
@@ -122,7 +123,7 @@ float SkinnedData::GetClipEndTime(const std::string& clipName)const
 	return clip->second.GetClipEndTime();
 }
 
-UINT SkinnedData::BoneCount()const
+std::uint32_t SkinnedData::BoneCount()const
 {
 	return mBoneHierarchy.size();
 }
@@ -138,7 +139,9 @@ void SkinnedData::Set(std::vector<int>& boneHierarchy,
  
 void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,  std::vector<XMFLOAT4X4>& finalTransforms)const
 {
-	UINT numBones = mBoneOffsets.size();
+	PROFILE_FUNCTION();
+
+	std::uint32_t numBones = mBoneOffsets.size();
 
 	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
 
@@ -157,7 +160,7 @@ void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,
 	toRootTransforms[0] = toParentTransforms[0];
 
 	// Now find the toRootTransform of the children.
-	for(UINT i = 1; i < numBones; ++i)
+	for(std::uint32_t i = 1; i < numBones; ++i)
 	{
 		XMMATRIX toParent = XMLoadFloat4x4(&toParentTransforms[i]);
 
@@ -170,7 +173,7 @@ void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,
 	}
 
 	// Premultiply by the bone offset transform to get the final transform.
-	for(UINT i = 0; i < numBones; ++i)
+	for(std::uint32_t i = 0; i < numBones; ++i)
 	{
 		XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
 		XMMATRIX toRoot = XMLoadFloat4x4(&toRootTransforms[i]);
@@ -1,8 +1,12 @@
 #ifndef SKINNEDDATA_H
 #define SKINNEDDATA_H
 
-#include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 ///<summary>
 /// A Keyframe defines the bone transformation at an instant in time.
@@ -54,7 +58,7 @@ class SkinnedData
 {
 public:
 
-	UINT BoneCount()const;
+	std::uint32_t BoneCount()const;
 
 	float GetClipStartTime(const std::string& clipName)const;
 	float GetClipEndTime(const std::string& clipName)const;
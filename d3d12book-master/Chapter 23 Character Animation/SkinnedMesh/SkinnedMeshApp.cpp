@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/ShadowCascades.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -69,6 +70,9 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+    // Local space bounds, used to cull shadow casters per cascade.
+    BoundingBox Bounds;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -119,6 +123,7 @@ private:
     void UpdateSkinnedCBs(const GameTimer& gt);
 	void UpdateMaterialBuffer(const GameTimer& gt);
     void UpdateShadowTransform(const GameTimer& gt);
+    void UpdateShadowCasters();
 	void UpdateMainPassCB(const GameTimer& gt);
     void UpdateShadowPassCB(const GameTimer& gt);
     void UpdateSsaoCB(const GameTimer& gt);
@@ -183,7 +188,7 @@ private:
     CD3DX12_GPU_DESCRIPTOR_HANDLE mNullSrv;
 
     PassConstants mMainPassCB;  // index 0 of pass cbuffer.
-    PassConstants mShadowPassCB;// index 1 of pass cbuffer.
+    PassConstants mShadowPassCB;// indices [1, 1+MaxCascades) of pass cbuffer.
 
     UINT mSkinnedSrvHeapStart = 0;
     std::string mSkinnedModelFilename = "Models\\soldier.m3d";
@@ -201,12 +206,12 @@ private:
 
     DirectX::BoundingSphere mSceneBounds;
 
-    float mLightNearZ = 0.0f;
-    float mLightFarZ = 0.0f;
-    XMFLOAT3 mLightPosW;
-    XMFLOAT4X4 mLightView = MathHelper::Identity4x4();
-    XMFLOAT4X4 mLightProj = MathHelper::Identity4x4();
-    XMFLOAT4X4 mShadowTransform = MathHelper::Identity4x4();
+    // The cascades are packed 2x2 into the shadow map.
+    ShadowCascades mShadowCascades;
+    XMFLOAT4X4 mCascadeShadowTransforms[ShadowCascades::MaxCascades];
+
+    // Opaque items that can cast a shadow into each cascade.
+    std::vector<RenderItem*> mCascadeCasters[ShadowCascades::MaxCascades];
 
     float mLightRotationAngle = 0.0f;
     XMFLOAT3 mBaseLightDirections[3] = {
@@ -272,6 +277,10 @@ bool SkinnedMeshApp::Initialize()
     mShadowMap = std::make_unique<ShadowMap>(md3dDevice.Get(),
         2048, 2048);
 
+    // Each cascade gets a quarter of the shadow map.
+    mShadowCascades.SetShadowMapSize(mShadowMap->Width() / 2);
+    mShadowCascades.SetShadowDistance(50.0f);
+
     mSsao = std::make_unique<Ssao>(
         md3dDevice.Get(),
         mCommandList.Get(),
@@ -348,13 +357,7 @@ void SkinnedMeshApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
     //
     // Animate the lights (and hence shadows).
@@ -375,6 +378,7 @@ void SkinnedMeshApp::Update(const GameTimer& gt)
     UpdateSkinnedCBs(gt);
 	UpdateMaterialBuffer(gt);
     UpdateShadowTransform(gt);
+    UpdateShadowCasters();
 	UpdateMainPassCB(gt);
     UpdateShadowPassCB(gt);
     UpdateSsaoCB(gt);
@@ -565,6 +569,8 @@ void SkinnedMeshApp::AnimateMaterials(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -590,6 +596,8 @@ void SkinnedMeshApp::UpdateObjectCBs(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateSkinnedCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
     auto currSkinnedCB = mCurrFrameResource->SkinnedCB.get();
    
     // We only have one skinned model being animated.
@@ -606,6 +614,8 @@ void SkinnedMeshApp::UpdateSkinnedCBs(const GameTimer& gt)
  
 void SkinnedMeshApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -634,46 +644,51 @@ void SkinnedMeshApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateShadowTransform(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
     // Only the first "main" light casts a shadow.
     XMVECTOR lightDir = XMLoadFloat3(&mRotatedLightDirections[0]);
-    XMVECTOR lightPos = -2.0f*mSceneBounds.Radius*lightDir;
-    XMVECTOR targetPos = XMLoadFloat3(&mSceneBounds.Center);
-    XMVECTOR lightUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-    XMMATRIX lightView = XMMatrixLookAtLH(lightPos, targetPos, lightUp);
 
-    XMStoreFloat3(&mLightPosW, lightPos);
+    mShadowCascades.Update(mCamera.GetView(), mCamera.GetFovY(), mCamera.GetAspect(),
+        mCamera.GetNearZ(), mCamera.GetFarZ(), lightDir, mSceneBounds);
 
-    // Transform bounding sphere to light space.
-    XMFLOAT3 sphereCenterLS;
-    XMStoreFloat3(&sphereCenterLS, XMVector3TransformCoord(targetPos, lightView));
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        // Scale and offset texture space [0,1]^2 into the quarter of the shadow map
+        // the cascade is rendered to.
+        XMMATRIX atlas = XMMatrixScaling(0.5f, 0.5f, 1.0f)*
+            XMMatrixTranslation(0.5f*(i % 2), 0.5f*(i / 2), 0.0f);
 
-    // Ortho frustum in light space encloses scene.
-    float l = sphereCenterLS.x - mSceneBounds.Radius;
-    float b = sphereCenterLS.y - mSceneBounds.Radius;
-    float n = sphereCenterLS.z - mSceneBounds.Radius;
-    float r = sphereCenterLS.x + mSceneBounds.Radius;
-    float t = sphereCenterLS.y + mSceneBounds.Radius;
-    float f = sphereCenterLS.z + mSceneBounds.Radius;
+        XMMATRIX S = XMLoadFloat4x4(&mShadowCascades.GetCascade(i).ShadowTransform)*atlas;
+        XMStoreFloat4x4(&mCascadeShadowTransforms[i], S);
+    }
+}
 
-    mLightNearZ = n;
-    mLightFarZ = f;
-    XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(l, r, b, t, n, f);
+void SkinnedMeshApp::UpdateShadowCasters()
+{
+	PROFILE_FUNCTION();
 
-    // Transform NDC space [-1,+1]^2 to texture space [0,1]^2
-    XMMATRIX T(
-        0.5f, 0.0f, 0.0f, 0.0f,
-        0.0f, -0.5f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f, 0.5f, 0.0f, 1.0f);
+    for(auto& casters : mCascadeCasters)
+        casters.clear();
+
+    for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+    {
+        BoundingBox worldBounds;
+        ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World));
 
-    XMMATRIX S = lightView*lightProj*T;
-    XMStoreFloat4x4(&mLightView, lightView);
-    XMStoreFloat4x4(&mLightProj, lightProj);
-    XMStoreFloat4x4(&mShadowTransform, S);
+        UINT mask = mShadowCascades.GetCasterMask(worldBounds);
+        for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+        {
+            if(mask & (1u << i))
+                mCascadeCasters[i].push_back(ri);
+        }
+    }
 }
 
 void SkinnedMeshApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -690,7 +705,7 @@ void SkinnedMeshApp::UpdateMainPassCB(const GameTimer& gt)
         0.5f, 0.5f, 0.0f, 1.0f);
 
     XMMATRIX viewProjTex = XMMatrixMultiply(viewProj, T);
-    XMMATRIX shadowTransform = XMLoadFloat4x4(&mShadowTransform);
+    XMMATRIX shadowTransform = XMLoadFloat4x4(&mCascadeShadowTransforms[0]);
 
 	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
 	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
@@ -714,6 +729,17 @@ void SkinnedMeshApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.Lights[1].Strength = { 0.4f, 0.4f, 0.4f };
 	mMainPassCB.Lights[2].Direction = mRotatedLightDirections[2];
 	mMainPassCB.Lights[2].Strength = { 0.2f, 0.2f, 0.2f };
+
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        XMMATRIX S = XMLoadFloat4x4(&mCascadeShadowTransforms[i]);
+        XMStoreFloat4x4(&mMainPassCB.CascadeShadowTransforms[i], XMMatrixTranspose(S));
+    }
+    mMainPassCB.CascadeSplits = XMFLOAT4(
+        mShadowCascades.GetCascade(0).SplitFar,
+        mShadowCascades.GetCascade(1).SplitFar,
+        mShadowCascades.GetCascade(2).SplitFar,
+        mShadowCascades.GetCascade(3).SplitFar);
  
 	auto currPassCB = mCurrFrameResource->PassCB.get();
 	currPassCB->CopyData(0, mMainPassCB);
@@ -721,35 +747,46 @@ void SkinnedMeshApp::UpdateMainPassCB(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateShadowPassCB(const GameTimer& gt)
 {
-    XMMATRIX view = XMLoadFloat4x4(&mLightView);
-    XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
-
-    XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-    XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-    XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-    UINT w = mShadowMap->Width();
-    UINT h = mShadowMap->Height();
-
-    XMStoreFloat4x4(&mShadowPassCB.View, XMMatrixTranspose(view));
-    XMStoreFloat4x4(&mShadowPassCB.InvView, XMMatrixTranspose(invView));
-    XMStoreFloat4x4(&mShadowPassCB.Proj, XMMatrixTranspose(proj));
-    XMStoreFloat4x4(&mShadowPassCB.InvProj, XMMatrixTranspose(invProj));
-    XMStoreFloat4x4(&mShadowPassCB.ViewProj, XMMatrixTranspose(viewProj));
-    XMStoreFloat4x4(&mShadowPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-    mShadowPassCB.EyePosW = mLightPosW;
-    mShadowPassCB.RenderTargetSize = XMFLOAT2((float)w, (float)h);
-    mShadowPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / w, 1.0f / h);
-    mShadowPassCB.NearZ = mLightNearZ;
-    mShadowPassCB.FarZ = mLightFarZ;
+	PROFILE_FUNCTION();
 
     auto currPassCB = mCurrFrameResource->PassCB.get();
-    currPassCB->CopyData(1, mShadowPassCB);
+
+    // Cascade i is rendered with pass constants 1+i.
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        const ShadowCascade& cascade = mShadowCascades.GetCascade(i);
+
+        XMMATRIX view = XMLoadFloat4x4(&cascade.LightView);
+        XMMATRIX proj = XMLoadFloat4x4(&cascade.LightProj);
+
+        XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+        XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+        XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+        XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+        UINT w = mShadowMap->Width() / 2;
+        UINT h = mShadowMap->Height() / 2;
+
+        XMStoreFloat4x4(&mShadowPassCB.View, XMMatrixTranspose(view));
+        XMStoreFloat4x4(&mShadowPassCB.InvView, XMMatrixTranspose(invView));
+        XMStoreFloat4x4(&mShadowPassCB.Proj, XMMatrixTranspose(proj));
+        XMStoreFloat4x4(&mShadowPassCB.InvProj, XMMatrixTranspose(invProj));
+        XMStoreFloat4x4(&mShadowPassCB.ViewProj, XMMatrixTranspose(viewProj));
+        XMStoreFloat4x4(&mShadowPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
+        mShadowPassCB.EyePosW = cascade.LightPosW;
+        mShadowPassCB.RenderTargetSize = XMFLOAT2((float)w, (float)h);
+        mShadowPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / w, 1.0f / h);
+        mShadowPassCB.NearZ = cascade.LightNearZ;
+        mShadowPassCB.FarZ = cascade.LightFarZ;
+
+        currPassCB->CopyData(1 + i, mShadowPassCB);
+    }
 }
 
 void SkinnedMeshApp::UpdateSsaoCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
+
     SsaoConstants ssaoCB;
 
     XMMATRIX P = mCamera.GetProj();
@@ -1159,21 +1196,26 @@ void SkinnedMeshApp::BuildShapeGeometry()
 	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
 	boxSubmesh.StartIndexLocation = boxIndexOffset;
 	boxSubmesh.BaseVertexLocation = boxVertexOffset;
+	// Bounds follow from the dimensions the shapes were generated with.
+	boxSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry gridSubmesh;
 	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
 	gridSubmesh.StartIndexLocation = gridIndexOffset;
 	gridSubmesh.BaseVertexLocation = gridVertexOffset;
+	gridSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(10.0f, 0.0f, 15.0f));
 
 	SubmeshGeometry sphereSubmesh;
 	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
 	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
 	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
+	sphereSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
 
 	SubmeshGeometry cylinderSubmesh;
 	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
+	cylinderSubmesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 1.5f, 0.5f));
 
     SubmeshGeometry quadSubmesh;
     quadSubmesh.IndexCount = (UINT)quad.Indices32.size();
@@ -1539,7 +1581,7 @@ void SkinnedMeshApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            2, (UINT)mAllRitems.size(), 
+            1 + ShadowCascades::MaxCascades, (UINT)mAllRitems.size(), 
             1,
             (UINT)mMaterials.size()));
     }
@@ -1615,6 +1657,7 @@ void SkinnedMeshApp::BuildRenderItems()
 	skyRitem->Geo = mGeometries["shapeGeo"].get();
 	skyRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	skyRitem->IndexCount = skyRitem->Geo->DrawArgs["sphere"].IndexCount;
+	skyRitem->Bounds = skyRitem->Geo->DrawArgs["sphere"].Bounds;
 	skyRitem->StartIndexLocation = skyRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 	skyRitem->BaseVertexLocation = skyRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1629,6 +1672,7 @@ void SkinnedMeshApp::BuildRenderItems()
     quadRitem->Geo = mGeometries["shapeGeo"].get();
     quadRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     quadRitem->IndexCount = quadRitem->Geo->DrawArgs["quad"].IndexCount;
+    quadRitem->Bounds = quadRitem->Geo->DrawArgs["quad"].Bounds;
     quadRitem->StartIndexLocation = quadRitem->Geo->DrawArgs["quad"].StartIndexLocation;
     quadRitem->BaseVertexLocation = quadRitem->Geo->DrawArgs["quad"].BaseVertexLocation;
 
@@ -1643,6 +1687,7 @@ void SkinnedMeshApp::BuildRenderItems()
 	boxRitem->Geo = mGeometries["shapeGeo"].get();
 	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
+	boxRitem->Bounds = boxRitem->Geo->DrawArgs["box"].Bounds;
 	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
 	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
 
@@ -1657,6 +1702,7 @@ void SkinnedMeshApp::BuildRenderItems()
 	gridRitem->Geo = mGeometries["shapeGeo"].get();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
+    gridRitem->Bounds = gridRitem->Geo->DrawArgs["grid"].Bounds;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
     gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
 
@@ -1685,6 +1731,7 @@ void SkinnedMeshApp::BuildRenderItems()
 		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
 		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		leftCylRitem->Bounds = leftCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1695,6 +1742,7 @@ void SkinnedMeshApp::BuildRenderItems()
 		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
 		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
+		rightCylRitem->Bounds = rightCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
@@ -1705,6 +1753,7 @@ void SkinnedMeshApp::BuildRenderItems()
 		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		leftSphereRitem->Bounds = leftSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1715,6 +1764,7 @@ void SkinnedMeshApp::BuildRenderItems()
 		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
+		rightSphereRitem->Bounds = rightSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
@@ -1797,31 +1847,45 @@ void SkinnedMeshApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const s
 
 void SkinnedMeshApp::DrawSceneToShadowMap()
 {
-    mCommandList->RSSetViewports(1, &mShadowMap->Viewport());
-    mCommandList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
-
     // Change to DEPTH_WRITE.
     mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
         D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
 
-    // Clear the back buffer and depth buffer.
+    // Clear all cascades at once.
     mCommandList->ClearDepthStencilView(mShadowMap->Dsv(), 
         D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    // Specify the buffers we are going to render to.
+    // Set null render target because we are only going to draw to
+    // depth buffer.  Setting a null render target will disable color writes.
+    // Note the active PSO also must specify a render target count of 0.
     mCommandList->OMSetRenderTargets(0, nullptr, false, &mShadowMap->Dsv());
 
-    // Bind the pass constant buffer for the shadow map pass.
     UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
     auto passCB = mCurrFrameResource->PassCB->Resource();
-    D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + 1*passCBByteSize;
-    mCommandList->SetGraphicsRootConstantBufferView(2, passCBAddress);
 
-    mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    // Each cascade renders its casters into its own quarter of the shadow map.
+    UINT cascadeSize = mShadowMap->Width() / 2;
+    for(UINT i = 0; i < ShadowCascades::MaxCascades; ++i)
+    {
+        D3D12_VIEWPORT viewport = { (float)((i % 2)*cascadeSize), (float)((i / 2)*cascadeSize),
+            (float)cascadeSize, (float)cascadeSize, 0.0f, 1.0f };
+        D3D12_RECT scissorRect = { (LONG)viewport.TopLeftX, (LONG)viewport.TopLeftY,
+            (LONG)(viewport.TopLeftX + cascadeSize), (LONG)(viewport.TopLeftY + cascadeSize) };
 
-    mCommandList->SetPipelineState(mPSOs["skinnedShadow_opaque"].Get());
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::SkinnedOpaque]);
+        mCommandList->RSSetViewports(1, &viewport);
+        mCommandList->RSSetScissorRects(1, &scissorRect);
+
+        // Bind the pass constant buffer of the cascade.
+        D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + (1 + i)*passCBByteSize;
+        mCommandList->SetGraphicsRootConstantBufferView(2, passCBAddress);
+
+        mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
+        DrawRenderItems(mCommandList.Get(), mCascadeCasters[i]);
+
+        // Skinned items are not culled; their bounds change with the animation.
+        mCommandList->SetPipelineState(mPSOs["skinnedShadow_opaque"].Get());
+        DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::SkinnedOpaque]);
+    }
 
     // Change back to GENERIC_READ so we can read the texture in a shader.
     mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
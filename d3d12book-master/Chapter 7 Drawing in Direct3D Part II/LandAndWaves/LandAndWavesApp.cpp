@@ -116,6 +116,7 @@ private:
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
 	std::unique_ptr<Waves> mWaves;
+	std::vector<Vertex> mWavesVertices;
 
     PassConstants mMainPassCB;
 
@@ -219,13 +220,7 @@ void LandAndWavesApp::Update(const GameTimer& gt)
 
 	// Has the GPU finished processing the commands of the current frame resource?
 	// If not, wait until the GPU has completed commands up to this fence point.
-	if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	WaitForFence(mCurrFrameResource->Fence);
 
 	UpdateObjectCBs(gt);
 	UpdateMainPassCB(gt);
@@ -435,18 +430,20 @@ void LandAndWavesApp::UpdateWaves(const GameTimer& gt)
 	// Update the wave simulation.
 	mWaves->Update(gt.DeltaTime());
 
-	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	// Update the wave vertex buffer with the new solution.  The vertices are built in
+	// system memory and streamed to the upload buffer in one copy.
+	mWavesVertices.resize(mWaves->VertexCount());
 	for(int i = 0; i < mWaves->VertexCount(); ++i)
 	{
-		Vertex v;
+		Vertex& v = mWavesVertices[i];
 
 		v.Pos = mWaves->Position(i);
         v.Color = XMFLOAT4(DirectX::Colors::Blue);
-
-		currWavesVB->CopyData(i, v);
 	}
 
+	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	currWavesVB->CopyData(0, mWavesVertices.data(), (UINT)mWavesVertices.size());
+
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
@@ -6,6 +6,9 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/ThreadPool.h"
+#include "../../Common/RecordScheduler.h"
+#include "../../Common/CommandListPool.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -85,7 +88,8 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems,
+        UINT first, UINT count);
  
 private:
 
@@ -116,6 +120,11 @@ private:
 
     PassConstants mMainPassCB;
 
+	// Records the frame on several threads, one command list per chunk of draws.
+	std::unique_ptr<ThreadPool> mThreadPool;
+	std::unique_ptr<RecordScheduler> mRecordScheduler;
+	std::unique_ptr<CommandListPool> mCommandListPool;
+
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
 	XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
@@ -182,6 +191,15 @@ bool LitColumnsApp::Initialize()
     BuildFrameResources();
     BuildPSOs();
 
+	mThreadPool = std::make_unique<ThreadPool>();
+	mRecordScheduler = std::make_unique<RecordScheduler>(mThreadPool.get());
+	mCommandListPool = std::make_unique<CommandListPool>(md3dDevice.Get(),
+		D3D12_COMMAND_LIST_TYPE_DIRECT, gNumFrameResources);
+
+	// The scene is small; let even a handful of draws get their own list so the
+	// parallel path is exercised.
+	mRecordScheduler->SetMinItemsPerChunk(4);
+
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
     ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
@@ -213,13 +231,7 @@ void LitColumnsApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
@@ -229,47 +241,67 @@ void LitColumnsApp::Update(const GameTimer& gt)
 
 void LitColumnsApp::Draw(const GameTimer& gt)
 {
-    auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
-
     // Reuse the memory associated with command recording.
-    // We can only reset when the associated command lists have finished execution on the GPU.
-    ThrowIfFailed(cmdListAlloc->Reset());
+    // We can only reset when the associated command lists have finished execution on the GPU,
+    // which Update() waited for.
+    mCommandListPool->BeginFrame(mCurrFrameResourceIndex);
+
+    // The frame is a clear pass, the opaque draws split into chunks, and a pass that
+    // transitions the back buffer for presenting.  Each task records into its own
+    // command list; submitting the lists in slot order gives the same command stream
+    // as recording everything into one list.
+    mRecordScheduler->BeginFrame();
+
+    mRecordScheduler->AddPass([this](const RecordTask& task)
+    {
+        auto cmdList = mCommandListPool->Begin(task.Slot, nullptr);
 
-    // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
-    // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mOpaquePSO.Get()));
+        // Indicate a state transition on the resource usage.
+        cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+            D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
+        // Clear the back buffer and depth buffer.
+        cmdList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
+        cmdList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    });
 
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    mRecordScheduler->AddChunkedPass((UINT)mOpaqueRitems.size(), [this](const RecordTask& task)
+    {
+        // Command lists do not inherit state from the lists executed before them, so
+        // every chunk sets up the pipeline it draws with.
+        auto cmdList = mCommandListPool->Begin(task.Slot, mOpaquePSO.Get());
 
-    // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
-    mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+        cmdList->RSSetViewports(1, &mScreenViewport);
+        cmdList->RSSetScissorRects(1, &mScissorRect);
 
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+        // Specify the buffers we are going to render to.
+        cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+        cmdList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+        auto passCB = mCurrFrameResource->PassCB->Resource();
+        cmdList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
-    DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+        DrawRenderItems(cmdList, mOpaqueRitems, task.First, task.Count);
+    });
 
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    mRecordScheduler->AddPass([this](const RecordTask& task)
+    {
+        auto cmdList = mCommandListPool->Begin(task.Slot, nullptr);
 
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
+        // Indicate a state transition on the resource usage.
+        cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    });
 
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+    // Create any missing lists before the workers start using them.
+    UINT slotCount = mRecordScheduler->GetSlotCount();
+    mCommandListPool->Reserve(slotCount);
+
+    mRecordScheduler->Execute();
+
+    // Done recording commands; add the command lists to the queue for execution.
+    mCommandListPool->Submit(mCommandQueue.Get(), slotCount);
 
     // Swap the back and front buffers
     ThrowIfFailed(mSwapChain->Present(0, 0));
@@ -871,7 +903,8 @@ void LitColumnsApp::BuildRenderItems()
 		mOpaqueRitems.push_back(e.get());
 }
 
-void LitColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void LitColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems,
+    UINT first, UINT count)
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
@@ -879,8 +912,8 @@ void LitColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const st
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
 	auto matCB = mCurrFrameResource->MaterialCB->Resource();
 
-    // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
+    // For each render item in [first, first+count)...
+    for(size_t i = first; i < first + count; ++i)
     {
         auto ri = ritems[i];
 
@@ -7,7 +7,7 @@
 
 #include "../../Common/d3dApp.h"
 #include "../../Common/MathHelper.h"
-#include "../../Common/UploadBuffer.h"
+#include "../../Common/UploadHeapMemory.h"
 #include "../../Common/GeometryGenerator.h"
 #include "FrameResource.h"
 #include "Waves.h"
@@ -34,13 +34,8 @@ struct RenderItem
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Index into the frame's ObjectCB allocation for this render item.  Object constants
+	// live in transient upload memory, so they are written every frame.
 	UINT ObjCBIndex = -1;
 
 	Material* Mat = nullptr;
@@ -87,6 +82,8 @@ private:
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt);
 
+	UploadAllocation AllocateUpload(UINT64 byteSize);
+
     void BuildRootSignature();
     void BuildShadersAndInputLayout();
     void BuildLandGeometry();
@@ -106,6 +103,10 @@ private:
     FrameResource* mCurrFrameResource = nullptr;
     int mCurrFrameResourceIndex = 0;
 
+	// One mapped upload heap for all per-frame constants and the waves vertices.
+	std::unique_ptr<UploadHeapMemory> mUploadMemory;
+	std::unique_ptr<UploadRing> mUploadRing;
+
     UINT mCbvSrvDescriptorSize = 0;
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
@@ -233,13 +234,10 @@ void LitWavesApp::Update(const GameTimer& gt)
 
 	// Has the GPU finished processing the commands of the current frame resource?
 	// If not, wait until the GPU has completed commands up to this fence point.
-	if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	WaitForFence(mCurrFrameResource->Fence);
+
+	// Hand back the upload memory of every frame the GPU has finished.
+	mUploadRing->Retire(mFenceTracker->GetCompletedValue(0));
 
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
@@ -275,8 +273,7 @@ void LitWavesApp::Draw(const GameTimer& gt)
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootConstantBufferView(2, mCurrFrameResource->PassCB.GpuAddress);
 
 	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
 
@@ -302,6 +299,9 @@ void LitWavesApp::Draw(const GameTimer& gt)
     // Because we are on the GPU timeline, the new fence point won't be 
     // set until the GPU finishes processing all the commands prior to this Signal().
 	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+
+	// This frame's upload memory stays reserved until the GPU reaches the fence.
+	mUploadRing->FinishFrame(mCurrentFence);
 }
 
 void LitWavesApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -386,49 +386,39 @@ void LitWavesApp::UpdateCamera(const GameTimer& gt)
 
 void LitWavesApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	auto& currObjectCB = mCurrFrameResource->ObjectCB;
+	currObjectCB = AllocateUpload(mAllRitems.size()*objCBByteSize);
+
 	for(auto& e : mAllRitems)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+		XMMATRIX world = XMLoadFloat4x4(&e->World);
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+		ObjectConstants objConstants;
+		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
+		memcpy(currObjectCB.CpuAddress + e->ObjCBIndex*objCBByteSize, &objConstants, sizeof(ObjectConstants));
 	}
 }
 
 void LitWavesApp::UpdateMaterialCBs(const GameTimer& gt)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	auto& currMaterialCB = mCurrFrameResource->MaterialCB;
+	currMaterialCB = AllocateUpload(mMaterials.size()*matCBByteSize);
+
 	for(auto& e : mMaterials)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
 		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
-
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+		MaterialConstants matConstants;
+		matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matConstants.FresnelR0 = mat->FresnelR0;
+		matConstants.Roughness = mat->Roughness;
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
+		memcpy(currMaterialCB.CpuAddress + mat->MatCBIndex*matCBByteSize, &matConstants, sizeof(MaterialConstants));
 	}
 }
 
@@ -462,8 +452,9 @@ void LitWavesApp::UpdateMainPassCB(const GameTimer& gt)
 	XMStoreFloat3(&mMainPassCB.Lights[0].Direction, lightDir);
 	mMainPassCB.Lights[0].Strength = { 1.0f, 1.0f, 0.9f };
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	auto& currPassCB = mCurrFrameResource->PassCB;
+	currPassCB = AllocateUpload(d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)));
+	memcpy(currPassCB.CpuAddress, &mMainPassCB, sizeof(PassConstants));
 }
 
 void LitWavesApp::UpdateWaves(const GameTimer& gt)
@@ -486,19 +477,33 @@ void LitWavesApp::UpdateWaves(const GameTimer& gt)
 	mWaves->Update(gt.DeltaTime());
 
 	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	auto& currWavesVB = mCurrFrameResource->WavesVB;
+	currWavesVB = AllocateUpload(mWaves->VertexCount()*sizeof(Vertex));
+
+	Vertex* vertices = reinterpret_cast<Vertex*>(currWavesVB.CpuAddress);
 	for(int i = 0; i < mWaves->VertexCount(); ++i)
 	{
-		Vertex v;
+		vertices[i].Pos = mWaves->Position(i);
+		vertices[i].Normal = mWaves->Normal(i);
+	}
+}
+
+UploadAllocation LitWavesApp::AllocateUpload(UINT64 byteSize)
+{
+	UploadAllocation alloc = mUploadRing->Allocate(byteSize);
 
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
+	// The ring is full.  Wait for the oldest frame still using it and try again.
+	while(!alloc.IsValid() && mUploadRing->HasPendingFrames())
+	{
+		UINT64 fence = mUploadRing->GetOldestPendingFence();
+		WaitForFence(fence);
 
-		currWavesVB->CopyData(i, v);
+		mUploadRing->Retire(fence);
+		alloc = mUploadRing->Allocate(byteSize);
 	}
 
-	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+	assert(alloc.IsValid());
+	return alloc;
 }
 
 void LitWavesApp::BuildRootSignature()
@@ -631,7 +636,7 @@ void LitWavesApp::BuildWavesGeometryBuffers()
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "waterGeo";
 
-	// Set dynamically.
+	// Set dynamically; DrawRenderItems binds the frame's WavesVB allocation.
 	geo->VertexBufferCPU = nullptr;
 	geo->VertexBufferGPU = nullptr;
 
@@ -693,9 +698,19 @@ void LitWavesApp::BuildFrameResources()
 {
     for(int i = 0; i < gNumFrameResources; ++i)
     {
-        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get()));
     }
+
+    // Size the ring for every frame in flight plus one, which leaves room for the
+    // allocation padding and the space skipped when the ring wraps.
+    UINT64 frameByteSize =
+        d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)) +
+        mAllRitems.size()*d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants)) +
+        mMaterials.size()*d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants)) +
+        d3dUtil::CalcConstantBufferByteSize((UINT)(mWaves->VertexCount()*sizeof(Vertex)));
+
+    mUploadMemory = std::make_unique<UploadHeapMemory>(md3dDevice.Get(), (gNumFrameResources + 1)*frameByteSize);
+    mUploadRing = std::make_unique<UploadRing>(mUploadMemory.get());
 }
 
 void LitWavesApp::BuildMaterials()
@@ -757,20 +772,32 @@ void LitWavesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std:
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	D3D12_GPU_VIRTUAL_ADDRESS objectCB = mCurrFrameResource->ObjectCB.GpuAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS matCB = mCurrFrameResource->MaterialCB.GpuAddress;
 
 	// For each render item...
 	for(size_t i = 0; i < ritems.size(); ++i)
 	{
 		auto ri = ritems[i];
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+		D3D12_VERTEX_BUFFER_VIEW vbv;
+		if(ri == mWavesRitem)
+		{
+			vbv.BufferLocation = mCurrFrameResource->WavesVB.GpuAddress;
+			vbv.StrideInBytes = ri->Geo->VertexByteStride;
+			vbv.SizeInBytes = ri->Geo->VertexBufferByteSize;
+		}
+		else
+		{
+			vbv = ri->Geo->VertexBufferView();
+		}
+
+		cmdList->IASetVertexBuffers(0, 1, &vbv);
 		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB + ri->ObjCBIndex*objCBByteSize;
+		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB + ri->Mat->MatCBIndex*matCBByteSize;
 
 		cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
 		cmdList->SetGraphicsRootConstantBufferView(1, matCBAddress);
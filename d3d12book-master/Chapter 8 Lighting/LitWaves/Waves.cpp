@@ -3,13 +3,32 @@
 //***************************************************************************************
 
 #include "Waves.h"
+#include "../../Common/Profiler.h"
+#if defined(_WIN32)
 #include <ppl.h>
+#endif
 #include <algorithm>
 #include <vector>
 #include <cassert>
 
 using namespace DirectX;
 
+namespace
+{
+    // The rows are independent, so they run in parallel where the Parallel Patterns
+    // Library is available and one after another elsewhere.
+    template<typename Function>
+    void ForEachRow(int first, int last, const Function& f)
+    {
+#if defined(_WIN32)
+        concurrency::parallel_for(first, last, f);
+#else
+        for(int i = first; i < last; ++i)
+            f(i);
+#endif
+    }
+}
+
 Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 {
     mNumRows = m;
@@ -87,6 +106,8 @@ float Waves::Depth()const
 
 void Waves::Update(float dt)
 {
+	PROFILE_FUNCTION();
+
 	static float t = 0;
 
 	// Accumulate time.
@@ -96,7 +117,7 @@ void Waves::Update(float dt)
 	if( t >= mTimeStep )
 	{
 		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+		ForEachRow(1, mNumRows - 1, [this](int i)
 		//for(int i = 1; i < mNumRows-1; ++i)
 		{
 			for(int j = 1; j < mNumCols-1; ++j)
@@ -130,7 +151,7 @@ void Waves::Update(float dt)
 		//
 		// Compute normals using finite difference scheme.
 		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+		ForEachRow(1, mNumRows - 1, [this](int i)
 		//for(int i = 1; i < mNumRows - 1; ++i)
 		{
 			for(int j = 1; j < mNumCols-1; ++j)
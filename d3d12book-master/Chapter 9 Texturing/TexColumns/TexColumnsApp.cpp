@@ -6,6 +6,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/DrawPacket.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -43,6 +44,10 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+	// Small id of Geo for draw sort keys; items with the same id share vertex and
+	// index buffers.
+	UINT GeoSortId = 0;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -66,6 +71,7 @@ private:
     virtual void OnResize()override;
     virtual void Update(const GameTimer& gt)override;
     virtual void Draw(const GameTimer& gt)override;
+	virtual void AppendFrameStats(std::wstring& text)override;
 
     virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
@@ -117,6 +123,12 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mOpaqueRitems;
 
+	// The items of a layer are drawn sorted by state, so binds that would not change
+	// anything can be skipped.
+	std::vector<DrawPacket> mDrawPackets;
+	DrawPacketSorter mDrawPacketSorter;
+	DrawStateCache mDrawStateCache;
+
     PassConstants mMainPassCB;
 
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
@@ -156,6 +168,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 TexColumnsApp::TexColumnsApp(HINSTANCE hInstance)
     : D3DApp(hInstance)
 {
+	mMainWndCaption = L"Tex Columns Demo";
 }
 
 TexColumnsApp::~TexColumnsApp()
@@ -218,13 +231,7 @@ void TexColumnsApp::Update(const GameTimer& gt)
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+    WaitForFence(mCurrFrameResource->Fence);
 
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
@@ -266,6 +273,7 @@ void TexColumnsApp::Draw(const GameTimer& gt)
 	auto passCB = mCurrFrameResource->PassCB->Resource();
 	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
+    mDrawStateCache.ResetStats();
     DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
 
     // Indicate a state transition on the resource usage.
@@ -292,6 +300,15 @@ void TexColumnsApp::Draw(const GameTimer& gt)
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
 }
 
+void TexColumnsApp::AppendFrameStats(std::wstring& text)
+{
+	// The bind counters of the last frame drawn.
+	const DrawBindStats& bindStats = mDrawStateCache.GetStats();
+	text += L"    draws: " + std::to_wstring(bindStats.DrawCount) +
+		L" binds: " + std::to_wstring(bindStats.GetTotalBindCount()) +
+		L" skipped: " + std::to_wstring(bindStats.GetTotalSkippedCount());
+}
+
 void TexColumnsApp::OnMouseDown(WPARAM btnState, int x, int y)
 {
     mLastMousePos.x = x;
@@ -868,6 +885,13 @@ void TexColumnsApp::BuildRenderItems()
 	// All the render items are opaque.
 	for(auto& e : mAllRitems)
 		mOpaqueRitems.push_back(e.get());
+
+	std::unordered_map<MeshGeometry*, UINT> geoSortIds;
+	for(auto& e : mAllRitems)
+	{
+		auto it = geoSortIds.insert(std::make_pair(e->Geo, (UINT)geoSortIds.size())).first;
+		e->GeoSortId = it->second;
+	}
 }
 
 void TexColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
@@ -878,26 +902,54 @@ void TexColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const st
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
 	auto matCB = mCurrFrameResource->MaterialCB->Resource();
 
+	// Sort the items by geometry, then material, then nearest first.
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	mDrawPackets.resize(ritems.size());
+	for(size_t i = 0; i < ritems.size(); ++i)
+	{
+		auto ri = ritems[i];
+
+		XMVECTOR center = XMVector3TransformCoord(
+			XMVectorSet(ri->World._41, ri->World._42, ri->World._43, 1.0f), view);
+		UINT depth = QuantizeDrawDepth(XMVectorGetZ(center), 1.0f, 1000.0f);
+
+		mDrawPackets[i].Key = MakeDrawSortKey(0, 0, ri->GeoSortId, ri->Mat->MatCBIndex, depth);
+		mDrawPackets[i].Item = (UINT)i;
+	}
+	mDrawPacketSorter.Sort(mDrawPackets);
+
+	mDrawStateCache.Invalidate();
+
     // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
+    for(const DrawPacket& packet : mDrawPackets)
     {
-        auto ri = ritems[i];
+        auto ri = ritems[packet.Item];
 
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		if(mDrawStateCache.Set(DrawState::Geometry, ri->GeoSortId))
+		{
+			cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+			cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+		}
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+		if(mDrawStateCache.Set(DrawState::Topology, ri->PrimitiveType))
+			cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+		if(mDrawStateCache.Set(DrawState::Material, ri->Mat->MatCBIndex))
+		{
+			CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+			tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+
+			D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
+			cmdList->SetGraphicsRootDescriptorTable(0, tex);
+			cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+		}
+
+        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
         cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-        cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
 
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		mDrawStateCache.CountDraw();
     }
 }
 
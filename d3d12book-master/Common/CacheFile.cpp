@@ -0,0 +1,91 @@
+//***************************************************************************************
+// CacheFile.cpp
+//***************************************************************************************
+
+#include "CacheFile.h"
+
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+	// Replaces to with from in one step, so there is no moment at which a crash
+	// leaves neither file behind.
+	bool MoveOverFile(const std::string& from, const std::string& to)
+	{
+#if defined(_WIN32)
+		// rename() does not replace an existing file on Windows.
+		auto toWide = [](const std::string& s)
+		{
+			int length = MultiByteToWideChar(CP_ACP, 0, s.c_str(), -1, nullptr, 0);
+			std::wstring wide(length > 0 ? length : 1, L'\0');
+			MultiByteToWideChar(CP_ACP, 0, s.c_str(), -1, &wide[0], length);
+			wide.resize(wide.size() - 1);
+			return wide;
+		};
+
+		return MoveFileExW(toWide(from).c_str(), toWide(to).c_str(),
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+}
+
+void Fnv1aHasher::AddBytes(const void* data, std::size_t size)
+{
+	const std::uint8_t* bytes = (const std::uint8_t*)data;
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		mHash ^= bytes[i];
+		mHash *= 1099511628211ull;
+	}
+}
+
+void Fnv1aHasher::AddUInt(std::uint64_t value)
+{
+	AddBytes(&value, sizeof(value));
+}
+
+void Fnv1aHasher::AddString(const std::string& s)
+{
+	AddUInt(s.size());
+	AddBytes(s.data(), s.size());
+}
+
+std::uint64_t Fnv1aHasher::GetHash()const
+{
+	return mHash;
+}
+
+bool SaveCacheFile(const std::string& filename, const CacheFileChunk* chunks, std::size_t chunkCount)
+{
+	std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream fout(tempFilename, std::ios::binary | std::ios::trunc);
+		if(!fout)
+			return false;
+
+		for(std::size_t i = 0; i < chunkCount; ++i)
+			fout.write((const char*)chunks[i].Data, chunks[i].Size);
+
+		if(!fout)
+		{
+			fout.close();
+			std::remove(tempFilename.c_str());
+			return false;
+		}
+	}
+
+	if(!MoveOverFile(tempFilename, filename))
+	{
+		std::remove(tempFilename.c_str());
+		return false;
+	}
+
+	return true;
+}
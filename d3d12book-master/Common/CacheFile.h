@@ -0,0 +1,41 @@
+//***************************************************************************************
+// CacheFile.h
+//
+// What the shader and pipeline caches share: the 64-bit FNV-1a hash their keys and
+// checksums are made of, and writing a cache file through a temporary, so a crash
+// never leaves a half written file behind.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Fnv1aHasher
+{
+public:
+	void AddBytes(const void* data, std::size_t size);
+
+	// Integers, enums and BOOLs, widened so the hash does not depend on the field size.
+	void AddUInt(std::uint64_t value);
+
+	// Length first, so that ("ab", "c") and ("a", "bc") hash differently.
+	void AddString(const std::string& s);
+
+	std::uint64_t GetHash()const;
+
+private:
+	std::uint64_t mHash = 14695981039346656037ull;
+};
+
+struct CacheFileChunk
+{
+	const void* Data = nullptr;
+	std::size_t Size = 0;
+};
+
+// Writes the chunks one after the other to filename + ".tmp" and replaces filename
+// with it.  Returns false if either step fails, which on Windows includes filename
+// being mapped or open elsewhere.
+bool SaveCacheFile(const std::string& filename, const CacheFileChunk* chunks, std::size_t chunkCount);
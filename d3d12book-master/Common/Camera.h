@@ -11,7 +11,8 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include "d3dUtil.h"
+#include "MathHelper.h"
+#include <DirectXMath.h>
 
 class Camera
 {
@@ -0,0 +1,321 @@
+//***************************************************************************************
+// ClusteredLighting.cpp
+//***************************************************************************************
+
+#include "ClusteredLighting.h"
+#include "ThreadPool.h"
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+ClusteredLightBuilder::ClusteredLightBuilder(ThreadPool* threadPool, std::uint32_t tilesX,
+	std::uint32_t tilesY, std::uint32_t slices)
+	: mThreadPool(threadPool), mTilesX(tilesX), mTilesY(tilesY), mSlices(slices)
+{
+	assert(tilesX > 0 && tilesY > 0 && slices > 0);
+
+	mSliceLists.resize(mSlices);
+	mClusterRanges.resize(GetClusterCount());
+}
+
+void ClusteredLightBuilder::SetLens(float fovY, float aspect, float nearZ, float farZ)
+{
+	assert(nearZ > 0.0f && farZ > nearZ);
+
+	mTanHalfFovY = std::tan(0.5f*fovY);
+	mTanHalfFovX = mTanHalfFovY*aspect;
+	mNearZ = nearZ;
+	mFarZ = farZ;
+}
+
+std::uint32_t ClusteredLightBuilder::GetTilesX()const
+{
+	return mTilesX;
+}
+
+std::uint32_t ClusteredLightBuilder::GetTilesY()const
+{
+	return mTilesY;
+}
+
+std::uint32_t ClusteredLightBuilder::GetSliceCount()const
+{
+	return mSlices;
+}
+
+std::uint32_t ClusteredLightBuilder::GetClusterCount()const
+{
+	return mTilesX*mTilesY*mSlices;
+}
+
+std::uint32_t ClusteredLightBuilder::GetClusterIndex(std::uint32_t x, std::uint32_t y, std::uint32_t slice)const
+{
+	return (slice*mTilesY + y)*mTilesX + x;
+}
+
+float ClusteredLightBuilder::GetSliceScale()const
+{
+	return (float)mSlices / std::log2(mFarZ / mNearZ);
+}
+
+float ClusteredLightBuilder::GetSliceBias()const
+{
+	return -(float)mSlices*std::log2(mNearZ) / std::log2(mFarZ / mNearZ);
+}
+
+const std::vector<ClusterRange>& ClusteredLightBuilder::GetClusterRanges()const
+{
+	return mClusterRanges;
+}
+
+const std::vector<std::uint32_t>& ClusteredLightBuilder::GetLightIndices()const
+{
+	return mLightIndices;
+}
+
+std::uint32_t ClusteredLightBuilder::GetBufferElementCount()const
+{
+	return 2*GetClusterCount() + (std::uint32_t)mLightIndices.size();
+}
+
+void ClusteredLightBuilder::WriteBuffer(std::uint32_t* dst)const
+{
+	static_assert(sizeof(ClusterRange) == 2*sizeof(std::uint32_t), "ClusterRange must be two uints.");
+
+	std::memcpy(dst, mClusterRanges.data(), mClusterRanges.size()*sizeof(ClusterRange));
+	dst += 2*mClusterRanges.size();
+
+	if(!mLightIndices.empty())
+		std::memcpy(dst, mLightIndices.data(), mLightIndices.size()*sizeof(std::uint32_t));
+}
+
+UploadAllocation ClusteredLightBuilder::Upload(UploadRing& ring)const
+{
+	UploadAllocation alloc = ring.Allocate(GetBufferElementCount()*sizeof(std::uint32_t));
+	if(alloc.IsValid())
+		WriteBuffer(reinterpret_cast<std::uint32_t*>(alloc.CpuAddress));
+
+	return alloc;
+}
+
+float ClusteredLightBuilder::GetSliceDepth(std::uint32_t slice)const
+{
+	// Logarithmic spacing keeps the clusters roughly cube shaped at every distance.
+	return mNearZ*std::pow(mFarZ / mNearZ, (float)slice / (float)mSlices);
+}
+
+void ClusteredLightBuilder::Build(FXMMATRIX view, const BoundingSphere* lights, std::uint32_t lightCount)
+{
+	//
+	// Move the lights to view space and find the slices each one overlaps.
+	//
+
+	mViewLights.resize(lightCount);
+
+	const float sliceScale = GetSliceScale();
+	const float sliceBias = GetSliceBias();
+
+	for(std::uint32_t i = 0; i < lightCount; ++i)
+	{
+		ViewLight& vl = mViewLights[i];
+
+		XMVECTOR centerV = XMVector3TransformCoord(XMLoadFloat3(&lights[i].Center), view);
+		XMStoreFloat3(&vl.Center, centerV);
+		vl.Radius = lights[i].Radius;
+
+		float zMin = vl.Center.z - vl.Radius;
+		float zMax = vl.Center.z + vl.Radius;
+
+		vl.Visible = zMax > mNearZ && zMin < mFarZ;
+		if(!vl.Visible)
+			continue;
+
+		zMin = std::max(zMin, mNearZ);
+		zMax = std::min(zMax, mFarZ);
+
+		float first = std::floor(std::log2(zMin)*sliceScale + sliceBias);
+		float last = std::floor(std::log2(zMax)*sliceScale + sliceBias);
+
+		vl.FirstSlice = (std::uint32_t)std::max(0.0f, std::min(first, (float)(mSlices - 1)));
+		vl.LastSlice = (std::uint32_t)std::max(0.0f, std::min(last, (float)(mSlices - 1)));
+	}
+
+	//
+	// Build the light lists of each slice in parallel.
+	//
+
+	if(mThreadPool != nullptr)
+		mThreadPool->ParallelFor(mSlices, [this](std::uint32_t slice){ BuildSlice(slice); });
+	else
+	{
+		for(std::uint32_t slice = 0; slice < mSlices; ++slice)
+			BuildSlice(slice);
+	}
+
+	//
+	// Concatenate the slices into one index list.
+	//
+
+	std::uint32_t totalIndices = 0;
+	for(const auto& lists : mSliceLists)
+		totalIndices += (std::uint32_t)lists.Indices.size();
+
+	mLightIndices.resize(totalIndices);
+
+	const std::uint32_t clustersPerSlice = mTilesX*mTilesY;
+
+	std::uint32_t base = 0;
+	for(std::uint32_t slice = 0; slice < mSlices; ++slice)
+	{
+		const SliceLists& lists = mSliceLists[slice];
+
+		ClusterRange* ranges = &mClusterRanges[slice*clustersPerSlice];
+		for(std::uint32_t i = 0; i < clustersPerSlice; ++i)
+		{
+			ranges[i].Offset = base + lists.Ranges[i].Offset;
+			ranges[i].Count = lists.Ranges[i].Count;
+		}
+
+		if(!lists.Indices.empty())
+		{
+			std::memcpy(&mLightIndices[base], lists.Indices.data(),
+				lists.Indices.size()*sizeof(std::uint32_t));
+		}
+
+		base += (std::uint32_t)lists.Indices.size();
+	}
+}
+
+void ClusteredLightBuilder::BuildSlice(std::uint32_t slice)
+{
+	SliceLists& lists = mSliceLists[slice];
+	lists.Hits.clear();
+	lists.Ranges.assign(mTilesX*mTilesY, ClusterRange());
+
+	const float sliceNear = GetSliceDepth(slice);
+	const float sliceFar = GetSliceDepth(slice + 1);
+
+	// NDC [-1,1] to tile coordinates; rows start at the top of the screen.
+	auto toTileX = [this](float ndc)
+	{
+		float t = std::floor((ndc + 1.0f)*0.5f*(float)mTilesX);
+		return (std::uint32_t)std::max(0.0f, std::min(t, (float)(mTilesX - 1)));
+	};
+	auto toTileY = [this](float ndc)
+	{
+		float t = std::floor((1.0f - ndc)*0.5f*(float)mTilesY);
+		return (std::uint32_t)std::max(0.0f, std::min(t, (float)(mTilesY - 1)));
+	};
+
+	// View space range of a tile edge between the slice's near and far depths.  The
+	// cluster's bounding box spans the widest of the two.
+	auto edgeBounds = [sliceNear, sliceFar](float ndcMin, float ndcMax, float tanHalfFov)
+	{
+		return XMFLOAT2(
+			std::min(ndcMin*sliceNear, ndcMin*sliceFar)*tanHalfFov,
+			std::max(ndcMax*sliceNear, ndcMax*sliceFar)*tanHalfFov);
+	};
+
+	lists.ColumnBounds.resize(mTilesX);
+	for(std::uint32_t x = 0; x < mTilesX; ++x)
+	{
+		float ndcMin = -1.0f + 2.0f*(float)x / (float)mTilesX;
+		float ndcMax = -1.0f + 2.0f*(float)(x + 1) / (float)mTilesX;
+		lists.ColumnBounds[x] = edgeBounds(ndcMin, ndcMax, mTanHalfFovX);
+	}
+
+	lists.RowBounds.resize(mTilesY);
+	for(std::uint32_t y = 0; y < mTilesY; ++y)
+	{
+		float ndcMax = 1.0f - 2.0f*(float)y / (float)mTilesY;
+		float ndcMin = 1.0f - 2.0f*(float)(y + 1) / (float)mTilesY;
+		lists.RowBounds[y] = edgeBounds(ndcMin, ndcMax, mTanHalfFovY);
+	}
+
+	//
+	// Tiles of every light within this slice.
+	//
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)mViewLights.size(); ++i)
+	{
+		const ViewLight& vl = mViewLights[i];
+		if(!vl.Visible || slice < vl.FirstSlice || slice > vl.LastSlice)
+			continue;
+
+		// Depth range of the part of the light's bounding box inside the slice.
+		float zNear = std::max(sliceNear, vl.Center.z - vl.Radius);
+		float zFar = std::min(sliceFar, vl.Center.z + vl.Radius);
+
+		// Project the box conservatively: a negative extent is widest at the near
+		// depth, a positive one at the far depth, and the other way round for the
+		// opposite side.
+		float left = vl.Center.x - vl.Radius;
+		float right = vl.Center.x + vl.Radius;
+		float bottom = vl.Center.y - vl.Radius;
+		float top = vl.Center.y + vl.Radius;
+
+		float ndcLeft = left / ((left < 0.0f ? zNear : zFar)*mTanHalfFovX);
+		float ndcRight = right / ((right > 0.0f ? zNear : zFar)*mTanHalfFovX);
+		float ndcBottom = bottom / ((bottom < 0.0f ? zNear : zFar)*mTanHalfFovY);
+		float ndcTop = top / ((top > 0.0f ? zNear : zFar)*mTanHalfFovY);
+
+		if(ndcRight < -1.0f || ndcLeft > 1.0f || ndcTop < -1.0f || ndcBottom > 1.0f)
+			continue;
+
+		std::uint32_t x0 = toTileX(ndcLeft);
+		std::uint32_t x1 = toTileX(ndcRight);
+		std::uint32_t y0 = toTileY(ndcTop);
+		std::uint32_t y1 = toTileY(ndcBottom);
+
+		// The rectangle bounds the sphere's box, so drop the tiles whose cluster box
+		// the sphere itself misses.
+		float dz = std::max(0.0f, std::max(sliceNear - vl.Center.z, vl.Center.z - sliceFar));
+		float r2 = vl.Radius*vl.Radius - dz*dz;
+		if(r2 < 0.0f)
+			continue;
+
+		for(std::uint32_t y = y0; y <= y1; ++y)
+		{
+			const XMFLOAT2& row = lists.RowBounds[y];
+			float dy = std::max(0.0f, std::max(row.x - vl.Center.y, vl.Center.y - row.y));
+			if(dy*dy > r2)
+				continue;
+
+			for(std::uint32_t x = x0; x <= x1; ++x)
+			{
+				const XMFLOAT2& column = lists.ColumnBounds[x];
+				float dx = std::max(0.0f, std::max(column.x - vl.Center.x, vl.Center.x - column.y));
+				if(dx*dx + dy*dy <= r2)
+					lists.Hits.push_back({ y*mTilesX + x, i });
+			}
+		}
+	}
+
+	//
+	// Count, then scatter the light indices so each cluster's list is contiguous.
+	//
+
+	for(const auto& hit : lists.Hits)
+		++lists.Ranges[hit.Tile].Count;
+
+	std::uint32_t offset = 0;
+	for(auto& range : lists.Ranges)
+	{
+		range.Offset = offset;
+		offset += range.Count;
+		range.Count = 0;
+	}
+
+	lists.Indices.resize(offset);
+
+	for(const auto& hit : lists.Hits)
+	{
+		ClusterRange& range = lists.Ranges[hit.Tile];
+		lists.Indices[range.Offset + range.Count++] = hit.Light;
+	}
+}
@@ -0,0 +1,132 @@
+//***************************************************************************************
+// ClusteredLighting.h
+//
+// CPU builder for clustered shading.  The view frustum is divided into a grid of
+// clusters ("froxels"): TilesX x TilesY screen tiles times Slices depth slices spaced
+// logarithmically between the near and far planes.  Every point/spot light is binned
+// into the clusters its bounding sphere overlaps, producing a compact light index list
+// per cluster, so a pixel shader only loops over the lights of its own cluster instead
+// of over every light in the scene.
+//
+// The sphere's screen rectangle within each slice picks the candidate tiles, and a
+// test against each candidate cluster's view space bounding box drops the corners of
+// the rectangle the sphere does not reach.
+//
+// Depth slices are built in parallel on a ThreadPool.  Only DirectXMath/DirectXCollision
+// are used, so the builder can be run and timed without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+class UploadRing;
+struct UploadAllocation;
+
+// Light list of one cluster: LightIndices[Offset, Offset+Count).
+struct ClusterRange
+{
+	std::uint32_t Offset = 0;
+	std::uint32_t Count = 0;
+};
+
+class ClusteredLightBuilder
+{
+public:
+	// threadPool may be null, in which case everything runs on the calling thread.
+	ClusteredLightBuilder(ThreadPool* threadPool, std::uint32_t tilesX = 16,
+		std::uint32_t tilesY = 9, std::uint32_t slices = 24);
+	ClusteredLightBuilder(const ClusteredLightBuilder& rhs) = delete;
+	ClusteredLightBuilder& operator=(const ClusteredLightBuilder& rhs) = delete;
+	~ClusteredLightBuilder() = default;
+
+	// Same parameters as Camera::SetLens.
+	void SetLens(float fovY, float aspect, float nearZ, float farZ);
+
+	// Bins the lights, given by their world space bounding spheres (position and
+	// falloff end; spot lights use the sphere around their cone), into the clusters of
+	// the camera with the given view matrix.  Light indices refer to the lights array.
+	void Build(DirectX::FXMMATRIX view, const DirectX::BoundingSphere* lights, std::uint32_t lightCount);
+
+	std::uint32_t GetTilesX()const;
+	std::uint32_t GetTilesY()const;
+	std::uint32_t GetSliceCount()const;
+	std::uint32_t GetClusterCount()const;
+
+	// Clusters are stored slice by slice, row by row: (slice*TilesY + y)*TilesX + x.
+	std::uint32_t GetClusterIndex(std::uint32_t x, std::uint32_t y, std::uint32_t slice)const;
+
+	// Depth slice of a view space depth: slice = floor(log2(z)*scale + bias).  The
+	// shader needs scale and bias to find its cluster.
+	float GetSliceScale()const;
+	float GetSliceBias()const;
+
+	const std::vector<ClusterRange>& GetClusterRanges()const;
+	const std::vector<std::uint32_t>& GetLightIndices()const;
+
+	// Number of 32-bit values WriteBuffer() writes: two per cluster followed by the
+	// light index list.
+	std::uint32_t GetBufferElementCount()const;
+
+	// Writes the cluster ranges and light indices in the layout the shader reads,
+	// e.g. to a mapped upload buffer.
+	void WriteBuffer(std::uint32_t* dst)const;
+
+	// Allocates GetBufferElementCount() uints from the frame's upload ring and writes
+	// the buffer there; bind the allocation's GPU address as a root shader resource
+	// view.  Returns an invalid allocation if the ring is full, like UploadRing::Allocate.
+	UploadAllocation Upload(UploadRing& ring)const;
+
+private:
+	// Light bounds in view space, and the slices they touch.
+	struct ViewLight
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		std::uint32_t FirstSlice;
+		std::uint32_t LastSlice;
+		bool Visible;
+	};
+
+	// A light overlapping one tile of a slice.
+	struct TileLight
+	{
+		std::uint32_t Tile;
+		std::uint32_t Light;
+	};
+
+	// Light lists of one depth slice, built independently of the other slices.
+	struct SliceLists
+	{
+		std::vector<DirectX::XMFLOAT2> ColumnBounds;   // View space x range of each tile column.
+		std::vector<DirectX::XMFLOAT2> RowBounds;      // View space y range of each tile row.
+		std::vector<TileLight> Hits;
+		std::vector<ClusterRange> Ranges;       // Offsets relative to Indices.
+		std::vector<std::uint32_t> Indices;
+	};
+
+	float GetSliceDepth(std::uint32_t slice)const;
+	void BuildSlice(std::uint32_t slice);
+
+private:
+	ThreadPool* mThreadPool = nullptr;
+
+	std::uint32_t mTilesX = 0;
+	std::uint32_t mTilesY = 0;
+	std::uint32_t mSlices = 0;
+
+	float mTanHalfFovX = 1.0f;
+	float mTanHalfFovY = 1.0f;
+	float mNearZ = 1.0f;
+	float mFarZ = 1000.0f;
+
+	std::vector<ViewLight> mViewLights;
+	std::vector<SliceLists> mSliceLists;
+
+	std::vector<ClusterRange> mClusterRanges;
+	std::vector<std::uint32_t> mLightIndices;
+};
@@ -0,0 +1,79 @@
+//***************************************************************************************
+// CommandListPool.cpp
+//***************************************************************************************
+
+#include "CommandListPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+CommandListPool::CommandListPool(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, UINT frameResourceCount)
+	: mDevice(device),
+	  mType(type),
+	  mFrameResourceCount(frameResourceCount),
+	  mAllocators(frameResourceCount),
+	  mUsedSlots(frameResourceCount, 0)
+{
+	assert(frameResourceCount > 0);
+}
+
+void CommandListPool::BeginFrame(UINT frameResource)
+{
+	assert(frameResource < mFrameResourceCount);
+
+	mCurrFrameResource = frameResource;
+
+	auto& allocators = mAllocators[frameResource];
+	for(UINT i = 0; i < mUsedSlots[frameResource]; ++i)
+		ThrowIfFailed(allocators[i]->Reset());
+
+	mUsedSlots[frameResource] = 0;
+}
+
+void CommandListPool::Reserve(UINT slotCount)
+{
+	auto& allocators = mAllocators[mCurrFrameResource];
+	while(allocators.size() < slotCount)
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		ThrowIfFailed(mDevice->CreateCommandAllocator(mType, IID_PPV_ARGS(allocator.GetAddressOf())));
+		allocators.push_back(allocator);
+	}
+
+	while(mCommandLists.size() < slotCount)
+	{
+		ComPtr<ID3D12GraphicsCommandList> cmdList;
+		ThrowIfFailed(mDevice->CreateCommandList(0, mType, allocators[mCommandLists.size()].Get(),
+			nullptr, IID_PPV_ARGS(cmdList.GetAddressOf())));
+
+		// Lists are created open; keep them closed until Begin().
+		ThrowIfFailed(cmdList->Close());
+		mCommandLists.push_back(cmdList);
+	}
+
+	mUsedSlots[mCurrFrameResource] = std::max(mUsedSlots[mCurrFrameResource], slotCount);
+}
+
+ID3D12GraphicsCommandList* CommandListPool::Begin(UINT slot, ID3D12PipelineState* initialState)
+{
+	assert(slot < mUsedSlots[mCurrFrameResource]);
+
+	ID3D12GraphicsCommandList* cmdList = mCommandLists[slot].Get();
+	ThrowIfFailed(cmdList->Reset(mAllocators[mCurrFrameResource][slot].Get(), initialState));
+
+	return cmdList;
+}
+
+void CommandListPool::Submit(ID3D12CommandQueue* queue, UINT slotCount)
+{
+	assert(slotCount <= mUsedSlots[mCurrFrameResource]);
+
+	mSubmitLists.clear();
+	for(UINT i = 0; i < slotCount; ++i)
+	{
+		ThrowIfFailed(mCommandLists[i]->Close());
+		mSubmitLists.push_back(mCommandLists[i].Get());
+	}
+
+	if(!mSubmitLists.empty())
+		queue->ExecuteCommandLists((UINT)mSubmitLists.size(), mSubmitLists.data());
+}
@@ -0,0 +1,51 @@
+//***************************************************************************************
+// CommandListPool.h
+//
+// Command lists and allocators for recording one frame on several threads, paired
+// with RecordScheduler.  Every slot owns a command list and one allocator per frame
+// resource, so a thread recording a slot never shares either with another thread, and
+// an allocator is only reset once the GPU is done with the frame that used it.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class CommandListPool
+{
+public:
+	CommandListPool(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, UINT frameResourceCount);
+	CommandListPool(const CommandListPool& rhs) = delete;
+	CommandListPool& operator=(const CommandListPool& rhs) = delete;
+	~CommandListPool() = default;
+
+	// Selects the allocators of frameResource and resets the ones used the last time
+	// it was current.  The caller must have waited for the GPU to finish that frame.
+	void BeginFrame(UINT frameResource);
+
+	// Makes sure slotCount lists exist.  Call on the main thread before recording.
+	void Reserve(UINT slotCount);
+
+	// Resets the list of slot for recording and returns it.  Safe to call for
+	// different slots from different threads.
+	ID3D12GraphicsCommandList* Begin(UINT slot, ID3D12PipelineState* initialState);
+
+	// Closes the lists of slots [0, slotCount) and executes them in slot order with
+	// one ExecuteCommandLists call.
+	void Submit(ID3D12CommandQueue* queue, UINT slotCount);
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	D3D12_COMMAND_LIST_TYPE mType;
+	UINT mFrameResourceCount = 0;
+	UINT mCurrFrameResource = 0;
+
+	// mAllocators[frameResource][slot]
+	std::vector<std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>> mAllocators;
+
+	// Number of slots recorded the last time each frame resource was current.
+	std::vector<UINT> mUsedSlots;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> mCommandLists;
+	std::vector<ID3D12CommandList*> mSubmitLists;
+};
@@ -0,0 +1,74 @@
+//***************************************************************************************
+// D3D12FenceBackend.h
+//
+// FenceBackend over ID3D12Fence objects.  Each fence gets one auto-reset event,
+// created once and reused by every wait on that fence.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FenceTracker.h"
+
+class D3D12FenceBackend : public FenceBackend
+{
+public:
+    D3D12FenceBackend(ID3D12Fence* const* fences, UINT fenceCount)
+    {
+        for(UINT i = 0; i < fenceCount; ++i)
+        {
+            HANDLE eventHandle = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+            if(eventHandle == nullptr)
+                ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+            mFences.push_back(fences[i]);
+            mEvents.push_back(eventHandle);
+        }
+    }
+
+    D3D12FenceBackend(const D3D12FenceBackend& rhs) = delete;
+    D3D12FenceBackend& operator=(const D3D12FenceBackend& rhs) = delete;
+    ~D3D12FenceBackend()
+    {
+        for(HANDLE eventHandle : mEvents)
+            CloseHandle(eventHandle);
+    }
+
+    std::uint32_t GetFenceCount()const override
+    {
+        return (std::uint32_t)mFences.size();
+    }
+
+    std::uint64_t QueryCompletedValue(std::uint32_t fence) override
+    {
+        return mFences[fence]->GetCompletedValue();
+    }
+
+    void BlockUntilAny(const FenceWait* waits, std::uint32_t count) override
+    {
+        // WaitForMultipleObjects does not take the same handle twice, so arm each
+        // fence's event once, for the smallest value waited on.
+        mArmedValues.assign(mFences.size(), UINT64_MAX);
+        for(std::uint32_t i = 0; i < count; ++i)
+            mArmedValues[waits[i].Fence] = std::min(mArmedValues[waits[i].Fence], waits[i].Value);
+
+        mWaitHandles.clear();
+        for(std::uint32_t fence = 0; fence < (std::uint32_t)mFences.size(); ++fence)
+        {
+            if(mArmedValues[fence] == UINT64_MAX)
+                continue;
+
+            ThrowIfFailed(mFences[fence]->SetEventOnCompletion(mArmedValues[fence], mEvents[fence]));
+            mWaitHandles.push_back(mEvents[fence]);
+        }
+
+        WaitForMultipleObjects((DWORD)mWaitHandles.size(), mWaitHandles.data(), FALSE, INFINITE);
+    }
+
+private:
+    std::vector<ID3D12Fence*> mFences;
+    std::vector<HANDLE> mEvents;
+
+    std::vector<UINT64> mArmedValues;
+    std::vector<HANDLE> mWaitHandles;
+};
@@ -0,0 +1,128 @@
+//***************************************************************************************
+// D3D12GpuTimer.h
+//
+// Times passes on the GPU with a GpuTimer: a timestamp query heap with a slot of
+// queries per frame in flight, resolved at the end of the frame into a readback
+// buffer that is read once the frame's fence has completed.
+//
+//     Collect(completedFence);            // before recording, reads finished frames
+//     BeginFrame();
+//     UINT pass = BeginPass(cmdList, "Shadow");
+//     ...
+//     EndPass(cmdList, pass);
+//     EndFrame(cmdList);                  // before closing the command list
+//     SetFrameFence(fence);               // after signaling the fence
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "GpuTimer.h"
+
+class D3D12GpuTimer
+{
+public:
+    // queue is the one the timed command lists run on; its timestamp frequency is
+    // what the ticks are converted with.
+    D3D12GpuTimer(ID3D12Device* device, ID3D12CommandQueue* queue, UINT frameCount, UINT maxPassesPerFrame)
+        : mTimer(frameCount, maxPassesPerFrame)
+    {
+        ThrowIfFailed(queue->GetTimestampFrequency(&mFrequency));
+
+        D3D12_QUERY_HEAP_DESC heapDesc = {};
+        heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        heapDesc.Count = mTimer.GetQueryCount();
+        ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&mQueryHeap)));
+
+        ThrowIfFailed(device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(UINT64(mTimer.GetQueryCount()) * sizeof(UINT64)),
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&mReadbackBuffer)));
+    }
+
+    D3D12GpuTimer(const D3D12GpuTimer& rhs) = delete;
+    D3D12GpuTimer& operator=(const D3D12GpuTimer& rhs) = delete;
+    ~D3D12GpuTimer() = default;
+
+    // Reads the timings of every frame whose fence has reached completedFenceValue.
+    void Collect(UINT64 completedFenceValue)
+    {
+        if(!mTimer.HasCompletedFrames(completedFenceValue))
+        {
+            // Nothing to map; this only empties GetCollectedSamples().
+            mTimer.Collect(completedFenceValue, nullptr, mFrequency);
+            return;
+        }
+
+        // Every slot that can be read is in this range; slots still being written
+        // by the GPU are read too but not looked at.
+        D3D12_RANGE readRange = { 0, SIZE_T(mTimer.GetQueryCount()) * sizeof(UINT64) };
+        D3D12_RANGE writeRange = { 0, 0 };
+
+        void* timestamps = nullptr;
+        ThrowIfFailed(mReadbackBuffer->Map(0, &readRange, &timestamps));
+        mTimer.Collect(completedFenceValue, static_cast<const std::uint64_t*>(timestamps), mFrequency);
+        mReadbackBuffer->Unmap(0, &writeRange);
+    }
+
+    void BeginFrame()
+    {
+        mTimer.BeginFrame();
+    }
+
+    // Returns what EndPass needs.  Passes past the frame's limit are not timed.
+    UINT BeginPass(ID3D12GraphicsCommandList* cmdList, const std::string& name)
+    {
+        UINT query = mTimer.BeginPass(name);
+        if(query != GpuTimer::NoQuery)
+            cmdList->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+
+        return query;
+    }
+
+    void EndPass(ID3D12GraphicsCommandList* cmdList, UINT beginQuery)
+    {
+        UINT query = mTimer.EndPass(beginQuery);
+        if(query != GpuTimer::NoQuery)
+            cmdList->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+    }
+
+    void EndFrame(ID3D12GraphicsCommandList* cmdList)
+    {
+        std::uint32_t firstQuery = 0;
+        std::uint32_t queryCount = 0;
+        mTimer.EndFrame(firstQuery, queryCount);
+
+        if(queryCount > 0)
+        {
+            cmdList->ResolveQueryData(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, queryCount,
+                mReadbackBuffer.Get(), UINT64(firstQuery) * sizeof(UINT64));
+        }
+    }
+
+    void SetFrameFence(UINT64 fenceValue)
+    {
+        mTimer.SetFrameFence(fenceValue);
+    }
+
+    GpuTimer& GetTimer()
+    {
+        return mTimer;
+    }
+
+    const GpuTimer& GetTimer()const
+    {
+        return mTimer;
+    }
+
+private:
+    GpuTimer mTimer;
+
+    UINT64 mFrequency = 0;
+
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> mQueryHeap;
+    Microsoft::WRL::ComPtr<ID3D12Resource> mReadbackBuffer;
+};
@@ -0,0 +1,280 @@
+//***************************************************************************************
+// D3D12PipelineStateCache.h
+//
+// Creates graphics pipeline states through a PipelineStateCache.  A description the
+// cache has seen before returns the existing handle; a new one is looked up in the
+// pipeline library loaded from disk and only compiled by the driver if it is not
+// there.  Save() writes the library back when pipelines were added to it.
+//
+// Root signatures are pointers in the description, so each one has to be registered
+// with its serialized blob, which is what goes into the key.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "PipelineStateCache.h"
+
+class D3D12PipelineStateCache
+{
+public:
+    D3D12PipelineStateCache(ID3D12Device* device, const std::wstring& libraryFilename)
+        : mDevice(device), mLibraryFilename(libraryFilename)
+    {
+        // Pipeline libraries need ID3D12Device1.  Without one, pipelines are still
+        // shared within the run, just not kept across runs.
+        if(FAILED(device->QueryInterface(IID_PPV_ARGS(&mDevice1))))
+            return;
+
+        if(GetFileAttributesW(mLibraryFilename.c_str()) != INVALID_FILE_ATTRIBUTES)
+        {
+            // The library reads from the blob it was created from as long as it lives.
+            // LoadBinary maps the file, and Windows does not replace a mapped file, so
+            // the blob is copied out and the mapping closed before Save() rewrites it.
+            const void* library = nullptr;
+            std::size_t size = 0;
+            {
+                Microsoft::WRL::ComPtr<ID3DBlob> file = d3dUtil::LoadBinary(mLibraryFilename);
+                if(PipelineStateCache::GetLibrary(file->GetBufferPointer(), file->GetBufferSize(), library, size))
+                {
+                    const std::uint8_t* bytes = (const std::uint8_t*)library;
+                    mLibraryData.assign(bytes, bytes + size);
+                }
+            }
+
+            if(mLibraryData.empty() ||
+               FAILED(mDevice1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary))))
+            {
+                // Damaged, or written by another driver or adapter: start over.
+                mLibrary = nullptr;
+                mLibraryData.clear();
+            }
+        }
+
+        if(mLibrary == nullptr && FAILED(mDevice1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary))))
+            mLibrary = nullptr;
+    }
+
+    D3D12PipelineStateCache(const D3D12PipelineStateCache& rhs) = delete;
+    D3D12PipelineStateCache& operator=(const D3D12PipelineStateCache& rhs) = delete;
+    ~D3D12PipelineStateCache() = default;
+
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serializedRootSignature)
+    {
+        PipelineStateHasher hasher;
+        hasher.AddBytes(serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize());
+        mRootSignatureKeys[rootSignature] = hasher.GetHash();
+    }
+
+    PipelineStateHandle Create(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+    {
+        std::uint64_t key = HashDesc(desc);
+
+        PipelineStateHandle handle = mCache.Find(key);
+        if(handle != InvalidPipelineStateHandle)
+        {
+            ++mStats.SharedCount;
+            return handle;
+        }
+
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> pso;
+        std::wstring name = PipelineStateCache::GetLibraryName(key);
+        if(mLibrary != nullptr && SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pso))))
+        {
+            ++mStats.LoadedCount;
+        }
+        else
+        {
+            ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+            ++mStats.CreatedCount;
+
+            // Storing fails if the name is taken by a pipeline with a different
+            // description; the pipeline is then just not kept.
+            if(mLibrary != nullptr && SUCCEEDED(mLibrary->StorePipeline(name.c_str(), pso.Get())))
+                mIsLibraryDirty = true;
+        }
+
+        bool isNew = false;
+        handle = mCache.Add(key, isNew);
+        assert(isNew && handle == mPipelineStates.size());
+        mPipelineStates.push_back(pso);
+
+        return handle;
+    }
+
+    ID3D12PipelineState* Get(PipelineStateHandle handle)const
+    {
+        assert(handle < mPipelineStates.size());
+        return mPipelineStates[handle].Get();
+    }
+
+    // Writes the library if pipelines were added to it.  Returns false, and says so in
+    // the debugger output, if it could not be written; that only costs the compiles
+    // next time.
+    bool Save()
+    {
+        if(mLibrary == nullptr || !mIsLibraryDirty)
+            return true;
+
+        std::vector<std::uint8_t> library(mLibrary->GetSerializedSize());
+        ThrowIfFailed(mLibrary->Serialize(library.data(), library.size()));
+
+        std::string filename = WStringToAnsi(mLibraryFilename);
+        if(!PipelineStateCache::SaveLibraryFile(filename, library.data(), library.size()))
+        {
+            OutputDebugStringA(("Could not write the pipeline library " + filename + "\n").c_str());
+            return false;
+        }
+
+        mIsLibraryDirty = false;
+        return true;
+    }
+
+    const PipelineStateCacheStats& GetStats()const
+    {
+        return mStats;
+    }
+
+private:
+    static void HashShader(PipelineStateHasher& hasher, const D3D12_SHADER_BYTECODE& shader)
+    {
+        hasher.AddUInt(shader.BytecodeLength);
+        if(shader.pShaderBytecode != nullptr)
+            hasher.AddBytes(shader.pShaderBytecode, shader.BytecodeLength);
+    }
+
+    static void HashRenderTargetBlend(PipelineStateHasher& hasher, const D3D12_RENDER_TARGET_BLEND_DESC& blend)
+    {
+        hasher.AddUInt(blend.BlendEnable);
+        hasher.AddUInt(blend.LogicOpEnable);
+        hasher.AddUInt(blend.SrcBlend);
+        hasher.AddUInt(blend.DestBlend);
+        hasher.AddUInt(blend.BlendOp);
+        hasher.AddUInt(blend.SrcBlendAlpha);
+        hasher.AddUInt(blend.DestBlendAlpha);
+        hasher.AddUInt(blend.BlendOpAlpha);
+        hasher.AddUInt(blend.LogicOp);
+        hasher.AddUInt(blend.RenderTargetWriteMask);
+    }
+
+    static void HashStencilOp(PipelineStateHasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& op)
+    {
+        hasher.AddUInt(op.StencilFailOp);
+        hasher.AddUInt(op.StencilDepthFailOp);
+        hasher.AddUInt(op.StencilPassOp);
+        hasher.AddUInt(op.StencilFunc);
+    }
+
+    // Field by field, so padding never reaches the hash, and every pointer is
+    // replaced by what it points to.
+    std::uint64_t HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const
+    {
+        PipelineStateHasher hasher;
+
+        auto rootSignature = mRootSignatureKeys.find(desc.pRootSignature);
+        assert(rootSignature != mRootSignatureKeys.end() && "Root signature was not registered.");
+        hasher.AddUInt(rootSignature != mRootSignatureKeys.end() ? rootSignature->second : 0);
+
+        HashShader(hasher, desc.VS);
+        HashShader(hasher, desc.PS);
+        HashShader(hasher, desc.DS);
+        HashShader(hasher, desc.HS);
+        HashShader(hasher, desc.GS);
+
+        const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+        hasher.AddUInt(so.NumEntries);
+        for(UINT i = 0; i < so.NumEntries; ++i)
+        {
+            const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+            hasher.AddUInt(entry.Stream);
+            hasher.AddString(entry.SemanticName);
+            hasher.AddUInt(entry.SemanticIndex);
+            hasher.AddUInt(entry.StartComponent);
+            hasher.AddUInt(entry.ComponentCount);
+            hasher.AddUInt(entry.OutputSlot);
+        }
+        hasher.AddUInt(so.NumStrides);
+        for(UINT i = 0; i < so.NumStrides; ++i)
+            hasher.AddUInt(so.pBufferStrides[i]);
+        hasher.AddUInt(so.RasterizedStream);
+
+        // Without independent blending only the first render target's blend is used.
+        const D3D12_BLEND_DESC& blend = desc.BlendState;
+        hasher.AddUInt(blend.AlphaToCoverageEnable);
+        hasher.AddUInt(blend.IndependentBlendEnable);
+        UINT blendCount = blend.IndependentBlendEnable ? 8 : 1;
+        for(UINT i = 0; i < blendCount; ++i)
+            HashRenderTargetBlend(hasher, blend.RenderTarget[i]);
+
+        hasher.AddUInt(desc.SampleMask);
+
+        const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+        hasher.AddUInt(rasterizer.FillMode);
+        hasher.AddUInt(rasterizer.CullMode);
+        hasher.AddUInt(rasterizer.FrontCounterClockwise);
+        hasher.AddUInt((std::uint32_t)rasterizer.DepthBias);
+        hasher.AddFloat(rasterizer.DepthBiasClamp);
+        hasher.AddFloat(rasterizer.SlopeScaledDepthBias);
+        hasher.AddUInt(rasterizer.DepthClipEnable);
+        hasher.AddUInt(rasterizer.MultisampleEnable);
+        hasher.AddUInt(rasterizer.AntialiasedLineEnable);
+        hasher.AddUInt(rasterizer.ForcedSampleCount);
+        hasher.AddUInt(rasterizer.ConservativeRaster);
+
+        const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+        hasher.AddUInt(depthStencil.DepthEnable);
+        hasher.AddUInt(depthStencil.DepthWriteMask);
+        hasher.AddUInt(depthStencil.DepthFunc);
+        hasher.AddUInt(depthStencil.StencilEnable);
+        hasher.AddUInt(depthStencil.StencilReadMask);
+        hasher.AddUInt(depthStencil.StencilWriteMask);
+        HashStencilOp(hasher, depthStencil.FrontFace);
+        HashStencilOp(hasher, depthStencil.BackFace);
+
+        hasher.AddUInt(desc.InputLayout.NumElements);
+        for(UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+        {
+            const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+            hasher.AddString(element.SemanticName);
+            hasher.AddUInt(element.SemanticIndex);
+            hasher.AddUInt(element.Format);
+            hasher.AddUInt(element.InputSlot);
+            hasher.AddUInt(element.AlignedByteOffset);
+            hasher.AddUInt(element.InputSlotClass);
+            hasher.AddUInt(element.InstanceDataStepRate);
+        }
+
+        hasher.AddUInt(desc.IBStripCutValue);
+        hasher.AddUInt(desc.PrimitiveTopologyType);
+
+        hasher.AddUInt(desc.NumRenderTargets);
+        for(UINT i = 0; i < desc.NumRenderTargets; ++i)
+            hasher.AddUInt(desc.RTVFormats[i]);
+        hasher.AddUInt(desc.DSVFormat);
+
+        hasher.AddUInt(desc.SampleDesc.Count);
+        hasher.AddUInt(desc.SampleDesc.Quality);
+        hasher.AddUInt(desc.NodeMask);
+        hasher.AddUInt(desc.Flags);
+
+        // CachedPSO only speeds up creation; it does not change the pipeline.
+
+        return hasher.GetHash();
+    }
+
+private:
+    ID3D12Device* mDevice = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12Device1> mDevice1;
+
+    std::wstring mLibraryFilename;
+    std::vector<std::uint8_t> mLibraryData;
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+    bool mIsLibraryDirty = false;
+
+    std::unordered_map<ID3D12RootSignature*, std::uint64_t> mRootSignatureKeys;
+
+    PipelineStateCache mCache;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12PipelineState>> mPipelineStates;
+
+    PipelineStateCacheStats mStats;
+};
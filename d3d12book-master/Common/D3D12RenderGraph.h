@@ -0,0 +1,74 @@
+//***************************************************************************************
+// D3D12RenderGraph.h
+//
+// Records a compiled RenderGraph to a command list.  Graph resources are bound to
+// the ID3D12Resource they stand for (the back buffer can be rebound every frame
+// without recompiling), and each batch of barriers becomes one ResourceBarrier call.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "RenderGraph.h"
+
+static_assert(RenderGraphUnorderedAccessState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+    "RenderGraph's unordered access state must match Direct3D's");
+
+class D3D12RenderGraph
+{
+public:
+    D3D12RenderGraph() = default;
+    D3D12RenderGraph(const D3D12RenderGraph& rhs) = delete;
+    D3D12RenderGraph& operator=(const D3D12RenderGraph& rhs) = delete;
+    ~D3D12RenderGraph() = default;
+
+    void Bind(RenderGraphResource resource, ID3D12Resource* d3dResource)
+    {
+        if(resource >= mResources.size())
+            mResources.resize(resource + 1, nullptr);
+
+        mResources[resource] = d3dResource;
+    }
+
+    // Runs graph's passes, recording their barriers to cmdList.  The passes record
+    // their own commands.
+    void Execute(const RenderGraph& graph, ID3D12GraphicsCommandList* cmdList)
+    {
+        graph.Execute([this, cmdList](const RenderGraphBarrier* barriers, std::uint32_t count)
+        {
+            mBarriers.clear();
+            for(std::uint32_t i = 0; i < count; ++i)
+            {
+                const RenderGraphBarrier& b = barriers[i];
+                if(b.Type == RenderGraphBarrierType::Aliasing)
+                {
+                    ID3D12Resource* before = b.AliasedResource != InvalidRenderGraphResource ?
+                        Get(b.AliasedResource) : nullptr;
+                    mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(before, Get(b.Resource)));
+                }
+                else if(b.Type == RenderGraphBarrierType::UnorderedAccess)
+                {
+                    mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(Get(b.Resource)));
+                }
+                else
+                {
+                    mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(Get(b.Resource),
+                        (D3D12_RESOURCE_STATES)b.Before, (D3D12_RESOURCE_STATES)b.After));
+                }
+            }
+
+            cmdList->ResourceBarrier((UINT)mBarriers.size(), mBarriers.data());
+        });
+    }
+
+private:
+    ID3D12Resource* Get(RenderGraphResource resource)const
+    {
+        assert(resource < mResources.size() && mResources[resource] != nullptr);
+        return mResources[resource];
+    }
+
+private:
+    std::vector<ID3D12Resource*> mResources;
+    std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+};
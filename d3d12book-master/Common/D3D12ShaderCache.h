@@ -0,0 +1,141 @@
+//***************************************************************************************
+// D3D12ShaderCache.h
+//
+// ShaderCache backed by D3DCompileFromFile, with the pack file read through
+// d3dUtil::LoadBinary.  Queue every shader with Add(), then CompileAll() fills the
+// blobs: cached bytecode is copied out of the pack, misses are compiled on the
+// thread pool and the pack is rewritten when anything new was compiled.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ShaderCache.h"
+
+#include <cstring>
+#include <mutex>
+
+class D3D12ShaderCache
+{
+public:
+    explicit D3D12ShaderCache(const std::wstring& packFilename, ThreadPool* threadPool = nullptr)
+        : mPackFilename(packFilename),
+          mCache([this](const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode)
+          {
+              return Compile(request, bytecode);
+          }, threadPool)
+    {
+        mCache.SetCompilerId("d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION));
+
+        // No pack yet on the first run; everything is a miss.
+        if(GetFileAttributesW(mPackFilename.c_str()) != INVALID_FILE_ATTRIBUTES)
+        {
+            Microsoft::WRL::ComPtr<ID3DBlob> pack = d3dUtil::LoadBinary(mPackFilename);
+            mCache.LoadPack(pack->GetBufferPointer(), pack->GetBufferSize());
+        }
+    }
+
+    D3D12ShaderCache(const D3D12ShaderCache& rhs) = delete;
+    D3D12ShaderCache& operator=(const D3D12ShaderCache& rhs) = delete;
+    ~D3D12ShaderCache() = default;
+
+    // Same arguments as d3dUtil::CompileShader.  byteCode is set by CompileAll(), so it
+    // must outlive the call.
+    void Add(const std::wstring& filename, const D3D_SHADER_MACRO* defines,
+        const std::string& entrypoint, const std::string& target,
+        Microsoft::WRL::ComPtr<ID3DBlob>& byteCode)
+    {
+        ShaderCompileRequest request;
+        request.Filename = WStringToAnsi(filename);
+        for(const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define)
+            request.Defines.push_back({ define->Name, define->Definition != nullptr ? define->Definition : "" });
+        request.EntryPoint = entrypoint;
+        request.Target = target;
+        request.Flags = GetCompileFlags();
+
+        mCache.Add(request);
+        mTargets.push_back(&byteCode);
+    }
+
+    // Throws like d3dUtil::CompileShader if a shader fails to compile; the errors go
+    // to the debugger output.
+    void CompileAll()
+    {
+        mFailure = S_OK;
+        bool succeeded = mCache.Resolve();
+
+        for(std::uint32_t i = 0; i < mCache.GetRequestCount(); ++i)
+        {
+            const std::vector<std::uint8_t>* bytecode = mCache.GetBytecode(i);
+            if(bytecode == nullptr)
+                continue;
+
+            ThrowIfFailed(D3DCreateBlob(bytecode->size(), mTargets[i]->ReleaseAndGetAddressOf()));
+            std::memcpy((*mTargets[i])->GetBufferPointer(), bytecode->data(), bytecode->size());
+        }
+        mTargets.clear();
+
+        // Whatever did compile is worth keeping, even if another shader failed.  A pack
+        // that cannot be written only costs the compiles next time.
+        std::string packFilename = WStringToAnsi(mPackFilename);
+        if(mCache.IsDirty() && !mCache.SavePack(packFilename))
+            OutputDebugStringA(("Could not write the shader pack " + packFilename + "\n").c_str());
+
+        if(!succeeded)
+            ThrowIfFailed(FAILED(mFailure) ? mFailure : E_FAIL);
+    }
+
+    const ShaderCacheStats& GetStats()const
+    {
+        return mCache.GetStats();
+    }
+
+private:
+    static UINT GetCompileFlags()
+    {
+        UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+        compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+        return compileFlags;
+    }
+
+    // Runs on pool threads.
+    bool Compile(const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode)
+    {
+        std::vector<D3D_SHADER_MACRO> defines;
+        for(const ShaderDefine& define : request.Defines)
+            defines.push_back({ define.Name.c_str(), define.Value.c_str() });
+        defines.push_back({ nullptr, nullptr });
+
+        Microsoft::WRL::ComPtr<ID3DBlob> byteCode;
+        Microsoft::WRL::ComPtr<ID3DBlob> errors;
+        HRESULT hr = D3DCompileFromFile(AnsiToWString(request.Filename).c_str(), defines.data(),
+            D3D_COMPILE_STANDARD_FILE_INCLUDE, request.EntryPoint.c_str(), request.Target.c_str(),
+            request.Flags, 0, &byteCode, &errors);
+
+        if(errors != nullptr)
+            OutputDebugStringA((char*)errors->GetBufferPointer());
+
+        if(FAILED(hr))
+        {
+            std::lock_guard<std::mutex> lock(mFailureMutex);
+            if(SUCCEEDED(mFailure))
+                mFailure = hr;
+            return false;
+        }
+
+        const std::uint8_t* data = (const std::uint8_t*)byteCode->GetBufferPointer();
+        bytecode.assign(data, data + byteCode->GetBufferSize());
+        return true;
+    }
+
+private:
+    std::wstring mPackFilename;
+    ShaderCache mCache;
+
+    std::vector<Microsoft::WRL::ComPtr<ID3DBlob>*> mTargets;
+
+    std::mutex mFailureMutex;
+    HRESULT mFailure = S_OK;
+};
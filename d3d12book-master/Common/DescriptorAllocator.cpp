@@ -0,0 +1,349 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+
+#include <cassert>
+
+namespace
+{
+	// Index of the highest set bit; x must not be 0.
+	std::uint32_t HighestBit(std::uint32_t x)
+	{
+		std::uint32_t bit = 0;
+		while(x >>= 1)
+			++bit;
+		return bit;
+	}
+
+	// Index of the lowest set bit; x must not be 0.
+	std::uint32_t LowestBit(std::uint32_t x)
+	{
+		std::uint32_t bit = 0;
+		while((x & 1) == 0)
+		{
+			x >>= 1;
+			++bit;
+		}
+		return bit;
+	}
+}
+
+const std::uint32_t DescriptorRangeAllocator::SubclassBits;
+const std::uint32_t DescriptorRangeAllocator::SubclassCount;
+const std::uint32_t DescriptorRangeAllocator::ClassCount;
+const std::uint32_t DescriptorRangeAllocator::InvalidBlock;
+
+DescriptorRangeAllocator::DescriptorRangeAllocator(std::uint32_t first, std::uint32_t count)
+	: mFirst(first),
+	  mCapacity(count),
+	  mBlockAtOffset(count, InvalidBlock)
+{
+	for(std::uint32_t fl = 0; fl < ClassCount; ++fl)
+	{
+		mSubclassBitmaps[fl] = 0;
+		for(std::uint32_t sl = 0; sl < SubclassCount; ++sl)
+			mFreeLists[fl][sl] = InvalidBlock;
+	}
+
+	if(count > 0)
+	{
+		std::uint32_t block = NewBlock();
+		mBlocks[block].Offset = 0;
+		mBlocks[block].Count = count;
+		InsertFreeBlock(block);
+	}
+}
+
+DescriptorRange DescriptorRangeAllocator::Allocate(std::uint32_t count)
+{
+	DescriptorRange range;
+	if(count == 0)
+		return range;
+
+	std::uint32_t block = FindFreeBlock(count);
+	if(block == InvalidBlock)
+		return range;
+
+	RemoveFreeBlock(block);
+
+	// Give the tail back as a free block of its own.
+	if(mBlocks[block].Count > count)
+	{
+		std::uint32_t rest = NewBlock();
+		mBlocks[rest].Offset = mBlocks[block].Offset + count;
+		mBlocks[rest].Count = mBlocks[block].Count - count;
+		mBlocks[rest].PrevPhysical = block;
+		mBlocks[rest].NextPhysical = mBlocks[block].NextPhysical;
+
+		if(mBlocks[block].NextPhysical != InvalidBlock)
+			mBlocks[mBlocks[block].NextPhysical].PrevPhysical = rest;
+
+		mBlocks[block].NextPhysical = rest;
+		mBlocks[block].Count = count;
+
+		InsertFreeBlock(rest);
+	}
+
+	mBlockAtOffset[mBlocks[block].Offset] = block;
+
+	range.Offset = mFirst + mBlocks[block].Offset;
+	range.Count = count;
+	return range;
+}
+
+void DescriptorRangeAllocator::Free(const DescriptorRange& range)
+{
+	if(!range.IsValid())
+		return;
+
+	assert(range.Offset >= mFirst && range.Offset - mFirst < mCapacity);
+
+	std::uint32_t offset = range.Offset - mFirst;
+	std::uint32_t block = mBlockAtOffset[offset];
+
+	assert(block != InvalidBlock && !mBlocks[block].IsFree && mBlocks[block].Count == range.Count);
+	mBlockAtOffset[offset] = InvalidBlock;
+
+	// Merge with a free block that follows...
+	std::uint32_t next = mBlocks[block].NextPhysical;
+	if(next != InvalidBlock && mBlocks[next].IsFree)
+	{
+		RemoveFreeBlock(next);
+
+		mBlocks[block].Count += mBlocks[next].Count;
+		mBlocks[block].NextPhysical = mBlocks[next].NextPhysical;
+		if(mBlocks[next].NextPhysical != InvalidBlock)
+			mBlocks[mBlocks[next].NextPhysical].PrevPhysical = block;
+
+		DeleteBlock(next);
+	}
+
+	// ...and with one that precedes.
+	std::uint32_t prev = mBlocks[block].PrevPhysical;
+	if(prev != InvalidBlock && mBlocks[prev].IsFree)
+	{
+		RemoveFreeBlock(prev);
+
+		mBlocks[prev].Count += mBlocks[block].Count;
+		mBlocks[prev].NextPhysical = mBlocks[block].NextPhysical;
+		if(mBlocks[block].NextPhysical != InvalidBlock)
+			mBlocks[mBlocks[block].NextPhysical].PrevPhysical = prev;
+
+		DeleteBlock(block);
+		block = prev;
+	}
+
+	InsertFreeBlock(block);
+}
+
+std::uint32_t DescriptorRangeAllocator::GetCapacity()const
+{
+	return mCapacity;
+}
+
+std::uint32_t DescriptorRangeAllocator::GetFreeCount()const
+{
+	return mFreeCount;
+}
+
+void DescriptorRangeAllocator::MapSize(std::uint32_t count, std::uint32_t& fl, std::uint32_t& sl)
+{
+	if(count < SubclassCount)
+	{
+		// Small sizes get a subclass each.
+		fl = 0;
+		sl = count;
+	}
+	else
+	{
+		std::uint32_t highBit = HighestBit(count);
+		fl = highBit - SubclassBits + 1;
+		sl = (count >> (highBit - SubclassBits)) ^ SubclassCount;
+	}
+}
+
+std::uint32_t DescriptorRangeAllocator::FindFreeBlock(std::uint32_t count)const
+{
+	// Round up to the next subclass boundary so any block in the class found is big
+	// enough.
+	std::uint64_t rounded = count;
+	if(count >= SubclassCount)
+		rounded += (std::uint64_t(1) << (HighestBit(count) - SubclassBits)) - 1;
+
+	std::uint32_t fl = 0, sl = 0;
+	std::uint32_t subclassMap = 0;
+	if(rounded <= 0xffffffff)
+	{
+		MapSize((std::uint32_t)rounded, fl, sl);
+		subclassMap = mSubclassBitmaps[fl] & (~0u << sl);
+	}
+
+	if(subclassMap == 0 && rounded <= 0xffffffff)
+	{
+		std::uint32_t classMap = (fl + 1 < 32) ? mClassBitmap & (~0u << (fl + 1)) : 0;
+		if(classMap != 0)
+		{
+			fl = LowestBit(classMap);
+			subclassMap = mSubclassBitmaps[fl];
+		}
+	}
+
+	if(subclassMap != 0)
+	{
+		sl = LowestBit(subclassMap);
+		return mFreeLists[fl][sl];
+	}
+
+	// Nothing in the classes that are guaranteed to fit.  Blocks in count's own
+	// subclass may still be large enough (e.g. the whole heap, when asking for all of
+	// it), so look through that one list before giving up.
+	MapSize(count, fl, sl);
+	for(std::uint32_t block = mFreeLists[fl][sl]; block != InvalidBlock; block = mBlocks[block].NextFree)
+	{
+		if(mBlocks[block].Count >= count)
+			return block;
+	}
+
+	return InvalidBlock;
+}
+
+void DescriptorRangeAllocator::InsertFreeBlock(std::uint32_t block)
+{
+	std::uint32_t fl, sl;
+	MapSize(mBlocks[block].Count, fl, sl);
+
+	std::uint32_t head = mFreeLists[fl][sl];
+	mBlocks[block].IsFree = true;
+	mBlocks[block].PrevFree = InvalidBlock;
+	mBlocks[block].NextFree = head;
+	if(head != InvalidBlock)
+		mBlocks[head].PrevFree = block;
+
+	mFreeLists[fl][sl] = block;
+	mSubclassBitmaps[fl] |= 1u << sl;
+	mClassBitmap |= 1u << fl;
+
+	mFreeCount += mBlocks[block].Count;
+}
+
+void DescriptorRangeAllocator::RemoveFreeBlock(std::uint32_t block)
+{
+	std::uint32_t fl, sl;
+	MapSize(mBlocks[block].Count, fl, sl);
+
+	std::uint32_t prev = mBlocks[block].PrevFree;
+	std::uint32_t next = mBlocks[block].NextFree;
+	if(prev != InvalidBlock)
+		mBlocks[prev].NextFree = next;
+	else
+		mFreeLists[fl][sl] = next;
+
+	if(next != InvalidBlock)
+		mBlocks[next].PrevFree = prev;
+
+	if(mFreeLists[fl][sl] == InvalidBlock)
+	{
+		mSubclassBitmaps[fl] &= ~(1u << sl);
+		if(mSubclassBitmaps[fl] == 0)
+			mClassBitmap &= ~(1u << fl);
+	}
+
+	mBlocks[block].IsFree = false;
+	mBlocks[block].PrevFree = InvalidBlock;
+	mBlocks[block].NextFree = InvalidBlock;
+
+	mFreeCount -= mBlocks[block].Count;
+}
+
+std::uint32_t DescriptorRangeAllocator::NewBlock()
+{
+	if(!mUnusedBlocks.empty())
+	{
+		std::uint32_t block = mUnusedBlocks.back();
+		mUnusedBlocks.pop_back();
+		mBlocks[block] = Block();
+		return block;
+	}
+
+	mBlocks.push_back(Block());
+	return (std::uint32_t)mBlocks.size() - 1;
+}
+
+void DescriptorRangeAllocator::DeleteBlock(std::uint32_t block)
+{
+	mUnusedBlocks.push_back(block);
+}
+
+TransientDescriptorAllocator::TransientDescriptorAllocator(std::uint32_t first,
+	std::uint32_t countPerFrame, std::uint32_t frameCount)
+	: mFirst(first),
+	  mCountPerFrame(countPerFrame),
+	  mFrameCount(frameCount)
+{
+	assert(frameCount > 0);
+}
+
+void TransientDescriptorAllocator::BeginFrame(std::uint32_t frameIndex)
+{
+	assert(frameIndex < mFrameCount);
+
+	mFrameIndex = frameIndex;
+	mUsedCount = 0;
+}
+
+DescriptorRange TransientDescriptorAllocator::Allocate(std::uint32_t count)
+{
+	DescriptorRange range;
+	if(count == 0 || count > mCountPerFrame - mUsedCount)
+		return range;
+
+	range.Offset = mFirst + mFrameIndex*mCountPerFrame + mUsedCount;
+	range.Count = count;
+
+	mUsedCount += count;
+	return range;
+}
+
+std::uint32_t TransientDescriptorAllocator::GetUsedCount()const
+{
+	return mUsedCount;
+}
+
+void DescriptorCopyBatch::Add(std::uint32_t srcOffset, std::uint32_t dstOffset, std::uint32_t count)
+{
+	if(count == 0)
+		return;
+
+	if(!mCopies.empty())
+	{
+		DescriptorCopy& last = mCopies.back();
+		if(last.SrcOffset + last.Count == srcOffset && last.DstOffset + last.Count == dstOffset)
+		{
+			last.Count += count;
+			return;
+		}
+	}
+
+	DescriptorCopy copy;
+	copy.SrcOffset = srcOffset;
+	copy.DstOffset = dstOffset;
+	copy.Count = count;
+	mCopies.push_back(copy);
+}
+
+const std::vector<DescriptorCopy>& DescriptorCopyBatch::GetCopies()const
+{
+	return mCopies;
+}
+
+bool DescriptorCopyBatch::IsEmpty()const
+{
+	return mCopies.empty();
+}
+
+void DescriptorCopyBatch::Clear()
+{
+	mCopies.clear();
+}
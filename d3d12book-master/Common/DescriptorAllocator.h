@@ -0,0 +1,148 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Index bookkeeping for descriptor heaps, independent of Direct3D (see DescriptorHeap.h
+// for the heap itself).
+//
+// DescriptorRangeAllocator hands out contiguous ranges of a persistent region and
+// takes them back in any order.  Free ranges are kept in a two-level segregated fit
+// (TLSF) structure: size classes by power of two, each split in eight linear
+// subclasses, with bitmaps to find a large enough free range in constant time.
+// Freed ranges are merged with free neighbours right away.
+//
+// TransientDescriptorAllocator is a linear allocator per frame resource for
+// descriptors that only live for one frame; a frame's region is reset when the frame
+// resource comes around again, after its fence has been waited for.
+//
+// DescriptorCopyBatch collects descriptor copies (e.g. from a CPU-only staging heap
+// to the shader-visible heap) and merges adjacent ones, so they can be issued with a
+// single CopyDescriptors call.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct DescriptorRange
+{
+	std::uint32_t Offset = 0;
+	std::uint32_t Count = 0;
+
+	bool IsValid()const { return Count > 0; }
+};
+
+class DescriptorRangeAllocator
+{
+public:
+	// Manages the indices [first, first + count).
+	DescriptorRangeAllocator(std::uint32_t first, std::uint32_t count);
+	DescriptorRangeAllocator(const DescriptorRangeAllocator& rhs) = delete;
+	DescriptorRangeAllocator& operator=(const DescriptorRangeAllocator& rhs) = delete;
+	~DescriptorRangeAllocator() = default;
+
+	// Returns an invalid range if no free range of count descriptors is left.
+	DescriptorRange Allocate(std::uint32_t count);
+
+	// range must have been returned by Allocate() and not freed since.
+	void Free(const DescriptorRange& range);
+
+	std::uint32_t GetCapacity()const;
+	std::uint32_t GetFreeCount()const;
+
+private:
+	static const std::uint32_t SubclassBits = 3;
+	static const std::uint32_t SubclassCount = 1 << SubclassBits;
+	static const std::uint32_t ClassCount = 32 - SubclassBits + 1;
+
+	static const std::uint32_t InvalidBlock = 0xffffffff;
+
+	struct Block
+	{
+		std::uint32_t Offset = 0;
+		std::uint32_t Count = 0;
+
+		// Neighbours in the heap, by offset.
+		std::uint32_t PrevPhysical = InvalidBlock;
+		std::uint32_t NextPhysical = InvalidBlock;
+
+		// Neighbours in the free list of the block's size class.
+		std::uint32_t PrevFree = InvalidBlock;
+		std::uint32_t NextFree = InvalidBlock;
+
+		bool IsFree = false;
+	};
+
+	static void MapSize(std::uint32_t count, std::uint32_t& fl, std::uint32_t& sl);
+
+	std::uint32_t FindFreeBlock(std::uint32_t count)const;
+	void InsertFreeBlock(std::uint32_t block);
+	void RemoveFreeBlock(std::uint32_t block);
+
+	std::uint32_t NewBlock();
+	void DeleteBlock(std::uint32_t block);
+
+private:
+	std::uint32_t mFirst = 0;
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mFreeCount = 0;
+
+	std::vector<Block> mBlocks;
+	std::vector<std::uint32_t> mUnusedBlocks;
+
+	// Block starting at each offset (relative to mFirst), valid for allocated blocks.
+	std::vector<std::uint32_t> mBlockAtOffset;
+
+	std::uint32_t mClassBitmap = 0;
+	std::uint32_t mSubclassBitmaps[ClassCount];
+	std::uint32_t mFreeLists[ClassCount][SubclassCount];
+};
+
+class TransientDescriptorAllocator
+{
+public:
+	// Manages frameCount regions of countPerFrame descriptors starting at first.
+	TransientDescriptorAllocator(std::uint32_t first, std::uint32_t countPerFrame, std::uint32_t frameCount);
+	TransientDescriptorAllocator(const TransientDescriptorAllocator& rhs) = delete;
+	TransientDescriptorAllocator& operator=(const TransientDescriptorAllocator& rhs) = delete;
+	~TransientDescriptorAllocator() = default;
+
+	// Switches to the region of frameIndex and empties it.  The GPU must be done with
+	// the frame that last used it.
+	void BeginFrame(std::uint32_t frameIndex);
+
+	// Returns an invalid range if the current frame's region is full.
+	DescriptorRange Allocate(std::uint32_t count);
+
+	std::uint32_t GetUsedCount()const;
+
+private:
+	std::uint32_t mFirst = 0;
+	std::uint32_t mCountPerFrame = 0;
+	std::uint32_t mFrameCount = 0;
+
+	std::uint32_t mFrameIndex = 0;
+	std::uint32_t mUsedCount = 0;
+};
+
+struct DescriptorCopy
+{
+	std::uint32_t SrcOffset = 0;
+	std::uint32_t DstOffset = 0;
+	std::uint32_t Count = 0;
+};
+
+class DescriptorCopyBatch
+{
+public:
+	// Adds a copy of count descriptors, merged into the previous copy when both its
+	// source and destination continue it.
+	void Add(std::uint32_t srcOffset, std::uint32_t dstOffset, std::uint32_t count);
+
+	const std::vector<DescriptorCopy>& GetCopies()const;
+	bool IsEmpty()const;
+	void Clear();
+
+private:
+	std::vector<DescriptorCopy> mCopies;
+};
@@ -0,0 +1,137 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// A descriptor heap split into a persistent region, managed by a
+// DescriptorRangeAllocator, and a transient region with one linear part per frame
+// resource.  Descriptors can be created directly in the heap or, for a
+// shader-visible heap, created in a CPU-only staging heap and copied over in one
+// batched CopyDescriptors call.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+    DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, bool shaderVisible,
+        UINT persistentCount, UINT transientCountPerFrame = 0, UINT frameCount = 1)
+        : mDevice(device),
+          mType(type),
+          mPersistent(0, persistentCount),
+          mTransient(persistentCount, transientCountPerFrame, frameCount)
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+        heapDesc.NumDescriptors = persistentCount + transientCountPerFrame*frameCount;
+        heapDesc.Type = type;
+        heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+        mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+        mShaderVisible = shaderVisible;
+    }
+
+    DescriptorHeap(const DescriptorHeap& rhs) = delete;
+    DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+    ~DescriptorHeap() = default;
+
+    ID3D12DescriptorHeap* Get()const
+    {
+        return mHeap.Get();
+    }
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(UINT index)const
+    {
+        return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+    }
+
+    // Only for shader-visible heaps.
+    CD3DX12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index)const
+    {
+        assert(mShaderVisible);
+        return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+    }
+
+    // Throws E_OUTOFMEMORY when the persistent region has no free range that large.
+    DescriptorRange AllocatePersistent(UINT count)
+    {
+        DescriptorRange range = mPersistent.Allocate(count);
+        if(!range.IsValid())
+            ThrowIfFailed(E_OUTOFMEMORY);
+        return range;
+    }
+
+    // The GPU must be done with every command list using the range.
+    void FreePersistent(const DescriptorRange& range)
+    {
+        mPersistent.Free(range);
+    }
+
+    // Call once the frame resource frameIndex is free again.
+    void BeginFrame(UINT frameIndex)
+    {
+        mTransient.BeginFrame(frameIndex);
+    }
+
+    // Throws E_OUTOFMEMORY when the current frame's transient region is full.
+    DescriptorRange AllocateTransient(UINT count)
+    {
+        DescriptorRange range = mTransient.Allocate(count);
+        if(!range.IsValid())
+            ThrowIfFailed(E_OUTOFMEMORY);
+        return range;
+    }
+
+    // Queues a copy of count descriptors from staging (a CPU-only heap of the same
+    // type) into this heap.  Nothing is copied until FlushCopies().
+    void QueueCopy(const DescriptorHeap& staging, UINT srcIndex, UINT dstIndex, UINT count)
+    {
+        assert(mStaging == nullptr || mStaging == &staging);
+        assert(!staging.mShaderVisible && staging.mType == mType);
+
+        mStaging = &staging;
+        mCopies.Add(srcIndex, dstIndex, count);
+    }
+
+    // Issues every queued copy with one CopyDescriptors call.
+    void FlushCopies()
+    {
+        if(mCopies.IsEmpty())
+            return;
+
+        mSrcStarts.clear();
+        mDstStarts.clear();
+        mCounts.clear();
+        for(const DescriptorCopy& copy : mCopies.GetCopies())
+        {
+            mSrcStarts.push_back(mStaging->GetCpuHandle(copy.SrcOffset));
+            mDstStarts.push_back(GetCpuHandle(copy.DstOffset));
+            mCounts.push_back(copy.Count);
+        }
+
+        UINT rangeCount = (UINT)mCounts.size();
+        mDevice->CopyDescriptors(rangeCount, mDstStarts.data(), mCounts.data(),
+            rangeCount, mSrcStarts.data(), mCounts.data(), mType);
+
+        mCopies.Clear();
+        mStaging = nullptr;
+    }
+
+private:
+    ID3D12Device* mDevice = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+    D3D12_DESCRIPTOR_HEAP_TYPE mType;
+    UINT mDescriptorSize = 0;
+    bool mShaderVisible = false;
+
+    DescriptorRangeAllocator mPersistent;
+    TransientDescriptorAllocator mTransient;
+
+    const DescriptorHeap* mStaging = nullptr;
+    DescriptorCopyBatch mCopies;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> mSrcStarts;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> mDstStarts;
+    std::vector<UINT> mCounts;
+};
@@ -0,0 +1,143 @@
+//***************************************************************************************
+// DirtySet.cpp
+//***************************************************************************************
+
+#include "DirtySet.h"
+
+#include <algorithm>
+#include <cassert>
+
+DirtySet::DirtySet(std::uint32_t elementCount, std::uint32_t frameResourceCount)
+	: mFrameGenerations(frameResourceCount, 1)
+{
+	assert(frameResourceCount > 0);
+
+	Resize(elementCount);
+}
+
+std::uint32_t DirtySet::GetElementCount()const
+{
+	return mElementCount;
+}
+
+void DirtySet::Resize(std::uint32_t elementCount)
+{
+	mElementCount = elementCount;
+	mStamps.assign(elementCount, 0);
+	mBits.assign((elementCount + 63) / 64, 0);
+
+	MarkAllDirty();
+}
+
+void DirtySet::MarkDirty(std::uint32_t index)
+{
+	assert(index < mElementCount);
+
+	if(mStamps[index] == mGeneration)
+		return;
+
+	mStamps[index] = mGeneration;
+
+	Change change;
+	change.Generation = mGeneration;
+	change.Index = index;
+	mChanges.push_back(change);
+
+	mGenerationHasChanges = true;
+}
+
+void DirtySet::MarkAllDirty()
+{
+	// Everything logged so far is covered by the full range.
+	mChanges.clear();
+
+	mAllDirtyGeneration = mGeneration;
+	mGenerationHasChanges = true;
+}
+
+const std::vector<DirtyRange>& DirtySet::CollectDirtyRanges(std::uint32_t frameResource)
+{
+	assert(frameResource < mFrameGenerations.size());
+
+	// Close the current generation so marks made from now on are seen by this frame
+	// resource next time, and by the others when they collect.
+	if(mGenerationHasChanges)
+	{
+		++mGeneration;
+		mGenerationHasChanges = false;
+	}
+
+	std::uint32_t firstUnseen = mFrameGenerations[frameResource];
+	mFrameGenerations[frameResource] = mGeneration;
+
+	mRanges.clear();
+	mCollectedCount = 0;
+
+	if(mAllDirtyGeneration >= firstUnseen)
+	{
+		if(mElementCount > 0)
+		{
+			DirtyRange range;
+			range.First = 0;
+			range.Count = mElementCount;
+			mRanges.push_back(range);
+			mCollectedCount = mElementCount;
+		}
+	}
+	else
+	{
+		// Walk back over the changes this frame resource has not seen, setting their bits.
+		for(auto it = mChanges.rbegin(); it != mChanges.rend() && it->Generation >= firstUnseen; ++it)
+		{
+			std::uint32_t word = it->Index / 64;
+			if(mBits[word] == 0)
+				mTouchedWords.push_back(word);
+
+			mBits[word] |= std::uint64_t(1) << (it->Index % 64);
+		}
+
+		std::sort(mTouchedWords.begin(), mTouchedWords.end());
+
+		// Turn the set bits into ranges, merging runs that continue across words.
+		for(std::uint32_t word : mTouchedWords)
+		{
+			std::uint64_t bits = mBits[word];
+			mBits[word] = 0;
+
+			for(std::uint32_t bit = 0; bit < 64; ++bit)
+			{
+				if((bits & (std::uint64_t(1) << bit)) == 0)
+					continue;
+
+				std::uint32_t index = word*64 + bit;
+				if(!mRanges.empty() && mRanges.back().First + mRanges.back().Count == index)
+				{
+					++mRanges.back().Count;
+				}
+				else
+				{
+					DirtyRange range;
+					range.First = index;
+					range.Count = 1;
+					mRanges.push_back(range);
+				}
+
+				++mCollectedCount;
+			}
+		}
+
+		mTouchedWords.clear();
+	}
+
+	// Drop the changes every frame resource has collected.
+	std::uint32_t oldestUnseen = *std::min_element(mFrameGenerations.begin(), mFrameGenerations.end());
+	while(!mChanges.empty() && mChanges.front().Generation < oldestUnseen)
+		mChanges.pop_front();
+
+	return mRanges;
+}
+
+std::uint32_t DirtySet::GetCollectedCount()const
+{
+	return mCollectedCount;
+}
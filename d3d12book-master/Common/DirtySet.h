@@ -0,0 +1,87 @@
+//***************************************************************************************
+// DirtySet.h
+//
+// Tracks which elements of a per-frame-resource buffer (object constants, materials,
+// instances) need to be rewritten.  It replaces the NumFramesDirty counters, which
+// make every update pass visit every object just to test the counter.
+//
+// MarkDirty() stamps an element with the current generation and logs it once per
+// generation.  Each frame resource remembers the first generation it has not seen
+// yet, so collecting its dirty elements only walks the changes logged since then:
+// the cost is proportional to the number of changes, not the number of elements.
+// The collected indices are deduplicated through a bitset and merged into sorted
+// contiguous ranges so the caller can write each range with one bulk copy.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct DirtyRange
+{
+	std::uint32_t First = 0;
+	std::uint32_t Count = 0;
+};
+
+class DirtySet
+{
+public:
+	// Every element starts out dirty in every frame resource.
+	DirtySet(std::uint32_t elementCount, std::uint32_t frameResourceCount);
+	DirtySet(const DirtySet& rhs) = delete;
+	DirtySet& operator=(const DirtySet& rhs) = delete;
+	~DirtySet() = default;
+
+	std::uint32_t GetElementCount()const;
+
+	// Changes the number of elements and marks all of them dirty.
+	void Resize(std::uint32_t elementCount);
+
+	void MarkDirty(std::uint32_t index);
+	void MarkAllDirty();
+
+	// Returns the elements that changed since frameResource was last collected, as
+	// sorted, non-overlapping ranges, and marks the frame resource up to date.  The
+	// reference stays valid until the next call.
+	const std::vector<DirtyRange>& CollectDirtyRanges(std::uint32_t frameResource);
+
+	// Number of elements in the ranges returned by the last CollectDirtyRanges().
+	std::uint32_t GetCollectedCount()const;
+
+private:
+	struct Change
+	{
+		std::uint32_t Generation;
+		std::uint32_t Index;
+	};
+
+	std::uint32_t mElementCount = 0;
+
+	// Generation changes are currently logged under.  It advances when a frame
+	// resource collects, if anything was logged.
+	std::uint32_t mGeneration = 1;
+	bool mGenerationHasChanges = false;
+
+	// Last generation every element was marked in, so repeated marks in one
+	// generation are logged once.
+	std::vector<std::uint32_t> mStamps;
+
+	// Changes in generation order, trimmed once every frame resource has seen them.
+	std::deque<Change> mChanges;
+
+	// Generation of the last MarkAllDirty(); frame resources that have not seen it
+	// get the whole range.
+	std::uint32_t mAllDirtyGeneration = 0;
+
+	// First generation each frame resource has not collected yet.
+	std::vector<std::uint32_t> mFrameGenerations;
+
+	// Scratch state for deduplicating and sorting the collected indices.
+	std::vector<std::uint64_t> mBits;
+	std::vector<std::uint32_t> mTouchedWords;
+
+	std::vector<DirtyRange> mRanges;
+	std::uint32_t mCollectedCount = 0;
+};
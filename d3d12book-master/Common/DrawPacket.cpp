@@ -0,0 +1,247 @@
+//***************************************************************************************
+// DrawPacket.cpp
+//***************************************************************************************
+
+#include "DrawPacket.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	const std::uint32_t DepthShift = 12;
+	const std::uint32_t MaterialShift = DepthShift + DrawKeyDepthBits;
+	const std::uint32_t GeometryShift = MaterialShift + DrawKeyMaterialBits;
+	const std::uint32_t PsoShift = GeometryShift + DrawKeyGeometryBits;
+	const std::uint32_t LayerShift = PsoShift + DrawKeyPsoBits;
+
+	std::uint64_t Field(std::uint32_t value, std::uint32_t bits, std::uint32_t shift)
+	{
+		assert(value < (1u << bits));
+		(void)bits;
+
+		return std::uint64_t(value) << shift;
+	}
+}
+
+const std::uint32_t DrawPacketSorter::DigitCount;
+const std::uint32_t DrawPacketSorter::BucketCount;
+
+std::uint64_t MakeDrawSortKey(std::uint32_t layer, std::uint32_t pso,
+	std::uint32_t geometry, std::uint32_t material, std::uint32_t depth)
+{
+	return Field(layer, DrawKeyLayerBits, LayerShift) |
+		Field(pso, DrawKeyPsoBits, PsoShift) |
+		Field(geometry, DrawKeyGeometryBits, GeometryShift) |
+		Field(material, DrawKeyMaterialBits, MaterialShift) |
+		Field(depth, DrawKeyDepthBits, DepthShift);
+}
+
+std::uint64_t MakeBackToFrontDrawSortKey(std::uint32_t layer, std::uint32_t depth,
+	std::uint32_t pso, std::uint32_t geometry, std::uint32_t material)
+{
+	// Same fields, with the depth taking the place of the pso right below the layer.
+	std::uint32_t depthShift = LayerShift - DrawKeyDepthBits;
+	std::uint32_t psoShift = depthShift - DrawKeyPsoBits;
+	std::uint32_t geometryShift = psoShift - DrawKeyGeometryBits;
+	std::uint32_t materialShift = geometryShift - DrawKeyMaterialBits;
+
+	return Field(layer, DrawKeyLayerBits, LayerShift) |
+		Field(depth, DrawKeyDepthBits, depthShift) |
+		Field(pso, DrawKeyPsoBits, psoShift) |
+		Field(geometry, DrawKeyGeometryBits, geometryShift) |
+		Field(material, DrawKeyMaterialBits, materialShift);
+}
+
+std::uint32_t QuantizeDrawDepth(float viewDepth, float nearZ, float farZ)
+{
+	const std::uint32_t maxDepth = (1u << DrawKeyDepthBits) - 1;
+
+	float t = (viewDepth - nearZ) / (farZ - nearZ);
+	if(!(t > 0.0f))
+		return 0;
+	if(t >= 1.0f)
+		return maxDepth;
+
+	return (std::uint32_t)(t*maxDepth);
+}
+
+DrawPacketSorter::DrawPacketSorter(ThreadPool* threadPool)
+	: mThreadPool(threadPool)
+{
+}
+
+void DrawPacketSorter::SetMinPacketsPerChunk(std::uint32_t count)
+{
+	mMinPacketsPerChunk = std::max(count, 1u);
+}
+
+void DrawPacketSorter::Sort(std::vector<DrawPacket>& packets)
+{
+	mLastPassCount = 0;
+
+	std::uint32_t count = (std::uint32_t)packets.size();
+	if(count < 2)
+		return;
+
+	std::uint32_t chunkCount = 1;
+	if(mThreadPool != nullptr && count >= 2*mMinPacketsPerChunk)
+		chunkCount = std::min(mThreadPool->GetWorkerCount() + 1, count / mMinPacketsPerChunk);
+	std::uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+	mScratch.resize(count);
+	mHistograms.assign(chunkCount*DigitCount*BucketCount, 0);
+	mOffsets.resize(chunkCount*BucketCount);
+
+	// Histograms of every digit in one read over the packets.  They decide which
+	// digits need a pass at all, and give the first pass its per-chunk counts.
+	const DrawPacket* input = packets.data();
+	ForEachChunk(chunkCount, [&](std::uint32_t chunk)
+	{
+		std::uint32_t* histograms = &mHistograms[chunk*DigitCount*BucketCount];
+		std::uint32_t end = std::min(count, (chunk + 1)*chunkSize);
+		for(std::uint32_t i = chunk*chunkSize; i < end; ++i)
+		{
+			std::uint64_t key = input[i].Key;
+			for(std::uint32_t digit = 0; digit < DigitCount; ++digit)
+				++histograms[digit*BucketCount + ((key >> (8*digit)) & 0xff)];
+		}
+	});
+
+	std::uint32_t passDigits[DigitCount];
+	std::uint32_t passCount = 0;
+	for(std::uint32_t digit = 0; digit < DigitCount; ++digit)
+	{
+		// A digit is worth a pass unless all packets fall into one bucket.
+		std::uint32_t usedBuckets = 0;
+		for(std::uint32_t bucket = 0; bucket < BucketCount && usedBuckets < 2; ++bucket)
+		{
+			std::uint32_t total = 0;
+			for(std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+				total += mHistograms[(chunk*DigitCount + digit)*BucketCount + bucket];
+
+			if(total > 0)
+				++usedBuckets;
+		}
+
+		if(usedBuckets > 1)
+			passDigits[passCount++] = digit;
+	}
+
+	DrawPacket* src = packets.data();
+	DrawPacket* dst = mScratch.data();
+	for(std::uint32_t pass = 0; pass < passCount; ++pass)
+	{
+		std::uint32_t digit = passDigits[pass];
+		std::uint32_t shift = 8*digit;
+
+		// After the first pass the packets have moved between chunks, so their counts
+		// for this digit have to be taken again.
+		if(pass > 0)
+		{
+			ForEachChunk(chunkCount, [&](std::uint32_t chunk)
+			{
+				std::uint32_t* histogram = &mHistograms[(chunk*DigitCount + digit)*BucketCount];
+				std::fill(histogram, histogram + BucketCount, 0);
+
+				std::uint32_t end = std::min(count, (chunk + 1)*chunkSize);
+				for(std::uint32_t i = chunk*chunkSize; i < end; ++i)
+					++histogram[(src[i].Key >> shift) & 0xff];
+			});
+		}
+
+		// Bucket by bucket, chunk by chunk: the chunks scatter to disjoint ranges and
+		// packets keep their relative order, which keeps the sort stable.
+		std::uint32_t offset = 0;
+		for(std::uint32_t bucket = 0; bucket < BucketCount; ++bucket)
+		{
+			for(std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				mOffsets[chunk*BucketCount + bucket] = offset;
+				offset += mHistograms[(chunk*DigitCount + digit)*BucketCount + bucket];
+			}
+		}
+
+		ForEachChunk(chunkCount, [&](std::uint32_t chunk)
+		{
+			std::uint32_t* offsets = &mOffsets[chunk*BucketCount];
+			std::uint32_t end = std::min(count, (chunk + 1)*chunkSize);
+			for(std::uint32_t i = chunk*chunkSize; i < end; ++i)
+				dst[offsets[(src[i].Key >> shift) & 0xff]++] = src[i];
+		});
+
+		std::swap(src, dst);
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer.
+	if(src != packets.data())
+		packets.swap(mScratch);
+
+	mLastPassCount = passCount;
+}
+
+std::uint32_t DrawPacketSorter::GetLastPassCount()const
+{
+	return mLastPassCount;
+}
+
+void DrawPacketSorter::ForEachChunk(std::uint32_t chunkCount, const std::function<void(std::uint32_t)>& func)
+{
+	if(chunkCount == 1)
+		func(0);
+	else
+		mThreadPool->ParallelFor(chunkCount, func);
+}
+
+std::uint64_t DrawBindStats::GetTotalBindCount()const
+{
+	std::uint64_t total = 0;
+	for(std::uint64_t count : BindCount)
+		total += count;
+	return total;
+}
+
+std::uint64_t DrawBindStats::GetTotalSkippedCount()const
+{
+	std::uint64_t total = 0;
+	for(std::uint64_t count : SkippedCount)
+		total += count;
+	return total;
+}
+
+void DrawStateCache::Invalidate()
+{
+	for(bool& isBound : mIsBound)
+		isBound = false;
+}
+
+bool DrawStateCache::Set(DrawState state, std::uint64_t value)
+{
+	int i = (int)state;
+	if(mIsBound[i] && mBound[i] == value)
+	{
+		++mStats.SkippedCount[i];
+		return false;
+	}
+
+	mBound[i] = value;
+	mIsBound[i] = true;
+	++mStats.BindCount[i];
+	return true;
+}
+
+void DrawStateCache::CountDraw()
+{
+	++mStats.DrawCount;
+}
+
+const DrawBindStats& DrawStateCache::GetStats()const
+{
+	return mStats;
+}
+
+void DrawStateCache::ResetStats()
+{
+	mStats = DrawBindStats();
+}
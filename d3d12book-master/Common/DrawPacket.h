@@ -0,0 +1,135 @@
+//***************************************************************************************
+// DrawPacket.h
+//
+// Sort-key based draw submission.  Each render item becomes a DrawPacket holding a
+// 64-bit key and the item's index.  Sorting the packets by key groups draws by layer,
+// then by pipeline state, geometry and material, so consecutive draws share as much
+// state as possible, and DrawStateCache skips the binds that would not change
+// anything.
+//
+// Key layout, most significant bits first:
+//
+//   layer (4) | pso (8) | geometry (12) | material (12) | depth (16) | unused (12)
+//
+// Layers drawn back to front (transparency) use MakeBackToFrontDrawSortKey, which
+// moves the depth right after the layer.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class ThreadPool;
+
+struct DrawPacket
+{
+	std::uint64_t Key = 0;
+
+	// Index of the render item the packet draws.
+	std::uint32_t Item = 0;
+};
+
+const std::uint32_t DrawKeyLayerBits = 4;
+const std::uint32_t DrawKeyPsoBits = 8;
+const std::uint32_t DrawKeyGeometryBits = 12;
+const std::uint32_t DrawKeyMaterialBits = 12;
+const std::uint32_t DrawKeyDepthBits = 16;
+
+std::uint64_t MakeDrawSortKey(std::uint32_t layer, std::uint32_t pso,
+	std::uint32_t geometry, std::uint32_t material, std::uint32_t depth);
+
+std::uint64_t MakeBackToFrontDrawSortKey(std::uint32_t layer, std::uint32_t depth,
+	std::uint32_t pso, std::uint32_t geometry, std::uint32_t material);
+
+// Maps a view space depth in [nearZ, farZ] to a depth field value that grows with
+// depth, for front to back sorting.  Subtract it from the largest value to sort back
+// to front.
+std::uint32_t QuantizeDrawDepth(float viewDepth, float nearZ, float farZ);
+
+// Stable LSD radix sort of the packets by key, 8 bits per pass.  Digits every key has
+// in common (the unused low bits, a layer field that is always 0) are skipped.  With a
+// ThreadPool, each pass builds per-chunk histograms and scatters the chunks in
+// parallel.
+class DrawPacketSorter
+{
+public:
+	explicit DrawPacketSorter(ThreadPool* threadPool = nullptr);
+	DrawPacketSorter(const DrawPacketSorter& rhs) = delete;
+	DrawPacketSorter& operator=(const DrawPacketSorter& rhs) = delete;
+	~DrawPacketSorter() = default;
+
+	// Below twice this many packets the sort runs on the calling thread.
+	void SetMinPacketsPerChunk(std::uint32_t count);
+
+	void Sort(std::vector<DrawPacket>& packets);
+
+	// Passes the last Sort() made (at most 8).
+	std::uint32_t GetLastPassCount()const;
+
+private:
+	static const std::uint32_t DigitCount = 8;
+	static const std::uint32_t BucketCount = 256;
+
+	void ForEachChunk(std::uint32_t chunkCount, const std::function<void(std::uint32_t)>& func);
+
+private:
+	ThreadPool* mThreadPool = nullptr;
+	std::uint32_t mMinPacketsPerChunk = 8192;
+	std::uint32_t mLastPassCount = 0;
+
+	std::vector<DrawPacket> mScratch;
+
+	// [chunk][digit][bucket] counts, and [chunk][bucket] scatter offsets.
+	std::vector<std::uint32_t> mHistograms;
+	std::vector<std::uint32_t> mOffsets;
+};
+
+enum class DrawState
+{
+	Pso,
+	Geometry,
+	Topology,
+	Material,
+	Count
+};
+
+struct DrawBindStats
+{
+	std::uint64_t DrawCount = 0;
+
+	// Per DrawState: binds issued, and binds skipped since the value was already bound.
+	std::uint64_t BindCount[(int)DrawState::Count] = {};
+	std::uint64_t SkippedCount[(int)DrawState::Count] = {};
+
+	std::uint64_t GetTotalBindCount()const;
+	std::uint64_t GetTotalSkippedCount()const;
+};
+
+// Remembers what is bound on a command list so a draw only rebinds what changed.
+class DrawStateCache
+{
+public:
+	DrawStateCache() = default;
+	DrawStateCache(const DrawStateCache& rhs) = delete;
+	DrawStateCache& operator=(const DrawStateCache& rhs) = delete;
+	~DrawStateCache() = default;
+
+	// Forgets the bound state; call when recording into a new command list.
+	void Invalidate();
+
+	// Returns true if value differs from what is bound, i.e. the caller has to bind it.
+	bool Set(DrawState state, std::uint64_t value);
+
+	void CountDraw();
+
+	const DrawBindStats& GetStats()const;
+	void ResetStats();
+
+private:
+	std::uint64_t mBound[(int)DrawState::Count] = {};
+	bool mIsBound[(int)DrawState::Count] = {};
+
+	DrawBindStats mStats;
+};
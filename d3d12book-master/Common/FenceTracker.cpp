@@ -0,0 +1,137 @@
+//***************************************************************************************
+// FenceTracker.cpp
+//***************************************************************************************
+
+#include "FenceTracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+FenceTracker::FenceTracker(std::unique_ptr<FenceBackend> backend)
+	: mBackend(std::move(backend))
+{
+	assert(mBackend != nullptr);
+
+	mCompletedValues.assign(mBackend->GetFenceCount(), 0);
+	Refresh();
+}
+
+std::uint32_t FenceTracker::GetFenceCount()const
+{
+	return (std::uint32_t)mCompletedValues.size();
+}
+
+void FenceTracker::Refresh()
+{
+	for(std::uint32_t i = 0; i < GetFenceCount(); ++i)
+		Query(i);
+}
+
+std::uint64_t FenceTracker::GetCompletedValue(std::uint32_t fence)const
+{
+	assert(fence < GetFenceCount());
+
+	return mCompletedValues[fence];
+}
+
+bool FenceTracker::IsComplete(std::uint32_t fence, std::uint64_t value)
+{
+	assert(fence < GetFenceCount());
+
+	++mStats.RequestCount;
+
+	if(mCompletedValues[fence] >= value)
+	{
+		++mStats.CacheHitCount;
+		return true;
+	}
+
+	return Query(fence) >= value;
+}
+
+void FenceTracker::Wait(std::uint32_t fence, std::uint64_t value)
+{
+	FenceWait wait;
+	wait.Fence = fence;
+	wait.Value = value;
+
+	WaitAny(&wait, 1);
+}
+
+std::uint32_t FenceTracker::WaitAny(const FenceWait* waits, std::uint32_t count)
+{
+	assert(count > 0);
+
+	++mStats.RequestCount;
+
+	std::uint32_t completed = FindCompleted(waits, count);
+	if(completed < count)
+	{
+		++mStats.CacheHitCount;
+		return completed;
+	}
+
+	// Not reached according to the cache; look at the fences themselves.
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		if(Query(waits[i].Fence) >= waits[i].Value)
+			return i;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	do
+	{
+		++mStats.BlockCount;
+		mBackend->BlockUntilAny(waits, count);
+
+		for(std::uint32_t i = 0; i < count; ++i)
+			Query(waits[i].Fence);
+
+		completed = FindCompleted(waits, count);
+	}
+	while(completed == count);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	++mStats.BlockedWaitCount;
+	mStats.TotalBlockedSeconds += seconds;
+	mStats.MaxBlockedSeconds = std::max(mStats.MaxBlockedSeconds, seconds);
+
+	return completed;
+}
+
+const FenceWaitStats& FenceTracker::GetStats()const
+{
+	return mStats;
+}
+
+void FenceTracker::ResetStats()
+{
+	mStats = FenceWaitStats();
+}
+
+std::uint32_t FenceTracker::FindCompleted(const FenceWait* waits, std::uint32_t count)const
+{
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		assert(waits[i].Fence < GetFenceCount());
+
+		if(mCompletedValues[waits[i].Fence] >= waits[i].Value)
+			return i;
+	}
+
+	return count;
+}
+
+std::uint64_t FenceTracker::Query(std::uint32_t fence)
+{
+	++mStats.QueryCount;
+
+	// Completed values only grow; never let a stale read move the cache back.
+	std::uint64_t value = mBackend->QueryCompletedValue(fence);
+	mCompletedValues[fence] = std::max(mCompletedValues[fence], value);
+
+	return mCompletedValues[fence];
+}
@@ -0,0 +1,110 @@
+//***************************************************************************************
+// FenceTracker.h
+//
+// Answers "has the GPU reached fence value N yet?" and waits for it, for one or more
+// fences (one per command queue).
+//
+// The last completed value of every fence is cached, so a wait that is already
+// satisfied is answered without touching the fence, and a satisfied wait that is not
+// is answered with one query.  Only waits that really need the GPU to progress block,
+// through the FenceBackend, which owns one persistent event per fence instead of
+// creating one per wait.  Waits are timed and summarized in FenceWaitStats.
+//
+// The tracker itself knows nothing about Direct3D: D3D12FenceBackend waits on
+// ID3D12Fence objects, and a mock backend can drive it anywhere.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct FenceWait
+{
+	std::uint32_t Fence = 0;
+	std::uint64_t Value = 0;
+};
+
+class FenceBackend
+{
+public:
+	virtual ~FenceBackend() = default;
+
+	virtual std::uint32_t GetFenceCount()const = 0;
+
+	// Reads the last value the GPU has completed on fence.
+	virtual std::uint64_t QueryCompletedValue(std::uint32_t fence) = 0;
+
+	// Blocks until at least one of the waits may have been reached.  It may return
+	// early (e.g. on an event left signaled by an earlier wait); the tracker
+	// re-queries and blocks again if nothing was reached.
+	virtual void BlockUntilAny(const FenceWait* waits, std::uint32_t count) = 0;
+};
+
+struct FenceWaitStats
+{
+	// Every IsComplete/Wait/WaitAny call.
+	std::uint64_t RequestCount = 0;
+
+	// Requests answered from the cached completed values.
+	std::uint64_t CacheHitCount = 0;
+
+	// Calls into the backend.
+	std::uint64_t QueryCount = 0;
+	std::uint64_t BlockCount = 0;
+
+	// Waits that had to block, and how long they took in total and at most.
+	std::uint64_t BlockedWaitCount = 0;
+	double TotalBlockedSeconds = 0.0;
+	double MaxBlockedSeconds = 0.0;
+
+	double GetAverageBlockedSeconds()const
+	{
+		return BlockedWaitCount > 0 ? TotalBlockedSeconds / BlockedWaitCount : 0.0;
+	}
+};
+
+class FenceTracker
+{
+public:
+	explicit FenceTracker(std::unique_ptr<FenceBackend> backend);
+	FenceTracker(const FenceTracker& rhs) = delete;
+	FenceTracker& operator=(const FenceTracker& rhs) = delete;
+	~FenceTracker() = default;
+
+	std::uint32_t GetFenceCount()const;
+
+	// Queries every fence once.  Call at most once per frame; everything else reads
+	// the cached values until a wait needs a newer one.
+	void Refresh();
+
+	// Last completed value seen, without querying.
+	std::uint64_t GetCompletedValue(std::uint32_t fence)const;
+
+	// Queries the fence only if the cached value is not enough.
+	bool IsComplete(std::uint32_t fence, std::uint64_t value);
+
+	// Returns once fence has reached value.
+	void Wait(std::uint32_t fence, std::uint64_t value);
+
+	// Returns once any of the waits has been reached, with the index of the first one
+	// that has.  count must be at least 1.
+	std::uint32_t WaitAny(const FenceWait* waits, std::uint32_t count);
+
+	const FenceWaitStats& GetStats()const;
+	void ResetStats();
+
+private:
+	// Index of the first reached wait according to the cache, or count.
+	std::uint32_t FindCompleted(const FenceWait* waits, std::uint32_t count)const;
+
+	std::uint64_t Query(std::uint32_t fence);
+
+private:
+	std::unique_ptr<FenceBackend> mBackend;
+
+	std::vector<std::uint64_t> mCompletedValues;
+
+	FenceWaitStats mStats;
+};
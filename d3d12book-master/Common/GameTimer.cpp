@@ -2,16 +2,20 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
+#include <chrono>
 
 GameTimer::GameTimer()
 : mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	typedef std::chrono::steady_clock::period Period;
+	mSecondsPerCount = (double)Period::num / (double)Period::den;
+}
+
+std::int64_t GameTimer::CurrentCount()
+{
+	return (std::int64_t)std::chrono::steady_clock::now().time_since_epoch().count();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -55,8 +59,7 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = CurrentCount();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
@@ -66,8 +69,7 @@ void GameTimer::Reset()
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = CurrentCount();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,8 +92,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = CurrentCount();
 
 		mStopTime = currTime;
 		mStopped  = true;
@@ -106,8 +107,7 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = CurrentCount();
 	mCurrTime = currTime;
 
 	// Time difference between this frame and the previous.
@@ -5,6 +5,10 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+
+// Counts std::chrono::steady_clock ticks (QueryPerformanceCounter on Windows), so the
+// timer also builds, and can be tested, off Windows.
 class GameTimer
 {
 public:
@@ -19,14 +23,16 @@ public:
 	void Tick();  // Call every frame.
 
 private:
+	static std::int64_t CurrentCount();
+
 	double mSecondsPerCount;
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
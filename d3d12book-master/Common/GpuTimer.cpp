@@ -0,0 +1,225 @@
+//***************************************************************************************
+// GpuTimer.cpp
+//***************************************************************************************
+
+#include "GpuTimer.h"
+
+#include <algorithm>
+#include <cassert>
+
+const std::uint32_t GpuTimer::NoQuery;
+const std::uint32_t GpuTimer::FrameTiming;
+
+GpuTimer::GpuTimer(std::uint32_t frameCount, std::uint32_t maxPassesPerFrame)
+	: mMaxPassesPerFrame(maxPassesPerFrame), mFrames(frameCount)
+{
+	assert(frameCount > 0 && maxPassesPerFrame > 0);
+
+	for(auto& frame : mFrames)
+		frame.Passes.reserve(maxPassesPerFrame);
+
+	mFrameTiming.Name = "Frame";
+}
+
+std::uint32_t GpuTimer::GetQueryCount()const
+{
+	return (std::uint32_t)mFrames.size() * mMaxPassesPerFrame * 2;
+}
+
+void GpuTimer::BeginFrame()
+{
+	Frame& frame = mFrames[mFrameNumber % mFrames.size()];
+
+	// Still on the GPU, or never collected: give up on it rather than wait.
+	if(frame.IsPending)
+		++mDroppedFrameCount;
+
+	frame.Number = mFrameNumber++;
+	frame.Fence = 0;
+	frame.IsPending = false;
+	frame.Passes.clear();
+
+	mCurrentFrame = &frame;
+}
+
+std::uint32_t GpuTimer::BeginPass(const std::string& name)
+{
+	assert(mCurrentFrame != nullptr);
+
+	std::vector<Pass>& passes = mCurrentFrame->Passes;
+	if(passes.size() == mMaxPassesPerFrame)
+		return NoQuery;
+
+	std::uint32_t slot = std::uint32_t(mCurrentFrame->Number % mFrames.size());
+
+	Pass pass;
+	pass.Timing = FindTiming(name);
+	pass.BeginQuery = (slot * mMaxPassesPerFrame + (std::uint32_t)passes.size()) * 2;
+	passes.push_back(pass);
+
+	return pass.BeginQuery;
+}
+
+std::uint32_t GpuTimer::EndPass(std::uint32_t beginQuery)
+{
+	return beginQuery == NoQuery ? NoQuery : beginQuery + 1;
+}
+
+void GpuTimer::EndFrame(std::uint32_t& firstQuery, std::uint32_t& queryCount)const
+{
+	assert(mCurrentFrame != nullptr);
+
+	std::uint32_t slot = std::uint32_t(mCurrentFrame->Number % mFrames.size());
+	firstQuery = slot * mMaxPassesPerFrame * 2;
+	queryCount = (std::uint32_t)mCurrentFrame->Passes.size() * 2;
+}
+
+void GpuTimer::SetFrameFence(std::uint64_t fenceValue)
+{
+	assert(mCurrentFrame != nullptr);
+
+	mCurrentFrame->Fence = fenceValue;
+	mCurrentFrame->IsPending = !mCurrentFrame->Passes.empty();
+	mCurrentFrame = nullptr;
+}
+
+bool GpuTimer::HasCompletedFrames(std::uint64_t completedFenceValue)const
+{
+	for(const auto& frame : mFrames)
+	{
+		if(frame.IsPending && frame.Fence <= completedFenceValue)
+			return true;
+	}
+
+	return false;
+}
+
+std::uint32_t GpuTimer::Collect(std::uint64_t completedFenceValue, const std::uint64_t* timestamps,
+	std::uint64_t frequency)
+{
+	const double ticksPerMs = double(frequency) / 1000.0;
+
+	mCollectedSamples.clear();
+
+	// Oldest first, so the last values are the newest frame's.
+	std::uint32_t collectedCount = 0;
+	for(std::uint64_t number = mFrameNumber - std::min<std::uint64_t>(mFrameNumber, mFrames.size());
+		number < mFrameNumber; ++number)
+	{
+		Frame& frame = mFrames[number % mFrames.size()];
+		if(!frame.IsPending || frame.Fence > completedFenceValue)
+			continue;
+
+		CollectFrame(frame, timestamps, ticksPerMs);
+		++collectedCount;
+	}
+
+	return collectedCount;
+}
+
+const std::vector<GpuPassTiming>& GpuTimer::GetPassTimings()const
+{
+	return mPassTimings;
+}
+
+const GpuPassTiming& GpuTimer::GetFrameTiming()const
+{
+	return mFrameTiming;
+}
+
+const std::vector<GpuTimingSample>& GpuTimer::GetCollectedSamples()const
+{
+	return mCollectedSamples;
+}
+
+std::uint32_t GpuTimer::GetLatency()const
+{
+	return mLatency;
+}
+
+std::uint64_t GpuTimer::GetCollectedFrameCount()const
+{
+	return mCollectedFrameCount;
+}
+
+std::uint64_t GpuTimer::GetDroppedFrameCount()const
+{
+	return mDroppedFrameCount;
+}
+
+void GpuTimer::ResetAverages()
+{
+	for(auto& timing : mPassTimings)
+	{
+		timing.MaxMs = 0.0;
+		timing.TotalMs = 0.0;
+		timing.SampleCount = 0;
+	}
+
+	mFrameTiming.MaxMs = 0.0;
+	mFrameTiming.TotalMs = 0.0;
+	mFrameTiming.SampleCount = 0;
+}
+
+std::uint32_t GpuTimer::FindTiming(const std::string& name)
+{
+	for(std::uint32_t i = 0; i < mPassTimings.size(); ++i)
+	{
+		if(mPassTimings[i].Name == name)
+			return i;
+	}
+
+	GpuPassTiming timing;
+	timing.Name = name;
+	mPassTimings.push_back(timing);
+
+	return (std::uint32_t)mPassTimings.size() - 1;
+}
+
+void GpuTimer::CollectFrame(Frame& frame, const std::uint64_t* timestamps, double ticksPerMs)
+{
+	auto addSample = [this](GpuPassTiming& timing, std::uint32_t index, double ms)
+	{
+		timing.LastMs = ms;
+		timing.MaxMs = std::max(timing.MaxMs, ms);
+		timing.TotalMs += ms;
+		++timing.SampleCount;
+
+		mCollectedSamples.push_back({ index, ms });
+	};
+
+	// -1 marks passes the frame did not time.
+	mFramePassMs.assign(mPassTimings.size(), -1.0);
+
+	std::uint64_t frameBegin = ~0ull;
+	std::uint64_t frameEnd = 0;
+	for(const Pass& pass : frame.Passes)
+	{
+		std::uint64_t begin = timestamps[pass.BeginQuery];
+		std::uint64_t end = timestamps[pass.BeginQuery + 1];
+
+		// Timestamps are meaningless across a power state change or a device removal;
+		// skip what cannot be right.
+		if(end < begin)
+			continue;
+
+		double& ms = mFramePassMs[pass.Timing];
+		ms = std::max(ms, 0.0) + double(end - begin) / ticksPerMs;
+
+		frameBegin = std::min(frameBegin, begin);
+		frameEnd = std::max(frameEnd, end);
+	}
+
+	for(std::uint32_t i = 0; i < mFramePassMs.size(); ++i)
+	{
+		if(mFramePassMs[i] >= 0.0)
+			addSample(mPassTimings[i], i, mFramePassMs[i]);
+	}
+
+	if(frameBegin <= frameEnd)
+		addSample(mFrameTiming, FrameTiming, double(frameEnd - frameBegin) / ticksPerMs);
+
+	mLatency = std::uint32_t(mFrameNumber - frame.Number);
+	frame.IsPending = false;
+	++mCollectedFrameCount;
+}
@@ -0,0 +1,147 @@
+//***************************************************************************************
+// GpuTimer.h
+//
+// CPU side of per-pass GPU timing with timestamp queries.  Every frame in flight has
+// its own slot of queries, two per pass.  A frame's timestamps are resolved into a
+// readback buffer at the end of its command list and only read once the fence it
+// was submitted with has completed, a few frames later, so reading them never waits
+// on the GPU.  If a slot comes around again before its frame completed, that frame's
+// timings are dropped rather than waited for.
+//
+// Passes are identified by name; passes with the same name in one frame add up.
+// Times are kept per pass (and for the whole frame) as the last value and the
+// average and maximum since ResetAverages().  Every frame's times are also handed out
+// by GetCollectedSamples(), for a histogram (see frame_stats) to take percentiles of.
+//
+// Nothing here touches Direct3D, so the ring and the aggregation can be driven with
+// made up timestamps.  See D3D12GpuTimer.h for the Direct3D side.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GpuPassTiming
+{
+	std::string Name;
+
+	double LastMs = 0.0;
+	double MaxMs = 0.0;
+	double TotalMs = 0.0;
+	std::uint32_t SampleCount = 0;
+
+	double GetAverageMs()const
+	{
+		return SampleCount > 0 ? TotalMs / SampleCount : 0.0;
+	}
+};
+
+// One pass's, or the whole frame's, time in one frame.
+struct GpuTimingSample
+{
+	// Index into GetPassTimings(), or GpuTimer::FrameTiming.
+	std::uint32_t Timing;
+	double Ms;
+};
+
+class GpuTimer
+{
+public:
+	static const std::uint32_t NoQuery = 0xffffffff;
+	static const std::uint32_t FrameTiming = 0xffffffff;
+
+	// frameCount is the number of frames that can be in flight, maxPassesPerFrame the
+	// number of passes one frame can time.
+	GpuTimer(std::uint32_t frameCount, std::uint32_t maxPassesPerFrame);
+	GpuTimer(const GpuTimer& rhs) = delete;
+	GpuTimer& operator=(const GpuTimer& rhs) = delete;
+	~GpuTimer() = default;
+
+	// Size of the query heap and of the readback buffer, in timestamps.
+	std::uint32_t GetQueryCount()const;
+
+	// Starts a frame in the next slot.
+	void BeginFrame();
+
+	// Query to write the pass's start timestamp to, or NoQuery if the frame has no
+	// room left for it.
+	std::uint32_t BeginPass(const std::string& name);
+
+	// Query to write the pass's end timestamp to, for the value BeginPass returned.
+	std::uint32_t EndPass(std::uint32_t beginQuery);
+
+	// The queries the frame used, to be resolved to the same place in the readback
+	// buffer.  queryCount is 0 if no pass was timed.
+	void EndFrame(std::uint32_t& firstQuery, std::uint32_t& queryCount)const;
+
+	// The frame is complete on the GPU once its fence reaches fenceValue.
+	void SetFrameFence(std::uint64_t fenceValue);
+
+	// Whether Collect() would read anything.
+	bool HasCompletedFrames(std::uint64_t completedFenceValue)const;
+
+	// Reads every frame whose fence has completed.  timestamps is the readback buffer
+	// (GetQueryCount() values), frequency the timestamp ticks per second.  Returns the
+	// number of frames read.  timestamps is not read, and may be null, when
+	// HasCompletedFrames() is false.
+	std::uint32_t Collect(std::uint64_t completedFenceValue, const std::uint64_t* timestamps,
+		std::uint64_t frequency);
+
+	// Passes in the order they were first seen.
+	const std::vector<GpuPassTiming>& GetPassTimings()const;
+
+	// From the start of the first pass to the end of the last one.
+	const GpuPassTiming& GetFrameTiming()const;
+
+	// Every time the last Collect() read, oldest frame first.
+	const std::vector<GpuTimingSample>& GetCollectedSamples()const;
+
+	// Frames between a frame being recorded and being read, for the last one read.
+	std::uint32_t GetLatency()const;
+
+	std::uint64_t GetCollectedFrameCount()const;
+	std::uint64_t GetDroppedFrameCount()const;
+
+	// Starts new averages and maxima; the last values stay.
+	void ResetAverages();
+
+private:
+	struct Pass
+	{
+		std::uint32_t Timing;
+		std::uint32_t BeginQuery;
+	};
+
+	struct Frame
+	{
+		std::uint64_t Number = 0;
+		std::uint64_t Fence = 0;
+		bool IsPending = false;
+
+		std::vector<Pass> Passes;
+	};
+
+	std::uint32_t FindTiming(const std::string& name);
+	void CollectFrame(Frame& frame, const std::uint64_t* timestamps, double ticksPerMs);
+
+private:
+	std::uint32_t mMaxPassesPerFrame;
+
+	std::vector<Frame> mFrames;
+	std::uint64_t mFrameNumber = 0;
+	Frame* mCurrentFrame = nullptr;
+
+	std::vector<GpuPassTiming> mPassTimings;
+	GpuPassTiming mFrameTiming;
+
+	// Scratch for adding up same named passes.
+	std::vector<double> mFramePassMs;
+
+	std::vector<GpuTimingSample> mCollectedSamples;
+
+	std::uint32_t mLatency = 0;
+	std::uint64_t mCollectedFrameCount = 0;
+	std::uint64_t mDroppedFrameCount = 0;
+};
@@ -0,0 +1,276 @@
+//***************************************************************************************
+// MappedFile.cpp
+//***************************************************************************************
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs)
+	: mData(rhs.mData), mSize(rhs.mSize), mIsOpen(rhs.mIsOpen)
+{
+	rhs.mData = nullptr;
+	rhs.mSize = 0;
+	rhs.mIsOpen = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+	if(this != &rhs)
+	{
+		Close();
+
+		mData = rhs.mData;
+		mSize = rhs.mSize;
+		mIsOpen = rhs.mIsOpen;
+
+		rhs.mData = nullptr;
+		rhs.mSize = 0;
+		rhs.mIsOpen = false;
+	}
+
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& filename, MappedFileHint hint)
+{
+	int length = MultiByteToWideChar(CP_ACP, 0, filename.c_str(), -1, nullptr, 0);
+	if(length == 0)
+		return false;
+
+	std::wstring wideFilename(length, L'\0');
+	MultiByteToWideChar(CP_ACP, 0, filename.c_str(), -1, &wideFilename[0], length);
+	wideFilename.resize(length - 1);
+
+	return Open(wideFilename, hint);
+}
+
+bool MappedFile::Open(const std::wstring& filename, MappedFileHint hint)
+{
+	Close();
+
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if(hint == MappedFileHint::Sequential)
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	else if(hint == MappedFileHint::Random)
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, flags, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	// Closing the handles below must not clobber the error of the call that failed.
+	auto fail = [](HANDLE handle)
+	{
+		DWORD error = GetLastError();
+		CloseHandle(handle);
+		SetLastError(error);
+		return false;
+	};
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size))
+		return fail(file);
+
+	if(size.QuadPart == 0)
+	{
+		// Empty files cannot be mapped.
+		CloseHandle(file);
+		mIsOpen = true;
+		return true;
+	}
+
+	if(std::uint64_t(size.QuadPart) > SIZE_MAX)
+	{
+		SetLastError(ERROR_FILE_TOO_LARGE);
+		return fail(file);
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping == nullptr)
+		return fail(file);
+	CloseHandle(file);
+
+	// The view keeps the mapping, and the mapping the file, alive.
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(view == nullptr)
+		return fail(mapping);
+	CloseHandle(mapping);
+
+	mData = static_cast<const std::uint8_t*>(view);
+	mSize = std::uint64_t(size.QuadPart);
+	mIsOpen = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		UnmapViewOfFile(mData);
+
+	mData = nullptr;
+	mSize = 0;
+	mIsOpen = false;
+}
+
+void MappedFile::Prefetch(std::uint64_t offset, std::uint64_t size)const
+{
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+	if(mData == nullptr || offset >= mSize)
+		return;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<std::uint8_t*>(mData + offset);
+	range.NumberOfBytes = SIZE_T(size < mSize - offset ? size : mSize - offset);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	(void)offset;
+	(void)size;
+#endif
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filename, MappedFileHint hint)
+{
+	Close();
+
+	int file = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if(file < 0)
+		return false;
+
+	// Closing the descriptor must not clobber the error of the call that failed.
+	auto fail = [](int fd)
+	{
+		int error = errno;
+		close(fd);
+		errno = error;
+		return false;
+	};
+
+	struct stat info;
+	if(fstat(file, &info) != 0)
+		return fail(file);
+
+	if(info.st_size == 0)
+	{
+		// Empty files cannot be mapped.
+		close(file);
+		mIsOpen = true;
+		return true;
+	}
+
+	if(std::uint64_t(info.st_size) > SIZE_MAX)
+	{
+		close(file);
+		errno = EFBIG;
+		return false;
+	}
+
+	// The mapping keeps the file alive.
+	void* view = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	if(view == MAP_FAILED)
+		return fail(file);
+	close(file);
+
+	if(hint == MappedFileHint::Sequential)
+		madvise(view, std::size_t(info.st_size), MADV_SEQUENTIAL);
+	else if(hint == MappedFileHint::Random)
+		madvise(view, std::size_t(info.st_size), MADV_RANDOM);
+
+	mData = static_cast<const std::uint8_t*>(view);
+	mSize = std::uint64_t(info.st_size);
+	mIsOpen = true;
+	return true;
+}
+
+bool MappedFile::Open(const std::wstring& filename, MappedFileHint hint)
+{
+	std::size_t length = std::wcstombs(nullptr, filename.c_str(), 0);
+	if(length == std::size_t(-1))
+	{
+		errno = EILSEQ;
+		return false;
+	}
+
+	std::vector<char> narrowFilename(length + 1);
+	std::wcstombs(narrowFilename.data(), filename.c_str(), length + 1);
+
+	return Open(std::string(narrowFilename.data()), hint);
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		munmap(const_cast<std::uint8_t*>(mData), std::size_t(mSize));
+
+	mData = nullptr;
+	mSize = 0;
+	mIsOpen = false;
+}
+
+void MappedFile::Prefetch(std::uint64_t offset, std::uint64_t size)const
+{
+	if(mData == nullptr || offset >= mSize)
+		return;
+
+	if(size > mSize - offset)
+		size = mSize - offset;
+
+	// madvise() wants a page aligned address.
+	std::uint64_t pageSize = std::uint64_t(sysconf(_SC_PAGESIZE));
+	std::uint64_t begin = offset / pageSize * pageSize;
+	madvise(const_cast<std::uint8_t*>(mData + begin), std::size_t(offset + size - begin), MADV_WILLNEED);
+}
+
+#endif
+
+bool MappedFile::IsOpen()const
+{
+	return mIsOpen;
+}
+
+const std::uint8_t* MappedFile::GetData()const
+{
+	return mData;
+}
+
+std::uint64_t MappedFile::GetSize()const
+{
+	return mSize;
+}
+
+void MappedFile::Load()const
+{
+	Prefetch(0, mSize);
+
+	// One read per page faults it in; 4 KB is the smallest page size on every target.
+	const std::uint64_t pageSize = 4096;
+	std::uint8_t sum = 0;
+	for(std::uint64_t offset = 0; offset < mSize; offset += pageSize)
+		sum += mData[offset];
+
+	// Stored so the reads are not optimized away.
+	volatile std::uint8_t sink = sum;
+	(void)sink;
+}
@@ -0,0 +1,92 @@
+//***************************************************************************************
+// MappedFile.h
+//
+// Read-only view of a whole file mapped into memory (MapViewOfFile on Windows, mmap
+// elsewhere).  Loading through a mapping costs page faults as the data is touched
+// instead of a read into a freshly allocated buffer, and the size is 64-bit.
+//
+// MemoryInputStream lets stream based parsers (the text model loaders) read straight
+// from the mapping.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+enum class MappedFileHint
+{
+	Normal,
+
+	// Read front to back once, e.g. parsed or uploaded; the OS reads ahead further.
+	Sequential,
+
+	// Jumped around in, e.g. a pack looked up through its index; no read ahead.
+	Random
+};
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(MappedFile&& rhs);
+	MappedFile& operator=(MappedFile&& rhs);
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	~MappedFile();
+
+	// Maps filename, closing the file mapped before.  Returns false if the file could
+	// not be opened or mapped; the reason is left in errno or GetLastError().  An empty
+	// file opens with no data.
+	bool Open(const std::string& filename, MappedFileHint hint = MappedFileHint::Normal);
+	bool Open(const std::wstring& filename, MappedFileHint hint = MappedFileHint::Normal);
+
+	void Close();
+
+	bool IsOpen()const;
+
+	const std::uint8_t* GetData()const;
+	std::uint64_t GetSize()const;
+
+	// Asks the OS to start reading [offset, offset + size) in before it is touched.
+	void Prefetch(std::uint64_t offset, std::uint64_t size)const;
+
+	// Reads the whole file in now, on the calling thread, by touching every page, so
+	// the I/O is not left to page faults wherever the data is first used.
+	void Load()const;
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::uint64_t mSize = 0;
+	bool mIsOpen = false;
+};
+
+// std::istream over memory that outlives it, e.g. a MappedFile.
+class MemoryInputStream : public std::istream
+{
+public:
+	MemoryInputStream(const void* data, std::uint64_t size)
+		: std::istream(nullptr), mBuffer(data, size)
+	{
+		rdbuf(&mBuffer);
+	}
+
+	MemoryInputStream(const MemoryInputStream& rhs) = delete;
+	MemoryInputStream& operator=(const MemoryInputStream& rhs) = delete;
+
+private:
+	class Buffer : public std::streambuf
+	{
+	public:
+		Buffer(const void* data, std::uint64_t size)
+		{
+			// The get area is never written through, so the cast is safe.
+			char* begin = const_cast<char*>(static_cast<const char*>(data));
+			setg(begin, begin, begin + size);
+		}
+	};
+
+	Buffer mBuffer;
+};
@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "MathHelper.h"
+#include <DirectXCollision.h>
 #include <float.h>
 #include <cmath>
 
@@ -35,48 +36,45 @@ float MathHelper::AngleFromXY(float x, float y)
 
 XMVECTOR MathHelper::RandUnitVec3()
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
-	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
-
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
-
-		return XMVector3Normalize(v);
-	}
+	return Random::ThreadLocal().NextUnitVec3();
 }
 
 XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+	return Random::ThreadLocal().NextHemisphereUnitVec3(n);
+}
 
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
+bool MathHelper::IntersectRayTriangles(FXMVECTOR rayOrigin, FXMVECTOR rayDir,
+	const void* vertices, std::uint32_t vertexStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, std::uint32_t& triangle, float& t)
+{
+	auto position = [vertices, vertexStride](std::uint32_t index)
 	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
-
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-		
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
+		const std::uint8_t* vertex = static_cast<const std::uint8_t*>(vertices) + std::size_t(index)*vertexStride;
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(vertex));
+	};
+
+	// We have to iterate over all the triangles in order to find the nearest intersection.
+	bool isHit = false;
+	float tmin = Infinity;
+	for(std::uint32_t i = 0; i < triangleCount; ++i)
+	{
+		XMVECTOR v0 = position(indices[i * 3 + 0]);
+		XMVECTOR v1 = position(indices[i * 3 + 1]);
+		XMVECTOR v2 = position(indices[i * 3 + 2]);
+
+		float ti = 0.0f;
+		if(TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, ti) && ti < tmin)
+		{
+			// This is the new nearest picked triangle.
+			tmin = ti;
+			triangle = i;
+			isHit = true;
+		}
+	}
 
-		// Ignore points in the bottom hemisphere.
-		if( XMVector3Less( XMVector3Dot(n, v), Zero ) )
-			continue;
+	if(isHit)
+		t = tmin;
 
-		return XMVector3Normalize(v);
-	}
+	return isHit;
 }
\ No newline at end of file
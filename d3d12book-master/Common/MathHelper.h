@@ -6,28 +6,33 @@
 
 #pragma once
 
-#include <Windows.h>
+#include <cmath>
+#include <cstdlib>
 #include <DirectXMath.h>
 #include <cstdint>
+#include "Random.h"
 
 class MathHelper
 {
 public:
+	// The Rand* functions draw from the calling thread's Random::ThreadLocal().
+
 	// Returns random float in [0, 1).
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return Random::ThreadLocal().NextFloat();
 	}
 
 	// Returns random float in [a, b).
 	static float RandF(float a, float b)
 	{
-		return a + RandF()*(b-a);
+		return Random::ThreadLocal().NextFloat(a, b);
 	}
 
+	// Returns random int in [a, b].
     static int Rand(int a, int b)
     {
-        return a + rand() % ((b - a) + 1);
+        return Random::ThreadLocal().NextInt(a, b);
     }
 
 	template<typename T>
@@ -92,6 +97,14 @@ public:
     static DirectX::XMVECTOR RandUnitVec3();
     static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
 
+	// Nearest triangle of an indexed triangle list hit by the ray, the loop in
+	// PickingApp::Pick.  rayDir is unit length and in the same space as the positions,
+	// which are the first XMFLOAT3 of every vertexStride bytes of vertices.  Returns
+	// false if no triangle is hit, else the triangle's index and the distance to it.
+	static bool IntersectRayTriangles(DirectX::FXMVECTOR rayOrigin, DirectX::FXMVECTOR rayDir,
+		const void* vertices, std::uint32_t vertexStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, std::uint32_t& triangle, float& t);
+
 	static const float Infinity;
 	static const float Pi;
 
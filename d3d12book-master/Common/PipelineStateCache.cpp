@@ -0,0 +1,120 @@
+//***************************************************************************************
+// PipelineStateCache.cpp
+//***************************************************************************************
+
+#include "PipelineStateCache.h"
+
+#include <cassert>
+#include <cstring>
+
+const std::uint32_t PipelineStateCache::LibraryMagic;
+const std::uint32_t PipelineStateCache::LibraryVersion;
+
+void PipelineStateHasher::AddFloat(float value)
+{
+	if(value == 0.0f)
+		value = 0.0f;
+
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	AddUInt(bits);
+}
+
+void PipelineStateHasher::AddString(const char* s)
+{
+	if(s == nullptr)
+	{
+		AddUInt(0);
+		return;
+	}
+
+	std::size_t length = std::strlen(s);
+	AddUInt(length + 1);
+	AddBytes(s, length);
+}
+
+PipelineStateHandle PipelineStateCache::Find(std::uint64_t key)const
+{
+	auto it = mHandles.find(key);
+	return it != mHandles.end() ? it->second : InvalidPipelineStateHandle;
+}
+
+PipelineStateHandle PipelineStateCache::Add(std::uint64_t key, bool& isNew)
+{
+	auto result = mHandles.insert({ key, (PipelineStateHandle)mKeys.size() });
+	isNew = result.second;
+	if(isNew)
+		mKeys.push_back(key);
+
+	return result.first->second;
+}
+
+std::uint64_t PipelineStateCache::GetKey(PipelineStateHandle handle)const
+{
+	assert(handle < mKeys.size());
+	return mKeys[handle];
+}
+
+std::uint32_t PipelineStateCache::GetCount()const
+{
+	return (std::uint32_t)mKeys.size();
+}
+
+void PipelineStateCache::Clear()
+{
+	mHandles.clear();
+	mKeys.clear();
+}
+
+std::wstring PipelineStateCache::GetLibraryName(std::uint64_t key)
+{
+	const wchar_t* digits = L"0123456789abcdef";
+
+	std::wstring name(16, L'0');
+	for(int i = 15; i >= 0; --i, key >>= 4)
+		name[i] = digits[key & 0xf];
+
+	return name;
+}
+
+bool PipelineStateCache::SaveLibraryFile(const std::string& filename, const void* library, std::size_t size)
+{
+	Fnv1aHasher hasher;
+	hasher.AddBytes(library, size);
+
+	LibraryHeader header;
+	header.Magic = LibraryMagic;
+	header.Version = LibraryVersion;
+	header.Size = size;
+	header.Hash = hasher.GetHash();
+
+	CacheFileChunk chunks[] =
+	{
+		{ &header, sizeof(header) },
+		{ library, size }
+	};
+	return SaveCacheFile(filename, chunks, 2);
+}
+
+bool PipelineStateCache::GetLibrary(const void* file, std::size_t fileSize, const void*& library, std::size_t& size)
+{
+	LibraryHeader header;
+	if(fileSize < sizeof(header))
+		return false;
+	std::memcpy(&header, file, sizeof(header));
+
+	if(header.Magic != LibraryMagic || header.Version != LibraryVersion ||
+		header.Size != fileSize - sizeof(header))
+		return false;
+
+	const std::uint8_t* payload = (const std::uint8_t*)file + sizeof(header);
+
+	Fnv1aHasher hasher;
+	hasher.AddBytes(payload, (std::size_t)header.Size);
+	if(hasher.GetHash() != header.Hash)
+		return false;
+
+	library = payload;
+	size = (std::size_t)header.Size;
+	return true;
+}
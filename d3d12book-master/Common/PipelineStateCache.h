@@ -0,0 +1,100 @@
+//***************************************************************************************
+// PipelineStateCache.h
+//
+// CPU side of the pipeline state cache.  A pipeline description is reduced to a
+// 64-bit key by feeding its fields one by one to a PipelineStateHasher: shaders by
+// their bytecode, strings by their characters, never by pointer, so the key of a
+// description is the same in every run and two descriptions that create the same
+// pipeline share one entry.  PipelineStateCache maps keys to dense handles, which is
+// what draw code holds on to instead of looking pipelines up by name.
+//
+// Pipelines are kept across runs in a driver pipeline library.  Its blob is opaque,
+// so the file adds a small header (magic, version, size, hash of the payload) that
+// rejects a truncated or foreign file before the driver sees it.  See
+// D3D12PipelineStateCache.h for the Direct3D side.
+//***************************************************************************************
+
+#pragma once
+
+#include "CacheFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::uint32_t PipelineStateHandle;
+
+const PipelineStateHandle InvalidPipelineStateHandle = 0xffffffff;
+
+// Fnv1aHasher over the fields added, in order, with the description's floats and
+// C strings.
+class PipelineStateHasher : public Fnv1aHasher
+{
+public:
+	// -0.0f is hashed as 0.0f, since both describe the same state.
+	void AddFloat(float value);
+
+	// A null string hashes differently from an empty one.
+	void AddString(const char* s);
+	using Fnv1aHasher::AddString;
+};
+
+struct PipelineStateCacheStats
+{
+	// Pipelines found in the library, compiled by the driver, and requests that asked
+	// for a pipeline the cache already had.
+	std::uint32_t LoadedCount = 0;
+	std::uint32_t CreatedCount = 0;
+	std::uint32_t SharedCount = 0;
+};
+
+class PipelineStateCache
+{
+public:
+	static const std::uint32_t LibraryMagic = 0x424c5350; // "PSLB"
+	static const std::uint32_t LibraryVersion = 1;
+
+	PipelineStateCache() = default;
+	PipelineStateCache(const PipelineStateCache& rhs) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache& rhs) = delete;
+	~PipelineStateCache() = default;
+
+	// Handle of key, or InvalidPipelineStateHandle if it was never added.
+	PipelineStateHandle Find(std::uint64_t key)const;
+
+	// Handle of key, adding it if needed; isNew tells whether it was.  Handles are
+	// given out in order starting at 0.
+	PipelineStateHandle Add(std::uint64_t key, bool& isNew);
+
+	std::uint64_t GetKey(PipelineStateHandle handle)const;
+	std::uint32_t GetCount()const;
+
+	void Clear();
+
+	// Name of the pipeline with this key in the pipeline library: the key in hex.
+	static std::wstring GetLibraryName(std::uint64_t key);
+
+	// Writes a pipeline library blob to filename, with the header in front.  Fails on
+	// Windows while filename is mapped, so the blob a library was created from must
+	// not be a view of the file it is saved to.
+	static bool SaveLibraryFile(const std::string& filename, const void* library, std::size_t size);
+
+	// Finds the library blob in the contents of a library file.  Returns false if the
+	// file is not one, or is damaged.
+	static bool GetLibrary(const void* file, std::size_t fileSize, const void*& library, std::size_t& size);
+
+private:
+	struct LibraryHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint64_t Size;
+		std::uint64_t Hash;
+	};
+
+private:
+	std::unordered_map<std::uint64_t, PipelineStateHandle> mHandles;
+	std::vector<std::uint64_t> mKeys;
+};
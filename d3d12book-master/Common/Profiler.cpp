@@ -0,0 +1,311 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+std::atomic<bool> Profiler::sIsCapturing(false);
+
+namespace
+{
+	struct ProfileEvent
+	{
+		const char* Name;
+		std::uint64_t Begin;
+		std::uint64_t End;
+	};
+
+	struct ThreadBuffer
+	{
+		// Left uninitialized so untouched pages cost nothing.
+		std::unique_ptr<ProfileEvent[]> Events{ new ProfileEvent[Profiler::EventsPerThread] };
+
+		// Written by the owning thread only.  Count is published with release after
+		// the event it counts, so the exporter reads complete events.
+		std::atomic<std::uint32_t> Count{ 0 };
+		std::atomic<std::uint64_t> DroppedCount{ 0 };
+
+		// Capture the events belong to.  A buffer is emptied by its thread when it
+		// records the first scope of a new capture.
+		std::atomic<std::uint32_t> Capture{ 0 };
+
+		// Guarded by the registry mutex.
+		std::uint32_t ThreadId = 0;
+		std::string Name;
+		bool InUse = true;
+	};
+
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+		std::unordered_set<std::string> Names;
+		std::uint32_t NextThreadId = 1;
+
+		// Written by the thread running the capture.
+		std::chrono::steady_clock::time_point StartTime;
+		std::chrono::steady_clock::time_point EndTime;
+		std::uint64_t StartTimestamp = 0;
+		std::uint64_t EndTimestamp = 0;
+	};
+
+	// Current capture, starting at 1 so a fresh buffer never belongs to one.
+	std::atomic<std::uint32_t> sCapture(0);
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	// Hands the buffer back when its thread exits.  Pool threads come and go, so the
+	// buffer is reused by a later thread once the capture in it has been replaced.
+	struct ThreadBufferOwner
+	{
+		ThreadBuffer* Buffer = nullptr;
+
+		~ThreadBufferOwner()
+		{
+			if(Buffer == nullptr)
+				return;
+
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+			Buffer->InUse = false;
+		}
+	};
+
+	thread_local ThreadBufferOwner tBufferOwner;
+
+	// Copies of the owner's buffer and of the buffer's capture for RecordScope.  Plain
+	// thread_locals without a destructor are read without a call to the TLS wrapper.
+	thread_local ThreadBuffer* tBuffer = nullptr;
+	thread_local std::uint32_t tBufferCapture = 0;
+
+	ThreadBuffer* GetThreadBuffer()
+	{
+		if(tBuffer != nullptr)
+			return tBuffer;
+
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		ThreadBuffer* buffer = nullptr;
+		for(auto& candidate : registry.Buffers)
+		{
+			if(!candidate->InUse &&
+			   (candidate->Count.load() == 0 || candidate->Capture.load() != sCapture.load()))
+			{
+				buffer = candidate.get();
+				buffer->Count = 0;
+				buffer->DroppedCount = 0;
+				buffer->Capture = 0;
+				buffer->InUse = true;
+				break;
+			}
+		}
+
+		if(buffer == nullptr)
+		{
+			registry.Buffers.emplace_back(new ThreadBuffer);
+			buffer = registry.Buffers.back().get();
+		}
+
+		buffer->ThreadId = registry.NextThreadId++;
+		buffer->Name = "Thread " + std::to_string(buffer->ThreadId);
+
+		tBufferOwner.Buffer = buffer;
+		tBuffer = buffer;
+		tBufferCapture = 0;
+		return buffer;
+	}
+
+	double GetTicksPerMicrosecond(const Registry& registry)
+	{
+#if defined(PROFILER_RDTSC)
+		// The TSC rate is measured over the capture itself.
+		auto endTime = Profiler::IsCapturing() ? std::chrono::steady_clock::now() : registry.EndTime;
+		std::uint64_t endTimestamp = Profiler::IsCapturing() ? Profiler::GetTimestamp() : registry.EndTimestamp;
+
+		double microseconds = std::chrono::duration<double, std::micro>(endTime - registry.StartTime).count();
+		if(microseconds <= 0.0 || endTimestamp <= registry.StartTimestamp)
+			return 1.0;
+
+		return double(endTimestamp - registry.StartTimestamp) / microseconds;
+#else
+		(void)registry;
+		typedef std::chrono::steady_clock::period Period;
+		return double(Period::den) / (double(Period::num) * 1e6);
+#endif
+	}
+
+	void WriteJsonString(std::ostream& out, const char* s)
+	{
+		out << '"';
+		for(; *s != '\0'; ++s)
+		{
+			unsigned char c = (unsigned char)*s;
+			if(c == '"' || c == '\\')
+				out << '\\' << char(c);
+			else if(c < 0x20)
+				out << ' ';
+			else
+				out << char(c);
+		}
+		out << '"';
+	}
+}
+
+void Profiler::BeginCapture()
+{
+	Registry& registry = GetRegistry();
+	registry.StartTime = std::chrono::steady_clock::now();
+	registry.StartTimestamp = GetTimestamp();
+
+	sCapture.fetch_add(1, std::memory_order_release);
+	sIsCapturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture()
+{
+	sIsCapturing.store(false, std::memory_order_release);
+
+	Registry& registry = GetRegistry();
+	registry.EndTime = std::chrono::steady_clock::now();
+	registry.EndTimestamp = GetTimestamp();
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	buffer->Name = name;
+}
+
+const char* Profiler::InternName(const std::string& name)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	return registry.Names.insert(name).first->c_str();
+}
+
+void Profiler::RecordScope(const char* name, std::uint64_t begin, std::uint64_t end)
+{
+	// Scopes still open when the capture ends are left out.
+	if(!IsCapturing())
+		return;
+
+	ThreadBuffer* buffer = tBuffer;
+	if(buffer == nullptr)
+		buffer = GetThreadBuffer();
+
+	std::uint32_t capture = sCapture.load(std::memory_order_acquire);
+	if(tBufferCapture != capture)
+	{
+		buffer->Count.store(0, std::memory_order_relaxed);
+		buffer->DroppedCount.store(0, std::memory_order_relaxed);
+		buffer->Capture.store(capture, std::memory_order_release);
+		tBufferCapture = capture;
+	}
+
+	std::uint32_t count = buffer->Count.load(std::memory_order_relaxed);
+	if(count == EventsPerThread)
+	{
+		buffer->DroppedCount.store(buffer->DroppedCount.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		return;
+	}
+
+	ProfileEvent& event = buffer->Events[count];
+	event.Name = name;
+	event.Begin = begin;
+	event.End = end;
+	buffer->Count.store(count + 1, std::memory_order_release);
+}
+
+ProfilerStats Profiler::GetStats()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	ProfilerStats stats;
+	std::uint32_t capture = sCapture.load(std::memory_order_acquire);
+	for(auto& buffer : registry.Buffers)
+	{
+		if(buffer->Capture.load(std::memory_order_acquire) != capture)
+			continue;
+
+		++stats.ThreadCount;
+		stats.EventCount += buffer->Count.load(std::memory_order_acquire);
+		stats.DroppedCount += buffer->DroppedCount.load(std::memory_order_relaxed);
+	}
+
+	return stats;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	const double ticksPerMicrosecond = GetTicksPerMicrosecond(registry);
+	const std::uint32_t capture = sCapture.load(std::memory_order_acquire);
+
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out.setf(std::ios_base::fixed, std::ios_base::floatfield);
+	out.precision(3);
+
+	out << "{\"traceEvents\":[";
+	const char* separator = "\n";
+	for(auto& buffer : registry.Buffers)
+	{
+		if(buffer->Capture.load(std::memory_order_acquire) != capture)
+			continue;
+
+		const std::uint32_t count = buffer->Count.load(std::memory_order_acquire);
+		if(count == 0)
+			continue;
+
+		out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+			buffer->ThreadId << ",\"args\":{\"name\":";
+		WriteJsonString(out, buffer->Name.c_str());
+		out << "}}";
+		separator = ",\n";
+
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			const ProfileEvent& event = buffer->Events[i];
+			double start = (double(event.Begin) - double(registry.StartTimestamp)) / ticksPerMicrosecond;
+			double duration = double(event.End - event.Begin) / ticksPerMicrosecond;
+
+			out << separator << "{\"name\":";
+			WriteJsonString(out, event.Name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadId <<
+				",\"ts\":" << (start > 0.0 ? start : 0.0) << ",\"dur\":" << duration << "}";
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+bool Profiler::SaveChromeTrace(const std::string& filename)
+{
+	std::ofstream file(filename, std::ios::trunc);
+	if(!file)
+		return false;
+
+	WriteChromeTrace(file);
+	return bool(file);
+}
@@ -0,0 +1,129 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Scoped CPU instrumentation.  PROFILE_SCOPE("Name") records when the enclosing scope
+// starts and ends on the calling thread, between Profiler::BeginCapture() and
+// Profiler::EndCapture(), and the capture is written out as Chrome trace_event JSON
+// (open it in chrome://tracing or ui.perfetto.dev) with one track per thread.
+//
+// Every thread appends to its own event buffer, so recording a scope takes no lock:
+// two timestamp reads (rdtsc where available) and one store.  The macros compile to
+// nothing unless PROFILER_ENABLED is set, which it is by default in debug builds and
+// in builds that define PROFILE.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC
+#else
+#include <chrono>
+#endif
+
+#ifndef PROFILER_ENABLED
+#if defined(DEBUG) || defined(_DEBUG) || defined(PROFILE)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+#endif
+
+struct ProfilerStats
+{
+	std::uint32_t ThreadCount = 0;
+	std::uint64_t EventCount = 0;
+
+	// Scopes that ended after their thread's buffer was full.
+	std::uint64_t DroppedCount = 0;
+};
+
+class Profiler
+{
+public:
+	// Scopes kept per thread and capture.
+	static const std::uint32_t EventsPerThread = 1 << 16;
+
+	// Starts recording, throwing away the previous capture.  BeginCapture, EndCapture
+	// and the exporting functions are called from one thread, and not while a capture
+	// is being recorded into from it; the scopes themselves can be on any thread.
+	static void BeginCapture();
+	static void EndCapture();
+
+	static bool IsCapturing()
+	{
+		return sIsCapturing.load(std::memory_order_relaxed);
+	}
+
+	// Name of the calling thread's track in the trace.
+	static void SetThreadName(const std::string& name);
+
+	// Scope names are kept by pointer until the capture is written, so names that are
+	// not string literals (task names, say) are copied here first.
+	static const char* InternName(const std::string& name);
+
+	// In rdtsc ticks, or steady_clock ticks where there is no rdtsc.
+	static std::uint64_t GetTimestamp()
+	{
+#if defined(PROFILER_RDTSC)
+		return __rdtsc();
+#else
+		return (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	static void RecordScope(const char* name, std::uint64_t begin, std::uint64_t end);
+
+	static ProfilerStats GetStats();
+
+	// The last capture as a Chrome trace, times in microseconds from BeginCapture().
+	static void WriteChromeTrace(std::ostream& out);
+	static bool SaveChromeTrace(const std::string& filename);
+
+private:
+	static std::atomic<bool> sIsCapturing;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: mName(Profiler::IsCapturing() ? name : nullptr)
+	{
+		if(mName != nullptr)
+			mBegin = Profiler::GetTimestamp();
+	}
+
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+	~ProfileScope()
+	{
+		if(mName != nullptr)
+			Profiler::RecordScope(mName, mBegin, Profiler::GetTimestamp());
+	}
+
+private:
+	const char* mName;
+	std::uint64_t mBegin = 0;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
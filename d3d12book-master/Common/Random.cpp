@@ -0,0 +1,368 @@
+//***************************************************************************************
+// Random.cpp
+//***************************************************************************************
+
+#include "Random.h"
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+// Same instruction set as DirectXMath was configured for.
+#if defined(_XM_AVX2_INTRINSICS_)
+#include <immintrin.h>
+#define RANDOM_AVX2
+#elif defined(_XM_SSE_INTRINSICS_)
+#include <emmintrin.h>
+#define RANDOM_SSE2
+#endif
+
+using namespace DirectX;
+
+const std::uint32_t Random::BatchSize;
+const std::uint64_t Random::DefaultSeed;
+
+namespace
+{
+	std::atomic<std::uint64_t> sThreadSeed(Random::DefaultSeed);
+	std::atomic<std::uint64_t> sNextThreadStream(0);
+
+	struct ThreadRandom
+	{
+		std::uint64_t Stream;
+		Random Generator;
+
+		ThreadRandom()
+			: Stream(sNextThreadStream.fetch_add(1, std::memory_order_relaxed)),
+			  Generator(sThreadSeed.load(std::memory_order_relaxed), Stream)
+		{
+		}
+	};
+
+	ThreadRandom& GetThreadRandom()
+	{
+		thread_local ThreadRandom random;
+		return random;
+	}
+
+	std::uint64_t SplitMix64(std::uint64_t& x)
+	{
+		std::uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+#if defined(RANDOM_AVX2)
+
+	__m256i Rotl(__m256i x, int k)
+	{
+		return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+	}
+
+	// One xoshiro128** step of all 8 streams.  The multiplications by 5 and 9 are
+	// shifts and adds, which are cheaper than vpmulld.
+	__m256i Step(std::uint32_t (&state)[4][Random::BatchSize])
+	{
+		__m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[0]));
+		__m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[1]));
+		__m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[2]));
+		__m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[3]));
+
+		__m256i s1x5 = _mm256_add_epi32(_mm256_slli_epi32(s1, 2), s1);
+		__m256i r = Rotl(s1x5, 7);
+		__m256i result = _mm256_add_epi32(_mm256_slli_epi32(r, 3), r);
+
+		__m256i t = _mm256_slli_epi32(s1, 9);
+		s2 = _mm256_xor_si256(s2, s0);
+		s3 = _mm256_xor_si256(s3, s1);
+		s1 = _mm256_xor_si256(s1, s2);
+		s0 = _mm256_xor_si256(s0, s3);
+		s2 = _mm256_xor_si256(s2, t);
+		s3 = Rotl(s3, 11);
+
+		_mm256_store_si256(reinterpret_cast<__m256i*>(state[0]), s0);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(state[1]), s1);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(state[2]), s2);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(state[3]), s3);
+
+		return result;
+	}
+
+#elif defined(RANDOM_SSE2)
+
+	__m128i Rotl(__m128i x, int k)
+	{
+		return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+	}
+
+	// One xoshiro128** step of the 4 streams starting at lane.  The multiplications by
+	// 5 and 9 are shifts and adds; there is no 32-bit multiply before SSE4.1.
+	__m128i Step(std::uint32_t (&state)[4][Random::BatchSize], std::uint32_t lane)
+	{
+		__m128i s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(&state[0][lane]));
+		__m128i s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(&state[1][lane]));
+		__m128i s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(&state[2][lane]));
+		__m128i s3 = _mm_load_si128(reinterpret_cast<const __m128i*>(&state[3][lane]));
+
+		__m128i s1x5 = _mm_add_epi32(_mm_slli_epi32(s1, 2), s1);
+		__m128i r = Rotl(s1x5, 7);
+		__m128i result = _mm_add_epi32(_mm_slli_epi32(r, 3), r);
+
+		__m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = Rotl(s3, 11);
+
+		_mm_store_si128(reinterpret_cast<__m128i*>(&state[0][lane]), s0);
+		_mm_store_si128(reinterpret_cast<__m128i*>(&state[1][lane]), s1);
+		_mm_store_si128(reinterpret_cast<__m128i*>(&state[2][lane]), s2);
+		_mm_store_si128(reinterpret_cast<__m128i*>(&state[3][lane]), s3);
+
+		return result;
+	}
+
+	// [0, 1) from the top 24 bits, which a float holds exactly.
+	__m128 ToFloat(__m128i bits)
+	{
+		return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+	}
+
+#else
+
+	std::uint32_t Rotl(std::uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+#endif
+
+	// Four points uniform on the unit sphere from u and v uniform in [0, 1): z uniform
+	// in [-1, 1] and the angle around z uniform give a uniform point on the sphere.
+	// Unlike rejection sampling there are no branches, so all lanes go together.
+	void UnitVectors(FXMVECTOR u, FXMVECTOR v, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		z = XMVectorMultiplyAdd(u, XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f));
+
+		XMVECTOR r = XMVectorSqrt(XMVectorMax(XMVectorZero(),
+			XMVectorNegativeMultiplySubtract(z, z, XMVectorSplatOne())));
+
+		XMVECTOR angle = XMVectorMultiplyAdd(v, XMVectorReplicate(XM_2PI), XMVectorReplicate(-XM_PI));
+
+		XMVECTOR sin;
+		XMVECTOR cos;
+		XMVectorSinCos(&sin, &cos, angle);
+
+		x = XMVectorMultiply(r, cos);
+		y = XMVectorMultiply(r, sin);
+	}
+
+	void StoreVectors(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, XMFLOAT3* out)
+	{
+		XMFLOAT4A xs;
+		XMFLOAT4A ys;
+		XMFLOAT4A zs;
+		XMStoreFloat4A(&xs, x);
+		XMStoreFloat4A(&ys, y);
+		XMStoreFloat4A(&zs, z);
+
+		out[0] = XMFLOAT3(xs.x, ys.x, zs.x);
+		out[1] = XMFLOAT3(xs.y, ys.y, zs.y);
+		out[2] = XMFLOAT3(xs.z, ys.z, zs.z);
+		out[3] = XMFLOAT3(xs.w, ys.w, zs.w);
+	}
+}
+
+Random::Random(std::uint64_t seed, std::uint64_t stream)
+{
+	Seed(seed, stream);
+}
+
+void Random::Seed(std::uint64_t seed, std::uint64_t stream)
+{
+	// Every lane gets 128 bits from SplitMix64, as the xoshiro authors suggest.
+	std::uint64_t streamBits = stream;
+	std::uint64_t x = seed ^ SplitMix64(streamBits);
+
+	for(std::uint32_t lane = 0; lane < BatchSize; ++lane)
+	{
+		std::uint64_t a = SplitMix64(x);
+		std::uint64_t b = SplitMix64(x);
+
+		// All zero is the one state xoshiro never leaves.
+		if(a == 0 && b == 0)
+			a = 1;
+
+		mState[0][lane] = std::uint32_t(a);
+		mState[1][lane] = std::uint32_t(a >> 32);
+		mState[2][lane] = std::uint32_t(b);
+		mState[3][lane] = std::uint32_t(b >> 32);
+	}
+
+	mBufferIndex = BatchSize;
+}
+
+Random& Random::ThreadLocal()
+{
+	return GetThreadRandom().Generator;
+}
+
+void Random::SeedThreadLocal(std::uint64_t seed)
+{
+	sThreadSeed.store(seed, std::memory_order_relaxed);
+
+	ThreadRandom& random = GetThreadRandom();
+	random.Generator.Seed(seed, random.Stream);
+}
+
+void Random::NextUInt32x8(std::uint32_t* out)
+{
+#if defined(RANDOM_AVX2)
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), Step(mState));
+#elif defined(RANDOM_SSE2)
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), Step(mState, 0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), Step(mState, 4));
+#else
+	for(std::uint32_t lane = 0; lane < BatchSize; ++lane)
+	{
+		std::uint32_t& s0 = mState[0][lane];
+		std::uint32_t& s1 = mState[1][lane];
+		std::uint32_t& s2 = mState[2][lane];
+		std::uint32_t& s3 = mState[3][lane];
+
+		out[lane] = Rotl(s1 * 5, 7) * 9;
+
+		std::uint32_t t = s1 << 9;
+		s2 ^= s0;
+		s3 ^= s1;
+		s1 ^= s2;
+		s0 ^= s3;
+		s2 ^= t;
+		s3 = Rotl(s3, 11);
+	}
+#endif
+}
+
+void Random::NextFloatx8(float* out)
+{
+#if defined(RANDOM_AVX2)
+	__m256 f = _mm256_cvtepi32_ps(_mm256_srli_epi32(Step(mState), 8));
+	_mm256_storeu_ps(out, _mm256_mul_ps(f, _mm256_set1_ps(1.0f / 16777216.0f)));
+#elif defined(RANDOM_SSE2)
+	_mm_storeu_ps(out, ToFloat(Step(mState, 0)));
+	_mm_storeu_ps(out + 4, ToFloat(Step(mState, 4)));
+#else
+	std::uint32_t bits[BatchSize];
+	NextUInt32x8(bits);
+
+	// [0, 1) from the top 24 bits, which a float holds exactly.
+	for(std::uint32_t i = 0; i < BatchSize; ++i)
+		out[i] = float(bits[i] >> 8) * (1.0f / 16777216.0f);
+#endif
+}
+
+void Random::NextUnitVec3x8(XMFLOAT3* out)
+{
+	alignas(16) float u[BatchSize];
+	alignas(16) float v[BatchSize];
+	NextFloatx8(u);
+	NextFloatx8(v);
+
+	for(std::uint32_t i = 0; i < BatchSize; i += 4)
+	{
+		XMVECTOR x, y, z;
+		UnitVectors(XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&u[i])),
+			XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&v[i])), x, y, z);
+
+		StoreVectors(x, y, z, out + i);
+	}
+}
+
+void Random::NextHemisphereUnitVec3x8(FXMVECTOR n, XMFLOAT3* out)
+{
+	alignas(16) float u[BatchSize];
+	alignas(16) float v[BatchSize];
+	NextFloatx8(u);
+	NextFloatx8(v);
+
+	XMVECTOR nx = XMVectorSplatX(n);
+	XMVECTOR ny = XMVectorSplatY(n);
+	XMVECTOR nz = XMVectorSplatZ(n);
+
+	for(std::uint32_t i = 0; i < BatchSize; i += 4)
+	{
+		XMVECTOR x, y, z;
+		UnitVectors(XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&u[i])),
+			XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&v[i])), x, y, z);
+
+		// Mirror the points on the wrong side through the center; the half sphere
+		// stays uniform.
+		XMVECTOR d = XMVectorMultiplyAdd(nz, z, XMVectorMultiplyAdd(ny, y, XMVectorMultiply(nx, x)));
+		XMVECTOR flip = XMVectorLess(d, XMVectorZero());
+
+		x = XMVectorSelect(x, XMVectorNegate(x), flip);
+		y = XMVectorSelect(y, XMVectorNegate(y), flip);
+		z = XMVectorSelect(z, XMVectorNegate(z), flip);
+
+		StoreVectors(x, y, z, out + i);
+	}
+}
+
+std::uint32_t Random::NextUInt32()
+{
+	if(mBufferIndex == BatchSize)
+		Refill();
+
+	return mBuffer[mBufferIndex++];
+}
+
+float Random::NextFloat()
+{
+	return float(NextUInt32() >> 8) * (1.0f / 16777216.0f);
+}
+
+float Random::NextFloat(float a, float b)
+{
+	return a + NextFloat()*(b - a);
+}
+
+int Random::NextInt(int a, int b)
+{
+	assert(a <= b);
+
+	// Scales the 32 bits to the range instead of taking a modulo.  The bias is below
+	// range / 2^32.
+	std::uint64_t range = std::uint64_t(std::int64_t(b) - std::int64_t(a)) + 1;
+	return int(std::int64_t(a) + std::int64_t((NextUInt32() * range) >> 32));
+}
+
+XMVECTOR Random::NextUnitVec3()
+{
+	float z = 2.0f*NextFloat() - 1.0f;
+	float r = std::sqrt(std::fmax(0.0f, 1.0f - z*z));
+
+	float sin;
+	float cos;
+	XMScalarSinCos(&sin, &cos, XM_2PI*NextFloat() - XM_PI);
+
+	return XMVectorSet(r*cos, r*sin, z, 0.0f);
+}
+
+XMVECTOR Random::NextHemisphereUnitVec3(FXMVECTOR n)
+{
+	XMVECTOR v = NextUnitVec3();
+
+	if(XMVectorGetX(XMVector3Dot(n, v)) < 0.0f)
+		v = XMVectorNegate(v);
+
+	return v;
+}
+
+void Random::Refill()
+{
+	NextUInt32x8(mBuffer);
+	mBufferIndex = 0;
+}
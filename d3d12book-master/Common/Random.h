@@ -0,0 +1,86 @@
+//***************************************************************************************
+// Random.h
+//
+// xoshiro128** random numbers, eight streams side by side so a batch of 8 values is
+// one step of a SIMD register (two with SSE2).  Single values are handed out from the
+// last batch, so they come from the same sequence.
+//
+// A generator is seeded with a seed and a stream number; the same pair always gives
+// the same sequence and different streams do not overlap in practice, so parallel
+// jobs stay reproducible by seeding one generator per job (seed, jobIndex).
+//
+// ThreadLocal() is the generator MathHelper's Rand* functions use.  Unlike rand() it
+// has no shared state, so it is safe and lock free from any thread.  Its stream is
+// the order in which threads first used it, which is only reproducible on one thread.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+class Random
+{
+public:
+	static const std::uint32_t BatchSize = 8;
+	static const std::uint64_t DefaultSeed = 0x2545f4914f6cdd1dull;
+
+	explicit Random(std::uint64_t seed = DefaultSeed, std::uint64_t stream = 0);
+	Random(const Random& rhs) = delete;
+	Random& operator=(const Random& rhs) = delete;
+	~Random() = default;
+
+	// Restarts the sequence.
+	void Seed(std::uint64_t seed, std::uint64_t stream = 0);
+
+	// The calling thread's generator.
+	static Random& ThreadLocal();
+
+	// Reseeds the calling thread's generator and seeds the generators of threads that
+	// have not used theirs yet.
+	static void SeedThreadLocal(std::uint64_t seed);
+
+	//
+	// Batches of 8.  out needs no particular alignment.
+	//
+
+	void NextUInt32x8(std::uint32_t* out);
+
+	// In [0, 1), in steps of 2^-24.
+	void NextFloatx8(float* out);
+
+	// Uniform on the unit sphere.
+	void NextUnitVec3x8(DirectX::XMFLOAT3* out);
+
+	// Uniform on the half of the unit sphere around n.
+	void NextHemisphereUnitVec3x8(DirectX::FXMVECTOR n, DirectX::XMFLOAT3* out);
+
+	//
+	// Single values.
+	//
+
+	std::uint32_t NextUInt32();
+
+	// In [0, 1).
+	float NextFloat();
+
+	// In [a, b).
+	float NextFloat(float a, float b);
+
+	// In [a, b].
+	int NextInt(int a, int b);
+
+	DirectX::XMVECTOR NextUnitVec3();
+	DirectX::XMVECTOR NextHemisphereUnitVec3(DirectX::FXMVECTOR n);
+
+private:
+	void Refill();
+
+private:
+	// xoshiro128** state, word by word for the 8 streams.
+	alignas(32) std::uint32_t mState[4][BatchSize];
+
+	// The last batch, handed out one value at a time.
+	alignas(32) std::uint32_t mBuffer[BatchSize];
+	std::uint32_t mBufferIndex = BatchSize;
+};
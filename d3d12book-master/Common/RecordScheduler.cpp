@@ -0,0 +1,119 @@
+//***************************************************************************************
+// RecordScheduler.cpp
+//***************************************************************************************
+
+#include "RecordScheduler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+RecordScheduler::RecordScheduler(ThreadPool* threadPool)
+	: mThreadPool(threadPool)
+{
+	mMaxChunksPerPass = (threadPool != nullptr) ? threadPool->GetWorkerCount() + 1 : 1;
+}
+
+void RecordScheduler::SetMinItemsPerChunk(std::uint32_t count)
+{
+	mMinItemsPerChunk = std::max(count, 1u);
+}
+
+void RecordScheduler::SetMaxChunksPerPass(std::uint32_t count)
+{
+	mMaxChunksPerPass = std::max(count, 1u);
+}
+
+void RecordScheduler::BeginFrame()
+{
+	mPassFuncs.clear();
+	mTasks.clear();
+}
+
+std::uint32_t RecordScheduler::AddPass(RecordFunc record)
+{
+	RecordTask task;
+	task.Slot = (std::uint32_t)mTasks.size();
+	task.Pass = (std::uint32_t)mPassFuncs.size();
+
+	mPassFuncs.push_back(std::move(record));
+	mTasks.push_back(task);
+
+	return task.Slot;
+}
+
+std::uint32_t RecordScheduler::AddChunkedPass(std::uint32_t itemCount, RecordFunc record)
+{
+	std::uint32_t chunkCount = Partition(itemCount, mMinItemsPerChunk, mMaxChunksPerPass, mScratch);
+
+	std::uint32_t pass = (std::uint32_t)mPassFuncs.size();
+	mPassFuncs.push_back(std::move(record));
+
+	for(std::uint32_t i = 0; i < chunkCount; ++i)
+	{
+		RecordTask task = mScratch[i];
+		task.Slot = (std::uint32_t)mTasks.size();
+		task.Pass = pass;
+		mTasks.push_back(task);
+	}
+
+	return chunkCount;
+}
+
+std::uint32_t RecordScheduler::GetSlotCount()const
+{
+	return (std::uint32_t)mTasks.size();
+}
+
+const std::vector<RecordTask>& RecordScheduler::GetTasks()const
+{
+	return mTasks;
+}
+
+void RecordScheduler::Execute()
+{
+	auto runTask = [this](std::uint32_t i)
+	{
+		const RecordTask& task = mTasks[i];
+		mPassFuncs[task.Pass](task);
+	};
+
+	if(mThreadPool != nullptr)
+		mThreadPool->ParallelFor((std::uint32_t)mTasks.size(), runTask);
+	else
+	{
+		for(std::uint32_t i = 0; i < (std::uint32_t)mTasks.size(); ++i)
+			runTask(i);
+	}
+}
+
+std::uint32_t RecordScheduler::Partition(std::uint32_t itemCount, std::uint32_t minItemsPerChunk,
+	std::uint32_t maxChunks, std::vector<RecordTask>& chunks)
+{
+	chunks.clear();
+	if(itemCount == 0)
+		return 0;
+
+	minItemsPerChunk = std::max(minItemsPerChunk, 1u);
+	maxChunks = std::max(maxChunks, 1u);
+
+	std::uint32_t chunkCount = std::max(1u, std::min(maxChunks, itemCount / minItemsPerChunk));
+
+	// The first (itemCount % chunkCount) chunks take one extra item.
+	std::uint32_t baseCount = itemCount / chunkCount;
+	std::uint32_t extra = itemCount % chunkCount;
+
+	std::uint32_t first = 0;
+	for(std::uint32_t i = 0; i < chunkCount; ++i)
+	{
+		RecordTask chunk;
+		chunk.First = first;
+		chunk.Count = baseCount + (i < extra ? 1 : 0);
+		chunks.push_back(chunk);
+
+		first += chunk.Count;
+	}
+
+	assert(first == itemCount);
+	return chunkCount;
+}
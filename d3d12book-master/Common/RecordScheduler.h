@@ -0,0 +1,85 @@
+//***************************************************************************************
+// RecordScheduler.h
+//
+// Splits a frame's command recording into tasks that can be recorded concurrently,
+// each into its own command list, and keeps track of the order the lists must be
+// submitted in.
+//
+// A frame is described as a sequence of passes.  AddPass() adds work that goes into
+// a single command list (clears, barriers); AddChunkedPass() adds a list of items
+// (draw calls) that is cut into contiguous chunks, one command list each.  Every task
+// gets a slot: its position in the submission order.  Execute() runs all tasks on the
+// ThreadPool; since each task writes its own list, they are independent, and
+// submitting slots 0..GetSlotCount()-1 in order reproduces the serial command stream.
+//
+// The scheduler knows nothing about Direct3D; see CommandListPool for the lists.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class ThreadPool;
+
+struct RecordTask
+{
+	std::uint32_t Slot = 0;     // Command list index and submission position.
+	std::uint32_t Pass = 0;     // Which AddPass/AddChunkedPass call the task came from.
+	std::uint32_t First = 0;    // Item range of a chunk; [0, 0) for a single-list pass.
+	std::uint32_t Count = 0;
+};
+
+class RecordScheduler
+{
+public:
+	typedef std::function<void(const RecordTask&)> RecordFunc;
+
+	// threadPool may be null, in which case Execute() records on the calling thread.
+	explicit RecordScheduler(ThreadPool* threadPool);
+	RecordScheduler(const RecordScheduler& rhs) = delete;
+	RecordScheduler& operator=(const RecordScheduler& rhs) = delete;
+	~RecordScheduler() = default;
+
+	// Chunks smaller than this are not worth a command list of their own.
+	void SetMinItemsPerChunk(std::uint32_t count);
+
+	// Upper bound on the chunks of one pass.  Defaults to one per thread.
+	void SetMaxChunksPerPass(std::uint32_t count);
+
+	// Clears the passes of the previous frame.
+	void BeginFrame();
+
+	// Adds a pass recorded into one command list.  Returns its slot.
+	std::uint32_t AddPass(RecordFunc record);
+
+	// Adds itemCount items split into contiguous chunks; record is called once per
+	// chunk with the chunk's item range.  Chunks are in item order, so their slots
+	// are too.  Returns the number of chunks (0 for an empty pass).
+	std::uint32_t AddChunkedPass(std::uint32_t itemCount, RecordFunc record);
+
+	// Number of command lists the frame needs.
+	std::uint32_t GetSlotCount()const;
+
+	const std::vector<RecordTask>& GetTasks()const;
+
+	// Runs every task and returns once all of them are recorded.
+	void Execute();
+
+	// Splits itemCount items into at most maxChunks contiguous chunks of at least
+	// minItemsPerChunk items (except when there are fewer items than that), sized as
+	// evenly as possible.  Writes (first, count) pairs and returns the chunk count.
+	static std::uint32_t Partition(std::uint32_t itemCount, std::uint32_t minItemsPerChunk,
+		std::uint32_t maxChunks, std::vector<RecordTask>& chunks);
+
+private:
+	ThreadPool* mThreadPool = nullptr;
+
+	std::uint32_t mMinItemsPerChunk = 64;
+	std::uint32_t mMaxChunksPerPass = 1;
+
+	std::vector<RecordFunc> mPassFuncs;
+	std::vector<RecordTask> mTasks;
+	std::vector<RecordTask> mScratch;
+};
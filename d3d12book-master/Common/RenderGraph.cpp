@@ -0,0 +1,573 @@
+//***************************************************************************************
+// RenderGraph.cpp
+//***************************************************************************************
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool Covers(std::uint32_t state, std::uint32_t requested)
+	{
+		return (state & requested) == requested;
+	}
+
+	bool IsUnorderedAccess(std::uint32_t state)
+	{
+		return (state & RenderGraphUnorderedAccessState) != 0;
+	}
+}
+
+RenderGraphResource RenderGraph::ImportResource(const std::string& name, std::uint32_t initialState, std::uint32_t finalState)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.IsImported = true;
+	resource.InitialState = initialState;
+	resource.FinalState = finalState;
+	mResources.push_back(resource);
+
+	mIsCompiled = false;
+	return (RenderGraphResource)mResources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::CreateTransient(const std::string& name, std::uint64_t size, std::uint64_t alignment)
+{
+	assert(size > 0 && alignment > 0);
+
+	Resource resource;
+	resource.Name = name;
+	resource.Size = size;
+	resource.Alignment = alignment;
+	mResources.push_back(resource);
+
+	mIsCompiled = false;
+	return (RenderGraphResource)mResources.size() - 1;
+}
+
+void RenderGraph::MarkOutput(RenderGraphResource resource)
+{
+	assert(resource < mResources.size());
+
+	mResources[resource].IsOutput = true;
+	mIsCompiled = false;
+}
+
+std::uint32_t RenderGraph::AddPass(const std::string& name, ExecuteFunc execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	mPasses.push_back(std::move(pass));
+
+	mIsCompiled = false;
+	return (std::uint32_t)mPasses.size() - 1;
+}
+
+void RenderGraph::Read(std::uint32_t pass, RenderGraphResource resource, std::uint32_t state)
+{
+	AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(std::uint32_t pass, RenderGraphResource resource, std::uint32_t state)
+{
+	AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::SetSideEffects(std::uint32_t pass)
+{
+	assert(pass < mPasses.size());
+
+	mPasses[pass].HasSideEffects = true;
+	mIsCompiled = false;
+}
+
+void RenderGraph::Clear()
+{
+	mPasses.clear();
+	mResources.clear();
+	mExecutionOrder.clear();
+	mBarriers.clear();
+	mStepBarriers.clear();
+	mFinalBarriers = BarrierRange();
+	mTransientHeapSize = 0;
+	mStats = RenderGraphStats();
+	mIsCompiled = false;
+}
+
+void RenderGraph::Compile()
+{
+	mStats = RenderGraphStats();
+	mStats.PassCount = (std::uint32_t)mPasses.size();
+
+	CullPasses();
+
+	mExecutionOrder.clear();
+	for(std::uint32_t i = 0; i < mPasses.size(); ++i)
+	{
+		if(!mPasses[i].IsCulled)
+			mExecutionOrder.push_back(i);
+	}
+
+	ComputeLifetimes();
+	PlaceTransients();
+	BuildBarriers();
+
+	mIsCompiled = true;
+}
+
+void RenderGraph::Execute(const BarrierFunc& issueBarriers)const
+{
+	assert(mIsCompiled);
+
+	for(std::uint32_t step = 0; step < mExecutionOrder.size(); ++step)
+	{
+		const BarrierRange& range = mStepBarriers[step];
+		if(range.Count > 0)
+			issueBarriers(&mBarriers[range.First], range.Count);
+
+		const Pass& pass = mPasses[mExecutionOrder[step]];
+		if(pass.Execute)
+			pass.Execute();
+	}
+
+	if(mFinalBarriers.Count > 0)
+		issueBarriers(&mBarriers[mFinalBarriers.First], mFinalBarriers.Count);
+}
+
+bool RenderGraph::IsCompiled()const
+{
+	return mIsCompiled;
+}
+
+std::uint32_t RenderGraph::GetPassCount()const
+{
+	return (std::uint32_t)mPasses.size();
+}
+
+std::uint32_t RenderGraph::GetResourceCount()const
+{
+	return (std::uint32_t)mResources.size();
+}
+
+const std::string& RenderGraph::GetPassName(std::uint32_t pass)const
+{
+	return mPasses[pass].Name;
+}
+
+const std::string& RenderGraph::GetResourceName(RenderGraphResource resource)const
+{
+	return mResources[resource].Name;
+}
+
+bool RenderGraph::IsPassCulled(std::uint32_t pass)const
+{
+	assert(mIsCompiled);
+	return mPasses[pass].IsCulled;
+}
+
+const std::vector<std::uint32_t>& RenderGraph::GetExecutionOrder()const
+{
+	assert(mIsCompiled);
+	return mExecutionOrder;
+}
+
+void RenderGraph::GetBarriers(std::uint32_t step, const RenderGraphBarrier*& barriers, std::uint32_t& count)const
+{
+	assert(mIsCompiled && step < mStepBarriers.size());
+
+	const BarrierRange& range = mStepBarriers[step];
+	barriers = range.Count > 0 ? &mBarriers[range.First] : nullptr;
+	count = range.Count;
+}
+
+void RenderGraph::GetFinalBarriers(const RenderGraphBarrier*& barriers, std::uint32_t& count)const
+{
+	assert(mIsCompiled);
+
+	barriers = mFinalBarriers.Count > 0 ? &mBarriers[mFinalBarriers.First] : nullptr;
+	count = mFinalBarriers.Count;
+}
+
+bool RenderGraph::IsTransient(RenderGraphResource resource)const
+{
+	return !mResources[resource].IsImported;
+}
+
+bool RenderGraph::IsAllocated(RenderGraphResource resource)const
+{
+	assert(mIsCompiled);
+	return mResources[resource].IsAllocated;
+}
+
+std::uint64_t RenderGraph::GetHeapOffset(RenderGraphResource resource)const
+{
+	assert(mIsCompiled && mResources[resource].IsAllocated);
+	return mResources[resource].HeapOffset;
+}
+
+std::uint64_t RenderGraph::GetTransientHeapSize()const
+{
+	assert(mIsCompiled);
+	return mTransientHeapSize;
+}
+
+std::uint32_t RenderGraph::GetInitialState(RenderGraphResource resource)const
+{
+	assert(mIsCompiled || mResources[resource].IsImported);
+	return mResources[resource].InitialState;
+}
+
+const RenderGraphStats& RenderGraph::GetStats()const
+{
+	return mStats;
+}
+
+void RenderGraph::AddAccess(std::uint32_t pass, RenderGraphResource resource, std::uint32_t state, bool isWrite)
+{
+	assert(pass < mPasses.size() && resource < mResources.size());
+
+	mIsCompiled = false;
+
+	for(Access& access : mPasses[pass].Accesses)
+	{
+		if(access.Resource == resource)
+		{
+			access.State |= state;
+			access.IsRead |= !isWrite;
+			access.IsWrite |= isWrite;
+			return;
+		}
+	}
+
+	Access access;
+	access.Resource = resource;
+	access.State = state;
+	access.IsRead = !isWrite;
+	access.IsWrite = isWrite;
+	mPasses[pass].Accesses.push_back(access);
+}
+
+void RenderGraph::CullPasses()
+{
+	// Walk backwards from the outputs.  A write is taken to replace the whole
+	// resource, so only reads make earlier writers necessary; a pass that blends into
+	// a target it does not clear should Read it as well.
+	std::vector<bool> isNeeded(mResources.size(), false);
+	for(std::uint32_t i = 0; i < mResources.size(); ++i)
+		isNeeded[i] = mResources[i].IsOutput;
+
+	for(std::uint32_t i = (std::uint32_t)mPasses.size(); i-- > 0; )
+	{
+		Pass& pass = mPasses[i];
+
+		bool isLive = pass.HasSideEffects;
+		for(const Access& access : pass.Accesses)
+		{
+			if(access.IsWrite && isNeeded[access.Resource])
+				isLive = true;
+		}
+
+		pass.IsCulled = !isLive;
+		if(!isLive)
+		{
+			++mStats.CulledPassCount;
+			continue;
+		}
+
+		// Whatever the pass reads must be produced by earlier passes, what it only
+		// writes need not.  Outputs stay needed, so every pass writing one is kept.
+		for(const Access& access : pass.Accesses)
+		{
+			if(access.IsWrite && !access.IsRead && !mResources[access.Resource].IsOutput)
+				isNeeded[access.Resource] = false;
+			else
+				isNeeded[access.Resource] = true;
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for(Resource& resource : mResources)
+		resource.IsAllocated = false;
+
+	for(std::uint32_t step = 0; step < mExecutionOrder.size(); ++step)
+	{
+		for(const Access& access : mPasses[mExecutionOrder[step]].Accesses)
+		{
+			Resource& resource = mResources[access.Resource];
+			if(resource.IsImported)
+				continue;
+
+			if(!resource.IsAllocated)
+			{
+				resource.IsAllocated = true;
+				resource.FirstStep = step;
+			}
+			resource.LastStep = step;
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	std::vector<RenderGraphResource> transients;
+	for(std::uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		if(mResources[i].IsAllocated)
+			transients.push_back(i);
+	}
+
+	// Largest first, so the small resources fill the gaps the big ones leave.
+	std::sort(transients.begin(), transients.end(),
+		[this](RenderGraphResource a, RenderGraphResource b)
+		{
+			if(mResources[a].Size != mResources[b].Size)
+				return mResources[a].Size > mResources[b].Size;
+			return a < b;
+		});
+
+	mTransientHeapSize = 0;
+
+	std::vector<RenderGraphResource> placed;
+	std::vector<std::uint64_t> candidates;
+	for(RenderGraphResource index : transients)
+	{
+		Resource& resource = mResources[index];
+
+		// Only resources alive at the same time as this one constrain its placement.
+		// Try the start of the heap and the end of each of those.
+		candidates.clear();
+		candidates.push_back(0);
+		for(RenderGraphResource other : placed)
+		{
+			const Resource& o = mResources[other];
+			if(o.FirstStep <= resource.LastStep && resource.FirstStep <= o.LastStep)
+				candidates.push_back(AlignUp(o.HeapOffset + o.Size, resource.Alignment));
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for(std::uint64_t offset : candidates)
+		{
+			bool fits = true;
+			for(RenderGraphResource other : placed)
+			{
+				const Resource& o = mResources[other];
+				if(o.FirstStep <= resource.LastStep && resource.FirstStep <= o.LastStep &&
+					Overlaps(offset, resource.Size, o.HeapOffset, o.Size))
+				{
+					fits = false;
+					break;
+				}
+			}
+
+			if(fits)
+			{
+				resource.HeapOffset = offset;
+				break;
+			}
+		}
+
+		placed.push_back(index);
+
+		mTransientHeapSize = std::max(mTransientHeapSize, resource.HeapOffset + resource.Size);
+		mStats.TransientBytes += resource.Size;
+	}
+
+	mStats.TransientHeapSize = mTransientHeapSize;
+}
+
+void RenderGraph::BuildBarriers()
+{
+	std::uint32_t stepCount = (std::uint32_t)mExecutionOrder.size();
+
+	// Live accesses of each resource in execution order.
+	struct StepAccess
+	{
+		std::uint32_t Step;
+		std::uint32_t State;
+		bool IsWrite;
+	};
+	std::vector<std::vector<StepAccess>> accesses(mResources.size());
+	for(std::uint32_t step = 0; step < stepCount; ++step)
+	{
+		for(const Access& access : mPasses[mExecutionOrder[step]].Accesses)
+			accesses[access.Resource].push_back({ step, access.State, access.IsWrite });
+	}
+
+	std::vector<std::vector<RenderGraphBarrier>> stepAliasing(stepCount);
+	std::vector<std::vector<RenderGraphBarrier>> stepTransitions(stepCount);
+	std::vector<RenderGraphBarrier> finalTransitions;
+
+	// A transient taking over memory another transient used needs an aliasing barrier
+	// before its first use: naming the last user earlier in the frame, or none if the
+	// memory was last used in the previous frame.
+	for(std::uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		const Resource& resource = mResources[i];
+		if(!resource.IsAllocated)
+			continue;
+
+		bool isShared = false;
+		RenderGraphResource previous = InvalidRenderGraphResource;
+		for(std::uint32_t j = 0; j < mResources.size(); ++j)
+		{
+			const Resource& other = mResources[j];
+			if(j == i || !other.IsAllocated || !Overlaps(resource.HeapOffset, resource.Size, other.HeapOffset, other.Size))
+				continue;
+
+			isShared = true;
+			if(other.LastStep < resource.FirstStep &&
+				(previous == InvalidRenderGraphResource || other.LastStep > mResources[previous].LastStep))
+			{
+				previous = j;
+			}
+		}
+
+		if(isShared)
+		{
+			RenderGraphBarrier barrier;
+			barrier.Type = RenderGraphBarrierType::Aliasing;
+			barrier.Resource = i;
+			barrier.AliasedResource = previous;
+			stepAliasing[resource.FirstStep].push_back(barrier);
+		}
+	}
+
+	for(std::uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		Resource& resource = mResources[i];
+		const std::vector<StepAccess>& list = accesses[i];
+		if(list.empty())
+		{
+			if(resource.IsImported && resource.InitialState != resource.FinalState)
+			{
+				RenderGraphBarrier barrier;
+				barrier.Resource = i;
+				barrier.Before = resource.InitialState;
+				barrier.After = resource.FinalState;
+				finalTransitions.push_back(barrier);
+			}
+			continue;
+		}
+
+		// Group consecutive reads, so they are served by one transition to the union of
+		// their states.  Each group is a run of reads or a single write.  Unordered
+		// access does not combine with other states, so reads through a UAV only group
+		// with each other.
+		struct Group
+		{
+			std::uint32_t Step;
+			std::uint32_t State;
+			bool IsWrite;
+		};
+		std::vector<Group> groups;
+		for(const StepAccess& access : list)
+		{
+			if(!access.IsWrite && !groups.empty() && !groups.back().IsWrite &&
+				IsUnorderedAccess(groups.back().State) == IsUnorderedAccess(access.State))
+				groups.back().State |= access.State;
+			else
+				groups.push_back({ access.Step, access.State, access.IsWrite });
+		}
+
+		Group& last = groups.back();
+		if(resource.IsImported)
+		{
+			// Reads at the end of the frame can use the final state directly if it
+			// allows them, saving the transition afterwards.
+			if(!last.IsWrite && Covers(resource.FinalState, last.State))
+				last.State = resource.FinalState;
+		}
+		else
+		{
+			// Transients start every frame in the state they were last used in.
+			resource.InitialState = last.State;
+		}
+
+		std::uint32_t current = resource.InitialState;
+		for(std::uint32_t g = 0; g < groups.size(); ++g)
+		{
+			const Group& group = groups[g];
+
+			std::uint32_t target = group.State;
+			if(!group.IsWrite && Covers(current, group.State))
+			{
+				// Already readable as is.  The last reads of a transient still go to
+				// their own state, which the next frame starts from.
+				if(resource.IsImported || g + 1 < groups.size())
+					target = current;
+			}
+
+			if(target != current)
+			{
+				RenderGraphBarrier barrier;
+				barrier.Resource = i;
+				barrier.Before = current;
+				barrier.After = target;
+				stepTransitions[group.Step].push_back(barrier);
+
+				current = target;
+			}
+			else if(g > 0 && IsUnorderedAccess(current) &&
+				(group.IsWrite || groups[g - 1].IsWrite))
+			{
+				// No transition to wait on the previous pass's unordered accesses, so
+				// a UAV barrier has to.
+				RenderGraphBarrier barrier;
+				barrier.Type = RenderGraphBarrierType::UnorderedAccess;
+				barrier.Resource = i;
+				barrier.Before = current;
+				barrier.After = current;
+				stepTransitions[group.Step].push_back(barrier);
+			}
+		}
+
+		if(resource.IsImported && current != resource.FinalState)
+		{
+			RenderGraphBarrier barrier;
+			barrier.Resource = i;
+			barrier.Before = current;
+			barrier.After = resource.FinalState;
+			finalTransitions.push_back(barrier);
+		}
+	}
+
+	mBarriers.clear();
+	mStepBarriers.assign(stepCount, BarrierRange());
+	for(std::uint32_t step = 0; step < stepCount; ++step)
+	{
+		BarrierRange& range = mStepBarriers[step];
+		range.First = (std::uint32_t)mBarriers.size();
+
+		// Aliasing barriers go first: the resource has to own the memory before it can
+		// be transitioned.
+		mBarriers.insert(mBarriers.end(), stepAliasing[step].begin(), stepAliasing[step].end());
+		mBarriers.insert(mBarriers.end(), stepTransitions[step].begin(), stepTransitions[step].end());
+
+		range.Count = (std::uint32_t)mBarriers.size() - range.First;
+		if(range.Count > 0)
+			++mStats.BarrierBatchCount;
+	}
+
+	mFinalBarriers.First = (std::uint32_t)mBarriers.size();
+	mFinalBarriers.Count = (std::uint32_t)finalTransitions.size();
+	mBarriers.insert(mBarriers.end(), finalTransitions.begin(), finalTransitions.end());
+	if(mFinalBarriers.Count > 0)
+		++mStats.BarrierBatchCount;
+
+	mStats.BarrierCount = (std::uint32_t)mBarriers.size();
+}
+
+bool RenderGraph::Overlaps(std::uint64_t offset0, std::uint64_t size0, std::uint64_t offset1, std::uint64_t size1)
+{
+	return offset0 < offset1 + size1 && offset1 < offset0 + size0;
+}
@@ -0,0 +1,212 @@
+//***************************************************************************************
+// RenderGraph.h
+//
+// Describes a frame as a list of passes that declare which resources they read and
+// write, and in which state.  Compile() turns the description into a schedule:
+//
+//   - Passes whose results never reach an output resource (or a pass marked as having
+//     side effects) are culled.
+//   - Every live pass gets the batch of barriers it needs before it runs.  A
+//     resource already in a state that covers a read is left alone, consecutive
+//     reads in different states are served by one transition to the combined state,
+//     and imported resources are returned to their final state after the last pass.
+//     Accesses that stay in the unordered access state with a write on either side
+//     (e.g. a compute blur ping-ponging between two textures) get a UAV barrier.
+//   - Transient resources are placed in one heap so that resources whose lifetimes
+//     do not overlap share memory, with aliasing barriers where memory changes hands.
+//
+// Passes run in the order they were added, which is a valid order by construction
+// since a pass can only consume what earlier passes produced.  Compiling is CPU only;
+// resources are handles and states plain bit masks, so the graph does not depend on
+// Direct3D.  See D3D12RenderGraph.h for recording the schedule to a command list.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef std::uint32_t RenderGraphResource;
+
+const RenderGraphResource InvalidRenderGraphResource = 0xffffffff;
+
+// The state bit of unordered access, the same as D3D12_RESOURCE_STATE_UNORDERED_ACCESS.
+const std::uint32_t RenderGraphUnorderedAccessState = 0x8;
+
+enum class RenderGraphBarrierType
+{
+	Transition,
+	Aliasing,
+	UnorderedAccess
+};
+
+struct RenderGraphBarrier
+{
+	RenderGraphBarrierType Type = RenderGraphBarrierType::Transition;
+
+	// Transition: the resource and its state before and after.  Aliasing: the resource
+	// taking over the memory and the one that used it last in the frame, or
+	// InvalidRenderGraphResource if that was in the previous frame.  UnorderedAccess:
+	// the resource, with Before and After both its current state.
+	RenderGraphResource Resource = InvalidRenderGraphResource;
+	RenderGraphResource AliasedResource = InvalidRenderGraphResource;
+	std::uint32_t Before = 0;
+	std::uint32_t After = 0;
+};
+
+struct RenderGraphStats
+{
+	std::uint32_t PassCount = 0;
+	std::uint32_t CulledPassCount = 0;
+
+	// Barriers in the schedule and the non-empty batches holding them.
+	std::uint32_t BarrierCount = 0;
+	std::uint32_t BarrierBatchCount = 0;
+
+	// Memory the live transient resources would take on their own, and the size of
+	// the heap they share once aliased.
+	std::uint64_t TransientBytes = 0;
+	std::uint64_t TransientHeapSize = 0;
+};
+
+class RenderGraph
+{
+public:
+	typedef std::function<void()> ExecuteFunc;
+	typedef std::function<void(const RenderGraphBarrier* barriers, std::uint32_t count)> BarrierFunc;
+
+	RenderGraph() = default;
+	RenderGraph(const RenderGraph& rhs) = delete;
+	RenderGraph& operator=(const RenderGraph& rhs) = delete;
+	~RenderGraph() = default;
+
+	// A resource owned outside the graph.  It is in initialState when the graph starts
+	// executing and is left in finalState.
+	RenderGraphResource ImportResource(const std::string& name, std::uint32_t initialState, std::uint32_t finalState);
+
+	// A resource only used within the frame, placed by Compile() in the transient heap.
+	// It must be created in GetInitialState() at GetHeapOffset().
+	RenderGraphResource CreateTransient(const std::string& name, std::uint64_t size, std::uint64_t alignment);
+
+	// Passes writing an output are never culled.
+	void MarkOutput(RenderGraphResource resource);
+
+	std::uint32_t AddPass(const std::string& name, ExecuteFunc execute);
+
+	// Declares an access by pass.  Several accesses to one resource by a pass are
+	// combined into one in the union of their states.
+	void Read(std::uint32_t pass, RenderGraphResource resource, std::uint32_t state);
+	void Write(std::uint32_t pass, RenderGraphResource resource, std::uint32_t state);
+
+	// The pass is kept even though nothing reads what it writes.
+	void SetSideEffects(std::uint32_t pass);
+
+	// Removes every pass and resource.
+	void Clear();
+
+	void Compile();
+
+	// Runs the live passes in order, handing each batch of barriers to issueBarriers
+	// right before the pass it belongs to, and the final transitions at the end.
+	void Execute(const BarrierFunc& issueBarriers)const;
+
+	bool IsCompiled()const;
+
+	std::uint32_t GetPassCount()const;
+	std::uint32_t GetResourceCount()const;
+
+	const std::string& GetPassName(std::uint32_t pass)const;
+	const std::string& GetResourceName(RenderGraphResource resource)const;
+
+	bool IsPassCulled(std::uint32_t pass)const;
+
+	// Live passes in execution order.
+	const std::vector<std::uint32_t>& GetExecutionOrder()const;
+
+	// Barriers to issue before the live pass at position step of the execution order,
+	// and after the last one.
+	void GetBarriers(std::uint32_t step, const RenderGraphBarrier*& barriers, std::uint32_t& count)const;
+	void GetFinalBarriers(const RenderGraphBarrier*& barriers, std::uint32_t& count)const;
+
+	// Transient placement.  Transient resources no live pass uses get no memory.
+	bool IsTransient(RenderGraphResource resource)const;
+	bool IsAllocated(RenderGraphResource resource)const;
+	std::uint64_t GetHeapOffset(RenderGraphResource resource)const;
+	std::uint64_t GetTransientHeapSize()const;
+
+	// The state a resource is in when the graph starts executing.  For transients,
+	// the state of their last access, so every frame starts out the same.
+	std::uint32_t GetInitialState(RenderGraphResource resource)const;
+
+	const RenderGraphStats& GetStats()const;
+
+private:
+	struct Access
+	{
+		RenderGraphResource Resource = InvalidRenderGraphResource;
+		std::uint32_t State = 0;
+		bool IsRead = false;
+		bool IsWrite = false;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFunc Execute;
+		std::vector<Access> Accesses;
+		bool HasSideEffects = false;
+		bool IsCulled = false;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		bool IsImported = false;
+		bool IsOutput = false;
+
+		std::uint32_t InitialState = 0;
+		std::uint32_t FinalState = 0;
+
+		std::uint64_t Size = 0;
+		std::uint64_t Alignment = 1;
+		std::uint64_t HeapOffset = 0;
+		bool IsAllocated = false;
+
+		// Execution steps of the first and last live access.
+		std::uint32_t FirstStep = 0;
+		std::uint32_t LastStep = 0;
+	};
+
+	struct BarrierRange
+	{
+		std::uint32_t First = 0;
+		std::uint32_t Count = 0;
+	};
+
+	void AddAccess(std::uint32_t pass, RenderGraphResource resource, std::uint32_t state, bool isWrite);
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void PlaceTransients();
+	void BuildBarriers();
+
+	static bool Overlaps(std::uint64_t offset0, std::uint64_t size0, std::uint64_t offset1, std::uint64_t size1);
+
+private:
+	std::vector<Pass> mPasses;
+	std::vector<Resource> mResources;
+
+	bool mIsCompiled = false;
+
+	std::vector<std::uint32_t> mExecutionOrder;
+
+	std::vector<RenderGraphBarrier> mBarriers;
+	std::vector<BarrierRange> mStepBarriers;
+	BarrierRange mFinalBarriers;
+
+	std::uint64_t mTransientHeapSize = 0;
+
+	RenderGraphStats mStats;
+};
@@ -0,0 +1,183 @@
+//***************************************************************************************
+// ResourceStateTracker.cpp
+//***************************************************************************************
+
+#include "ResourceStateTracker.h"
+
+#include <algorithm>
+#include <cassert>
+
+void ResourceStateTracker::Register(const void* resource, std::uint32_t subresourceCount, std::uint32_t state)
+{
+	assert(resource != nullptr && subresourceCount > 0);
+
+	// Re-registering drops whatever was pending for the resource.
+	Unregister(resource);
+
+	Entry& entry = mEntries[resource];
+	entry.States.assign(subresourceCount, state);
+	entry.FlushedStates.assign(subresourceCount, state);
+}
+
+void ResourceStateTracker::Unregister(const void* resource)
+{
+	auto it = mEntries.find(resource);
+	if(it == mEntries.end())
+		return;
+
+	if(it->second.IsDirty)
+		mDirtyResources.erase(std::find(mDirtyResources.begin(), mDirtyResources.end(), resource));
+
+	mEntries.erase(it);
+}
+
+void ResourceStateTracker::Clear()
+{
+	mEntries.clear();
+	mDirtyResources.clear();
+}
+
+bool ResourceStateTracker::IsRegistered(const void* resource)const
+{
+	return mEntries.find(resource) != mEntries.end();
+}
+
+std::uint32_t ResourceStateTracker::GetState(const void* resource, std::uint32_t subresource)const
+{
+	auto it = mEntries.find(resource);
+	assert(it != mEntries.end());
+
+	const std::vector<std::uint32_t>& states = it->second.States;
+	if(subresource != AllSubresources)
+	{
+		assert(subresource < states.size());
+		return states[subresource];
+	}
+
+	for(std::uint32_t state : states)
+	{
+		if(state != states[0])
+			return MixedResourceState;
+	}
+
+	return states[0];
+}
+
+void ResourceStateTracker::Transition(const void* resource, std::uint32_t state, std::uint32_t subresource)
+{
+	auto it = mEntries.find(resource);
+	assert(it != mEntries.end());
+
+	assert(state != MixedResourceState);
+
+	Entry& entry = it->second;
+	++mStats.RequestCount;
+
+	bool changed = false;
+	if(subresource == AllSubresources)
+	{
+		for(std::uint32_t& current : entry.States)
+		{
+			changed |= (current != state);
+			current = state;
+		}
+	}
+	else
+	{
+		assert(subresource < entry.States.size());
+
+		changed = (entry.States[subresource] != state);
+		entry.States[subresource] = state;
+	}
+
+	if(changed)
+		MarkDirty(resource, entry);
+	else
+		++mStats.RedundantCount;
+}
+
+bool ResourceStateTracker::HasPendingTransitions()const
+{
+	return !mDirtyResources.empty();
+}
+
+const std::vector<StateTransition>& ResourceStateTracker::Flush()
+{
+	mTransitions.clear();
+
+	for(const void* resource : mDirtyResources)
+	{
+		Entry& entry = mEntries[resource];
+		entry.IsDirty = false;
+
+		std::uint32_t subresourceCount = (std::uint32_t)entry.States.size();
+
+		// One transition covers the resource if every subresource went from one and the
+		// same state to another.
+		bool uniform = true;
+		for(std::uint32_t i = 1; i < subresourceCount && uniform; ++i)
+		{
+			uniform = entry.States[i] == entry.States[0] &&
+				entry.FlushedStates[i] == entry.FlushedStates[0];
+		}
+
+		if(uniform)
+		{
+			if(entry.States[0] != entry.FlushedStates[0])
+			{
+				StateTransition transition;
+				transition.Resource = resource;
+				transition.Subresource = AllSubresources;
+				transition.Before = entry.FlushedStates[0];
+				transition.After = entry.States[0];
+				mTransitions.push_back(transition);
+			}
+		}
+		else
+		{
+			for(std::uint32_t i = 0; i < subresourceCount; ++i)
+			{
+				if(entry.States[i] == entry.FlushedStates[i])
+					continue;
+
+				StateTransition transition;
+				transition.Resource = resource;
+				transition.Subresource = i;
+				transition.Before = entry.FlushedStates[i];
+				transition.After = entry.States[i];
+				mTransitions.push_back(transition);
+			}
+		}
+
+		entry.FlushedStates = entry.States;
+	}
+
+	mDirtyResources.clear();
+
+	if(!mTransitions.empty())
+	{
+		mStats.TransitionCount += mTransitions.size();
+		++mStats.BatchCount;
+	}
+
+	return mTransitions;
+}
+
+const StateTrackerStats& ResourceStateTracker::GetStats()const
+{
+	return mStats;
+}
+
+void ResourceStateTracker::ResetStats()
+{
+	mStats = StateTrackerStats();
+}
+
+void ResourceStateTracker::MarkDirty(const void* resource, Entry& entry)
+{
+	if(entry.IsDirty)
+		return;
+
+	entry.IsDirty = true;
+	mDirtyResources.push_back(resource);
+}
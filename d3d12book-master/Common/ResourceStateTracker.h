@@ -0,0 +1,103 @@
+//***************************************************************************************
+// ResourceStateTracker.h
+//
+// Remembers the state every registered resource (and each of its subresources) is
+// in, so command recording can ask for the state it needs instead of spelling out
+// "from" and "to" states by hand.
+//
+// Transition() only updates the tracked state.  Flush() turns everything that changed
+// since the previous flush into a list of transitions: a resource moved A -> B -> A
+// in between produces nothing, A -> B -> C produces a single A -> C, and a resource
+// whose subresources all moved from one state to another produces one transition for
+// all subresources.  Flush before any GPU work that depends on the new states (draws,
+// dispatches, copies, clears) and record the result as one batched barrier call.
+//
+// States are plain bit masks and resources opaque pointers, so the tracker has no
+// dependency on Direct3D; see StateTrackedCommandList for the command list side.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+const std::uint32_t AllSubresources = 0xffffffff;
+
+// GetState() of a whole resource whose subresources are in different states.  No
+// valid combination of D3D12_RESOURCE_STATES has every bit set; 0 would be COMMON.
+const std::uint32_t MixedResourceState = 0xffffffff;
+
+struct StateTransition
+{
+	const void* Resource = nullptr;
+	std::uint32_t Subresource = AllSubresources;
+	std::uint32_t Before = 0;
+	std::uint32_t After = 0;
+};
+
+struct StateTrackerStats
+{
+	// Transition() calls, and those that did not change the tracked state.
+	std::uint64_t RequestCount = 0;
+	std::uint64_t RedundantCount = 0;
+
+	// Transitions returned by Flush(), and the non-empty flushes that returned them.
+	std::uint64_t TransitionCount = 0;
+	std::uint64_t BatchCount = 0;
+};
+
+class ResourceStateTracker
+{
+public:
+	ResourceStateTracker() = default;
+	ResourceStateTracker(const ResourceStateTracker& rhs) = delete;
+	ResourceStateTracker& operator=(const ResourceStateTracker& rhs) = delete;
+	~ResourceStateTracker() = default;
+
+	// Starts tracking resource with every subresource in state.  Registering a
+	// resource again resets its state.
+	void Register(const void* resource, std::uint32_t subresourceCount, std::uint32_t state);
+	void Unregister(const void* resource);
+
+	// Forgets every resource and pending change.
+	void Clear();
+
+	bool IsRegistered(const void* resource)const;
+
+	// State of subresource, including unflushed transitions.  For AllSubresources, the
+	// state shared by every subresource, or MixedResourceState if they differ.
+	std::uint32_t GetState(const void* resource, std::uint32_t subresource = AllSubresources)const;
+
+	void Transition(const void* resource, std::uint32_t state, std::uint32_t subresource = AllSubresources);
+
+	bool HasPendingTransitions()const;
+
+	// Returns the transitions needed to move every resource from its state at the
+	// previous flush to its current state.  The reference stays valid until the next
+	// call.
+	const std::vector<StateTransition>& Flush();
+
+	const StateTrackerStats& GetStats()const;
+	void ResetStats();
+
+private:
+	struct Entry
+	{
+		// Per subresource: state now, and state as of the last flush.
+		std::vector<std::uint32_t> States;
+		std::vector<std::uint32_t> FlushedStates;
+
+		bool IsDirty = false;
+	};
+
+	void MarkDirty(const void* resource, Entry& entry);
+
+private:
+	std::unordered_map<const void*, Entry> mEntries;
+	std::vector<const void*> mDirtyResources;
+
+	std::vector<StateTransition> mTransitions;
+
+	StateTrackerStats mStats;
+};
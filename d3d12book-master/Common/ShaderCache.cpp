@@ -0,0 +1,333 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include "CacheFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	bool ReadFile(const std::string& filename, std::string& contents)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		if(!fin)
+			return false;
+
+		contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	std::string GetDirectory(const std::string& filename)
+	{
+		std::size_t slash = filename.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+	}
+
+	// Names of the #include directives in source, in order.  Directives inside
+	// comments or disabled #if blocks are picked up too, which at worst makes the key
+	// depend on a file the compiler never reads.
+	void FindIncludes(const std::string& source, std::vector<std::string>& includes)
+	{
+		std::size_t pos = 0;
+		while(pos < source.size())
+		{
+			std::size_t lineEnd = source.find('\n', pos);
+			if(lineEnd == std::string::npos)
+				lineEnd = source.size();
+
+			std::size_t i = source.find_first_not_of(" \t", pos);
+			if(i < lineEnd && source[i] == '#')
+			{
+				i = source.find_first_not_of(" \t", i + 1);
+				if(i < lineEnd && source.compare(i, 7, "include") == 0)
+				{
+					i = source.find_first_not_of(" \t", i + 7);
+					if(i < lineEnd && (source[i] == '"' || source[i] == '<'))
+					{
+						char close = source[i] == '"' ? '"' : '>';
+						std::size_t end = source.find(close, i + 1);
+						if(end < lineEnd)
+							includes.push_back(source.substr(i + 1, end - i - 1));
+					}
+				}
+			}
+
+			pos = lineEnd + 1;
+		}
+	}
+}
+
+const std::uint32_t ShaderCache::PackMagic;
+const std::uint32_t ShaderCache::PackVersion;
+
+ShaderCache::ShaderCache(CompileFunc compile, ThreadPool* threadPool)
+	: mCompile(std::move(compile)), mThreadPool(threadPool)
+{
+}
+
+void ShaderCache::SetCompilerId(const std::string& compilerId)
+{
+	mCompilerId = compilerId;
+}
+
+bool ShaderCache::LoadPack(const void* data, std::size_t size)
+{
+	mEntries.clear();
+	mIsDirty = false;
+	mRequests.clear();
+	mIsResolved = false;
+
+	const std::uint8_t* bytes = (const std::uint8_t*)data;
+
+	PackHeader header;
+	if(size < sizeof(header))
+		return false;
+	std::memcpy(&header, bytes, sizeof(header));
+
+	if(header.Magic != PackMagic || header.Version != PackVersion)
+		return false;
+
+	std::uint64_t indexEnd = sizeof(header) + std::uint64_t(header.EntryCount)*sizeof(PackIndexEntry);
+	if(indexEnd > size)
+		return false;
+
+	for(std::uint32_t i = 0; i < header.EntryCount; ++i)
+	{
+		PackIndexEntry entry;
+		std::memcpy(&entry, bytes + sizeof(header) + i*sizeof(PackIndexEntry), sizeof(entry));
+
+		if(entry.Offset < indexEnd || entry.Offset > size || entry.Size > size - entry.Offset)
+		{
+			mEntries.clear();
+			return false;
+		}
+
+		const std::uint8_t* bytecode = bytes + entry.Offset;
+		mEntries[entry.Key].assign(bytecode, bytecode + entry.Size);
+	}
+
+	return true;
+}
+
+bool ShaderCache::SavePack(const std::string& filename)
+{
+	std::vector<std::uint64_t> keys;
+	keys.reserve(mEntries.size());
+	for(const auto& entry : mEntries)
+		keys.push_back(entry.first);
+
+	// Sorted, so the same entries always make the same file.
+	std::sort(keys.begin(), keys.end());
+
+	PackHeader header;
+	header.Magic = PackMagic;
+	header.Version = PackVersion;
+	header.EntryCount = (std::uint32_t)keys.size();
+	header.Reserved = 0;
+
+	std::vector<PackIndexEntry> index(keys.size());
+	std::uint64_t offset = sizeof(header) + keys.size()*sizeof(PackIndexEntry);
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		index[i].Key = keys[i];
+		index[i].Offset = offset;
+		index[i].Size = mEntries[keys[i]].size();
+		offset += index[i].Size;
+	}
+
+	std::vector<CacheFileChunk> chunks;
+	chunks.push_back({ &header, sizeof(header) });
+	chunks.push_back({ index.data(), index.size()*sizeof(PackIndexEntry) });
+	for(std::uint64_t key : keys)
+	{
+		const std::vector<std::uint8_t>& bytecode = mEntries[key];
+		chunks.push_back({ bytecode.data(), bytecode.size() });
+	}
+
+	if(!SaveCacheFile(filename, chunks.data(), chunks.size()))
+		return false;
+
+	mIsDirty = false;
+	return true;
+}
+
+bool ShaderCache::IsDirty()const
+{
+	return mIsDirty;
+}
+
+std::uint32_t ShaderCache::GetEntryCount()const
+{
+	return (std::uint32_t)mEntries.size();
+}
+
+std::uint64_t ShaderCache::ComputeKey(const ShaderCompileRequest& request)const
+{
+	Fnv1aHasher hasher;
+
+	hasher.AddUInt(PackVersion);
+	hasher.AddString(mCompilerId);
+
+	std::vector<std::string> visited;
+	HashFile(request.Filename, hasher, visited);
+
+	hasher.AddUInt(request.Defines.size());
+	for(const ShaderDefine& define : request.Defines)
+	{
+		hasher.AddString(define.Name);
+		hasher.AddString(define.Value);
+	}
+
+	hasher.AddString(request.EntryPoint);
+	hasher.AddString(request.Target);
+	hasher.AddUInt(request.Flags);
+
+	return hasher.GetHash();
+}
+
+std::uint32_t ShaderCache::Add(const ShaderCompileRequest& request)
+{
+	if(mIsResolved)
+	{
+		mRequests.clear();
+		mIsResolved = false;
+	}
+
+	Request r;
+	r.Desc = request;
+	mRequests.push_back(std::move(r));
+
+	return (std::uint32_t)mRequests.size() - 1;
+}
+
+bool ShaderCache::Resolve()
+{
+	std::uint32_t requestCount = (std::uint32_t)mRequests.size();
+
+	auto forEach = [this](std::uint32_t count, const std::function<void(std::uint32_t)>& func)
+	{
+		if(mThreadPool != nullptr && count > 1)
+			mThreadPool->ParallelFor(count, func);
+		else
+		{
+			for(std::uint32_t i = 0; i < count; ++i)
+				func(i);
+		}
+	};
+
+	// Hashing reads every source file, so it is spread over the pool as well.
+	forEach(requestCount, [this](std::uint32_t i)
+	{
+		mRequests[i].Key = ComputeKey(mRequests[i].Desc);
+	});
+
+	// One compile per distinct missing key, even if the batch asks for it twice.
+	std::vector<std::uint32_t> misses;
+	for(std::uint32_t i = 0; i < requestCount; ++i)
+	{
+		Request& request = mRequests[i];
+
+		auto it = mEntries.find(request.Key);
+		if(it != mEntries.end())
+		{
+			request.Bytecode = &it->second;
+			++mStats.HitCount;
+			continue;
+		}
+
+		bool isQueued = false;
+		for(std::uint32_t miss : misses)
+			isQueued = isQueued || mRequests[miss].Key == request.Key;
+
+		if(!isQueued)
+		{
+			misses.push_back(i);
+			++mStats.MissCount;
+		}
+	}
+
+	std::vector<std::vector<std::uint8_t>> bytecodes(misses.size());
+	std::vector<char> succeeded(misses.size(), 0);
+	forEach((std::uint32_t)misses.size(), [&](std::uint32_t i)
+	{
+		succeeded[i] = mCompile(mRequests[misses[i]].Desc, bytecodes[i]) ? 1 : 0;
+	});
+
+	bool allSucceeded = true;
+	for(std::size_t i = 0; i < misses.size(); ++i)
+	{
+		if(!succeeded[i])
+		{
+			++mStats.FailedCount;
+			allSucceeded = false;
+			continue;
+		}
+
+		mEntries[mRequests[misses[i]].Key] = std::move(bytecodes[i]);
+		mIsDirty = true;
+	}
+
+	for(Request& request : mRequests)
+	{
+		if(request.Bytecode == nullptr)
+		{
+			auto it = mEntries.find(request.Key);
+			if(it != mEntries.end())
+				request.Bytecode = &it->second;
+		}
+	}
+
+	mIsResolved = true;
+	return allSucceeded;
+}
+
+std::uint32_t ShaderCache::GetRequestCount()const
+{
+	return (std::uint32_t)mRequests.size();
+}
+
+const std::vector<std::uint8_t>* ShaderCache::GetBytecode(std::uint32_t request)const
+{
+	assert(mIsResolved && request < mRequests.size());
+	return mRequests[request].Bytecode;
+}
+
+const ShaderCacheStats& ShaderCache::GetStats()const
+{
+	return mStats;
+}
+
+void ShaderCache::HashFile(const std::string& filename, Fnv1aHasher& hasher,
+	std::vector<std::string>& visited)const
+{
+	if(std::find(visited.begin(), visited.end(), filename) != visited.end())
+		return;
+	visited.push_back(filename);
+
+	hasher.AddString(filename);
+
+	// A missing file still counts, so that creating it later changes the key.
+	std::string source;
+	if(!ReadFile(filename, source))
+	{
+		hasher.AddUInt(0);
+		return;
+	}
+
+	hasher.AddUInt(1);
+	hasher.AddString(source);
+
+	std::vector<std::string> includes;
+	FindIncludes(source, includes);
+
+	std::string directory = GetDirectory(filename);
+	for(const std::string& include : includes)
+		HashFile(directory + include, hasher, visited);
+}
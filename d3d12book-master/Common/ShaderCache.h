@@ -0,0 +1,144 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Content-addressed cache of compiled shader bytecode.  A shader is identified by a
+// 64-bit key hashing everything the compiler sees: the source file, every file it
+// pulls in through #include (resolved relative to the including file, like
+// D3D_COMPILE_STANDARD_FILE_INCLUDE), the defines, the entry point, the target, the
+// compile flags and a compiler id.  Editing a shader or any header it includes
+// changes the key, so stale bytecode is never returned and nothing has to be cleared
+// by hand.
+//
+// Bytecode is kept in one pack file:
+//
+//   header  | index (key, offset, size per entry, sorted by key) | bytecode
+//
+// Requests are batched: Add() every shader, then Resolve() looks them up and compiles
+// the misses, in parallel when given a ThreadPool.  The compiler is a callback, so
+// the cache does not depend on Direct3D; see D3D12ShaderCache.h.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Fnv1aHasher;
+class ThreadPool;
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+struct ShaderCompileRequest
+{
+	std::string Filename;
+	std::vector<ShaderDefine> Defines;
+	std::string EntryPoint;
+	std::string Target;
+	std::uint32_t Flags = 0;
+};
+
+struct ShaderCacheStats
+{
+	std::uint32_t HitCount = 0;
+	std::uint32_t MissCount = 0;
+	std::uint32_t FailedCount = 0;
+};
+
+class ShaderCache
+{
+public:
+	// Compiles request into bytecode and returns true, or returns false on error.
+	// Called from pool threads when the cache has a ThreadPool.
+	typedef std::function<bool(const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode)> CompileFunc;
+
+	static const std::uint32_t PackMagic = 0x4b504353; // "SCPK"
+	static const std::uint32_t PackVersion = 1;
+
+	explicit ShaderCache(CompileFunc compile, ThreadPool* threadPool = nullptr);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+	~ShaderCache() = default;
+
+	// Hashed into every key; change it when the compiler changes.
+	void SetCompilerId(const std::string& compilerId);
+
+	// Replaces the cached entries with the pack in data.  A pack that is truncated or
+	// was written by another version is ignored and false returned; the cache is then
+	// empty and fills up again as shaders are compiled.
+	bool LoadPack(const void* data, std::size_t size);
+
+	// Writes every entry to filename (through a temporary file, so a crash never
+	// leaves a half written pack behind).
+	bool SavePack(const std::string& filename);
+
+	// True when entries were added since the last LoadPack()/SavePack().
+	bool IsDirty()const;
+
+	std::uint32_t GetEntryCount()const;
+
+	std::uint64_t ComputeKey(const ShaderCompileRequest& request)const;
+
+	// Queues a request and returns its index in the batch.
+	std::uint32_t Add(const ShaderCompileRequest& request);
+
+	// Looks up every queued request and compiles the misses.  Returns false if any of
+	// them failed to compile.  The batch stays readable until the next Add() or
+	// LoadPack().
+	bool Resolve();
+
+	std::uint32_t GetRequestCount()const;
+
+	// Bytecode of a resolved request, or nullptr if it failed to compile.
+	const std::vector<std::uint8_t>* GetBytecode(std::uint32_t request)const;
+
+	// Totals over every Resolve().
+	const ShaderCacheStats& GetStats()const;
+
+private:
+	struct PackHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint32_t EntryCount;
+		std::uint32_t Reserved;
+	};
+
+	struct PackIndexEntry
+	{
+		std::uint64_t Key;
+		std::uint64_t Offset;
+		std::uint64_t Size;
+	};
+
+	struct Request
+	{
+		ShaderCompileRequest Desc;
+		std::uint64_t Key = 0;
+		const std::vector<std::uint8_t>* Bytecode = nullptr;
+	};
+
+	// Hashes filename and, once, every file it includes, in include order.
+	void HashFile(const std::string& filename, Fnv1aHasher& hasher,
+		std::vector<std::string>& visited)const;
+
+private:
+	CompileFunc mCompile;
+	ThreadPool* mThreadPool = nullptr;
+
+	std::string mCompilerId;
+
+	std::unordered_map<std::uint64_t, std::vector<std::uint8_t>> mEntries;
+	bool mIsDirty = false;
+
+	std::vector<Request> mRequests;
+	bool mIsResolved = false;
+
+	ShaderCacheStats mStats;
+};
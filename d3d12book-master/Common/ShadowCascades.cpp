@@ -0,0 +1,229 @@
+//***************************************************************************************
+// ShadowCascades.cpp
+//***************************************************************************************
+
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+const std::uint32_t ShadowCascades::MaxCascades;
+
+ShadowCascades::ShadowCascades(std::uint32_t cascadeCount, std::uint32_t shadowMapSize)
+{
+	SetCascadeCount(cascadeCount);
+	SetShadowMapSize(shadowMapSize);
+
+	XMStoreFloat4x4(&mLightRotation, XMMatrixIdentity());
+	for(auto& cascade : mCascades)
+	{
+		XMStoreFloat4x4(&cascade.LightView, XMMatrixIdentity());
+		XMStoreFloat4x4(&cascade.LightProj, XMMatrixIdentity());
+		XMStoreFloat4x4(&cascade.ShadowTransform, XMMatrixIdentity());
+	}
+}
+
+std::uint32_t ShadowCascades::GetCascadeCount()const
+{
+	return mCascadeCount;
+}
+
+void ShadowCascades::SetCascadeCount(std::uint32_t cascadeCount)
+{
+	mCascadeCount = std::max(1u, std::min(cascadeCount, MaxCascades));
+}
+
+std::uint32_t ShadowCascades::GetShadowMapSize()const
+{
+	return mShadowMapSize;
+}
+
+void ShadowCascades::SetShadowMapSize(std::uint32_t shadowMapSize)
+{
+	mShadowMapSize = std::max(1u, shadowMapSize);
+}
+
+float ShadowCascades::GetSplitLambda()const
+{
+	return mSplitLambda;
+}
+
+void ShadowCascades::SetSplitLambda(float lambda)
+{
+	mSplitLambda = std::max(0.0f, std::min(lambda, 1.0f));
+}
+
+float ShadowCascades::GetShadowDistance()const
+{
+	return mShadowDistance;
+}
+
+void ShadowCascades::SetShadowDistance(float distance)
+{
+	mShadowDistance = distance;
+}
+
+void ShadowCascades::ComputeSplits(float nearZ, float farZ, std::uint32_t count, float lambda, float* splits)
+{
+	assert(nearZ > 0.0f && farZ > nearZ && count > 0);
+
+	splits[0] = nearZ;
+	for(std::uint32_t i = 1; i < count; ++i)
+	{
+		float p = (float)i / (float)count;
+
+		float logSplit = nearZ*std::pow(farZ / nearZ, p);
+		float uniformSplit = nearZ + (farZ - nearZ)*p;
+
+		splits[i] = lambda*logSplit + (1.0f - lambda)*uniformSplit;
+	}
+	splits[count] = farZ;
+}
+
+void ShadowCascades::Update(FXMMATRIX view, float fovY, float aspect, float nearZ, float farZ,
+	FXMVECTOR lightDir, const BoundingSphere& sceneBounds)
+{
+	float splits[MaxCascades + 1];
+	ComputeSplits(nearZ, std::max(nearZ*1.001f, std::min(farZ, mShadowDistance)),
+		mCascadeCount, mSplitLambda, splits);
+
+	// The light view only rotates into light space; the cascades position themselves
+	// with the off-center projection.  Keeping the translation out of the view matrix
+	// means moving the camera only moves the projection window, which is what is snapped.
+	XMVECTOR dir = XMVector3Normalize(lightDir);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	if(std::fabs(XMVectorGetX(XMVector3Dot(dir, up))) > 0.99f)
+		up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+	XMMATRIX lightRotation = XMMatrixLookToLH(XMVectorZero(), dir, up);
+	XMMATRIX invLightRotation = XMMatrixTranspose(lightRotation);
+	XMStoreFloat4x4(&mLightRotation, lightRotation);
+
+	XMVECTOR det = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&det, view);
+
+	XMFLOAT3 sceneCenterLS;
+	XMStoreFloat3(&sceneCenterLS, XMVector3TransformCoord(XMLoadFloat3(&sceneBounds.Center), lightRotation));
+
+	// Transform NDC space [-1,+1]^2 to texture space [0,1]^2
+	XMMATRIX T(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f);
+
+	float tanY = std::tan(0.5f*fovY);
+	float tanX = tanY*aspect;
+	float k = tanX*tanX + tanY*tanY;
+
+	for(std::uint32_t i = 0; i < mCascadeCount; ++i)
+	{
+		ShadowCascade& cascade = mCascades[i];
+
+		float a = splits[i];
+		float b = splits[i + 1];
+
+		// Smallest sphere around the slice.  Its center lies on the view axis where the
+		// distances to the near and far corners are equal, or on the far face when the
+		// slice is wide enough that the far corners alone decide the radius.  Both only
+		// depend on the lens, so the radius is the same for every camera orientation.
+		float centerZ = 0.5f*(1.0f + k)*(a + b);
+		float radius;
+		if(centerZ >= b)
+		{
+			centerZ = b;
+			radius = b*std::sqrt(k);
+		}
+		else
+		{
+			radius = std::sqrt(k*b*b + (b - centerZ)*(b - centerZ));
+		}
+
+		XMVECTOR centerW = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, centerZ, 1.0f), invView);
+
+		XMFLOAT3 centerLS;
+		XMStoreFloat3(&centerLS, XMVector3TransformCoord(centerW, lightRotation));
+
+		// Nothing outside the scene can be shadowed, so a smaller scene sphere is a
+		// tighter (and equally stable) fit.
+		if(sceneBounds.Radius < radius)
+		{
+			centerLS = sceneCenterLS;
+			radius = sceneBounds.Radius;
+		}
+
+		// Quantize the radius so round-off cannot change the texel size from frame to frame.
+		radius = std::ceil(radius*16.0f) / 16.0f;
+
+		// Move the window in whole texel steps so texels map to the same world positions.
+		float texelSize = 2.0f*radius / (float)mShadowMapSize;
+		centerLS.x = std::floor(centerLS.x / texelSize)*texelSize;
+		centerLS.y = std::floor(centerLS.y / texelSize)*texelSize;
+
+		cascade.SplitNear = a;
+		cascade.SplitFar = b;
+		cascade.Left = centerLS.x - radius;
+		cascade.Right = centerLS.x + radius;
+		cascade.Bottom = centerLS.y - radius;
+		cascade.Top = centerLS.y + radius;
+
+		// Casters between the light and the slice must still be rendered, so pull the
+		// near plane back to the far side of the scene.
+		cascade.LightNearZ = std::min(centerLS.z - radius, sceneCenterLS.z - sceneBounds.Radius);
+		cascade.LightFarZ = centerLS.z + radius;
+
+		XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(cascade.Left, cascade.Right,
+			cascade.Bottom, cascade.Top, cascade.LightNearZ, cascade.LightFarZ);
+
+		XMVECTOR lightPosLS = XMVectorSet(centerLS.x, centerLS.y, cascade.LightNearZ, 1.0f);
+		XMStoreFloat3(&cascade.LightPosW, XMVector3TransformCoord(lightPosLS, invLightRotation));
+
+		XMMATRIX S = lightRotation*lightProj*T;
+		XMStoreFloat4x4(&cascade.LightView, lightRotation);
+		XMStoreFloat4x4(&cascade.LightProj, lightProj);
+		XMStoreFloat4x4(&cascade.ShadowTransform, S);
+	}
+}
+
+const ShadowCascade& ShadowCascades::GetCascade(std::uint32_t cascade)const
+{
+	assert(cascade < mCascadeCount);
+	return mCascades[cascade];
+}
+
+std::uint32_t ShadowCascades::GetCasterMask(const BoundingBox& worldBounds)const
+{
+	BoundingBox boundsLS;
+	worldBounds.Transform(boundsLS, XMLoadFloat4x4(&mLightRotation));
+
+	float minX = boundsLS.Center.x - boundsLS.Extents.x;
+	float maxX = boundsLS.Center.x + boundsLS.Extents.x;
+	float minY = boundsLS.Center.y - boundsLS.Extents.y;
+	float maxY = boundsLS.Center.y + boundsLS.Extents.y;
+	float minZ = boundsLS.Center.z - boundsLS.Extents.z;
+	float maxZ = boundsLS.Center.z + boundsLS.Extents.z;
+
+	std::uint32_t mask = 0;
+	for(std::uint32_t i = 0; i < mCascadeCount; ++i)
+	{
+		const ShadowCascade& c = mCascades[i];
+
+		if(maxX >= c.Left && minX <= c.Right &&
+		   maxY >= c.Bottom && minY <= c.Top &&
+		   maxZ >= c.LightNearZ && minZ <= c.LightFarZ)
+		{
+			mask |= 1u << i;
+		}
+	}
+
+	return mask;
+}
+
+void ShadowCascades::CullCasters(const BoundingBox* worldBounds, std::uint32_t count, std::uint32_t* masks)const
+{
+	for(std::uint32_t i = 0; i < count; ++i)
+		masks[i] = GetCasterMask(worldBounds[i]);
+}
@@ -0,0 +1,102 @@
+//***************************************************************************************
+// ShadowCascades.h
+//
+// Cascade setup for cascaded shadow maps.  The camera frustum is cut into depth slices
+// with the "practical" split scheme (a blend of logarithmic and uniform splits) and an
+// orthographic light frustum is fitted around each slice.
+//
+// The light frustum of a cascade is fitted to the bounding sphere of its slice, whose
+// size does not change as the camera rotates, and its position is snapped to whole
+// shadow map texels in light space.  Together this keeps shadow edges from shimmering
+// while the camera moves.
+//
+// Only DirectXMath/DirectXCollision are used, so the class can be driven without a
+// device.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+
+struct ShadowCascade
+{
+	// View space depth range of the camera frustum slice covered by the cascade.
+	float SplitNear = 0.0f;
+	float SplitFar = 0.0f;
+
+	// Orthographic volume of the cascade in light view space.
+	float Left = 0.0f;
+	float Right = 0.0f;
+	float Bottom = 0.0f;
+	float Top = 0.0f;
+	float LightNearZ = 0.0f;
+	float LightFarZ = 0.0f;
+
+	// Center of the near face of the volume, in world space.
+	DirectX::XMFLOAT3 LightPosW = { 0.0f, 0.0f, 0.0f };
+
+	DirectX::XMFLOAT4X4 LightView;
+	DirectX::XMFLOAT4X4 LightProj;
+
+	// World space to shadow map texture space [0,1]^2 (depth in z).
+	DirectX::XMFLOAT4X4 ShadowTransform;
+};
+
+class ShadowCascades
+{
+public:
+	static const std::uint32_t MaxCascades = 4;
+
+	// shadowMapSize is the resolution of the square shadow map region of one cascade.
+	ShadowCascades(std::uint32_t cascadeCount = MaxCascades, std::uint32_t shadowMapSize = 1024);
+	ShadowCascades(const ShadowCascades& rhs) = delete;
+	ShadowCascades& operator=(const ShadowCascades& rhs) = delete;
+	~ShadowCascades() = default;
+
+	std::uint32_t GetCascadeCount()const;
+	void SetCascadeCount(std::uint32_t cascadeCount);
+
+	std::uint32_t GetShadowMapSize()const;
+	void SetShadowMapSize(std::uint32_t shadowMapSize);
+
+	// 0 gives uniform splits, 1 logarithmic splits.
+	float GetSplitLambda()const;
+	void SetSplitLambda(float lambda);
+
+	// Shadows are only computed up to this view space depth (clamped to the camera far plane).
+	float GetShadowDistance()const;
+	void SetShadowDistance(float distance);
+
+	// Writes count+1 split depths to splits; splits[0] = nearZ and splits[count] = farZ.
+	static void ComputeSplits(float nearZ, float farZ, std::uint32_t count, float lambda, float* splits);
+
+	// Fits the cascades to the camera described by view/fovY/aspect/nearZ/farZ (the
+	// parameters of Camera::SetLens).  lightDir is the direction the light travels.
+	// sceneBounds must contain every shadow caster; it extends the light volumes towards
+	// the light and replaces a slice sphere when it is the smaller of the two.
+	void Update(DirectX::FXMMATRIX view, float fovY, float aspect, float nearZ, float farZ,
+		DirectX::FXMVECTOR lightDir, const DirectX::BoundingSphere& sceneBounds);
+
+	const ShadowCascade& GetCascade(std::uint32_t cascade)const;
+
+	// Returns a mask with bit i set if the world space box can cast a shadow into
+	// cascade i.  All cascades share the light orientation, so the box is transformed
+	// to light space only once.
+	std::uint32_t GetCasterMask(const DirectX::BoundingBox& worldBounds)const;
+
+	// Writes the caster mask of count boxes to masks.
+	void CullCasters(const DirectX::BoundingBox* worldBounds, std::uint32_t count, std::uint32_t* masks)const;
+
+private:
+	std::uint32_t mCascadeCount = MaxCascades;
+	std::uint32_t mShadowMapSize = 1024;
+	float mSplitLambda = 0.75f;
+	float mShadowDistance = 100.0f;
+
+	// Rotation part of the light view shared by all cascades.
+	DirectX::XMFLOAT4X4 mLightRotation;
+
+	ShadowCascade mCascades[MaxCascades];
+};
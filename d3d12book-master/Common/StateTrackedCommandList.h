@@ -0,0 +1,111 @@
+//***************************************************************************************
+// StateTrackedCommandList.h
+//
+// Records resource transitions through a ResourceStateTracker.  Transition() names
+// only the state a resource is needed in; the barriers are collected and issued in
+// one ResourceBarrier call right before the next command that depends on them.  Use
+// operator-> for commands that do not touch resource states.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ResourceStateTracker.h"
+
+class StateTrackedCommandList
+{
+public:
+    explicit StateTrackedCommandList(ResourceStateTracker& tracker)
+        : mTracker(tracker)
+    {
+    }
+
+    StateTrackedCommandList(const StateTrackedCommandList& rhs) = delete;
+    StateTrackedCommandList& operator=(const StateTrackedCommandList& rhs) = delete;
+    ~StateTrackedCommandList() = default;
+
+    // Records into cmdList from now on.  Flush before switching lists.
+    void SetCommandList(ID3D12GraphicsCommandList* cmdList)
+    {
+        assert(!mTracker.HasPendingTransitions());
+        mCmdList = cmdList;
+    }
+
+    ID3D12GraphicsCommandList* Get()const
+    {
+        return mCmdList;
+    }
+
+    ID3D12GraphicsCommandList* operator->()const
+    {
+        return mCmdList;
+    }
+
+    void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+    {
+        mTracker.Transition(resource, (std::uint32_t)state, subresource);
+    }
+
+    // Issues the pending transitions, if any, as one ResourceBarrier call.
+    void FlushBarriers()
+    {
+        if(!mTracker.HasPendingTransitions())
+            return;
+
+        const std::vector<StateTransition>& transitions = mTracker.Flush();
+
+        mBarriers.clear();
+        for(const StateTransition& t : transitions)
+        {
+            mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+                static_cast<ID3D12Resource*>(const_cast<void*>(t.Resource)),
+                (D3D12_RESOURCE_STATES)t.Before, (D3D12_RESOURCE_STATES)t.After, t.Subresource));
+        }
+
+        if(!mBarriers.empty())
+            mCmdList->ResourceBarrier((UINT)mBarriers.size(), mBarriers.data());
+    }
+
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT color[4])
+    {
+        FlushBarriers();
+        mCmdList->ClearRenderTargetView(rtv, color, 0, nullptr);
+    }
+
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS flags, FLOAT depth, UINT8 stencil)
+    {
+        FlushBarriers();
+        mCmdList->ClearDepthStencilView(dsv, flags, depth, stencil, 0, nullptr);
+    }
+
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+    {
+        FlushBarriers();
+        mCmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    }
+
+    void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+    {
+        FlushBarriers();
+        mCmdList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+    }
+
+    void Dispatch(UINT groupCountX, UINT groupCountY, UINT groupCountZ)
+    {
+        FlushBarriers();
+        mCmdList->Dispatch(groupCountX, groupCountY, groupCountZ);
+    }
+
+    void CopyResource(ID3D12Resource* dst, ID3D12Resource* src)
+    {
+        FlushBarriers();
+        mCmdList->CopyResource(dst, src);
+    }
+
+private:
+    ResourceStateTracker& mTracker;
+    ID3D12GraphicsCommandList* mCmdList = nullptr;
+
+    std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+};
@@ -0,0 +1,109 @@
+//***************************************************************************************
+// StreamingCopy.h
+//
+// Copies into upload heaps.  Upload heaps are write-combined memory the CPU only ever
+// writes, so large copies use non-temporal (streaming) SSE2 stores: they fill whole
+// write-combining lines without first pulling the destination into the cache and
+// without evicting the data the CPU is still working on.  Small copies and targets
+// without SSE2 fall back to memcpy.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define STREAMING_COPY_SSE2 1
+#endif
+
+// Copies smaller than this go through memcpy; streaming only pays off once the copy
+// is well beyond what stays in the write-combining buffers anyway.
+const std::size_t StreamingCopyThreshold = 16*1024;
+
+#if defined(STREAMING_COPY_SSE2)
+// dst must be 16-byte aligned and byteSize a multiple of 16.
+inline void StreamAligned16(std::uint8_t* dst, const std::uint8_t* src, std::size_t byteSize)
+{
+    std::size_t i = 0;
+    for(; i + 64 <= byteSize; i += 64)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), d);
+    }
+
+    for(; i < byteSize; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+    }
+}
+#endif
+
+inline void StreamingCopy(void* dst, const void* src, std::size_t byteSize)
+{
+#if defined(STREAMING_COPY_SSE2)
+    if(byteSize >= StreamingCopyThreshold)
+    {
+        std::uint8_t* d = static_cast<std::uint8_t*>(dst);
+        const std::uint8_t* s = static_cast<const std::uint8_t*>(src);
+
+        // Regular stores up to the first 16-byte boundary of the destination, streaming
+        // stores for the aligned body, regular stores for the tail.
+        std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+        std::memcpy(d, s, head);
+
+        std::size_t body = (byteSize - head) & ~std::size_t(15);
+        StreamAligned16(d + head, s + head, body);
+
+        std::memcpy(d + head + body, s + head + body, byteSize - head - body);
+
+        // Streaming stores are weakly ordered; make them visible before the command
+        // list referencing the data is submitted.
+        _mm_sfence();
+        return;
+    }
+#endif
+
+    std::memcpy(dst, src, byteSize);
+}
+
+// Copies count elements of elementByteSize bytes from src (srcStride bytes apart) to
+// dst (dstStride bytes apart), e.g. packed structures into 256-byte constant buffer
+// slots.
+inline void StreamingCopyStrided(void* dst, std::size_t dstStride, const void* src, std::size_t srcStride,
+    std::size_t elementByteSize, std::size_t count)
+{
+    if(dstStride == elementByteSize && srcStride == elementByteSize)
+    {
+        StreamingCopy(dst, src, elementByteSize*count);
+        return;
+    }
+
+    std::uint8_t* d = static_cast<std::uint8_t*>(dst);
+    const std::uint8_t* s = static_cast<const std::uint8_t*>(src);
+
+#if defined(STREAMING_COPY_SSE2)
+    if(elementByteSize*count >= StreamingCopyThreshold &&
+       elementByteSize % 16 == 0 && dstStride % 16 == 0 &&
+       (reinterpret_cast<std::uintptr_t>(d) & 15) == 0)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+            StreamAligned16(d + i*dstStride, s + i*srcStride, elementByteSize);
+
+        _mm_sfence();
+        return;
+    }
+#endif
+
+    for(std::size_t i = 0; i < count; ++i)
+        std::memcpy(d + i*dstStride, s + i*srcStride, elementByteSize);
+}
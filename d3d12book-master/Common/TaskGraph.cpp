@@ -0,0 +1,202 @@
+//***************************************************************************************
+// TaskGraph.cpp
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+std::uint32_t TaskGraph::AddTask(const std::string& name, TaskFunc func, TaskAffinity affinity)
+{
+	Task task;
+	task.Name = name;
+	task.ProfileName = Profiler::InternName(name);
+	task.Func = std::move(func);
+	task.Affinity = affinity;
+	mTasks.push_back(std::move(task));
+
+	return (std::uint32_t)mTasks.size() - 1;
+}
+
+void TaskGraph::AddDependency(std::uint32_t task, std::uint32_t dependency)
+{
+	assert(task < mTasks.size() && dependency < task);
+
+	std::vector<std::uint32_t>& dependencies = mTasks[task].Dependencies;
+	if(std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end())
+		return;
+
+	dependencies.push_back(dependency);
+	mTasks[dependency].Dependents.push_back(task);
+}
+
+void TaskGraph::Run(ThreadPool* threadPool)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	mThreadPool = threadPool;
+	mStartTime = std::chrono::steady_clock::now();
+	mMainThreadQueue.clear();
+	mRunningCount = 0;
+	mError = nullptr;
+
+	for(Task& task : mTasks)
+	{
+		task.PendingCount = (std::uint32_t)task.Dependencies.size();
+		task.Timing = TaskTiming();
+	}
+
+	for(std::uint32_t i = 0; i < mTasks.size(); ++i)
+	{
+		if(mTasks[i].PendingCount == 0)
+			Schedule(i);
+	}
+
+	// Run main thread tasks as they become ready, until nothing is left running.
+	while(true)
+	{
+		if(!mMainThreadQueue.empty())
+		{
+			std::uint32_t task = mMainThreadQueue.front();
+			mMainThreadQueue.pop_front();
+
+			lock.unlock();
+			Execute(task);
+			lock.lock();
+		}
+		else if(mRunningCount == 0)
+			break;
+		else
+			mTaskFinished.wait(lock);
+	}
+
+	mElapsedSeconds = GetSecondsSinceStart();
+	mThreadPool = nullptr;
+
+	if(mError != nullptr)
+	{
+		std::exception_ptr error = mError;
+		mError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+std::uint32_t TaskGraph::GetTaskCount()const
+{
+	return (std::uint32_t)mTasks.size();
+}
+
+const std::string& TaskGraph::GetTaskName(std::uint32_t task)const
+{
+	return mTasks[task].Name;
+}
+
+const TaskTiming& TaskGraph::GetTiming(std::uint32_t task)const
+{
+	return mTasks[task].Timing;
+}
+
+double TaskGraph::GetElapsedSeconds()const
+{
+	return mElapsedSeconds;
+}
+
+double TaskGraph::GetSerialSeconds()const
+{
+	double seconds = 0.0;
+	for(const Task& task : mTasks)
+		seconds += task.Timing.GetSeconds();
+	return seconds;
+}
+
+double TaskGraph::GetCriticalPathSeconds()const
+{
+	// Dependencies always come first, so one pass in order sees them finished.
+	std::vector<double> pathSeconds(mTasks.size(), 0.0);
+	double longest = 0.0;
+	for(std::size_t i = 0; i < mTasks.size(); ++i)
+	{
+		double start = 0.0;
+		for(std::uint32_t dependency : mTasks[i].Dependencies)
+			start = std::max(start, pathSeconds[dependency]);
+
+		pathSeconds[i] = start + mTasks[i].Timing.GetSeconds();
+		longest = std::max(longest, pathSeconds[i]);
+	}
+
+	return longest;
+}
+
+void TaskGraph::Schedule(std::uint32_t task)
+{
+	++mRunningCount;
+
+	if(mThreadPool != nullptr && mTasks[task].Affinity == TaskAffinity::Any)
+		mThreadPool->Enqueue([this, task]() { Execute(task); });
+	else
+		mMainThreadQueue.push_back(task);
+}
+
+void TaskGraph::Finish(std::uint32_t task, std::exception_ptr error)
+{
+	--mRunningCount;
+
+	if(error != nullptr)
+	{
+		if(mError == nullptr)
+			mError = error;
+	}
+	else if(mError == nullptr)
+	{
+		for(std::uint32_t dependent : mTasks[task].Dependents)
+		{
+			if(--mTasks[dependent].PendingCount == 0)
+				Schedule(dependent);
+		}
+	}
+
+	mTaskFinished.notify_all();
+}
+
+void TaskGraph::Execute(std::uint32_t task)
+{
+	{
+		// A task queued before another one failed is dropped.
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(mError != nullptr)
+		{
+			--mRunningCount;
+			mTaskFinished.notify_all();
+			return;
+		}
+	}
+
+	// Only this thread writes the timing, and Run() reads it after every task is done.
+	TaskTiming& timing = mTasks[task].Timing;
+	timing.RanOnMainThread = mThreadPool == nullptr || mTasks[task].Affinity == TaskAffinity::MainThread;
+	timing.StartSeconds = GetSecondsSinceStart();
+
+	std::exception_ptr error;
+	try
+	{
+		PROFILE_SCOPE(mTasks[task].ProfileName);
+		mTasks[task].Func();
+	}
+	catch(...)
+	{
+		error = std::current_exception();
+	}
+
+	timing.EndSeconds = GetSecondsSinceStart();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	Finish(task, error);
+}
+
+double TaskGraph::GetSecondsSinceStart()const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+}
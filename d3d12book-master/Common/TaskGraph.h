@@ -0,0 +1,128 @@
+//***************************************************************************************
+// TaskGraph.h
+//
+// Runs a set of one-shot tasks (the steps of a demo's initialization) as soon as the
+// tasks they depend on are done.  Tasks that only touch the CPU (file I/O, parsing,
+// shader compilation, geometry generation) run concurrently on a ThreadPool; tasks
+// that record to a command list are marked TaskAffinity::MainThread and run one at a
+// time on the thread calling Run().  The elapsed time then approaches the longest
+// chain of dependent tasks rather than the sum of all of them.
+//
+// Each task's start and end times are recorded for reporting.
+//***************************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+enum class TaskAffinity
+{
+	// Any thread, so a pool worker.
+	Any,
+
+	// The thread calling Run(), in the order the tasks become ready.
+	MainThread
+};
+
+struct TaskTiming
+{
+	// Seconds since Run() started.
+	double StartSeconds = 0.0;
+	double EndSeconds = 0.0;
+
+	bool RanOnMainThread = false;
+
+	double GetSeconds()const { return EndSeconds - StartSeconds; }
+};
+
+class TaskGraph
+{
+public:
+	typedef std::function<void()> TaskFunc;
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph& rhs) = delete;
+	TaskGraph& operator=(const TaskGraph& rhs) = delete;
+	~TaskGraph() = default;
+
+	std::uint32_t AddTask(const std::string& name, TaskFunc func,
+		TaskAffinity affinity = TaskAffinity::Any);
+
+	// task does not start before dependency has finished.  The dependency must have
+	// been added first, which rules out cycles.
+	void AddDependency(std::uint32_t task, std::uint32_t dependency);
+
+	// Runs every task and returns when all are done.  Without a ThreadPool everything
+	// runs on the calling thread, in an order respecting the dependencies.  If a task
+	// throws, the tasks depending on it are skipped, the ones already running are
+	// waited for, and the first exception is rethrown.
+	void Run(ThreadPool* threadPool);
+
+	std::uint32_t GetTaskCount()const;
+	const std::string& GetTaskName(std::uint32_t task)const;
+
+	// Timings of the last Run().
+	const TaskTiming& GetTiming(std::uint32_t task)const;
+
+	// Time Run() took.
+	double GetElapsedSeconds()const;
+
+	// Sum of the task times: what running them one after the other would take.
+	double GetSerialSeconds()const;
+
+	// Longest chain of dependent tasks, by their measured times: the least Run() could
+	// take with enough threads.
+	double GetCriticalPathSeconds()const;
+
+private:
+	struct Task
+	{
+		std::string Name;
+
+		// Name interned once for PROFILE_SCOPE, which keeps it by pointer.
+		const char* ProfileName = nullptr;
+
+		TaskFunc Func;
+		TaskAffinity Affinity = TaskAffinity::Any;
+
+		std::vector<std::uint32_t> Dependencies;
+		std::vector<std::uint32_t> Dependents;
+
+		// Dependencies not finished yet during Run().
+		std::uint32_t PendingCount = 0;
+
+		TaskTiming Timing;
+	};
+
+	// Both called with mMutex held.
+	void Schedule(std::uint32_t task);
+	void Finish(std::uint32_t task, std::exception_ptr error);
+
+	void Execute(std::uint32_t task);
+
+	double GetSecondsSinceStart()const;
+
+private:
+	std::vector<Task> mTasks;
+
+	// State of the current Run().
+	ThreadPool* mThreadPool = nullptr;
+	std::chrono::steady_clock::time_point mStartTime;
+	std::mutex mMutex;
+	std::condition_variable mTaskFinished;
+	std::deque<std::uint32_t> mMainThreadQueue;
+	std::uint32_t mRunningCount = 0;
+	std::exception_ptr mError;
+
+	double mElapsedSeconds = 0.0;
+};
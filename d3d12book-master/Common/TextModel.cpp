@@ -0,0 +1,79 @@
+//***************************************************************************************
+// TextModel.cpp
+//***************************************************************************************
+
+#include "TextModel.h"
+#include "MappedFile.h"
+#include "MathHelper.h"
+
+using namespace DirectX;
+
+bool LoadTextModel(const std::string& filename, TextModel& model)
+{
+	MappedFile file;
+	if(!file.Open(filename, MappedFileHint::Sequential))
+		return false;
+
+	MemoryInputStream fin(file.GetData(), file.GetSize());
+
+	std::uint32_t vcount = 0;
+	std::uint32_t tcount = 0;
+	std::string ignore;
+
+	fin >> ignore >> vcount;
+	fin >> ignore >> tcount;
+	fin >> ignore >> ignore >> ignore >> ignore;
+
+	XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
+	XMFLOAT3 vMaxf3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
+
+	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
+	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
+
+	std::vector<TextModelVertex>& vertices = model.Vertices;
+	vertices.resize(vcount);
+	for(std::uint32_t i = 0; i < vcount; ++i)
+	{
+		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
+		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+
+		vertices[i].TexC = { 0.0f, 0.0f };
+
+		XMVECTOR P = XMLoadFloat3(&vertices[i].Pos);
+
+		XMVECTOR N = XMLoadFloat3(&vertices[i].Normal);
+
+		// Any vector perpendicular to the normal will do as the tangent.
+		XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		if(fabsf(XMVectorGetX(XMVector3Dot(N, up))) < 1.0f - 0.001f)
+		{
+			XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
+			XMStoreFloat3(&vertices[i].TangentU, T);
+		}
+		else
+		{
+			up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+			XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, up));
+			XMStoreFloat3(&vertices[i].TangentU, T);
+		}
+
+		vMin = XMVectorMin(vMin, P);
+		vMax = XMVectorMax(vMax, P);
+	}
+
+	XMStoreFloat3(&model.Bounds.Center, 0.5f*(vMin + vMax));
+	XMStoreFloat3(&model.Bounds.Extents, 0.5f*(vMax - vMin));
+
+	fin >> ignore;
+	fin >> ignore;
+	fin >> ignore;
+
+	std::vector<std::int32_t>& indices = model.Indices;
+	indices.resize(3 * tcount);
+	for(std::uint32_t i = 0; i < tcount; ++i)
+	{
+		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
+	}
+
+	return bool(fin);
+}
@@ -0,0 +1,37 @@
+//***************************************************************************************
+// TextModel.h
+//
+// Loader for the book's text models (Models/skull.txt, car.txt): a vertex count and a
+// triangle count, a position and a normal per vertex, then three indices per
+// triangle.  The file is parsed straight out of a MappedFile.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The models have no texture coordinates; TexC is zero and TangentU is any tangent,
+// which is all normal mapping needs to give back the interpolated vertex normal.
+struct TextModelVertex
+{
+	DirectX::XMFLOAT3 Pos;
+	DirectX::XMFLOAT3 Normal;
+	DirectX::XMFLOAT2 TexC;
+	DirectX::XMFLOAT3 TangentU;
+};
+
+struct TextModel
+{
+	std::vector<TextModelVertex> Vertices;
+	std::vector<std::int32_t> Indices;
+
+	// Of the vertex positions.
+	DirectX::BoundingBox Bounds;
+};
+
+// Returns false if filename could not be opened or is not a complete model.
+bool LoadTextModel(const std::string& filename, TextModel& model);
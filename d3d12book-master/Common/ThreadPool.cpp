@@ -0,0 +1,163 @@
+//***************************************************************************************
+// ThreadPool.cpp
+//***************************************************************************************
+
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+ThreadPool::ThreadPool(std::uint32_t threadCount)
+{
+	if(threadCount == 0)
+	{
+		std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	mWorkers.reserve(threadCount);
+	for(std::uint32_t i = 0; i < threadCount; ++i)
+		mWorkers.emplace_back(&ThreadPool::WorkerMain, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mJobAvailable.notify_all();
+
+	for(auto& worker : mWorkers)
+		worker.join();
+}
+
+std::uint32_t ThreadPool::GetWorkerCount()const
+{
+	return (std::uint32_t)mWorkers.size();
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(std::move(job));
+	}
+	mJobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mJobsDone.wait(lock, [this]{ return mJobs.empty() && mActiveJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t)>& func,
+	std::uint32_t grainSize)
+{
+	if(count == 0)
+		return;
+
+	grainSize = std::max(grainSize, 1u);
+	const std::uint32_t batchCount = (count + grainSize - 1) / grainSize;
+
+	// Not worth waking anybody up for a single batch.
+	if(batchCount == 1 || mWorkers.empty())
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+			func(i);
+		return;
+	}
+
+	// Helpers may only get to run after every batch is done, even after this call
+	// returned, so they share the counters through a shared_ptr and only touch func
+	// once they have claimed a batch, which this call waits for.
+	struct State
+	{
+		std::atomic<std::uint32_t> NextBatch;
+		std::uint32_t DoneBatchCount = 0;
+		std::mutex DoneMutex;
+		std::condition_variable DoneCV;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->NextBatch = 0;
+
+	auto runBatches = [count, grainSize, batchCount, &func](State& s)
+	{
+		PROFILE_SCOPE("ParallelFor");
+
+		std::uint32_t doneCount = 0;
+		for(;;)
+		{
+			std::uint32_t batch = s.NextBatch.fetch_add(1);
+			if(batch >= batchCount)
+				break;
+
+			std::uint32_t begin = batch * grainSize;
+			std::uint32_t end = std::min(begin + grainSize, count);
+			for(std::uint32_t i = begin; i < end; ++i)
+				func(i);
+
+			++doneCount;
+		}
+
+		if(doneCount > 0)
+		{
+			std::lock_guard<std::mutex> lock(s.DoneMutex);
+			s.DoneBatchCount += doneCount;
+			if(s.DoneBatchCount == batchCount)
+				s.DoneCV.notify_one();
+		}
+	};
+
+	// One helper per worker at most; the calling thread takes a share too.
+	const std::uint32_t helperCount = std::min(GetWorkerCount(), batchCount - 1);
+	for(std::uint32_t i = 0; i < helperCount; ++i)
+	{
+		Enqueue([state, runBatches]()
+		{
+			runBatches(*state);
+		});
+	}
+
+	runBatches(*state);
+
+	std::unique_lock<std::mutex> lock(state->DoneMutex);
+	state->DoneCV.wait(lock, [&]{ return state->DoneBatchCount == batchCount; });
+}
+
+void ThreadPool::WorkerMain(std::uint32_t index)
+{
+	PROFILE_THREAD_NAME("Worker " + std::to_string(index));
+	(void)index;
+
+	for(;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobAvailable.wait(lock, [this]{ return mQuit || !mJobs.empty(); });
+
+			if(mQuit && mJobs.empty())
+				return;
+
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+			++mActiveJobs;
+		}
+
+		{
+			PROFILE_SCOPE("Job");
+			job();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mActiveJobs;
+			if(mJobs.empty() && mActiveJobs == 0)
+				mJobsDone.notify_all();
+		}
+	}
+}
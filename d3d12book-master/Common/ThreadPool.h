@@ -0,0 +1,57 @@
+//***************************************************************************************
+// ThreadPool.h
+//
+// Small persistent worker pool for the CPU side jobs of the demos (culling, binning,
+// buffer updates).  Workers are created once and sleep on a condition variable, so
+// dispatching a ParallelFor every frame does not pay for thread creation.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threadCount = 0 uses one worker per hardware thread minus the calling thread.
+	explicit ThreadPool(std::uint32_t threadCount = 0);
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	// Number of background workers (not counting the thread calling ParallelFor).
+	std::uint32_t GetWorkerCount()const;
+
+	// Queues a job to run on a worker.  Use Wait() to block until the queue drains.
+	void Enqueue(std::function<void()> job);
+	void Wait();
+
+	// Calls func(i) for every i in [0, count).  Indices are handed out in batches of
+	// grainSize through an atomic counter; the calling thread participates and the
+	// function returns once every index has been processed.  It may be called from
+	// inside a job (e.g. a TaskGraph task): the calling thread works through the
+	// batches itself, and workers busy with other jobs simply do not help, so the pool
+	// is shared instead of oversubscribed.
+	void ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t)>& func,
+		std::uint32_t grainSize = 1);
+
+private:
+	void WorkerMain(std::uint32_t index);
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mJobAvailable;
+	std::condition_variable mJobsDone;
+	std::deque<std::function<void()>> mJobs;
+	std::uint32_t mActiveJobs = 0;
+	bool mQuit = false;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "StreamingCopy.h"
 
 template<typename T>
 class UploadBuffer
@@ -55,6 +56,49 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies count consecutive elements starting at firstElement.  Without constant
+    // buffer padding this is one contiguous copy; constant buffer elements are
+    // written at their 256-byte stride.  Large ranges use streaming stores.
+    void CopyData(int firstElement, const T* data, UINT count)
+    {
+        StreamingCopyStrided(&mMappedData[firstElement*mElementByteSize], mElementByteSize,
+            data, sizeof(T), sizeof(T), count);
+    }
+
+    // Copies data[i] to element elementIndices[i] for i in [0, count), e.g. only the
+    // constants of the objects that changed.
+    void CopyDataScattered(const UINT* elementIndices, const T* data, UINT count)
+    {
+        for(UINT i = 0; i < count; ++i)
+            memcpy(&mMappedData[elementIndices[i]*mElementByteSize], &data[i], sizeof(T));
+    }
+
+    // Hands out consecutive elements for building data in place, which saves the copy
+    // from a temporary.  Upload heaps are write-combined: only write through the
+    // pointers, never read, and fill each element front to back.
+    class WriteCursor
+    {
+    public:
+        WriteCursor(BYTE* data, UINT stride) : mData(data), mStride(stride) {}
+
+        // Returns the current element and advances to the next one.
+        T* Next()
+        {
+            T* element = reinterpret_cast<T*>(mData);
+            mData += mStride;
+            return element;
+        }
+
+    private:
+        BYTE* mData;
+        UINT mStride;
+    };
+
+    WriteCursor GetWriteCursor(int firstElement)
+    {
+        return WriteCursor(&mMappedData[firstElement*mElementByteSize], mElementByteSize);
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
@@ -0,0 +1,66 @@
+//***************************************************************************************
+// UploadHeapMemory.h
+//
+// UploadRingMemory backed by one committed buffer in an upload heap, mapped for its
+// whole lifetime like UploadBuffer.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "UploadRing.h"
+
+class UploadHeapMemory : public UploadRingMemory
+{
+public:
+    UploadHeapMemory(ID3D12Device* device, UINT64 byteSize)
+    {
+        ThrowIfFailed(device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&mUploadBuffer)));
+
+        ThrowIfFailed(mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+
+        mByteSize = byteSize;
+    }
+
+    UploadHeapMemory(const UploadHeapMemory& rhs) = delete;
+    UploadHeapMemory& operator=(const UploadHeapMemory& rhs) = delete;
+    ~UploadHeapMemory()
+    {
+        if(mUploadBuffer != nullptr)
+            mUploadBuffer->Unmap(0, nullptr);
+
+        mMappedData = nullptr;
+    }
+
+    ID3D12Resource* Resource()const
+    {
+        return mUploadBuffer.Get();
+    }
+
+    std::uint8_t* GetCpuAddress() override
+    {
+        return mMappedData;
+    }
+
+    std::uint64_t GetGpuAddress()const override
+    {
+        return mUploadBuffer->GetGPUVirtualAddress();
+    }
+
+    std::uint64_t GetSize()const override
+    {
+        return mByteSize;
+    }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
+    BYTE* mMappedData = nullptr;
+
+    UINT64 mByteSize = 0;
+};
@@ -0,0 +1,118 @@
+//***************************************************************************************
+// UploadRing.cpp
+//***************************************************************************************
+
+#include "UploadRing.h"
+
+#include <cassert>
+
+UploadRing::UploadRing(UploadRingMemory* memory)
+	: mMemory(memory), mCapacity(memory->GetSize())
+{
+}
+
+UploadAllocation UploadRing::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	UploadAllocation alloc;
+	if(size == 0 || size > mCapacity)
+		return alloc;
+
+	// With nothing in flight the whole ring is free; start over at the beginning so
+	// the largest possible block is available.
+	if(mUsed == 0)
+		mHead = mTail = 0;
+
+	std::uint64_t alignedHead = (mHead + alignment - 1) & ~(alignment - 1);
+	std::uint64_t offset = 0;
+
+	if(mUsed == 0 || mHead > mTail)
+	{
+		// Free space is [head, capacity) followed by [0, tail).
+		if(alignedHead + size <= mCapacity)
+			offset = alignedHead;
+		else if(size <= mTail)
+			offset = 0;   // Skip the end of the ring.
+		else
+			return alloc;
+	}
+	else if(mHead < mTail)
+	{
+		// Free space is [head, tail).
+		if(alignedHead + size <= mTail)
+			offset = alignedHead;
+		else
+			return alloc;
+	}
+	else
+	{
+		// head == tail with memory in use: the ring is full.
+		return alloc;
+	}
+
+	// Everything between the old head and the end of the block counts as used, so the
+	// tail advances over the padding and the skipped end when the frame retires.
+	std::uint64_t consumed = (offset >= mHead) ? (offset + size - mHead) : (mCapacity - mHead + offset + size);
+
+	mHead = offset + size;
+	if(mHead == mCapacity)
+		mHead = 0;
+
+	mUsed += consumed;
+	mFrameBytes += consumed;
+
+	alloc.CpuAddress = mMemory->GetCpuAddress() + offset;
+	alloc.GpuAddress = mMemory->GetGpuAddress() + offset;
+	alloc.Offset = offset;
+	alloc.Size = size;
+
+	return alloc;
+}
+
+void UploadRing::FinishFrame(std::uint64_t fenceValue)
+{
+	PendingFrame frame;
+	frame.Fence = fenceValue;
+	frame.Bytes = mFrameBytes;
+	mPendingFrames.push_back(frame);
+
+	mFrameBytes = 0;
+}
+
+void UploadRing::Retire(std::uint64_t completedFenceValue)
+{
+	while(!mPendingFrames.empty() && mPendingFrames.front().Fence <= completedFenceValue)
+	{
+		std::uint64_t bytes = mPendingFrames.front().Bytes;
+		mPendingFrames.pop_front();
+
+		mTail = (mTail + bytes) % mCapacity;
+		mUsed -= bytes;
+	}
+}
+
+bool UploadRing::HasPendingFrames()const
+{
+	return !mPendingFrames.empty();
+}
+
+std::uint64_t UploadRing::GetOldestPendingFence()const
+{
+	return mPendingFrames.empty() ? 0 : mPendingFrames.front().Fence;
+}
+
+std::uint64_t UploadRing::GetCapacity()const
+{
+	return mCapacity;
+}
+
+std::uint64_t UploadRing::GetUsedBytes()const
+{
+	return mUsed;
+}
+
+std::uint64_t UploadRing::GetFrameBytes()const
+{
+	return mFrameBytes;
+}
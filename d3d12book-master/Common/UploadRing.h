@@ -0,0 +1,125 @@
+//***************************************************************************************
+// UploadRing.h
+//
+// Ring allocator for per-frame upload data.  Instead of one UploadBuffer per data type
+// and frame resource, all transient data (constants, instance data, dynamic vertices)
+// is suballocated from one large mapped block.  Allocations are 256-byte aligned by
+// default so they can be bound directly as root constant buffer views.
+//
+// Every allocation belongs to the frame that is open when it is made.  FinishFrame()
+// closes the frame with the fence value signaled after its commands, and Retire()
+// hands the frame's memory back once the GPU has passed that fence.  The ring never
+// talks to the GPU itself; it only works on offsets into an UploadRingMemory, so the
+// allocation logic can be exercised on plain system memory.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// Mapped memory the ring suballocates from.
+class UploadRingMemory
+{
+public:
+	virtual ~UploadRingMemory() = default;
+
+	// Not const: the ring writes through the pointer.
+	virtual std::uint8_t* GetCpuAddress() = 0;
+
+	// GPU virtual address of the first byte, or 0 for memory the GPU cannot see.
+	virtual std::uint64_t GetGpuAddress()const = 0;
+
+	virtual std::uint64_t GetSize()const = 0;
+};
+
+// UploadRingMemory in ordinary system memory, for running the ring without a device.
+class SystemUploadRingMemory : public UploadRingMemory
+{
+public:
+	explicit SystemUploadRingMemory(std::uint64_t size) : mData((std::size_t)size) {}
+
+	std::uint8_t* GetCpuAddress() override { return mData.data(); }
+	std::uint64_t GetGpuAddress()const override { return 0; }
+	std::uint64_t GetSize()const override { return mData.size(); }
+
+private:
+	std::vector<std::uint8_t> mData;
+};
+
+struct UploadAllocation
+{
+	std::uint8_t* CpuAddress = nullptr;
+	std::uint64_t GpuAddress = 0;
+	std::uint64_t Offset = 0;
+	std::uint64_t Size = 0;
+
+	bool IsValid()const { return CpuAddress != nullptr; }
+};
+
+class UploadRing
+{
+public:
+	static const std::uint64_t ConstantBufferAlignment = 256;
+
+	explicit UploadRing(UploadRingMemory* memory);
+	UploadRing(const UploadRing& rhs) = delete;
+	UploadRing& operator=(const UploadRing& rhs) = delete;
+	~UploadRing() = default;
+
+	// Suballocates size bytes.  alignment must be a power of two.  Returns an invalid
+	// allocation if the free part of the ring is too small; the caller should then
+	// wait for GetOldestPendingFence(), call Retire() and try again.
+	UploadAllocation Allocate(std::uint64_t size, std::uint64_t alignment = ConstantBufferAlignment);
+
+	// Allocates a constant buffer (size rounded up to 256 bytes) and copies data into it.
+	template<typename T>
+	UploadAllocation AllocateConstants(const T& data)
+	{
+		UploadAllocation alloc = Allocate((sizeof(T) + 255) & ~255);
+		if(alloc.IsValid())
+			std::memcpy(alloc.CpuAddress, &data, sizeof(T));
+
+		return alloc;
+	}
+
+	// Closes the current frame; its allocations stay in use until Retire() sees a
+	// completed fence value >= fenceValue.
+	void FinishFrame(std::uint64_t fenceValue);
+
+	// Frees the memory of every finished frame whose fence has completed.
+	void Retire(std::uint64_t completedFenceValue);
+
+	bool HasPendingFrames()const;
+
+	// Fence value of the oldest frame still holding memory, or 0 if there is none.
+	std::uint64_t GetOldestPendingFence()const;
+
+	std::uint64_t GetCapacity()const;
+
+	// Bytes in use, including alignment padding and space skipped at the end of the ring.
+	std::uint64_t GetUsedBytes()const;
+
+	// Bytes allocated since the last FinishFrame().
+	std::uint64_t GetFrameBytes()const;
+
+private:
+	struct PendingFrame
+	{
+		std::uint64_t Fence;
+		std::uint64_t Bytes;
+	};
+
+	UploadRingMemory* mMemory = nullptr;
+	std::uint64_t mCapacity = 0;
+
+	// Allocations are made at mHead; the oldest memory still in use starts at mTail.
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+	std::uint64_t mUsed = 0;
+
+	std::uint64_t mFrameBytes = 0;
+	std::deque<PendingFrame> mPendingFrames;
+};
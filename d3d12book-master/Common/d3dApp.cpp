@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "d3dApp.h"
+#include "D3D12FenceBackend.h"
 #include <WindowsX.h>
 
 using Microsoft::WRL::ComPtr;
@@ -75,6 +76,12 @@ int D3DApp::Run()
  
 	mTimer.Reset();
 
+	mFrameStatsCsv.open("FrameStats.csv", std::ios::trunc);
+	if(mFrameStatsCsv)
+		frame_stats::write_csv_header(mFrameStatsCsv);
+
+	PROFILE_THREAD_NAME("Main");
+
 	while(msg.message != WM_QUIT)
 	{
 		// If there are Window messages then process them.
@@ -90,9 +97,21 @@ int D3DApp::Run()
 
 			if( !mAppPaused )
 			{
+				PROFILE_SCOPE("Frame");
+
+				// One query per fence per frame; the frame's waits and retirements
+				// read the cached values.
+				mFenceTracker->Refresh();
+
 				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
+				{
+					PROFILE_SCOPE("Update");
+					Update(mTimer);
+				}
+				{
+					PROFILE_SCOPE("Draw");
+					Draw(mTimer);
+				}
 			}
 			else
 			{
@@ -101,6 +120,10 @@ int D3DApp::Run()
         }
     }
 
+	std::ofstream frameStatsJson("FrameStats.json", std::ios::trunc);
+	if(frameStatsJson)
+		mFrameStats.write_json(frameStatsJson);
+
 	return (int)msg.wParam;
 }
 
@@ -365,6 +388,8 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else if((int)wParam == VK_F3)
+            ToggleProfilerCapture();
 
         return 0;
 	}
@@ -446,6 +471,10 @@ bool D3DApp::InitDirect3D()
 	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE,
 		IID_PPV_ARGS(&mFence)));
 
+	ID3D12Fence* fences[] = { mFence.Get() };
+	mFenceTracker = std::make_unique<FenceTracker>(
+		std::make_unique<D3D12FenceBackend>(fences, _countof(fences)));
+
 	mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	mCbvSrvUavDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -542,17 +571,12 @@ void D3DApp::FlushCommandQueue()
     ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
 
 	// Wait until the GPU has completed commands up to this fence point.
-    if(mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-
-        // Fire event when GPU hits current fence.  
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
+	WaitForFence(mCurrentFence);
+}
 
-        // Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-	}
+void D3DApp::WaitForFence(UINT64 fenceValue)
+{
+	mFenceTracker->Wait(0, fenceValue);
 }
 
 ID3D12Resource* D3DApp::CurrentBackBuffer()const
@@ -575,36 +599,52 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView()const
 
 void D3DApp::CalculateFrameStats()
 {
-	// Code computes the average frames per second, and also the 
-	// average time it takes to render one frame.  These stats 
-	// are appended to the window caption bar.
-    
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	// The mean hides hitches, so the caption also shows the 99th percentile of the
+	// frame times over the last second.
+	mFrameStats.add_frame(mTimer.DeltaTime());
 
-	frameCnt++;
-
-	// Compute averages over one second period.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
+	frame_time_summary summary;
+	if(mFrameStats.collect(mTimer.TotalTime(), summary))
 	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
-		float mspf = 1000.0f / fps;
-
-        wstring fpsStr = to_wstring(fps);
-        wstring mspfStr = to_wstring(mspf);
-
         wstring windowText = mMainWndCaption +
-            L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"    fps: " + to_wstring(summary.fps) +
+            L"   mspf: " + to_wstring(summary.mean_ms) +
+            L"   p99: " + to_wstring(summary.p99_ms);
+        AppendFrameStats(windowText);
 
         SetWindowText(mhMainWnd, windowText.c_str());
-		
-		// Reset for next average.
-		frameCnt = 0;
-		timeElapsed += 1.0f;
+
+		if(mFrameStatsCsv)
+		{
+			mFrameStats.write_interval_csv(mFrameStatsCsv);
+			mFrameStatsCsv.flush();
+		}
 	}
 }
 
+void D3DApp::ToggleProfilerCapture()
+{
+#if PROFILER_ENABLED
+	if(!Profiler::IsCapturing())
+	{
+		Profiler::BeginCapture();
+		::OutputDebugStringA("Profiler capture started.\n");
+		return;
+	}
+
+	Profiler::EndCapture();
+
+	ProfilerStats stats = Profiler::GetStats();
+	bool saved = Profiler::SaveChromeTrace("ProfileTrace.json");
+
+	char text[256];
+	sprintf_s(text, "Profiler capture: %u threads, %llu scopes, %llu dropped, %s\n",
+		stats.ThreadCount, (unsigned long long)stats.EventCount, (unsigned long long)stats.DroppedCount,
+		saved ? "written to ProfileTrace.json" : "could not write ProfileTrace.json");
+	::OutputDebugStringA(text);
+#endif
+}
+
 void D3DApp::LogAdapters()
 {
     UINT i = 0;
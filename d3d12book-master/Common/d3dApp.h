@@ -11,6 +11,10 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FenceTracker.h"
+#include "Profiler.h"
+// From d3d_application; the projects add its directory to the include path.
+#include "frame_stats.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib, "d3dcompiler.lib")
@@ -53,6 +57,10 @@ protected:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
 
+	// Called with the window caption once a second, for the app to add its own stats.
+	// Timings of their own (e.g. GPU passes) go into mFrameStats as extra series.
+	virtual void AppendFrameStats(std::wstring& text){ }
+
 protected:
 
 	bool InitMainWindow();
@@ -62,12 +70,20 @@ protected:
 
 	void FlushCommandQueue();
 
+	// Returns once the GPU has reached fenceValue on mFence.
+	void WaitForFence(UINT64 fenceValue);
+
 	ID3D12Resource* CurrentBackBuffer()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView()const;
 
+	// Feeds the frame time to mFrameStats and, once a second, puts the interval's fps,
+	// mean and 99th percentile in the caption and every series in FrameStats.csv.
 	void CalculateFrameStats();
 
+	// F3 starts a profiler capture, and pressed again writes it to ProfileTrace.json.
+	void ToggleProfilerCapture();
+
     void LogAdapters();
     void LogAdapterOutputs(IDXGIAdapter* adapter);
     void LogOutputDisplayModes(IDXGIOutput* output, DXGI_FORMAT format);
@@ -90,6 +106,11 @@ protected:
 
 	// Used to keep track of the delta-time?and game time (?.4).
 	GameTimer mTimer;
+
+	// Frame time percentiles (series 0) and any series the app adds.  The whole run is
+	// written to FrameStats.json when Run() returns.
+	frame_stats mFrameStats;
+	std::ofstream mFrameStatsCsv;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
@@ -97,6 +118,7 @@ protected:
 
     Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
     UINT64 mCurrentFence = 0;
+	std::unique_ptr<FenceTracker> mFenceTracker;
 	
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
@@ -5,6 +5,71 @@
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+    // ID3DBlob over a mapped file, so LoadBinary hands out the file's pages instead
+    // of a copy of them.
+    //
+    // READ-ONLY: ID3DBlob::GetBufferPointer() returns a writable LPVOID, but the pages
+    // behind it are mapped read-only and writing through it is an access violation.
+    // Copy the bytes out first if they have to be modified.
+    class MappedFileBlob : public ID3DBlob
+    {
+    public:
+        explicit MappedFileBlob(MappedFile&& file)
+            : mFile(std::move(file))
+        {
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if(object == nullptr)
+                return E_POINTER;
+
+            if(riid == __uuidof(IUnknown) || riid == __uuidof(ID3D10Blob))
+            {
+                *object = static_cast<ID3DBlob*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return (ULONG)InterlockedIncrement(&mRefCount);
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            LONG refCount = InterlockedDecrement(&mRefCount);
+            if(refCount == 0)
+                delete this;
+            return (ULONG)refCount;
+        }
+
+        LPVOID STDMETHODCALLTYPE GetBufferPointer() override
+        {
+            // The interface wants LPVOID; the pointer is still read-only (see above).
+            return const_cast<std::uint8_t*>(mFile.GetData());
+        }
+
+        SIZE_T STDMETHODCALLTYPE GetBufferSize() override
+        {
+            return (SIZE_T)mFile.GetSize();
+        }
+
+    private:
+        ~MappedFileBlob() = default;
+
+    private:
+        MappedFile mFile;
+        LONG mRefCount = 1;
+    };
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -18,19 +83,21 @@ bool d3dUtil::IsKeyDown(int vkeyCode)
     return (GetAsyncKeyState(vkeyCode) & 0x8000) != 0;
 }
 
-ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
+ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename, MappedFileHint hint)
 {
-    std::ifstream fin(filename, std::ios::binary);
+    MappedFile file;
+    if(!file.Open(filename, hint))
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        ThrowIfFailed(FAILED(hr) ? hr : E_FAIL);
+    }
 
-    fin.seekg(0, std::ios_base::end);
-    std::ifstream::pos_type size = (int)fin.tellg();
-    fin.seekg(0, std::ios_base::beg);
+    // Read the file here rather than in page faults on whichever thread first uses
+    // the blob, so loading from a worker really takes the I/O off the caller.
+    file.Load();
 
     ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
-
-    fin.read((char*)blob->GetBufferPointer(), size);
-    fin.close();
+    blob.Attach(new MappedFileBlob(std::move(file)));
 
     return blob;
 }
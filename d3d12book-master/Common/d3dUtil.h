@@ -28,6 +28,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "MappedFile.h"
 
 extern const int gNumFrameResources;
 
@@ -60,6 +61,13 @@ inline std::wstring AnsiToWString(const std::string& str)
     return std::wstring(buffer);
 }
 
+inline std::string WStringToAnsi(const std::wstring& str)
+{
+    char buffer[512];
+    WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, buffer, 512, nullptr, nullptr);
+    return std::string(buffer);
+}
+
 /*
 #if defined(_DEBUG)
     #ifndef Assert
@@ -112,7 +120,11 @@ public:
         return (byteSize + 255) & ~255;
     }
 
-    static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
+    // The blob is backed by a mapping of the file, not a copy, and the file is read
+    // in before this returns.  The mapping is READ-ONLY: never write through
+    // GetBufferPointer(), copy the data out if it has to change.
+    static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename,
+        MappedFileHint hint = MappedFileHint::Sequential);
 
     static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
         ID3D12Device* device,
@@ -0,0 +1,45 @@
+//***************************************************************************************
+// Check.h
+//
+// The few macros the tests in this directory need.  Every test is an executable
+// whose main() calls its test cases through RUN_TEST and returns TestResult(), which
+// is non-zero once any CHECK has failed, so ctest reports it.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+
+inline int& TestFailureCount()
+{
+	static int count = 0;
+	return count;
+}
+
+inline int TestResult()
+{
+	if(TestFailureCount() > 0)
+		std::printf("%d check(s) failed\n", TestFailureCount());
+
+	return TestFailureCount() > 0 ? 1 : 0;
+}
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if(!(expr)) \
+		{ \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			++TestFailureCount(); \
+		} \
+	} \
+	while(false)
+
+#define RUN_TEST(test) \
+	do \
+	{ \
+		int failuresBefore = TestFailureCount(); \
+		test(); \
+		std::printf("%-48s %s\n", #test, TestFailureCount() == failuresBefore ? "passed" : "FAILED"); \
+	} \
+	while(false)
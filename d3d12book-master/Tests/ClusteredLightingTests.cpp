@@ -0,0 +1,296 @@
+//***************************************************************************************
+// ClusteredLightingTests.cpp
+//
+// Most cases use the identity view matrix, so the lights are given in view space.  A
+// point's cluster is found the way the shader finds it: the slice from the log of its
+// depth, the tile from its projected position.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/ClusteredLighting.h"
+#include "Common/ThreadPool.h"
+#include "Common/UploadRing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const float FovY = 0.25f*XM_PI;
+	const float Aspect = 16.0f / 9.0f;
+	const float NearZ = 1.0f;
+	const float FarZ = 100.0f;
+
+	// Clusters whose list holds each light.
+	std::vector<std::vector<std::uint32_t>> GetLightClusters(const ClusteredLightBuilder& builder, std::uint32_t lightCount)
+	{
+		std::vector<std::vector<std::uint32_t>> clusters(lightCount);
+
+		const auto& ranges = builder.GetClusterRanges();
+		const auto& indices = builder.GetLightIndices();
+		for(std::uint32_t c = 0; c < (std::uint32_t)ranges.size(); ++c)
+		{
+			for(std::uint32_t i = 0; i < ranges[c].Count; ++i)
+				clusters[indices[ranges[c].Offset + i]].push_back(c);
+		}
+
+		return clusters;
+	}
+
+	// Returns false if the view space point is outside the frustum.
+	bool FindCluster(const ClusteredLightBuilder& builder, const XMFLOAT3& p, std::uint32_t& cluster)
+	{
+		if(p.z < NearZ || p.z >= FarZ)
+			return false;
+
+		float tanHalfFovY = std::tan(0.5f*FovY);
+		float ndcX = p.x / (p.z*tanHalfFovY*Aspect);
+		float ndcY = p.y / (p.z*tanHalfFovY);
+		if(std::fabs(ndcX) >= 1.0f || std::fabs(ndcY) >= 1.0f)
+			return false;
+
+		float slice = std::floor(std::log2(p.z)*builder.GetSliceScale() + builder.GetSliceBias());
+		float x = std::floor((ndcX + 1.0f)*0.5f*(float)builder.GetTilesX());
+		float y = std::floor((1.0f - ndcY)*0.5f*(float)builder.GetTilesY());
+
+		cluster = builder.GetClusterIndex((std::uint32_t)x, (std::uint32_t)y,
+			std::min((std::uint32_t)slice, builder.GetSliceCount() - 1));
+		return true;
+	}
+
+	// View space bounding box of a cluster, from the eight corners of its cell.
+	BoundingBox GetClusterBounds(const ClusteredLightBuilder& builder, std::uint32_t cluster)
+	{
+		std::uint32_t tilesX = builder.GetTilesX();
+		std::uint32_t tilesY = builder.GetTilesY();
+		std::uint32_t x = cluster % tilesX;
+		std::uint32_t y = (cluster / tilesX) % tilesY;
+		std::uint32_t slice = cluster / (tilesX*tilesY);
+
+		float tanHalfFovY = std::tan(0.5f*FovY);
+		float depths[2] =
+		{
+			NearZ*std::pow(FarZ / NearZ, (float)slice / (float)builder.GetSliceCount()),
+			NearZ*std::pow(FarZ / NearZ, (float)(slice + 1) / (float)builder.GetSliceCount())
+		};
+		float ndcX[2] = { -1.0f + 2.0f*x / tilesX, -1.0f + 2.0f*(x + 1) / tilesX };
+		float ndcY[2] = { 1.0f - 2.0f*(y + 1) / tilesY, 1.0f - 2.0f*y / tilesY };
+
+		XMVECTOR lo = XMVectorReplicate(1e30f);
+		XMVECTOR hi = XMVectorReplicate(-1e30f);
+		for(float z : depths)
+		{
+			for(float nx : ndcX)
+			{
+				for(float ny : ndcY)
+				{
+					XMVECTOR corner = XMVectorSet(nx*z*tanHalfFovY*Aspect, ny*z*tanHalfFovY, z, 0.0f);
+					lo = XMVectorMin(lo, corner);
+					hi = XMVectorMax(hi, corner);
+				}
+			}
+		}
+
+		BoundingBox box;
+		BoundingBox::CreateFromPoints(box, lo, hi);
+		return box;
+	}
+
+	bool SphereTouchesBox(const BoundingSphere& sphere, const BoundingBox& box)
+	{
+		float c[3] = { sphere.Center.x, sphere.Center.y, sphere.Center.z };
+		float bc[3] = { box.Center.x, box.Center.y, box.Center.z };
+		float be[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+
+		float d2 = 0.0f;
+		for(int i = 0; i < 3; ++i)
+		{
+			float d = std::max(0.0f, std::fabs(c[i] - bc[i]) - be[i]);
+			d2 += d*d;
+		}
+
+		// A little slack for rounding in the box corners.
+		float r = sphere.Radius*1.0001f + 1e-4f;
+		return d2 <= r*r;
+	}
+
+	std::vector<BoundingSphere> MakeLights(std::uint32_t count, std::uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> xy(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> z(-5.0f, 110.0f);
+		std::uniform_real_distribution<float> radius(0.2f, 8.0f);
+
+		std::vector<BoundingSphere> lights(count);
+		for(auto& light : lights)
+			light = BoundingSphere(XMFLOAT3(xy(rng), xy(rng), z(rng)), radius(rng));
+
+		return lights;
+	}
+
+	void BinsSmallLightsExactly()
+	{
+		ClusteredLightBuilder builder(nullptr);
+		builder.SetLens(FovY, Aspect, NearZ, FarZ);
+
+		// A light in the middle of cluster (5, 3, 10), one on the boundary between
+		// tiles 7 and 8 (ndc x = 0), and one behind the camera.
+		float sliceNear = NearZ*std::pow(FarZ / NearZ, 10.0f / 24.0f);
+		float sliceFar = NearZ*std::pow(FarZ / NearZ, 11.0f / 24.0f);
+		float z = 0.5f*(sliceNear + sliceFar);
+		float tanHalfFovY = std::tan(0.5f*FovY);
+		float ndcX = -1.0f + 2.0f*5.5f / 16.0f;
+		float ndcY = 1.0f - 2.0f*3.5f / 9.0f;
+
+		BoundingSphere lights[3] =
+		{
+			BoundingSphere(XMFLOAT3(ndcX*z*tanHalfFovY*Aspect, ndcY*z*tanHalfFovY, z), 0.01f),
+			BoundingSphere(XMFLOAT3(0.0f, ndcY*z*tanHalfFovY, z), 0.01f),
+			BoundingSphere(XMFLOAT3(0.0f, 0.0f, -5.0f), 2.0f)
+		};
+		builder.Build(XMMatrixIdentity(), lights, 3);
+
+		auto clusters = GetLightClusters(builder, 3);
+		CHECK(clusters[0] == std::vector<std::uint32_t>{ builder.GetClusterIndex(5, 3, 10) });
+		CHECK((clusters[1] == std::vector<std::uint32_t>{ builder.GetClusterIndex(7, 3, 10), builder.GetClusterIndex(8, 3, 10) }));
+		CHECK(clusters[2].empty());
+		CHECK(builder.GetLightIndices().size() == 3);
+	}
+
+	void BinsLightsIntoClustersTheyOverlap()
+	{
+		ClusteredLightBuilder builder(nullptr);
+		builder.SetLens(FovY, Aspect, NearZ, FarZ);
+
+		const std::uint32_t lightCount = 300;
+		std::vector<BoundingSphere> lights = MakeLights(lightCount, 7);
+		builder.Build(XMMatrixIdentity(), lights.data(), lightCount);
+
+		auto clusters = GetLightClusters(builder, lightCount);
+
+		// Every point of a light's sphere inside the frustum lies in one of its
+		// clusters, and every one of its clusters is close enough for the sphere to
+		// reach the cluster's bounding box.
+		std::mt19937 rng(8);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		bool coversSphere = true;
+		bool touchesClusters = true;
+		std::uint32_t sampled = 0;
+		for(std::uint32_t i = 0; i < lightCount; ++i)
+		{
+			const BoundingSphere& light = lights[i];
+			for(int s = 0; s < 400; ++s)
+			{
+				XMFLOAT3 d(unit(rng), unit(rng), unit(rng));
+				if(d.x*d.x + d.y*d.y + d.z*d.z > 1.0f)
+					continue;
+
+				XMFLOAT3 p(light.Center.x + d.x*light.Radius, light.Center.y + d.y*light.Radius,
+					light.Center.z + d.z*light.Radius);
+
+				std::uint32_t cluster;
+				if(!FindCluster(builder, p, cluster))
+					continue;
+
+				coversSphere &= std::binary_search(clusters[i].begin(), clusters[i].end(), cluster);
+				++sampled;
+			}
+
+			for(std::uint32_t cluster : clusters[i])
+				touchesClusters &= SphereTouchesBox(light, GetClusterBounds(builder, cluster));
+		}
+
+		CHECK(coversSphere);
+		CHECK(touchesClusters);
+		CHECK(sampled > 10000);
+
+		// A light's list entries stay in light order within every cluster.
+		bool sorted = true;
+		const auto& ranges = builder.GetClusterRanges();
+		const auto& indices = builder.GetLightIndices();
+		for(const auto& range : ranges)
+			sorted &= std::is_sorted(indices.begin() + range.Offset, indices.begin() + range.Offset + range.Count);
+		CHECK(sorted);
+	}
+
+	void ParallelBuildMatchesSerial()
+	{
+		ThreadPool pool(3);
+
+		ClusteredLightBuilder serial(nullptr);
+		ClusteredLightBuilder parallel(&pool);
+		serial.SetLens(FovY, Aspect, NearZ, FarZ);
+		parallel.SetLens(FovY, Aspect, NearZ, FarZ);
+
+		const std::uint32_t lightCount = 500;
+		std::vector<BoundingSphere> lights = MakeLights(lightCount, 21);
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(5.0f, 3.0f, -10.0f, 1.0f),
+			XMVectorSet(0.0f, 0.0f, 40.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+		for(int frame = 0; frame < 3; ++frame)
+		{
+			serial.Build(view, lights.data(), lightCount - 100*frame);
+			parallel.Build(view, lights.data(), lightCount - 100*frame);
+
+			const auto& a = serial.GetClusterRanges();
+			const auto& b = parallel.GetClusterRanges();
+			CHECK(a.size() == b.size());
+			CHECK(std::memcmp(a.data(), b.data(), a.size()*sizeof(ClusterRange)) == 0);
+			CHECK(serial.GetLightIndices() == parallel.GetLightIndices());
+			CHECK(!serial.GetLightIndices().empty());
+		}
+	}
+
+	void UploadWritesShaderLayout()
+	{
+		ClusteredLightBuilder builder(nullptr, 4, 2, 3);
+		builder.SetLens(FovY, Aspect, NearZ, FarZ);
+
+		std::vector<BoundingSphere> lights = MakeLights(20, 3);
+		builder.Build(XMMatrixIdentity(), lights.data(), 20);
+
+		SystemUploadRingMemory memory(64*1024);
+		UploadRing ring(&memory);
+		ring.Allocate(4);
+
+		std::uint32_t count = builder.GetBufferElementCount();
+		UploadAllocation alloc = builder.Upload(ring);
+		CHECK(alloc.IsValid());
+		CHECK(alloc.Offset % UploadRing::ConstantBufferAlignment == 0);
+		CHECK(alloc.Size >= count*sizeof(std::uint32_t));
+
+		// Two uints per cluster, then the light index list.
+		const std::uint32_t* words = reinterpret_cast<const std::uint32_t*>(alloc.CpuAddress);
+		const auto& ranges = builder.GetClusterRanges();
+		const auto& indices = builder.GetLightIndices();
+		CHECK(count == 2*builder.GetClusterCount() + indices.size());
+
+		bool sameRanges = true;
+		for(std::uint32_t c = 0; c < builder.GetClusterCount(); ++c)
+			sameRanges &= words[2*c] == ranges[c].Offset && words[2*c + 1] == ranges[c].Count;
+		CHECK(sameRanges);
+		CHECK(std::equal(indices.begin(), indices.end(), words + 2*builder.GetClusterCount()));
+
+		// A full ring gives an invalid allocation and writes nothing.
+		SystemUploadRingMemory small(16);
+		UploadRing smallRing(&small);
+		CHECK(!builder.Upload(smallRing).IsValid());
+	}
+}
+
+int main()
+{
+	RUN_TEST(BinsSmallLightsExactly);
+	RUN_TEST(BinsLightsIntoClustersTheyOverlap);
+	RUN_TEST(ParallelBuildMatchesSerial);
+	RUN_TEST(UploadWritesShaderLayout);
+
+	return TestResult();
+}
@@ -0,0 +1,173 @@
+//***************************************************************************************
+// CoherentFrustumCullerTests.cpp
+//
+// The instances are a grid of unit boxes around the camera, as in
+// InstancingAndCullingApp.  Every frame CullInstances runs once with the culler and
+// once without it, and both must find the same instances visible.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Chapter 16 Instancing and Frustum Culling/InstancingAndCulling/CoherentFrustumCuller.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Scene
+	{
+		BoundingBox LocalBounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+		std::vector<XMFLOAT4X4> Worlds;
+		BoundingFrustum ViewFrustum;
+		XMFLOAT4X4 Proj;
+	};
+
+	void BuildScene(Scene& scene, CoherentFrustumCuller& culler)
+	{
+		const int n = 12;
+		for(int k = 0; k < n; ++k)
+		{
+			for(int i = 0; i < n; ++i)
+			{
+				for(int j = 0; j < n; ++j)
+				{
+					scene.Worlds.emplace_back();
+					XMStoreFloat4x4(&scene.Worlds.back(),
+						XMMatrixTranslation(-33.0f + 6.0f*j, -33.0f + 6.0f*i, -33.0f + 6.0f*k));
+				}
+			}
+		}
+
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*XM_PI, 800.0f / 600.0f, 1.0f, 60.0f);
+		XMStoreFloat4x4(&scene.Proj, proj);
+		BoundingFrustum::CreateFromMatrix(scene.ViewFrustum, proj);
+
+		BoundingSphere localSphere;
+		BoundingSphere::CreateFromBoundingBox(localSphere, scene.LocalBounds);
+
+		culler.Reset((std::uint32_t)scene.Worlds.size());
+		for(std::uint32_t i = 0; i < culler.GetInstanceCount(); ++i)
+		{
+			BoundingSphere worldSphere;
+			localSphere.Transform(worldSphere, XMLoadFloat4x4(&scene.Worlds[i]));
+			culler.SetInstanceBounds(i, worldSphere);
+		}
+	}
+
+	// Culls one frame both ways; returns false if the answers differ.
+	bool CullFrame(const Scene& scene, CoherentFrustumCuller& culler, FXMMATRIX view,
+		std::vector<std::uint32_t>& visible)
+	{
+		XMVECTOR viewDet = XMMatrixDeterminant(view);
+		XMMATRIX invView = XMMatrixInverse(&viewDet, view);
+		auto getWorld = [&scene](std::uint32_t i) -> const XMFLOAT4X4& { return scene.Worlds[i]; };
+		std::uint32_t count = (std::uint32_t)scene.Worlds.size();
+
+		std::vector<std::uint32_t> exact;
+		CullInstances(nullptr, scene.ViewFrustum, invView, scene.LocalBounds, count, getWorld, exact);
+
+		culler.BeginFrame(view, XMLoadFloat4x4(&scene.Proj));
+		CullInstances(&culler, scene.ViewFrustum, invView, scene.LocalBounds, count, getWorld, visible);
+
+		return visible == exact;
+	}
+
+	void MatchesExactTestUnderMovingCamera()
+	{
+		Scene scene;
+		CoherentFrustumCuller culler;
+		BuildScene(scene, culler);
+
+		const std::uint32_t count = culler.GetInstanceCount();
+		const XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+		bool sameAnswers = true;
+		bool countersAddUp = true;
+		std::uint32_t skipped = 0;
+		std::uint32_t visibleTotal = 0;
+		std::vector<std::uint32_t> visible;
+		for(int frame = 0; frame < 400; ++frame)
+		{
+			// Turns and walks, pitches a little, and teleports once.
+			float yaw = 0.01f*frame;
+			float pitch = 0.3f*std::sin(0.02f*frame);
+			XMVECTOR pos = XMVectorSet(0.05f*frame - 10.0f, 2.0f*std::sin(0.03f*frame), 0.0f, 1.0f);
+			if(frame >= 250)
+				pos = XMVectorAdd(pos, XMVectorSet(0.0f, 0.0f, 20.0f, 0.0f));
+
+			XMVECTOR look = XMVectorSet(std::cos(pitch)*std::sin(yaw), std::sin(pitch), std::cos(pitch)*std::cos(yaw), 0.0f);
+			XMMATRIX view = XMMatrixLookToLH(pos, look, up);
+
+			sameAnswers &= CullFrame(scene, culler, view, visible);
+
+			const CoherentCullingStats& stats = culler.GetStats();
+			countersAddUp &= stats.Tested + stats.Skipped == count;
+			countersAddUp &= stats.Visible == visible.size();
+			skipped += stats.Skipped;
+			visibleTotal += stats.Visible;
+		}
+
+		CHECK(sameAnswers);
+		CHECK(countersAddUp);
+
+		// The cache is used and the camera sees something.
+		CHECK(skipped > 100*count);
+		CHECK(visibleTotal > 0);
+	}
+
+	void RetestsAfterMaxSkipFrames()
+	{
+		Scene scene;
+		CoherentFrustumCuller culler;
+		BuildScene(scene, culler);
+
+		const std::uint32_t count = culler.GetInstanceCount();
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 0.0f, -3.0f, 1.0f),
+			XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+		// A still camera tests everything once, then only what straddles a plane until
+		// the cached results are MaxSkipFrames old.
+		std::vector<std::uint32_t> visible;
+		CHECK(CullFrame(scene, culler, view, visible));
+		CHECK(culler.GetStats().Tested == count);
+
+		std::uint32_t straddling = 0;
+		for(std::uint32_t frame = 1; frame < CoherentFrustumCuller::MaxSkipFrames; ++frame)
+		{
+			CHECK(CullFrame(scene, culler, view, visible));
+			straddling = culler.GetStats().Tested;
+			CHECK(culler.GetStats().Skipped > 0);
+		}
+		CHECK(straddling < count);
+
+		CHECK(CullFrame(scene, culler, view, visible));
+		CHECK(culler.GetStats().Tested == count);
+
+		// Setting an instance's bounds or invalidating forgets the cached results.
+		CHECK(CullFrame(scene, culler, view, visible));
+		CHECK(culler.GetStats().Tested == straddling);
+
+		BoundingSphere localSphere;
+		BoundingSphere::CreateFromBoundingBox(localSphere, scene.LocalBounds);
+		BoundingSphere worldSphere;
+		localSphere.Transform(worldSphere, XMLoadFloat4x4(&scene.Worlds[0]));
+		culler.SetInstanceBounds(0, worldSphere);
+		CHECK(CullFrame(scene, culler, view, visible));
+		CHECK(culler.GetStats().Tested == straddling + 1);
+
+		culler.Invalidate();
+		CHECK(CullFrame(scene, culler, view, visible));
+		CHECK(culler.GetStats().Tested == count);
+	}
+}
+
+int main()
+{
+	RUN_TEST(MatchesExactTestUnderMovingCamera);
+	RUN_TEST(RetestsAfterMaxSkipFrames);
+
+	return TestResult();
+}
@@ -0,0 +1,333 @@
+//***************************************************************************************
+// CubeFaceCullerTests.cpp
+//
+// The reference is six separate frustum tests, one per face camera built the way
+// DynamicCubeMapApp::BuildCubeFaceCamera builds them, against each item's bounding
+// sphere.  Like the culler, it ignores the near planes.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Chapter 18 Cube Mapping/DynamicCube/CubeFaceCuller.h"
+#include "Common/Camera.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const XMFLOAT3 Center(0.0f, 2.0f, 0.0f);
+	const float FarZ = 50.0f;
+
+	struct FaceFrustums
+	{
+		// Left, right, bottom, top and far planes of every face, normals pointing in.
+		XMFLOAT4 Planes[CubeFaceCuller::FaceCount][5];
+
+		FaceFrustums()
+		{
+			const XMFLOAT3 targets[6] =
+			{
+				XMFLOAT3(Center.x + 1.0f, Center.y, Center.z),
+				XMFLOAT3(Center.x - 1.0f, Center.y, Center.z),
+				XMFLOAT3(Center.x, Center.y + 1.0f, Center.z),
+				XMFLOAT3(Center.x, Center.y - 1.0f, Center.z),
+				XMFLOAT3(Center.x, Center.y, Center.z + 1.0f),
+				XMFLOAT3(Center.x, Center.y, Center.z - 1.0f)
+			};
+			const XMFLOAT3 ups[6] =
+			{
+				XMFLOAT3(0.0f, 1.0f, 0.0f),
+				XMFLOAT3(0.0f, 1.0f, 0.0f),
+				XMFLOAT3(0.0f, 0.0f, -1.0f),
+				XMFLOAT3(0.0f, 0.0f, +1.0f),
+				XMFLOAT3(0.0f, 1.0f, 0.0f),
+				XMFLOAT3(0.0f, 1.0f, 0.0f)
+			};
+
+			for(int face = 0; face < 6; ++face)
+			{
+				Camera camera;
+				camera.LookAt(Center, targets[face], ups[face]);
+				camera.SetLens(0.5f*XM_PI, 1.0f, 0.1f, FarZ);
+				camera.UpdateViewMatrix();
+
+				XMMATRIX T = XMMatrixTranspose(XMMatrixMultiply(camera.GetView(), camera.GetProj()));
+				XMVECTOR planes[5] =
+				{
+					XMVectorAdd(T.r[3], T.r[0]),
+					XMVectorSubtract(T.r[3], T.r[0]),
+					XMVectorAdd(T.r[3], T.r[1]),
+					XMVectorSubtract(T.r[3], T.r[1]),
+					XMVectorSubtract(T.r[3], T.r[2])
+				};
+
+				for(int i = 0; i < 5; ++i)
+					XMStoreFloat4(&Planes[face][i], XMPlaneNormalize(planes[i]));
+			}
+		}
+
+		// Sets onBoundary if the sphere touches a plane within rounding error, where the
+		// two ways of testing may disagree.
+		std::uint8_t Mask(const BoundingBox& localBounds, const XMFLOAT4X4& world, bool* onBoundary = nullptr)const
+		{
+			BoundingSphere localSphere;
+			BoundingSphere::CreateFromBoundingBox(localSphere, localBounds);
+			BoundingSphere sphere;
+			localSphere.Transform(sphere, XMLoadFloat4x4(&world));
+
+			XMVECTOR center = XMVectorSetW(XMLoadFloat3(&sphere.Center), 1.0f);
+
+			std::uint8_t mask = 0;
+			for(int face = 0; face < 6; ++face)
+			{
+				bool inside = true;
+				for(int i = 0; i < 5; ++i)
+				{
+					float d = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&Planes[face][i]), center)) + sphere.Radius;
+					inside &= d >= 0.0f;
+					if(onBoundary != nullptr && std::fabs(d) < 1e-3f)
+						*onBoundary = true;
+				}
+
+				if(inside)
+					mask |= 1 << face;
+			}
+
+			return mask;
+		}
+	};
+
+	XMFLOAT4X4 Translation(float x, float y, float z)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixTranslation(Center.x + x, Center.y + y, Center.z + z));
+		return world;
+	}
+
+	void MasksMatchSixFrustumTests()
+	{
+		FaceFrustums frustums;
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-80.0f, 80.0f);
+		std::uniform_real_distribution<float> extent(0.1f, 4.0f);
+
+		const std::uint32_t count = 5000;
+		std::vector<BoundingBox> bounds(count);
+		std::vector<XMFLOAT4X4> worlds(count);
+
+		CubeFaceCuller culler;
+		culler.SetCubeCenter(Center, FarZ);
+		culler.Reset(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			bounds[i] = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(extent(rng), extent(rng), extent(rng)));
+			worlds[i] = Translation(position(rng), position(rng), position(rng));
+			culler.SetItem(i, bounds[i], worlds[i]);
+		}
+
+		// Items straddling the diagonals, in the far corners of a face and just past a
+		// far plane.
+		bounds.push_back(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		worlds.push_back(Translation(10.0f, 10.0f, 3.0f));
+		bounds.push_back(bounds.back());
+		worlds.push_back(Translation(45.0f, 40.0f, -38.0f));
+		bounds.push_back(bounds.back());
+		worlds.push_back(Translation(52.0f, 0.0f, 0.0f));
+		culler.Reset((std::uint32_t)bounds.size());
+		for(std::uint32_t i = 0; i < (std::uint32_t)bounds.size(); ++i)
+			culler.SetItem(i, bounds[i], worlds[i]);
+
+		culler.Cull();
+
+		bool masksMatch = true;
+		std::uint32_t compared = 0;
+		std::uint32_t visibleInSeveral = 0;
+		for(std::uint32_t i = 0; i < (std::uint32_t)bounds.size(); ++i)
+		{
+			bool onBoundary = false;
+			std::uint8_t expected = frustums.Mask(bounds[i], worlds[i], &onBoundary);
+			if(onBoundary)
+				continue;
+
+			std::uint8_t mask = culler.GetFaceMask(i);
+			masksMatch &= mask == expected;
+			visibleInSeveral += (mask & (mask - 1)) != 0 ? 1 : 0;
+			++compared;
+		}
+		CHECK(masksMatch);
+		CHECK(compared > count - 10);
+		CHECK(visibleInSeveral > 0);
+
+		std::uint32_t last = (std::uint32_t)bounds.size() - 1;
+		CHECK(culler.GetFaceMask(last - 2) == ((1 << 0) | (1 << 2)));
+		CHECK(culler.GetFaceMask(last - 1) == (1 << 0));
+		CHECK(culler.GetFaceMask(last) == 0);
+
+		// Face lists hold exactly the items whose mask has the face's bit.
+		bool listsMatch = true;
+		for(std::uint32_t face = 0; face < CubeFaceCuller::FaceCount; ++face)
+		{
+			std::vector<std::uint32_t> expected;
+			for(std::uint32_t i = 0; i < (std::uint32_t)bounds.size(); ++i)
+			{
+				if(culler.GetFaceMask(i) & (1u << face))
+					expected.push_back(i);
+			}
+			listsMatch &= culler.GetFaceItems(face) == expected;
+		}
+		CHECK(listsMatch);
+	}
+
+	void RedrawsOnlyChangedFaces()
+	{
+		CubeFaceCuller culler;
+		culler.SetCubeCenter(Center, FarZ);
+		culler.Reset(3);
+
+		const BoundingBox box(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+		culler.SetItem(0, box, Translation(10.0f, 0.0f, 0.0f));  // +X
+		culler.SetItem(1, box, Translation(0.0f, 0.0f, 10.0f));  // +Z
+		culler.SetItem(2, box, Translation(0.0f, -10.0f, 0.0f)); // -Y
+
+		// Everything is drawn once.
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 6);
+		CHECK(culler.GetStats().Classified == 3);
+
+		// Nothing changed: every face keeps its image, even when the same matrices are
+		// set again.
+		culler.SetItem(0, box, Translation(10.0f, 0.0f, 0.0f));
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 0);
+		CHECK(culler.GetStats().Classified == 0);
+
+		// Moving inside +X only redraws +X.
+		culler.SetItem(0, box, Translation(12.0f, 1.0f, 0.0f));
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 1);
+		CHECK(culler.IsFaceDirty(0));
+
+		// Moving from +Z to -Z redraws both.
+		culler.SetItem(1, box, Translation(0.0f, 0.0f, -10.0f));
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 2);
+		CHECK(culler.IsFaceDirty(4) && culler.IsFaceDirty(5));
+		CHECK(culler.GetFaceItems(4).empty());
+		CHECK(culler.GetFaceItems(5).size() == 1);
+
+		// Changing the bounds alone counts as a change.
+		culler.SetItem(2, BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.6f, 0.5f)), Translation(0.0f, -10.0f, 0.0f));
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 1);
+		CHECK(culler.IsFaceDirty(3));
+
+		// Moving where no face sees it before or after redraws nothing.
+		culler.SetItem(2, box, Translation(0.0f, -60.0f, 0.0f));
+		culler.Cull();
+		culler.SetItem(2, box, Translation(0.0f, -70.0f, 0.0f));
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 0);
+		CHECK(culler.GetStats().Classified == 1);
+
+		// Invalidate and a new center redraw everything.
+		culler.Invalidate();
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 6);
+		culler.SetCubeCenter(XMFLOAT3(1.0f, 2.0f, 3.0f), FarZ);
+		culler.Cull();
+		CHECK(culler.GetStats().DirtyFaces == 6);
+		CHECK(culler.GetStats().Classified == 3);
+	}
+
+	void CleanFacesKeepTheirItems()
+	{
+		FaceFrustums frustums;
+
+		std::mt19937 rng(99);
+		std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> nudge(-0.5f, 0.5f);
+		std::uniform_int_distribution<std::uint32_t> pick(0, 99);
+
+		const std::uint32_t count = 100;
+		const BoundingBox box(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+		std::vector<XMFLOAT4X4> worlds(count);
+
+		CubeFaceCuller culler;
+		culler.SetCubeCenter(Center, FarZ);
+		culler.Reset(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			worlds[i] = Translation(position(rng), position(rng), position(rng));
+			culler.SetItem(i, box, worlds[i]);
+		}
+		culler.Cull();
+
+		// A few items move a little every frame.  A face is dirty exactly when one of
+		// them was or is now in it, and every face's list holds the items in it whether
+		// it was rebuilt or not.
+		bool masksMatch = true;
+		bool dirtyMatches = true;
+		bool listsMatch = true;
+		std::uint32_t cleanFaces = 0;
+		std::vector<std::uint8_t> oldMasks(count);
+		for(int frame = 0; frame < 200; ++frame)
+		{
+			for(std::uint32_t i = 0; i < count; ++i)
+				oldMasks[i] = culler.GetFaceMask(i);
+
+			std::vector<std::uint32_t> moved;
+			for(int moves = 0; moves < 2; ++moves)
+			{
+				std::uint32_t i = pick(rng);
+				worlds[i]._41 += nudge(rng);
+				worlds[i]._42 += nudge(rng);
+				worlds[i]._43 += nudge(rng);
+				culler.SetItem(i, box, worlds[i]);
+				moved.push_back(i);
+			}
+			culler.Cull();
+
+			std::uint8_t expectedDirty = 0;
+			for(std::uint32_t i : moved)
+			{
+				bool onBoundary = false;
+				std::uint8_t expected = frustums.Mask(box, worlds[i], &onBoundary);
+				masksMatch &= onBoundary || culler.GetFaceMask(i) == expected;
+				expectedDirty |= oldMasks[i] | culler.GetFaceMask(i);
+			}
+
+			for(std::uint32_t face = 0; face < CubeFaceCuller::FaceCount; ++face)
+			{
+				dirtyMatches &= culler.IsFaceDirty(face) == ((expectedDirty & (1u << face)) != 0);
+				cleanFaces += culler.IsFaceDirty(face) ? 0 : 1;
+
+				std::vector<std::uint32_t> expected;
+				for(std::uint32_t i = 0; i < count; ++i)
+				{
+					if(culler.GetFaceMask(i) & (1u << face))
+						expected.push_back(i);
+				}
+				listsMatch &= culler.GetFaceItems(face) == expected;
+			}
+		}
+
+		CHECK(masksMatch);
+		CHECK(dirtyMatches);
+		CHECK(listsMatch);
+		CHECK(cleanFaces > 0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(MasksMatchSixFrustumTests);
+	RUN_TEST(RedrawsOnlyChangedFaces);
+	RUN_TEST(CleanFacesKeepTheirItems);
+
+	return TestResult();
+}
@@ -0,0 +1,205 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/DescriptorAllocator.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	void AllocatesContiguousRanges()
+	{
+		DescriptorRangeAllocator allocator(100, 64);
+
+		DescriptorRange a = allocator.Allocate(10);
+		DescriptorRange b = allocator.Allocate(20);
+
+		CHECK(a.IsValid() && a.Offset == 100 && a.Count == 10);
+		CHECK(b.IsValid() && b.Offset == 110 && b.Count == 20);
+		CHECK(allocator.GetCapacity() == 64 && allocator.GetFreeCount() == 34);
+
+		CHECK(!allocator.Allocate(0).IsValid());
+		CHECK(!allocator.Allocate(35).IsValid());
+		CHECK(allocator.Allocate(34).IsValid());
+		CHECK(allocator.GetFreeCount() == 0);
+		CHECK(!allocator.Allocate(1).IsValid());
+	}
+
+	void AllocatesTheWholeHeap()
+	{
+		// 1000 rounds up past itself, so this only works through the exact-class search.
+		DescriptorRangeAllocator allocator(0, 1000);
+
+		DescriptorRange all = allocator.Allocate(1000);
+		CHECK(all.IsValid() && all.Offset == 0);
+
+		allocator.Free(all);
+		CHECK(allocator.GetFreeCount() == 1000);
+	}
+
+	void FreeCoalescesWithBothNeighbours()
+	{
+		DescriptorRangeAllocator allocator(0, 30);
+
+		DescriptorRange a = allocator.Allocate(10);
+		DescriptorRange b = allocator.Allocate(10);
+		DescriptorRange c = allocator.Allocate(10);
+
+		// Neither a nor c alone makes room for 20...
+		allocator.Free(a);
+		allocator.Free(c);
+		CHECK(allocator.GetFreeCount() == 20);
+		CHECK(!allocator.Allocate(20).IsValid());
+
+		// ...but freeing b between them merges all three.
+		allocator.Free(b);
+		CHECK(allocator.GetFreeCount() == 30);
+
+		DescriptorRange all = allocator.Allocate(30);
+		CHECK(all.IsValid() && all.Offset == 0);
+	}
+
+	void ReusesFreedRanges()
+	{
+		DescriptorRangeAllocator allocator(0, 64);
+
+		DescriptorRange a = allocator.Allocate(8);
+		DescriptorRange b = allocator.Allocate(8);
+		allocator.Allocate(48);
+
+		allocator.Free(a);
+		DescriptorRange c = allocator.Allocate(8);
+		CHECK(c.Offset == a.Offset);
+
+		// A smaller request splits the freed range and leaves the rest free.
+		allocator.Free(b);
+		DescriptorRange d = allocator.Allocate(3);
+		DescriptorRange e = allocator.Allocate(5);
+		CHECK(d.Offset == b.Offset && e.Offset == b.Offset + 3);
+		CHECK(allocator.GetFreeCount() == 0);
+	}
+
+	// Random allocations and frees checked against a map of which descriptor is in use.
+	void RandomAllocationsNeverOverlap()
+	{
+		const std::uint32_t capacity = 4096;
+		DescriptorRangeAllocator allocator(16, capacity);
+
+		std::mt19937 rng(7);
+		std::vector<bool> used(capacity, false);
+		std::vector<DescriptorRange> live;
+		std::uint32_t usedCount = 0;
+
+		bool overlap = false;
+		bool countsMatch = true;
+		for(int step = 0; step < 20000; ++step)
+		{
+			if(live.empty() || rng() % 3 != 0)
+			{
+				std::uint32_t count = 1 + rng() % ((rng() % 8 == 0) ? 300 : 16);
+				DescriptorRange range = allocator.Allocate(count);
+				if(!range.IsValid())
+					continue;
+
+				for(std::uint32_t i = range.Offset - 16; i < range.Offset - 16 + count; ++i)
+				{
+					overlap |= used[i];
+					used[i] = true;
+				}
+
+				usedCount += count;
+				live.push_back(range);
+			}
+			else
+			{
+				std::size_t index = rng() % live.size();
+				DescriptorRange range = live[index];
+				live[index] = live.back();
+				live.pop_back();
+
+				for(std::uint32_t i = range.Offset - 16; i < range.Offset - 16 + range.Count; ++i)
+					used[i] = false;
+
+				usedCount -= range.Count;
+				allocator.Free(range);
+			}
+
+			countsMatch &= (allocator.GetFreeCount() == capacity - usedCount);
+		}
+
+		CHECK(!overlap);
+		CHECK(countsMatch);
+
+		// Everything back: one block again.
+		for(const DescriptorRange& range : live)
+			allocator.Free(range);
+		CHECK(allocator.GetFreeCount() == capacity);
+		CHECK(allocator.Allocate(capacity).IsValid());
+	}
+
+	void TransientRegionIsReusedPerFrame()
+	{
+		// Three frames of 8 descriptors after 100 persistent ones.
+		TransientDescriptorAllocator allocator(100, 8, 3);
+
+		allocator.BeginFrame(0);
+		DescriptorRange a = allocator.Allocate(5);
+		DescriptorRange b = allocator.Allocate(3);
+		CHECK(a.Offset == 100 && b.Offset == 105);
+		CHECK(!allocator.Allocate(1).IsValid());
+		CHECK(allocator.GetUsedCount() == 8);
+
+		allocator.BeginFrame(1);
+		CHECK(allocator.GetUsedCount() == 0);
+		CHECK(allocator.Allocate(8).Offset == 108);
+
+		allocator.BeginFrame(2);
+		CHECK(allocator.Allocate(2).Offset == 116);
+
+		// Frame resource 0 comes around again and starts from the top of its region.
+		allocator.BeginFrame(0);
+		CHECK(allocator.Allocate(4).Offset == 100);
+
+		CHECK(!allocator.Allocate(0).IsValid());
+		CHECK(!allocator.Allocate(5).IsValid());
+	}
+
+	void CopyBatchMergesAdjacentCopies()
+	{
+		DescriptorCopyBatch batch;
+		CHECK(batch.IsEmpty());
+
+		batch.Add(0, 10, 2);
+		batch.Add(2, 12, 1);   // Continues both source and destination.
+		batch.Add(3, 20, 1);   // Source continues, destination does not.
+		batch.Add(4, 21, 0);   // Nothing to copy.
+		batch.Add(4, 21, 2);
+		batch.Add(9, 23, 1);   // Destination continues, source does not.
+
+		const std::vector<DescriptorCopy>& copies = batch.GetCopies();
+		CHECK(copies.size() == 3);
+		CHECK(copies[0].SrcOffset == 0 && copies[0].DstOffset == 10 && copies[0].Count == 3);
+		CHECK(copies[1].SrcOffset == 3 && copies[1].DstOffset == 20 && copies[1].Count == 3);
+		CHECK(copies[2].SrcOffset == 9 && copies[2].DstOffset == 23 && copies[2].Count == 1);
+
+		batch.Clear();
+		CHECK(batch.IsEmpty());
+	}
+}
+
+int main()
+{
+	RUN_TEST(AllocatesContiguousRanges);
+	RUN_TEST(AllocatesTheWholeHeap);
+	RUN_TEST(FreeCoalescesWithBothNeighbours);
+	RUN_TEST(ReusesFreedRanges);
+	RUN_TEST(RandomAllocationsNeverOverlap);
+	RUN_TEST(TransientRegionIsReusedPerFrame);
+	RUN_TEST(CopyBatchMergesAdjacentCopies);
+
+	return TestResult();
+}
@@ -0,0 +1,218 @@
+//***************************************************************************************
+// DirtySetTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/DirtySet.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Ranges flattened to indices, to compare against plain flags.
+	std::vector<std::uint32_t> ToIndices(const std::vector<DirtyRange>& ranges)
+	{
+		std::vector<std::uint32_t> indices;
+		for(const auto& range : ranges)
+		{
+			for(std::uint32_t i = 0; i < range.Count; ++i)
+				indices.push_back(range.First + i);
+		}
+
+		return indices;
+	}
+
+	bool IsRange(const DirtyRange& range, std::uint32_t first, std::uint32_t count)
+	{
+		return range.First == first && range.Count == count;
+	}
+
+	void StartsAllDirtyInEveryFrameResource()
+	{
+		DirtySet set(100, 3);
+
+		for(std::uint32_t frame = 0; frame < 3; ++frame)
+		{
+			const auto& ranges = set.CollectDirtyRanges(frame);
+			CHECK(ranges.size() == 1 && IsRange(ranges[0], 0, 100));
+			CHECK(set.GetCollectedCount() == 100);
+		}
+
+		for(std::uint32_t frame = 0; frame < 3; ++frame)
+		{
+			CHECK(set.CollectDirtyRanges(frame).empty());
+			CHECK(set.GetCollectedCount() == 0);
+		}
+	}
+
+	void CoalescesContiguousIndices()
+	{
+		DirtySet set(200, 1);
+		set.CollectDirtyRanges(0);
+
+		// Out of order, repeated, and running across the 64-bit word at 64 and 128.
+		const std::uint32_t marks[] = { 5, 3, 4, 4, 10, 63, 65, 64, 127, 128, 129, 199, 3 };
+		for(std::uint32_t index : marks)
+			set.MarkDirty(index);
+
+		const auto& ranges = set.CollectDirtyRanges(0);
+		CHECK(ranges.size() == 5);
+		if(ranges.size() == 5)
+		{
+			CHECK(IsRange(ranges[0], 3, 3));
+			CHECK(IsRange(ranges[1], 10, 1));
+			CHECK(IsRange(ranges[2], 63, 3));
+			CHECK(IsRange(ranges[3], 127, 3));
+			CHECK(IsRange(ranges[4], 199, 1));
+		}
+		CHECK(set.GetCollectedCount() == 11);
+	}
+
+	void StaysDirtyUntilEveryFrameResourceSawIt()
+	{
+		DirtySet set(50, 3);
+		for(std::uint32_t frame = 0; frame < 3; ++frame)
+			set.CollectDirtyRanges(frame);
+
+		// Marked before frame resource 0 collects; 1 and 2 collect in later frames.
+		set.MarkDirty(7);
+		const auto& first = set.CollectDirtyRanges(0);
+		CHECK(first.size() == 1 && IsRange(first[0], 7, 1));
+
+		set.MarkDirty(20);
+		const auto& second = set.CollectDirtyRanges(1);
+		CHECK(ToIndices(second) == (std::vector<std::uint32_t>{ 7, 20 }));
+
+		const auto& third = set.CollectDirtyRanges(2);
+		CHECK(ToIndices(third) == (std::vector<std::uint32_t>{ 7, 20 }));
+
+		// Frame resource 0 has seen 7 but not 20.
+		const auto& again = set.CollectDirtyRanges(0);
+		CHECK(ToIndices(again) == (std::vector<std::uint32_t>{ 20 }));
+
+		// Now everyone has seen both.
+		for(std::uint32_t frame = 0; frame < 3; ++frame)
+			CHECK(set.CollectDirtyRanges(frame).empty());
+
+		// Marking again after it was collected makes it dirty again.
+		set.MarkDirty(7);
+		set.MarkDirty(7);
+		for(std::uint32_t frame = 0; frame < 3; ++frame)
+			CHECK(ToIndices(set.CollectDirtyRanges(frame)) == (std::vector<std::uint32_t>{ 7 }));
+	}
+
+	void ResizeMarksEverythingDirty()
+	{
+		DirtySet set(10, 2);
+		set.CollectDirtyRanges(0);
+		set.CollectDirtyRanges(1);
+
+		set.MarkDirty(9);
+		set.Resize(300);
+		CHECK(set.GetElementCount() == 300);
+
+		for(std::uint32_t frame = 0; frame < 2; ++frame)
+		{
+			const auto& ranges = set.CollectDirtyRanges(frame);
+			CHECK(ranges.size() == 1 && IsRange(ranges[0], 0, 300));
+		}
+
+		// Marks after the resize are tracked per frame resource as usual, also past
+		// the old size.
+		set.MarkDirty(250);
+		CHECK(ToIndices(set.CollectDirtyRanges(0)) == (std::vector<std::uint32_t>{ 250 }));
+
+		set.MarkAllDirty();
+		CHECK(IsRange(set.CollectDirtyRanges(0)[0], 0, 300));
+		CHECK(IsRange(set.CollectDirtyRanges(1)[0], 0, 300));
+
+		// Shrinking drops marks beyond the new size; empty sets collect nothing.
+		set.MarkDirty(299);
+		set.Resize(0);
+		CHECK(set.CollectDirtyRanges(0).empty());
+		CHECK(set.CollectDirtyRanges(1).empty());
+	}
+
+	void MatchesPerFrameResourceFlags()
+	{
+		const std::uint32_t frameCount = 3;
+		const std::uint32_t elementCount = 500;
+
+		DirtySet set(elementCount, frameCount);
+
+		// The reference: one dirty flag per element and frame resource.
+		std::vector<std::vector<bool>> flags(frameCount, std::vector<bool>(elementCount, true));
+
+		std::mt19937 rng(5);
+		std::uniform_int_distribution<std::uint32_t> index(0, elementCount - 1);
+		std::uniform_int_distribution<std::uint32_t> action(0, 99);
+
+		bool matches = true;
+		for(std::uint32_t frame = 0; frame < 600; ++frame)
+		{
+			// Bursts of neighbours, scattered marks and now and then everything.
+			std::uint32_t marks = action(rng) % 20;
+			for(std::uint32_t m = 0; m < marks; ++m)
+			{
+				std::uint32_t first = index(rng);
+				std::uint32_t run = 1 + action(rng) % 8;
+				for(std::uint32_t i = first; i < first + run && i < elementCount; ++i)
+				{
+					set.MarkDirty(i);
+					for(auto& f : flags)
+						f[i] = true;
+				}
+			}
+
+			if(action(rng) == 0)
+			{
+				set.MarkAllDirty();
+				for(auto& f : flags)
+					f.assign(elementCount, true);
+			}
+
+			// Frame resources are collected round robin, with one sometimes collected
+			// twice in a row.
+			std::uint32_t frameResource = frame % frameCount;
+			std::uint32_t collects = action(rng) < 10 ? 2 : 1;
+			for(std::uint32_t c = 0; c < collects; ++c)
+			{
+				const auto& ranges = set.CollectDirtyRanges(frameResource);
+
+				std::vector<std::uint32_t> expected;
+				for(std::uint32_t i = 0; i < elementCount; ++i)
+				{
+					if(flags[frameResource][i])
+						expected.push_back(i);
+				}
+				flags[frameResource].assign(elementCount, false);
+
+				matches &= ToIndices(ranges) == expected;
+				matches &= set.GetCollectedCount() == expected.size();
+
+				// Ranges are sorted, non-empty and never touch each other.
+				for(std::size_t r = 0; r < ranges.size(); ++r)
+				{
+					matches &= ranges[r].Count > 0;
+					if(r > 0)
+						matches &= ranges[r - 1].First + ranges[r - 1].Count < ranges[r].First;
+				}
+			}
+		}
+
+		CHECK(matches);
+	}
+}
+
+int main()
+{
+	RUN_TEST(StartsAllDirtyInEveryFrameResource);
+	RUN_TEST(CoalescesContiguousIndices);
+	RUN_TEST(StaysDirtyUntilEveryFrameResourceSawIt);
+	RUN_TEST(ResizeMarksEverythingDirty);
+	RUN_TEST(MatchesPerFrameResourceFlags);
+
+	return TestResult();
+}
@@ -0,0 +1,173 @@
+//***************************************************************************************
+// DrawPacketTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/DrawPacket.h"
+#include "Common/ThreadPool.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool KeyLess(const DrawPacket& a, const DrawPacket& b)
+	{
+		return a.Key < b.Key;
+	}
+
+	bool SamePackets(const std::vector<DrawPacket>& a, const std::vector<DrawPacket>& b)
+	{
+		if(a.size() != b.size())
+			return false;
+
+		for(std::size_t i = 0; i < a.size(); ++i)
+		{
+			if(a[i].Key != b[i].Key || a[i].Item != b[i].Item)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Random packets drawn from a few values per field, so there are many equal keys.
+	std::vector<DrawPacket> MakePackets(std::uint32_t count, std::uint32_t seed, bool backToFront)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<std::uint32_t> layer(0, 2);
+		std::uniform_int_distribution<std::uint32_t> pso(0, 5);
+		std::uniform_int_distribution<std::uint32_t> geometry(0, 300);
+		std::uniform_int_distribution<std::uint32_t> material(0, 20);
+		std::uniform_real_distribution<float> depth(1.0f, 200.0f);
+
+		std::vector<DrawPacket> packets(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint32_t d = QuantizeDrawDepth(depth(rng), 1.0f, 200.0f) & 0xfff0;
+			packets[i].Item = i;
+			packets[i].Key = backToFront ?
+				MakeBackToFrontDrawSortKey(layer(rng), 0xffff - d, pso(rng), geometry(rng), material(rng)) :
+				MakeDrawSortKey(layer(rng), pso(rng), geometry(rng), material(rng), d);
+		}
+
+		return packets;
+	}
+
+	void KeyFieldsSortByPriority()
+	{
+		// Each pair differs in one field and has the other fields ordered against it,
+		// so the more significant field must win.
+		CHECK(MakeDrawSortKey(0, 255, 4095, 4095, 65535) < MakeDrawSortKey(1, 0, 0, 0, 0));
+		CHECK(MakeDrawSortKey(0, 0, 4095, 4095, 65535) < MakeDrawSortKey(0, 1, 0, 0, 0));
+		CHECK(MakeDrawSortKey(0, 0, 0, 4095, 65535) < MakeDrawSortKey(0, 0, 1, 0, 0));
+		CHECK(MakeDrawSortKey(0, 0, 0, 0, 65535) < MakeDrawSortKey(0, 0, 0, 1, 0));
+		CHECK(MakeDrawSortKey(0, 0, 0, 0, 0) < MakeDrawSortKey(0, 0, 0, 0, 1));
+		CHECK(MakeDrawSortKey(0, 0, 0, 0, 0) == 0);
+
+		// Back to front keys put the depth right after the layer.
+		CHECK(MakeBackToFrontDrawSortKey(0, 65535, 255, 4095, 4095) < MakeBackToFrontDrawSortKey(1, 0, 0, 0, 0));
+		CHECK(MakeBackToFrontDrawSortKey(0, 0, 255, 4095, 4095) < MakeBackToFrontDrawSortKey(0, 1, 0, 0, 0));
+		CHECK(MakeBackToFrontDrawSortKey(0, 0, 0, 4095, 4095) < MakeBackToFrontDrawSortKey(0, 0, 1, 0, 0));
+		CHECK(MakeBackToFrontDrawSortKey(0, 0, 0, 0, 4095) < MakeBackToFrontDrawSortKey(0, 0, 0, 1, 0));
+		CHECK(MakeBackToFrontDrawSortKey(0, 0, 0, 0, 0) < MakeBackToFrontDrawSortKey(0, 0, 0, 0, 1));
+
+		// Depth grows with distance and saturates at both ends.
+		CHECK(QuantizeDrawDepth(0.5f, 1.0f, 100.0f) == 0);
+		CHECK(QuantizeDrawDepth(10.0f, 1.0f, 100.0f) < QuantizeDrawDepth(20.0f, 1.0f, 100.0f));
+		CHECK(QuantizeDrawDepth(150.0f, 1.0f, 100.0f) == 65535);
+	}
+
+	void TiesKeepSubmissionOrder()
+	{
+		DrawPacketSorter sorter;
+
+		// Two keys, interleaved; each key's items must stay in submission order.
+		std::uint64_t a = MakeDrawSortKey(0, 3, 1, 1, 0);
+		std::uint64_t b = MakeDrawSortKey(0, 1, 7, 1, 0);
+
+		std::vector<DrawPacket> packets;
+		for(std::uint32_t i = 0; i < 20; ++i)
+		{
+			DrawPacket packet;
+			packet.Key = (i % 3 == 0) ? a : b;
+			packet.Item = i;
+			packets.push_back(packet);
+		}
+
+		sorter.Sort(packets);
+
+		bool ordered = true;
+		for(std::size_t i = 1; i < packets.size(); ++i)
+		{
+			ordered &= packets[i - 1].Key <= packets[i].Key;
+			if(packets[i - 1].Key == packets[i].Key)
+				ordered &= packets[i - 1].Item < packets[i].Item;
+		}
+		CHECK(ordered);
+		CHECK(packets.front().Key == b && packets.back().Key == a);
+
+		// Only the pso and geometry digits differ.
+		CHECK(sorter.GetLastPassCount() == 2);
+
+		// Identical keys need no pass and leave the order alone.
+		std::vector<DrawPacket> same(10);
+		for(std::uint32_t i = 0; i < 10; ++i)
+		{
+			same[i].Key = a;
+			same[i].Item = i;
+		}
+		sorter.Sort(same);
+		CHECK(sorter.GetLastPassCount() == 0);
+		CHECK(same[0].Item == 0 && same[9].Item == 9);
+
+		// Empty and single packet lists.
+		std::vector<DrawPacket> none;
+		sorter.Sort(none);
+		CHECK(none.empty());
+		std::vector<DrawPacket> one(1);
+		one[0].Key = a;
+		sorter.Sort(one);
+		CHECK(one.size() == 1 && one[0].Key == a);
+	}
+
+	void RadixSortsMatchStableSort()
+	{
+		ThreadPool pool(3);
+
+		DrawPacketSorter serial;
+		DrawPacketSorter parallel(&pool);
+		parallel.SetMinPacketsPerChunk(64);
+
+		bool serialMatches = true;
+		bool parallelMatches = true;
+		for(std::uint32_t count : { 2u, 3u, 100u, 127u, 128u, 1000u, 5003u, 40000u })
+		{
+			for(bool backToFront : { false, true })
+			{
+				std::vector<DrawPacket> expected = MakePackets(count, count, backToFront);
+				std::vector<DrawPacket> a = expected;
+				std::vector<DrawPacket> b = expected;
+				std::stable_sort(expected.begin(), expected.end(), KeyLess);
+
+				serial.Sort(a);
+				parallel.Sort(b);
+				serialMatches &= SamePackets(a, expected);
+				parallelMatches &= SamePackets(b, expected);
+			}
+		}
+
+		CHECK(serialMatches);
+		CHECK(parallelMatches);
+	}
+}
+
+int main()
+{
+	RUN_TEST(KeyFieldsSortByPriority);
+	RUN_TEST(TiesKeepSubmissionOrder);
+	RUN_TEST(RadixSortsMatchStableSort);
+
+	return TestResult();
+}
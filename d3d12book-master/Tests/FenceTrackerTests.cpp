@@ -0,0 +1,231 @@
+//***************************************************************************************
+// FenceTrackerTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/FenceTracker.h"
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace
+{
+	// Fences whose completed values the test sets.  BlockUntilAny runs OnBlock, which
+	// plays the GPU making progress while the CPU waits.
+	class MockFenceBackend : public FenceBackend
+	{
+	public:
+		explicit MockFenceBackend(std::uint32_t fenceCount) : CompletedValues(fenceCount, 0) {}
+
+		std::uint32_t GetFenceCount()const override
+		{
+			return (std::uint32_t)CompletedValues.size();
+		}
+
+		std::uint64_t QueryCompletedValue(std::uint32_t fence) override
+		{
+			++QueryCount;
+			return CompletedValues[fence];
+		}
+
+		void BlockUntilAny(const FenceWait* waits, std::uint32_t count) override
+		{
+			++BlockCount;
+			if(OnBlock)
+				OnBlock(waits, count);
+		}
+
+		std::vector<std::uint64_t> CompletedValues;
+		std::function<void(const FenceWait*, std::uint32_t)> OnBlock;
+
+		std::uint32_t QueryCount = 0;
+		std::uint32_t BlockCount = 0;
+	};
+
+	// The tracker owns the backend; the test keeps a pointer to steer it.
+	struct Fixture
+	{
+		explicit Fixture(std::uint32_t fenceCount)
+		{
+			std::unique_ptr<MockFenceBackend> mock(new MockFenceBackend(fenceCount));
+			Backend = mock.get();
+			Tracker.reset(new FenceTracker(std::move(mock)));
+		}
+
+		MockFenceBackend* Backend;
+		std::unique_ptr<FenceTracker> Tracker;
+	};
+
+	void SatisfiedWaitsDoNotBlock()
+	{
+		Fixture f(1);
+		f.Backend->CompletedValues[0] = 5;
+		f.Tracker->Refresh();
+
+		std::uint32_t queries = f.Backend->QueryCount;
+
+		// Answered from the cache: no query, no block.
+		f.Tracker->Wait(0, 3);
+		f.Tracker->Wait(0, 5);
+		CHECK(f.Tracker->IsComplete(0, 4));
+		CHECK(f.Backend->QueryCount == queries);
+		CHECK(f.Backend->BlockCount == 0);
+		CHECK(f.Tracker->GetStats().CacheHitCount == 3);
+
+		// The GPU moved on since the refresh: one query, still no block.
+		f.Backend->CompletedValues[0] = 8;
+		f.Tracker->Wait(0, 7);
+		CHECK(f.Backend->QueryCount == queries + 1);
+		CHECK(f.Backend->BlockCount == 0);
+		CHECK(f.Tracker->GetCompletedValue(0) == 8);
+		CHECK(f.Tracker->GetStats().BlockedWaitCount == 0);
+	}
+
+	void IsCompleteDoesNotBlock()
+	{
+		Fixture f(1);
+
+		CHECK(!f.Tracker->IsComplete(0, 1));
+		CHECK(f.Backend->BlockCount == 0);
+
+		f.Backend->CompletedValues[0] = 1;
+		CHECK(f.Tracker->IsComplete(0, 1));
+	}
+
+	void RefreshQueriesEveryFenceOnce()
+	{
+		Fixture f(3);
+		f.Backend->QueryCount = 0;
+
+		f.Backend->CompletedValues = { 4, 5, 6 };
+		f.Tracker->Refresh();
+
+		CHECK(f.Backend->QueryCount == 3);
+		CHECK(f.Tracker->GetCompletedValue(0) == 4);
+		CHECK(f.Tracker->GetCompletedValue(2) == 6);
+	}
+
+	void CachedValueNeverGoesBack()
+	{
+		Fixture f(1);
+		f.Backend->CompletedValues[0] = 10;
+		f.Tracker->Refresh();
+
+		f.Backend->CompletedValues[0] = 7;
+		f.Tracker->Refresh();
+		CHECK(f.Tracker->GetCompletedValue(0) == 10);
+	}
+
+	void WaitBlocksUntilReached()
+	{
+		Fixture f(1);
+
+		// The GPU gets one step further every time the CPU blocks.
+		MockFenceBackend* backend = f.Backend;
+		backend->OnBlock = [backend](const FenceWait*, std::uint32_t) { ++backend->CompletedValues[0]; };
+
+		f.Tracker->Wait(0, 3);
+
+		CHECK(f.Tracker->GetCompletedValue(0) == 3);
+		CHECK(backend->BlockCount == 3);
+		CHECK(f.Tracker->GetStats().BlockCount == 3);
+		CHECK(f.Tracker->GetStats().BlockedWaitCount == 1);
+	}
+
+	void WaitAnyReturnsFirstReached()
+	{
+		Fixture f(2);
+		f.Backend->CompletedValues = { 2, 9 };
+		f.Tracker->Refresh();
+
+		FenceWait waits[3];
+		waits[0].Fence = 0; waits[0].Value = 5;
+		waits[1].Fence = 1; waits[1].Value = 8;
+		waits[2].Fence = 1; waits[2].Value = 9;
+
+		// From the cache.
+		CHECK(f.Tracker->WaitAny(waits, 3) == 1);
+		CHECK(f.Backend->BlockCount == 0);
+
+		// Blocks until the copy queue (fence 1) gets there, with the graphics queue
+		// (fence 0) behind.
+		waits[1].Value = 12;
+		waits[2].Value = 11;
+
+		MockFenceBackend* backend = f.Backend;
+		backend->OnBlock = [backend](const FenceWait* blockWaits, std::uint32_t count)
+		{
+			CHECK(count == 3 && blockWaits[2].Value == 11);
+			backend->CompletedValues[1] = 11;
+		};
+
+		CHECK(f.Tracker->WaitAny(waits, 3) == 2);
+		CHECK(backend->BlockCount == 1);
+	}
+
+	void WaitAnyBlocksAgainAfterSpuriousWake()
+	{
+		Fixture f(2);
+
+		MockFenceBackend* backend = f.Backend;
+		backend->OnBlock = [backend](const FenceWait*, std::uint32_t)
+		{
+			// Nothing reached on the first wake.
+			if(backend->BlockCount == 2)
+				backend->CompletedValues[0] = 1;
+		};
+
+		FenceWait waits[2];
+		waits[0].Fence = 0; waits[0].Value = 1;
+		waits[1].Fence = 1; waits[1].Value = 1;
+
+		CHECK(f.Tracker->WaitAny(waits, 2) == 0);
+		CHECK(backend->BlockCount == 2);
+		CHECK(f.Tracker->GetStats().BlockedWaitCount == 1);
+	}
+
+	void MeasuresBlockedTime()
+	{
+		Fixture f(1);
+
+		MockFenceBackend* backend = f.Backend;
+		backend->OnBlock = [backend](const FenceWait* waits, std::uint32_t)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5 * waits[0].Value));
+			backend->CompletedValues[0] = waits[0].Value;
+		};
+
+		f.Tracker->Wait(0, 1);
+		f.Tracker->Wait(0, 3);
+		f.Tracker->Wait(0, 2);
+
+		const FenceWaitStats& stats = f.Tracker->GetStats();
+		CHECK(stats.RequestCount == 3);
+		CHECK(stats.BlockedWaitCount == 2);
+		CHECK(stats.MaxBlockedSeconds >= 0.015);
+		CHECK(stats.TotalBlockedSeconds >= 0.020);
+		CHECK(stats.TotalBlockedSeconds >= stats.MaxBlockedSeconds);
+		CHECK(stats.GetAverageBlockedSeconds() >= 0.010);
+		CHECK(stats.GetAverageBlockedSeconds() <= stats.MaxBlockedSeconds);
+
+		f.Tracker->ResetStats();
+		CHECK(f.Tracker->GetStats().BlockedWaitCount == 0);
+		CHECK(f.Tracker->GetStats().GetAverageBlockedSeconds() == 0.0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(SatisfiedWaitsDoNotBlock);
+	RUN_TEST(IsCompleteDoesNotBlock);
+	RUN_TEST(RefreshQueriesEveryFenceOnce);
+	RUN_TEST(CachedValueNeverGoesBack);
+	RUN_TEST(WaitBlocksUntilReached);
+	RUN_TEST(WaitAnyReturnsFirstReached);
+	RUN_TEST(WaitAnyBlocksAgainAfterSpuriousWake);
+	RUN_TEST(MeasuresBlockedTime);
+
+	return TestResult();
+}
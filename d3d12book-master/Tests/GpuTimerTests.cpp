@@ -0,0 +1,253 @@
+//***************************************************************************************
+// GpuTimerTests.cpp
+//
+// The GPU is played by the test: it writes made up timestamps into the readback
+// buffer and decides which fences have completed.  The frequency is 1 MHz, so one
+// tick is a microsecond.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/GpuTimer.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	const std::uint64_t Frequency = 1000000;
+
+	// A frame whose passes take the given times (in ticks), back to back from start.
+	std::uint64_t SubmitFrame(GpuTimer& timer, std::vector<std::uint64_t>& timestamps,
+		std::uint64_t fence, std::uint64_t start, const std::vector<const char*>& names,
+		const std::vector<std::uint64_t>& durations)
+	{
+		timer.BeginFrame();
+
+		std::uint64_t time = start;
+		for(std::size_t i = 0; i < names.size(); ++i)
+		{
+			std::uint32_t begin = timer.BeginPass(names[i]);
+			std::uint32_t end = timer.EndPass(begin);
+			if(begin == GpuTimer::NoQuery)
+				continue;
+
+			timestamps[begin] = time;
+			time += durations[i];
+			timestamps[end] = time;
+		}
+
+		timer.SetFrameFence(fence);
+		return time;
+	}
+
+	bool HasSample(const GpuTimer& timer, std::uint32_t timing, double ms)
+	{
+		for(const GpuTimingSample& sample : timer.GetCollectedSamples())
+		{
+			if(sample.Timing == timing && sample.Ms == ms)
+				return true;
+		}
+
+		return false;
+	}
+
+	void EverySlotHasItsOwnQueries()
+	{
+		GpuTimer timer(3, 4);
+		CHECK(timer.GetQueryCount() == 24);
+
+		// Frame n uses slot n % 3, two queries per pass.
+		for(std::uint32_t frame = 0; frame < 6; ++frame)
+		{
+			timer.BeginFrame();
+
+			std::uint32_t slot = frame % 3;
+			CHECK(timer.BeginPass("A") == slot * 8);
+			CHECK(timer.BeginPass("B") == slot * 8 + 2);
+			CHECK(timer.EndPass(slot * 8 + 2) == slot * 8 + 3);
+
+			std::uint32_t firstQuery = 0;
+			std::uint32_t queryCount = 0;
+			timer.EndFrame(firstQuery, queryCount);
+			CHECK(firstQuery == slot * 8);
+			CHECK(queryCount == 4);
+
+			timer.SetFrameFence(frame + 1);
+
+			// The GPU keeps up.
+			std::vector<std::uint64_t> timestamps(timer.GetQueryCount(), 0);
+			CHECK(timer.Collect(frame + 1, timestamps.data(), Frequency) == 1);
+		}
+
+		CHECK(timer.GetCollectedFrameCount() == 6);
+		CHECK(timer.GetDroppedFrameCount() == 0);
+	}
+
+	void LimitsPassesPerFrame()
+	{
+		GpuTimer timer(2, 2);
+		timer.BeginFrame();
+
+		CHECK(timer.BeginPass("A") != GpuTimer::NoQuery);
+		CHECK(timer.BeginPass("B") != GpuTimer::NoQuery);
+		CHECK(timer.BeginPass("C") == GpuTimer::NoQuery);
+		CHECK(timer.EndPass(GpuTimer::NoQuery) == GpuTimer::NoQuery);
+
+		std::uint32_t firstQuery = 0;
+		std::uint32_t queryCount = 0;
+		timer.EndFrame(firstQuery, queryCount);
+		CHECK(queryCount == 4);
+	}
+
+	void DropsFramesWhoseSlotComesAroundFirst()
+	{
+		GpuTimer timer(3, 4);
+		std::vector<std::uint64_t> timestamps(timer.GetQueryCount(), 0);
+
+		// Five frames and the GPU finishes none: frames 0 and 1 lose their slots to
+		// frames 3 and 4.
+		for(std::uint64_t frame = 0; frame < 5; ++frame)
+			SubmitFrame(timer, timestamps, frame + 1, frame * 100, { "A" }, { 10 });
+		CHECK(timer.GetDroppedFrameCount() == 2);
+
+		// Frames 2 to 4 are still read.
+		CHECK(!timer.HasCompletedFrames(2));
+		CHECK(timer.HasCompletedFrames(3));
+		CHECK(timer.Collect(5, timestamps.data(), Frequency) == 3);
+		CHECK(timer.GetCollectedFrameCount() == 3);
+		CHECK(timer.GetDroppedFrameCount() == 2);
+
+		// A frame without passes has nothing to wait for and is never dropped.
+		for(std::uint64_t frame = 5; frame < 10; ++frame)
+		{
+			timer.BeginFrame();
+			timer.SetFrameFence(frame + 1);
+		}
+		CHECK(timer.GetDroppedFrameCount() == 2);
+		CHECK(!timer.HasCompletedFrames(10));
+	}
+
+	void MeasuresLatency()
+	{
+		GpuTimer timer(3, 4);
+		std::vector<std::uint64_t> timestamps(timer.GetQueryCount(), 0);
+
+		SubmitFrame(timer, timestamps, 1, 0, { "A" }, { 10 });
+		SubmitFrame(timer, timestamps, 2, 100, { "A" }, { 20 });
+		CHECK(timer.Collect(0, timestamps.data(), Frequency) == 0);
+
+		// Frame 0 is read while frame 2 is being recorded.
+		timer.BeginFrame();
+		CHECK(timer.Collect(1, timestamps.data(), Frequency) == 1);
+		CHECK(timer.GetLatency() == 3);
+		CHECK(timer.GetFrameTiming().LastMs == 0.01);
+		timer.SetFrameFence(3);
+
+		// Oldest first, so the last values are the newest frame's.
+		CHECK(timer.Collect(3, timestamps.data(), Frequency) == 1);
+		CHECK(timer.GetLatency() == 2);
+		CHECK(timer.GetFrameTiming().LastMs == 0.02);
+	}
+
+	void SumsSameNamedPasses()
+	{
+		GpuTimer timer(2, 8);
+		std::vector<std::uint64_t> timestamps(timer.GetQueryCount(), 0);
+
+		// Blur runs twice; the frame spans all four passes.
+		SubmitFrame(timer, timestamps, 1, 1000, { "Shadow", "Blur", "Main", "Blur" }, { 500, 250, 2000, 750 });
+		CHECK(timer.Collect(1, timestamps.data(), Frequency) == 1);
+
+		const std::vector<GpuPassTiming>& passes = timer.GetPassTimings();
+		CHECK(passes.size() == 3);
+		CHECK(passes[0].Name == "Shadow" && passes[0].LastMs == 0.5);
+		CHECK(passes[1].Name == "Blur" && passes[1].LastMs == 1.0);
+		CHECK(passes[2].Name == "Main" && passes[2].LastMs == 2.0);
+		CHECK(passes[1].SampleCount == 1);
+		CHECK(timer.GetFrameTiming().LastMs == 3.5);
+
+		// One sample per pass name and one for the frame.
+		CHECK(timer.GetCollectedSamples().size() == 4);
+		CHECK(HasSample(timer, 1, 1.0));
+		CHECK(HasSample(timer, GpuTimer::FrameTiming, 3.5));
+
+		// Averages and maxima over frames, until ResetAverages().
+		SubmitFrame(timer, timestamps, 2, 9000, { "Blur" }, { 3000 });
+		CHECK(timer.Collect(2, timestamps.data(), Frequency) == 1);
+		CHECK(passes[1].SampleCount == 2);
+		CHECK(passes[1].GetAverageMs() == 2.0);
+		CHECK(passes[1].MaxMs == 3.0);
+		CHECK(passes[0].SampleCount == 1);
+		CHECK(timer.GetCollectedSamples().size() == 2);
+
+		timer.ResetAverages();
+		CHECK(passes[1].SampleCount == 0);
+		CHECK(passes[1].MaxMs == 0.0);
+		CHECK(passes[1].LastMs == 3.0);
+	}
+
+	void RejectsEndBeforeBegin()
+	{
+		GpuTimer timer(2, 4);
+		std::vector<std::uint64_t> timestamps(timer.GetQueryCount(), 0);
+
+		timer.BeginFrame();
+		std::uint32_t broken = timer.BeginPass("Broken");
+		std::uint32_t good = timer.BeginPass("Good");
+		timestamps[broken] = 5000;
+		timestamps[broken + 1] = 1000;
+		timestamps[good] = 6000;
+		timestamps[good + 1] = 7000;
+		timer.SetFrameFence(1);
+
+		CHECK(timer.Collect(1, timestamps.data(), Frequency) == 1);
+		CHECK(timer.GetPassTimings()[0].SampleCount == 0);
+		CHECK(timer.GetPassTimings()[1].LastMs == 1.0);
+
+		// The frame spans only the passes that made sense.
+		CHECK(timer.GetFrameTiming().LastMs == 1.0);
+		CHECK(timer.GetCollectedSamples().size() == 2);
+
+		// A frame with nothing sensible has no frame time either, but is still read.
+		timer.BeginFrame();
+		broken = timer.BeginPass("Broken");
+		timestamps[broken] = 9000;
+		timestamps[broken + 1] = 8000;
+		timer.SetFrameFence(2);
+
+		CHECK(timer.Collect(2, timestamps.data(), Frequency) == 1);
+		CHECK(timer.GetCollectedSamples().empty());
+		CHECK(timer.GetFrameTiming().SampleCount == 1);
+		CHECK(timer.GetCollectedFrameCount() == 2);
+	}
+
+	void EmptyCollectClearsSamples()
+	{
+		GpuTimer timer(2, 4);
+		std::vector<std::uint64_t> timestamps(timer.GetQueryCount(), 0);
+
+		SubmitFrame(timer, timestamps, 1, 0, { "A" }, { 10 });
+		CHECK(timer.Collect(1, timestamps.data(), Frequency) == 1);
+		CHECK(timer.GetCollectedSamples().size() == 2);
+
+		// Nothing completed: the timestamps are not read.
+		SubmitFrame(timer, timestamps, 2, 100, { "A" }, { 10 });
+		CHECK(!timer.HasCompletedFrames(1));
+		CHECK(timer.Collect(1, nullptr, Frequency) == 0);
+		CHECK(timer.GetCollectedSamples().empty());
+	}
+}
+
+int main()
+{
+	RUN_TEST(EverySlotHasItsOwnQueries);
+	RUN_TEST(LimitsPassesPerFrame);
+	RUN_TEST(DropsFramesWhoseSlotComesAroundFirst);
+	RUN_TEST(MeasuresLatency);
+	RUN_TEST(SumsSameNamedPasses);
+	RUN_TEST(RejectsEndBeforeBegin);
+	RUN_TEST(EmptyCollectClearsSamples);
+
+	return TestResult();
+}
@@ -0,0 +1,166 @@
+//***************************************************************************************
+// MappedFileTests.cpp
+//
+// The files are written to the working directory and removed again.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	const char* DataFilename = "MappedFileTests.bin";
+	const char* EmptyFilename = "MappedFileTests_Empty.bin";
+	const char* OtherFilename = "MappedFileTests_Other.bin";
+	const char* TextFilename = "MappedFileTests.txt";
+	const char* MissingFilename = "MappedFileTests_Missing.bin";
+
+	void WriteFile(const std::string& filename, const std::vector<std::uint8_t>& contents)
+	{
+		std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+		fout.write(reinterpret_cast<const char*>(contents.data()), std::streamsize(contents.size()));
+	}
+
+	// A few pages and a bit, so the last page is partly used.
+	std::vector<std::uint8_t> MakeContents()
+	{
+		std::vector<std::uint8_t> contents(3 * 4096 + 123);
+		for(std::size_t i = 0; i < contents.size(); ++i)
+			contents[i] = std::uint8_t(i * 7 + i / 256);
+
+		return contents;
+	}
+
+	bool HasContents(const MappedFile& file, const std::vector<std::uint8_t>& contents)
+	{
+		return file.GetSize() == contents.size() && file.GetData() != nullptr &&
+			std::memcmp(file.GetData(), contents.data(), contents.size()) == 0;
+	}
+
+	void MapsTheWholeFile()
+	{
+		std::vector<std::uint8_t> contents = MakeContents();
+		WriteFile(DataFilename, contents);
+
+		for(MappedFileHint hint : { MappedFileHint::Normal, MappedFileHint::Sequential, MappedFileHint::Random })
+		{
+			MappedFile file;
+			CHECK(!file.IsOpen());
+			CHECK(file.Open(std::string(DataFilename), hint));
+			CHECK(file.IsOpen());
+			CHECK(HasContents(file, contents));
+
+			// Prefetching and loading only read; ranges past the end are clipped.
+			file.Prefetch(0, file.GetSize());
+			file.Prefetch(4096 + 1, 100000);
+			file.Prefetch(file.GetSize(), 10);
+			file.Load();
+			CHECK(HasContents(file, contents));
+		}
+
+		// The wide name opens the same file.
+		MappedFile wide;
+		CHECK(wide.Open(std::wstring(L"MappedFileTests.bin")));
+		CHECK(HasContents(wide, contents));
+
+		// Windows cannot remove a file that is still mapped.
+		wide.Close();
+		std::remove(DataFilename);
+	}
+
+	void EmptyAndMissingFiles()
+	{
+		WriteFile(EmptyFilename, std::vector<std::uint8_t>());
+
+		MappedFile file;
+		CHECK(file.Open(std::string(EmptyFilename)));
+		CHECK(file.IsOpen());
+		CHECK(file.GetSize() == 0);
+		file.Prefetch(0, 100);
+		file.Load();
+
+		// A failed open leaves the file closed, also when one was open before.
+		std::remove(MissingFilename);
+		CHECK(!file.Open(std::string(MissingFilename)));
+		CHECK(!file.IsOpen());
+		CHECK(file.GetData() == nullptr && file.GetSize() == 0);
+
+		std::remove(EmptyFilename);
+	}
+
+	void MovesAndCloses()
+	{
+		std::vector<std::uint8_t> contents = MakeContents();
+		WriteFile(DataFilename, contents);
+
+		MappedFile a;
+		CHECK(a.Open(std::string(DataFilename)));
+
+		// The mapping moves with the object and the source is left closed.
+		MappedFile b(std::move(a));
+		CHECK(!a.IsOpen() && a.GetData() == nullptr && a.GetSize() == 0);
+		CHECK(HasContents(b, contents));
+
+		MappedFile c;
+		c = std::move(b);
+		CHECK(!b.IsOpen());
+		CHECK(HasContents(c, contents));
+
+		// Reopening replaces the mapping.
+		std::vector<std::uint8_t> other(10, 42);
+		WriteFile(OtherFilename, other);
+		CHECK(c.Open(std::string(OtherFilename)));
+		CHECK(HasContents(c, other));
+
+		c.Close();
+		CHECK(!c.IsOpen() && c.GetData() == nullptr && c.GetSize() == 0);
+		c.Close();
+
+		std::remove(DataFilename);
+		std::remove(OtherFilename);
+	}
+
+	void StreamsFromTheMapping()
+	{
+		const std::string text = "3 vertices\n1.5 2.5 -3\nname end";
+		WriteFile(TextFilename, std::vector<std::uint8_t>(text.begin(), text.end()));
+
+		MappedFile file;
+		CHECK(file.Open(std::string(TextFilename), MappedFileHint::Sequential));
+
+		MemoryInputStream fin(file.GetData(), file.GetSize());
+		int count = 0;
+		std::string word;
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		std::string name, last;
+		fin >> count >> word >> x >> y >> z >> name >> last;
+		CHECK(fin && count == 3 && word == "vertices");
+		CHECK(x == 1.5f && y == 2.5f && z == -3.0f);
+		CHECK(name == "name" && last == "end");
+
+		// Reading past the end fails like a file stream.
+		fin >> word;
+		CHECK(fin.eof() && fin.fail());
+
+		file.Close();
+		std::remove(TextFilename);
+	}
+}
+
+int main()
+{
+	RUN_TEST(MapsTheWholeFile);
+	RUN_TEST(EmptyAndMissingFiles);
+	RUN_TEST(MovesAndCloses);
+	RUN_TEST(StreamsFromTheMapping);
+
+	return TestResult();
+}
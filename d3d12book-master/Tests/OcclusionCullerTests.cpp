@@ -0,0 +1,245 @@
+//***************************************************************************************
+// OcclusionCullerTests.cpp
+//
+// Most cases use the identity view-projection matrix, so positions are already in
+// NDC: x and y in [-1, 1] map to the 256x128 depth buffer and z is the depth.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Chapter 16 Instancing and Frustum Culling/InstancingAndCulling/OcclusionCuller.h"
+#include "Common/ThreadPool.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	BoundingBox MakeBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+	{
+		BoundingBox box;
+		box.Center = XMFLOAT3(0.5f*(minX + maxX), 0.5f*(minY + maxY), 0.5f*(minZ + maxZ));
+		box.Extents = XMFLOAT3(0.5f*(maxX - minX), 0.5f*(maxY - minY), 0.5f*(maxZ - minZ));
+		return box;
+	}
+
+	// The box x, y in [-0.5, 0.5] covers pixels [64, 192) x [32, 96); its front face
+	// is at depth 0.4.
+	void RasterizeWall(OcclusionCuller& culler)
+	{
+		culler.BeginFrame(XMMatrixIdentity());
+		culler.AddOccluderBox(MakeBox(-0.5f, -0.5f, 0.4f, 0.5f, 0.5f, 0.5f), XMMatrixIdentity());
+		culler.RasterizeOccluders();
+	}
+
+	// A camera looking down +z at random boxes, for comparing runs.
+	void RasterizeScene(OcclusionCuller& culler)
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 2.0f, -20.0f, 1.0f),
+			XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*XM_PI, 2.0f, 1.0f, 100.0f);
+		culler.BeginFrame(XMMatrixMultiply(view, proj));
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-15.0f, 15.0f);
+		std::uniform_real_distribution<float> size(0.2f, 3.0f);
+		for(int i = 0; i < 200; ++i)
+		{
+			BoundingBox box(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(size(rng), size(rng), size(rng)));
+			culler.AddOccluderBox(box, XMMatrixTranslation(position(rng), position(rng), position(rng)));
+		}
+
+		culler.RasterizeOccluders();
+	}
+
+	void RasterizesBoxOccluder()
+	{
+		OcclusionCuller culler(nullptr);
+		RasterizeWall(culler);
+
+		// The front and back faces are drawn; the sides are edge on and rejected.
+		CHECK(culler.GetStats().OccluderTriangles + culler.GetStats().RejectedTriangles == 12);
+		CHECK(culler.GetStats().OccluderTriangles == 4);
+
+		const float* depth = culler.GetDepth();
+		bool inside = true;
+		bool outside = true;
+		for(std::uint32_t y = 0; y < culler.GetHeight(); ++y)
+		{
+			for(std::uint32_t x = 0; x < culler.GetWidth(); ++x)
+			{
+				float d = depth[y*culler.GetWidth() + x];
+				if(x >= 64 && x < 192 && y >= 32 && y < 96)
+					inside &= std::fabs(d - 0.4f) < 1e-5f;
+				else
+					outside &= d == 1.0f;
+			}
+		}
+		CHECK(inside);
+		CHECK(outside);
+
+		// The next frame starts from the far plane again.
+		culler.BeginFrame(XMMatrixIdentity());
+		culler.RasterizeOccluders();
+		CHECK(culler.GetDepth()[64*culler.GetWidth() + 128] == 1.0f);
+	}
+
+	void HiZKeepsFarthestChild()
+	{
+		// 192x96 has a 3x2 level, so the last column of its children is clamped.
+		OcclusionCuller culler(nullptr, 192, 96);
+		RasterizeScene(culler);
+
+		CHECK(culler.GetHiZLevelCount() == 9);
+
+		std::uint32_t srcWidth = culler.GetWidth();
+		std::uint32_t srcHeight = culler.GetHeight();
+		bool isMax = true;
+		for(std::uint32_t level = 1; level < culler.GetHiZLevelCount(); ++level)
+		{
+			const float* src = culler.GetDepth(level - 1);
+			const float* dst = culler.GetDepth(level);
+
+			std::uint32_t width = (srcWidth + 1) / 2;
+			std::uint32_t height = (srcHeight + 1) / 2;
+			for(std::uint32_t y = 0; y < height; ++y)
+			{
+				for(std::uint32_t x = 0; x < width; ++x)
+				{
+					float farthest = 0.0f;
+					for(std::uint32_t sy = 2*y; sy <= 2*y + 1 && sy < srcHeight; ++sy)
+					{
+						for(std::uint32_t sx = 2*x; sx <= 2*x + 1 && sx < srcWidth; ++sx)
+							farthest = std::fmax(farthest, src[sy*srcWidth + sx]);
+					}
+					isMax &= dst[y*width + x] == farthest;
+				}
+			}
+
+			srcWidth = width;
+			srcHeight = height;
+		}
+		CHECK(isMax);
+		CHECK(srcWidth == 1 && srcHeight == 1);
+
+		// Texels 32 pixels wide that lie completely on the wall keep its depth.
+		OcclusionCuller wall(nullptr);
+		RasterizeWall(wall);
+		const float* level5 = wall.GetDepth(5);
+		CHECK(std::fabs(level5[1*8 + 2] - 0.4f) < 1e-5f);
+		CHECK(std::fabs(level5[2*8 + 5] - 0.4f) < 1e-5f);
+		CHECK(level5[1*8 + 1] == 1.0f);
+		CHECK(level5[0*8 + 3] == 1.0f);
+	}
+
+	void CullsOnlyBoxesBehindOccluder()
+	{
+		OcclusionCuller culler(nullptr);
+		RasterizeWall(culler);
+
+		XMMATRIX identity = XMMatrixIdentity();
+
+		// Behind the middle of the wall.
+		CHECK(culler.IsOccluded(MakeBox(-0.2f, -0.2f, 0.7f, 0.2f, 0.2f, 0.8f), identity));
+		CHECK(culler.IsOccluded(MakeBox(-0.45f, -0.45f, 0.6f, -0.3f, -0.3f, 0.9f), identity));
+
+		// Also behind, but its Hi-Z texels reach past the wall, so it is kept.
+		CHECK(!culler.IsOccluded(MakeBox(-0.45f, -0.45f, 0.6f, 0.45f, 0.45f, 0.9f), identity));
+
+		// In front of it, beside it, sticking out past its edge or through it.
+		CHECK(!culler.IsOccluded(MakeBox(-0.2f, -0.2f, 0.1f, 0.2f, 0.2f, 0.2f), identity));
+		CHECK(!culler.IsOccluded(MakeBox(0.6f, -0.2f, 0.7f, 0.8f, 0.2f, 0.8f), identity));
+		CHECK(!culler.IsOccluded(MakeBox(0.3f, -0.2f, 0.7f, 0.7f, 0.2f, 0.8f), identity));
+		CHECK(!culler.IsOccluded(MakeBox(-0.2f, -0.2f, 0.3f, 0.2f, 0.2f, 0.8f), identity));
+
+		// Crossing the near plane or off screen is never occluded.
+		CHECK(!culler.IsOccluded(MakeBox(-0.2f, -0.2f, -0.1f, 0.2f, 0.2f, 0.8f), identity));
+		CHECK(!culler.IsOccluded(MakeBox(1.2f, -0.2f, 0.7f, 1.4f, 0.2f, 0.8f), identity));
+
+		// The same boxes moved into place by their world matrices, in one batch.
+		BoundingBox unit = MakeBox(-0.1f, -0.1f, -0.05f, 0.1f, 0.1f, 0.05f);
+		const XMFLOAT3 positions[] =
+		{
+			XMFLOAT3(0.0f, 0.0f, 0.75f),  // behind
+			XMFLOAT3(0.0f, 0.0f, 0.15f),  // in front
+			XMFLOAT3(0.7f, 0.0f, 0.75f),  // beside
+			XMFLOAT3(-0.3f, 0.3f, 0.75f), // behind
+		};
+
+		std::vector<XMFLOAT4X4> worlds(4);
+		for(int i = 0; i < 4; ++i)
+			XMStoreFloat4x4(&worlds[i], XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z));
+
+		std::vector<std::uint8_t> visible(4, 2);
+		culler.TestObjects(unit, worlds.data(), 4, visible.data());
+		CHECK(visible[0] == 0);
+		CHECK(visible[1] == 1);
+		CHECK(visible[2] == 1);
+		CHECK(visible[3] == 0);
+		CHECK(culler.GetStats().TestedObjects == 4);
+		CHECK(culler.GetStats().OccludedObjects == 2);
+	}
+
+	void ThreadPoolGivesSameResults()
+	{
+		ThreadPool pool(3);
+
+		OcclusionCuller serial(nullptr);
+		OcclusionCuller parallel(&pool);
+		RasterizeScene(serial);
+		RasterizeScene(parallel);
+
+		CHECK(serial.GetStats().OccluderTriangles > 0);
+		CHECK(serial.GetStats().OccluderTriangles == parallel.GetStats().OccluderTriangles);
+		CHECK(serial.GetStats().RejectedTriangles == parallel.GetStats().RejectedTriangles);
+
+		std::uint32_t width = serial.GetWidth();
+		std::uint32_t height = serial.GetHeight();
+		for(std::uint32_t level = 0; level < serial.GetHiZLevelCount(); ++level)
+		{
+			CHECK(std::memcmp(serial.GetDepth(level), parallel.GetDepth(level), width*height*sizeof(float)) == 0);
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+
+		// A grid of small boxes through the scene.
+		std::vector<XMFLOAT4X4> worlds;
+		for(int z = 0; z < 8; ++z)
+		{
+			for(int y = -8; y < 8; ++y)
+			{
+				for(int x = -8; x < 8; ++x)
+				{
+					worlds.emplace_back();
+					XMStoreFloat4x4(&worlds.back(), XMMatrixTranslation(2.0f*x, 2.0f*y, 4.0f*z));
+				}
+			}
+		}
+
+		BoundingBox box(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.3f, 0.3f, 0.3f));
+		std::uint32_t count = (std::uint32_t)worlds.size();
+		std::vector<std::uint8_t> serialVisible(count);
+		std::vector<std::uint8_t> parallelVisible(count);
+		serial.TestObjects(box, worlds.data(), count, serialVisible.data());
+		parallel.TestObjects(box, worlds.data(), count, parallelVisible.data());
+
+		CHECK(serialVisible == parallelVisible);
+		CHECK(serial.GetStats().OccludedObjects == parallel.GetStats().OccludedObjects);
+		CHECK(serial.GetStats().OccludedObjects > 0);
+		CHECK(serial.GetStats().OccludedObjects < count);
+	}
+}
+
+int main()
+{
+	RUN_TEST(RasterizesBoxOccluder);
+	RUN_TEST(HiZKeepsFarthestChild);
+	RUN_TEST(CullsOnlyBoxesBehindOccluder);
+	RUN_TEST(ThreadPoolGivesSameResults);
+
+	return TestResult();
+}
@@ -0,0 +1,195 @@
+//***************************************************************************************
+// PipelineStateCacheTests.cpp
+//
+// D3D12PipelineStateCache hashes a pipeline description field by field through
+// PipelineStateHasher; these tests pin down the properties that relies on, along
+// with the handles and the library file.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/PipelineStateCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* LibraryFilename = "PipelineStateCacheTests.bin";
+
+	std::vector<std::uint8_t> ReadFile(const std::string& filename)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	bool FileExists(const std::string& filename)
+	{
+		return std::ifstream(filename).good();
+	}
+
+	void HashesAreFnv1a()
+	{
+		// The published FNV-1a test vectors, so keys stay the same across builds.
+		Fnv1aHasher empty;
+		CHECK(empty.GetHash() == 0xcbf29ce484222325ull);
+
+		Fnv1aHasher a;
+		a.AddBytes("a", 1);
+		CHECK(a.GetHash() == 0xaf63dc4c8601ec8cull);
+
+		Fnv1aHasher foobar;
+		foobar.AddBytes("foobar", 6);
+		CHECK(foobar.GetHash() == 0x85944171f73967e8ull);
+	}
+
+	void HashesFieldsByValue()
+	{
+		// Field sizes do not matter, a BOOL hashes like a UINT.
+		PipelineStateHasher narrow, wide;
+		narrow.AddUInt(std::uint8_t(5));
+		wide.AddUInt(std::uint64_t(5));
+		CHECK(narrow.GetHash() == wide.GetHash());
+
+		// Order does.
+		PipelineStateHasher ab, ba;
+		ab.AddUInt(1);
+		ab.AddUInt(2);
+		ba.AddUInt(2);
+		ba.AddUInt(1);
+		CHECK(ab.GetHash() != ba.GetHash());
+
+		// -0.0f describes the same depth bias as 0.0f.
+		PipelineStateHasher zero, negativeZero, one;
+		zero.AddFloat(0.0f);
+		negativeZero.AddFloat(-0.0f);
+		one.AddFloat(1.0f);
+		CHECK(zero.GetHash() == negativeZero.GetHash());
+		CHECK(zero.GetHash() != one.GetHash());
+	}
+
+	void HashesStringsByContents()
+	{
+		// Semantic names by their characters, not by where they are stored.
+		std::string copy = "POSITION";
+		PipelineStateHasher literal, copied;
+		literal.AddString("POSITION");
+		copied.AddString(copy.c_str());
+		CHECK(literal.GetHash() == copied.GetHash());
+
+		PipelineStateHasher none, empty;
+		none.AddString(nullptr);
+		empty.AddString("");
+		CHECK(none.GetHash() != empty.GetHash());
+
+		// Length prefixed, so characters cannot move between neighbouring strings.
+		PipelineStateHasher split0, split1;
+		split0.AddString("TEX");
+		split0.AddString("COORD");
+		split1.AddString("TEXC");
+		split1.AddString("OORD");
+		CHECK(split0.GetHash() != split1.GetHash());
+
+		// std::strings still reach Fnv1aHasher::AddString.
+		PipelineStateHasher fromString;
+		Fnv1aHasher base;
+		fromString.AddString(copy);
+		base.AddString(copy);
+		CHECK(fromString.GetHash() == base.GetHash());
+	}
+
+	void HandsOutDenseHandles()
+	{
+		PipelineStateCache cache;
+		CHECK(cache.Find(42) == InvalidPipelineStateHandle);
+
+		bool isNew = false;
+		CHECK(cache.Add(42, isNew) == 0 && isNew);
+		CHECK(cache.Add(7, isNew) == 1 && isNew);
+		CHECK(cache.Add(42, isNew) == 0 && !isNew);
+		CHECK(cache.Find(7) == 1);
+		CHECK(cache.GetKey(1) == 7);
+		CHECK(cache.GetCount() == 2);
+
+		cache.Clear();
+		CHECK(cache.GetCount() == 0);
+		CHECK(cache.Find(42) == InvalidPipelineStateHandle);
+	}
+
+	void NamesLibraryEntriesInHex()
+	{
+		CHECK(PipelineStateCache::GetLibraryName(0) == L"0000000000000000");
+		CHECK(PipelineStateCache::GetLibraryName(0x0123456789abcdefull) == L"0123456789abcdef");
+	}
+
+	void LibraryFileRoundTrips()
+	{
+		std::vector<std::uint8_t> library(1000);
+		for(std::size_t i = 0; i < library.size(); ++i)
+			library[i] = (std::uint8_t)(i*7);
+
+		CHECK(PipelineStateCache::SaveLibraryFile(LibraryFilename, library.data(), library.size()));
+		CHECK(!FileExists(std::string(LibraryFilename) + ".tmp"));
+
+		std::vector<std::uint8_t> file = ReadFile(LibraryFilename);
+		const void* payload = nullptr;
+		std::size_t size = 0;
+		CHECK(PipelineStateCache::GetLibrary(file.data(), file.size(), payload, size));
+		CHECK(size == library.size());
+		CHECK(payload != nullptr && std::equal(library.begin(), library.end(), (const std::uint8_t*)payload));
+
+		// Saving again replaces the file.
+		library.resize(10);
+		CHECK(PipelineStateCache::SaveLibraryFile(LibraryFilename, library.data(), library.size()));
+		file = ReadFile(LibraryFilename);
+		CHECK(PipelineStateCache::GetLibrary(file.data(), file.size(), payload, size));
+		CHECK(size == 10);
+
+		std::remove(LibraryFilename);
+	}
+
+	void RejectsDamagedLibraryFiles()
+	{
+		std::vector<std::uint8_t> library(100, 0xab);
+		CHECK(PipelineStateCache::SaveLibraryFile(LibraryFilename, library.data(), library.size()));
+		std::vector<std::uint8_t> file = ReadFile(LibraryFilename);
+		std::remove(LibraryFilename);
+
+		const void* payload = nullptr;
+		std::size_t size = 0;
+		CHECK(!PipelineStateCache::GetLibrary(file.data(), 8, payload, size));
+		CHECK(!PipelineStateCache::GetLibrary(file.data(), file.size() - 1, payload, size));
+
+		std::vector<std::uint8_t> corrupt = file;
+		corrupt[0] ^= 0xff;
+		CHECK(!PipelineStateCache::GetLibrary(corrupt.data(), corrupt.size(), payload, size));
+
+		corrupt = file;
+		corrupt.back() ^= 0xff;
+		CHECK(!PipelineStateCache::GetLibrary(corrupt.data(), corrupt.size(), payload, size));
+	}
+
+	void ReportsFilesThatCannotBeWritten()
+	{
+		std::uint8_t data = 0;
+		CHECK(!PipelineStateCache::SaveLibraryFile("NoSuchDirectory/Library.bin", &data, 1));
+	}
+}
+
+int main()
+{
+	RUN_TEST(HashesAreFnv1a);
+	RUN_TEST(HashesFieldsByValue);
+	RUN_TEST(HashesStringsByContents);
+	RUN_TEST(HandsOutDenseHandles);
+	RUN_TEST(NamesLibraryEntriesInHex);
+	RUN_TEST(LibraryFileRoundTrips);
+	RUN_TEST(RejectsDamagedLibraryFiles);
+	RUN_TEST(ReportsFilesThatCannotBeWritten);
+
+	return TestResult();
+}
@@ -0,0 +1,211 @@
+//***************************************************************************************
+// ProfilerTests.cpp
+//
+// The macros are enabled here whatever the build type; the library itself only
+// records through them in debug and PROFILE builds.
+//***************************************************************************************
+
+#define PROFILER_ENABLED 1
+
+#include "Check.h"
+
+#include "Common/Profiler.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const int ThreadCount = 4;
+	const int ScopesPerThread = 1000;
+
+	std::size_t CountOf(const std::string& text, const std::string& pattern)
+	{
+		std::size_t count = 0;
+		for(std::size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1))
+			++count;
+
+		return count;
+	}
+
+	std::string GetTrace()
+	{
+		std::ostringstream out;
+		Profiler::WriteChromeTrace(out);
+		return out.str();
+	}
+
+	void RecordsOnlyWhileCapturing()
+	{
+		Profiler::EndCapture();
+		CHECK(!Profiler::IsCapturing());
+		{
+			PROFILE_SCOPE("Before");
+		}
+
+		Profiler::BeginCapture();
+		CHECK(Profiler::IsCapturing());
+		for(int i = 0; i < 3; ++i)
+		{
+			PROFILE_SCOPE("Outer");
+			PROFILE_SCOPE("Inner");
+		}
+
+		// Still open when the capture ends, so left out.
+		{
+			PROFILE_SCOPE("Open");
+			Profiler::EndCapture();
+		}
+		{
+			PROFILE_SCOPE("After");
+		}
+
+		ProfilerStats stats = Profiler::GetStats();
+		CHECK(stats.ThreadCount == 1);
+		CHECK(stats.EventCount == 6);
+		CHECK(stats.DroppedCount == 0);
+
+		std::string trace = GetTrace();
+		CHECK(CountOf(trace, "\"name\":\"Outer\"") == 3);
+		CHECK(CountOf(trace, "\"name\":\"Inner\"") == 3);
+		CHECK(CountOf(trace, "\"ph\":\"X\"") == 6);
+		CHECK(trace.find("Before") == std::string::npos);
+		CHECK(trace.find("Open") == std::string::npos);
+		CHECK(trace.find("After") == std::string::npos);
+
+		// The next capture starts empty.
+		Profiler::BeginCapture();
+		{
+			PROFILE_SCOPE("Second");
+		}
+		Profiler::EndCapture();
+
+		stats = Profiler::GetStats();
+		CHECK(stats.ThreadCount == 1 && stats.EventCount == 1);
+		trace = GetTrace();
+		CHECK(trace.find("Outer") == std::string::npos);
+		CHECK(CountOf(trace, "\"name\":\"Second\"") == 1);
+
+		// A capture nothing was recorded into has no threads.
+		Profiler::BeginCapture();
+		Profiler::EndCapture();
+		stats = Profiler::GetStats();
+		CHECK(stats.ThreadCount == 0 && stats.EventCount == 0);
+		CHECK(CountOf(GetTrace(), "\"ph\"") == 0);
+	}
+
+	void DropsScopesPastTheBuffer()
+	{
+		const std::uint32_t extra = 10;
+
+		Profiler::BeginCapture();
+		for(std::uint32_t i = 0; i < Profiler::EventsPerThread + extra; ++i)
+			Profiler::RecordScope("Full", i, i + 1);
+		Profiler::EndCapture();
+
+		ProfilerStats stats = Profiler::GetStats();
+		CHECK(stats.EventCount == Profiler::EventsPerThread);
+		CHECK(stats.DroppedCount == extra);
+
+		// A new capture reuses the buffer from the start.
+		Profiler::BeginCapture();
+		Profiler::RecordScope("Full", 0, 1);
+		Profiler::EndCapture();
+
+		stats = Profiler::GetStats();
+		CHECK(stats.EventCount == 1 && stats.DroppedCount == 0);
+	}
+
+	void TracksEveryThread()
+	{
+		Profiler::BeginCapture();
+
+		std::vector<std::thread> threads;
+		for(int t = 0; t < ThreadCount; ++t)
+		{
+			threads.emplace_back([t]()
+			{
+				PROFILE_THREAD_NAME("Profiled " + std::to_string(t));
+				for(int i = 0; i < ScopesPerThread; ++i)
+				{
+					PROFILE_SCOPE("ThreadScope");
+				}
+			});
+		}
+		for(auto& thread : threads)
+			thread.join();
+
+		Profiler::EndCapture();
+
+		ProfilerStats stats = Profiler::GetStats();
+		CHECK(stats.ThreadCount == ThreadCount);
+		CHECK(stats.EventCount == std::uint64_t(ThreadCount * ScopesPerThread));
+
+		// One track per thread, named as the thread asked.
+		std::string trace = GetTrace();
+		CHECK(CountOf(trace, "\"name\":\"thread_name\"") == ThreadCount);
+		for(int t = 0; t < ThreadCount; ++t)
+			CHECK(CountOf(trace, "\"args\":{\"name\":\"Profiled " + std::to_string(t) + "\"}") == 1);
+		CHECK(CountOf(trace, "\"name\":\"ThreadScope\"") == std::size_t(ThreadCount * ScopesPerThread));
+
+		// Buffers of threads that exited are reused, so capturing again does not
+		// leave the old tracks in.
+		Profiler::BeginCapture();
+		std::thread([]() { PROFILE_SCOPE("Later"); }).join();
+		Profiler::EndCapture();
+
+		stats = Profiler::GetStats();
+		CHECK(stats.ThreadCount == 1 && stats.EventCount == 1);
+		CHECK(GetTrace().find("Profiled") == std::string::npos);
+	}
+
+	void WritesChromeTraceJson()
+	{
+		Profiler::BeginCapture();
+		Profiler::SetThreadName("Main \"thread\"");
+
+		// Interned names outlive the string they were made from.
+		const char* interned = nullptr;
+		{
+			std::string name = std::string("Task\\") + "Name";
+			interned = Profiler::InternName(name);
+		}
+		CHECK(interned == Profiler::InternName("Task\\Name"));
+		{
+			PROFILE_SCOPE(interned);
+		}
+		Profiler::EndCapture();
+
+		std::string trace = GetTrace();
+		CHECK(trace.compare(0, 16, "{\"traceEvents\":[") == 0);
+		CHECK(trace.find("\n],\"displayTimeUnit\":\"ms\"}\n") == trace.size() - 27);
+
+		// Quotes and backslashes are escaped.
+		CHECK(trace.find("\"name\":\"Task\\\\Name\"") != std::string::npos);
+		CHECK(trace.find("\"name\":\"Main \\\"thread\\\"\"") != std::string::npos);
+
+		// Every event has a start and a duration that are not negative.
+		CHECK(CountOf(trace, "\"ts\":") == 1 && CountOf(trace, "\"dur\":") == 1);
+		CHECK(trace.find("\"ts\":-") == std::string::npos);
+		CHECK(trace.find("\"dur\":-") == std::string::npos);
+
+		// Writing a trace leaves the stream's format alone.
+		std::ostringstream out;
+		out.precision(9);
+		Profiler::WriteChromeTrace(out);
+		CHECK(out.precision() == 9);
+		CHECK((out.flags() & std::ios_base::floatfield) == 0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(RecordsOnlyWhileCapturing);
+	RUN_TEST(DropsScopesPastTheBuffer);
+	RUN_TEST(TracksEveryThread);
+	RUN_TEST(WritesChromeTraceJson);
+
+	return TestResult();
+}
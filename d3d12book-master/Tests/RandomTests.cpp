@@ -0,0 +1,383 @@
+//***************************************************************************************
+// RandomTests.cpp
+//
+// Random.cpp steps the generator with AVX2, SSE2 or plain C++, whichever DirectXMath
+// was configured for (D3D12_SIMD), so configure with NONE, SSE2 and AVX2 to run these
+// against every path.  All of them must give the reference xoshiro128** sequences.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/Random.h"
+
+#include <climits>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Reference xoshiro128**, one stream, as published by Blackman and Vigna.
+	struct Xoshiro128
+	{
+		std::uint32_t S[4];
+
+		static std::uint32_t Rotl(std::uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		std::uint32_t Next()
+		{
+			std::uint32_t result = Rotl(S[1] * 5, 7) * 9;
+			std::uint32_t t = S[1] << 9;
+
+			S[2] ^= S[0];
+			S[3] ^= S[1];
+			S[1] ^= S[2];
+			S[0] ^= S[3];
+			S[2] ^= t;
+			S[3] = Rotl(S[3], 11);
+
+			return result;
+		}
+	};
+
+	std::uint64_t SplitMix64(std::uint64_t& x)
+	{
+		std::uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// The reference states of the 8 lanes of Random(seed, stream): 128 bits each from
+	// SplitMix64, seeded with seed and the mixed stream number.
+	std::vector<Xoshiro128> ReferenceLanes(std::uint64_t seed, std::uint64_t stream)
+	{
+		std::uint64_t x = seed ^ SplitMix64(stream);
+
+		std::vector<Xoshiro128> lanes(Random::BatchSize);
+		for(auto& lane : lanes)
+		{
+			std::uint64_t a = SplitMix64(x);
+			std::uint64_t b = SplitMix64(x);
+			lane.S[0] = std::uint32_t(a);
+			lane.S[1] = std::uint32_t(a >> 32);
+			lane.S[2] = std::uint32_t(b);
+			lane.S[3] = std::uint32_t(b >> 32);
+		}
+
+		return lanes;
+	}
+
+	std::vector<std::uint32_t> Take(Random& random, std::uint32_t count)
+	{
+		std::vector<std::uint32_t> values(count);
+		for(auto& value : values)
+			value = random.NextUInt32();
+
+		return values;
+	}
+
+	float Length(const XMFLOAT3& v)
+	{
+		return std::sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
+	}
+
+	void MatchesReferenceXoshiro()
+	{
+		// The first outputs from state { 1, 2, 3, 4 }, as other implementations
+		// publish them, check the reference itself.
+		Xoshiro128 reference = { { 1, 2, 3, 4 } };
+		const std::uint32_t expected[] = { 11520, 0, 5927040, 70819200, 2031721883,
+			1637235492, 1287239034, 3734860849, 3729100597, 4258142804 };
+		bool referenceMatches = true;
+		for(std::uint32_t value : expected)
+			referenceMatches &= reference.Next() == value;
+		CHECK(referenceMatches);
+
+		// Every lane of a batch is one reference stream.
+		for(std::uint64_t stream : { 0ull, 1ull, 12345ull })
+		{
+			Random random(Random::DefaultSeed ^ stream, stream);
+			std::vector<Xoshiro128> lanes = ReferenceLanes(Random::DefaultSeed ^ stream, stream);
+
+			bool lane0Matches = true;
+			bool lanesMatch = true;
+			for(int step = 0; step < 100; ++step)
+			{
+				std::uint32_t batch[Random::BatchSize];
+				random.NextUInt32x8(batch);
+
+				lane0Matches &= batch[0] == lanes[0].Next();
+				for(std::uint32_t lane = 1; lane < Random::BatchSize; ++lane)
+					lanesMatch &= batch[lane] == lanes[lane].Next();
+			}
+			CHECK(lane0Matches);
+			CHECK(lanesMatch);
+		}
+	}
+
+	void SeedsGiveReproducibleStreams()
+	{
+		Random a(42, 3);
+		Random b(42, 3);
+		std::vector<std::uint32_t> first = Take(a, 100);
+		CHECK(first == Take(b, 100));
+
+		// Seed() restarts the sequence, also halfway through a batch.
+		a.Seed(42, 3);
+		CHECK(Take(a, 5) == std::vector<std::uint32_t>(first.begin(), first.begin() + 5));
+		a.Seed(42, 3);
+		CHECK(Take(a, 100) == first);
+
+		// Other streams and other seeds give other sequences, and so do the lanes
+		// within one.
+		Random otherStream(42, 4);
+		Random otherSeed(43, 3);
+		CHECK(Take(otherStream, 100) != first);
+		CHECK(Take(otherSeed, 100) != first);
+
+		bool lanesDiffer = true;
+		for(std::uint32_t i = 1; i < Random::BatchSize; ++i)
+			lanesDiffer &= first[i] != first[0];
+		CHECK(lanesDiffer);
+
+		// The default generator is seed DefaultSeed, stream 0.
+		Random byDefault;
+		Random explicitly(Random::DefaultSeed, 0);
+		CHECK(Take(byDefault, 20) == Take(explicitly, 20));
+
+		// The thread's generator repeats after reseeding.
+		Random::SeedThreadLocal(7);
+		std::vector<std::uint32_t> local = Take(Random::ThreadLocal(), 20);
+		Random::SeedThreadLocal(7);
+		CHECK(Take(Random::ThreadLocal(), 20) == local);
+	}
+
+	void BatchesMatchSingleValues()
+	{
+		const std::uint64_t seed = 99;
+
+		// Single values come from the batches in order.
+		Random batches(seed);
+		Random singles(seed);
+		bool uintsMatch = true;
+		for(int step = 0; step < 50; ++step)
+		{
+			std::uint32_t batch[Random::BatchSize];
+			batches.NextUInt32x8(batch);
+			for(std::uint32_t value : batch)
+				uintsMatch &= singles.NextUInt32() == value;
+		}
+		CHECK(uintsMatch);
+
+		// Floats are the top 24 bits, in batches and one at a time.  out needs no
+		// alignment, so the batches are stored one float off.
+		Random bits(seed);
+		Random floats(seed);
+		Random singleFloats(seed);
+		bool floatsMatch = true;
+		bool singleFloatsMatch = true;
+		for(int step = 0; step < 50; ++step)
+		{
+			std::uint32_t batch[Random::BatchSize];
+			float f[Random::BatchSize + 1];
+			bits.NextUInt32x8(batch);
+			floats.NextFloatx8(f + 1);
+
+			for(std::uint32_t i = 0; i < Random::BatchSize; ++i)
+			{
+				float expected = float(batch[i] >> 8) * (1.0f / 16777216.0f);
+				floatsMatch &= f[i + 1] == expected;
+				singleFloatsMatch &= singleFloats.NextFloat() == expected;
+			}
+		}
+		CHECK(floatsMatch);
+		CHECK(singleFloatsMatch);
+
+		// Unit vector batches are built from one batch of floats for z and one for
+		// the angle around z.
+		Random vectors(seed);
+		Random uv(seed);
+		bool vectorsMatch = true;
+		for(int step = 0; step < 50; ++step)
+		{
+			XMFLOAT3 v[Random::BatchSize];
+			float u[Random::BatchSize];
+			float w[Random::BatchSize];
+			vectors.NextUnitVec3x8(v);
+			uv.NextFloatx8(u);
+			uv.NextFloatx8(w);
+
+			for(std::uint32_t i = 0; i < Random::BatchSize; ++i)
+			{
+				float z = 2.0f*u[i] - 1.0f;
+				float r = std::sqrt(std::fmax(0.0f, 1.0f - z*z));
+				float angle = XM_2PI*w[i] - XM_PI;
+
+				vectorsMatch &= std::fabs(v[i].x - r*std::cos(angle)) < 1e-4f;
+				vectorsMatch &= std::fabs(v[i].y - r*std::sin(angle)) < 1e-4f;
+				vectorsMatch &= std::fabs(v[i].z - z) < 1e-6f;
+			}
+		}
+		CHECK(vectorsMatch);
+	}
+
+	void UnitVectorsHaveUnitLength()
+	{
+		Random random(5);
+		const XMVECTOR n = XMVector3Normalize(XMVectorSet(1.0f, -2.0f, 0.5f, 0.0f));
+
+		bool batchLengths = true;
+		bool singleLengths = true;
+		XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+		const int steps = 10000;
+		for(int step = 0; step < steps; ++step)
+		{
+			XMFLOAT3 batch[Random::BatchSize];
+			random.NextUnitVec3x8(batch);
+			for(const auto& v : batch)
+			{
+				batchLengths &= std::fabs(Length(v) - 1.0f) < 1e-5f;
+				sum.x += v.x;
+				sum.y += v.y;
+				sum.z += v.z;
+			}
+
+			random.NextHemisphereUnitVec3x8(n, batch);
+			for(const auto& v : batch)
+				batchLengths &= std::fabs(Length(v) - 1.0f) < 1e-5f;
+
+			XMFLOAT3 single;
+			XMStoreFloat3(&single, random.NextUnitVec3());
+			singleLengths &= std::fabs(Length(single) - 1.0f) < 1e-5f;
+			XMStoreFloat3(&single, random.NextHemisphereUnitVec3(n));
+			singleLengths &= std::fabs(Length(single) - 1.0f) < 1e-5f;
+		}
+		CHECK(batchLengths);
+		CHECK(singleLengths);
+
+		// Uniform on the sphere, so the mean is near the center.  Each coordinate's
+		// standard error is about 0.002 here.
+		const float count = float(steps * Random::BatchSize);
+		CHECK(std::fabs(sum.x / count) < 0.01f);
+		CHECK(std::fabs(sum.y / count) < 0.01f);
+		CHECK(std::fabs(sum.z / count) < 0.01f);
+	}
+
+	void HemisphereMeanDotIsHalf()
+	{
+		Random random(11);
+
+		for(XMVECTOR n : { XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+			XMVector3Normalize(XMVectorSet(-3.0f, 1.0f, 2.0f, 0.0f)) })
+		{
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, n);
+
+			// On a uniform half sphere n.v is uniform in [0, 1].
+			bool aboveBatch = true;
+			bool aboveSingle = true;
+			double batchSum = 0.0;
+			double singleSum = 0.0;
+			const int steps = 10000;
+			for(int step = 0; step < steps; ++step)
+			{
+				XMFLOAT3 batch[Random::BatchSize];
+				random.NextHemisphereUnitVec3x8(n, batch);
+				for(const auto& v : batch)
+				{
+					float d = normal.x*v.x + normal.y*v.y + normal.z*v.z;
+					aboveBatch &= d >= -1e-6f;
+					batchSum += d;
+				}
+
+				for(std::uint32_t i = 0; i < Random::BatchSize; ++i)
+				{
+					float d = XMVectorGetX(XMVector3Dot(n, random.NextHemisphereUnitVec3(n)));
+					aboveSingle &= d >= -1e-6f;
+					singleSum += d;
+				}
+			}
+
+			// The standard error is about 0.001.
+			const double count = double(steps * Random::BatchSize);
+			CHECK(aboveBatch);
+			CHECK(aboveSingle);
+			CHECK(std::fabs(batchSum / count - 0.5) < 0.01);
+			CHECK(std::fabs(singleSum / count - 0.5) < 0.01);
+		}
+	}
+
+	void ValuesStayInTheirRanges()
+	{
+		Random random(3);
+
+		// Inclusive at both ends, every value hit.
+		std::vector<int> hits(7, 0);
+		bool inRange = true;
+		for(int i = 0; i < 7000; ++i)
+		{
+			int value = random.NextInt(-3, 3);
+			inRange &= value >= -3 && value <= 3;
+			if(value >= -3 && value <= 3)
+				++hits[value + 3];
+		}
+		CHECK(inRange);
+		bool everyValue = true;
+		for(int count : hits)
+			everyValue &= count > 700 && count < 1300;
+		CHECK(everyValue);
+
+		// One value, and the full range without overflow.
+		bool single = true;
+		bool signs[2] = { false, false };
+		for(int i = 0; i < 1000; ++i)
+		{
+			single &= random.NextInt(5, 5) == 5;
+			signs[random.NextInt(INT_MIN, INT_MAX) >= 0 ? 1 : 0] = true;
+		}
+		CHECK(single);
+		CHECK(signs[0] && signs[1]);
+
+		// Floats are in [0, 1) and [a, b).
+		bool floatsInRange = true;
+		double sum = 0.0;
+		for(int i = 0; i < 100000; ++i)
+		{
+			float f = random.NextFloat();
+			floatsInRange &= f >= 0.0f && f < 1.0f;
+			sum += f;
+
+			float g = random.NextFloat(-2.0f, 6.0f);
+			floatsInRange &= g >= -2.0f && g < 6.0f;
+		}
+		CHECK(floatsInRange);
+		CHECK(std::fabs(sum / 100000.0 - 0.5) < 0.01);
+
+		float batch[Random::BatchSize];
+		bool batchInRange = true;
+		for(int step = 0; step < 10000; ++step)
+		{
+			random.NextFloatx8(batch);
+			for(float f : batch)
+				batchInRange &= f >= 0.0f && f < 1.0f;
+		}
+		CHECK(batchInRange);
+	}
+}
+
+int main()
+{
+	RUN_TEST(MatchesReferenceXoshiro);
+	RUN_TEST(SeedsGiveReproducibleStreams);
+	RUN_TEST(BatchesMatchSingleValues);
+	RUN_TEST(UnitVectorsHaveUnitLength);
+	RUN_TEST(HemisphereMeanDotIsHalf);
+	RUN_TEST(ValuesStayInTheirRanges);
+
+	return TestResult();
+}
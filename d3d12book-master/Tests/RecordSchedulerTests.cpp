@@ -0,0 +1,200 @@
+//***************************************************************************************
+// RecordSchedulerTests.cpp
+//
+// Command lists are stood in for by one vector of "commands" per slot.  Submitting
+// the slots in order must give the same stream as recording everything serially.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/RecordScheduler.h"
+#include "Common/ThreadPool.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Commands of the single-list passes; draws are their item index, offset by
+	// TransparentBase in the second pass.
+	const std::uint32_t Clear = 1000000;
+	const std::uint32_t Present = 2000000;
+	const std::uint32_t TransparentBase = 100000;
+
+	// Checks the chunks cover [0, itemCount) once, in order, and respect the limits.
+	bool IsValidPartition(const std::vector<RecordTask>& chunks, std::uint32_t chunkCount,
+		std::uint32_t itemCount, std::uint32_t minItemsPerChunk, std::uint32_t maxChunks)
+	{
+		if(chunks.size() != chunkCount || chunkCount > maxChunks)
+			return false;
+
+		std::uint32_t next = 0;
+		std::uint32_t smallest = itemCount;
+		std::uint32_t largest = 0;
+		for(const auto& chunk : chunks)
+		{
+			if(chunk.First != next || chunk.Count == 0)
+				return false;
+
+			next += chunk.Count;
+			smallest = chunk.Count < smallest ? chunk.Count : smallest;
+			largest = chunk.Count > largest ? chunk.Count : largest;
+		}
+
+		if(next != itemCount)
+			return false;
+
+		// Fewer items than minItemsPerChunk still give one chunk.
+		if(chunkCount > 1 && smallest < minItemsPerChunk)
+			return false;
+
+		// As even as possible.
+		return largest - smallest <= 1;
+	}
+
+	void PartitionCoversEveryItemOnce()
+	{
+		std::vector<RecordTask> chunks;
+
+		bool valid = true;
+		for(std::uint32_t itemCount = 0; itemCount < 300; ++itemCount)
+		{
+			for(std::uint32_t minItems : { 1u, 4u, 16u, 64u })
+			{
+				for(std::uint32_t maxChunks : { 1u, 2u, 3u, 8u })
+				{
+					std::uint32_t count = RecordScheduler::Partition(itemCount, minItems, maxChunks, chunks);
+					valid &= IsValidPartition(chunks, count, itemCount, minItems, maxChunks);
+					valid &= (count == 0) == (itemCount == 0);
+				}
+			}
+		}
+		CHECK(valid);
+
+		// Zero and one item.
+		CHECK(RecordScheduler::Partition(0, 4, 8, chunks) == 0);
+		CHECK(chunks.empty());
+		CHECK(RecordScheduler::Partition(1, 4, 8, chunks) == 1);
+		CHECK(chunks.size() == 1 && chunks[0].First == 0 && chunks[0].Count == 1);
+
+		// The worker cap wins over small chunks, and small chunks over the cap.
+		CHECK(RecordScheduler::Partition(1000, 1, 4, chunks) == 4);
+		CHECK(RecordScheduler::Partition(100, 30, 8, chunks) == 3);
+		CHECK(chunks[0].Count == 34 && chunks[1].Count == 33 && chunks[2].Count == 33);
+
+		// Zero limits are treated as one.
+		CHECK(RecordScheduler::Partition(10, 0, 0, chunks) == 1);
+	}
+
+	void SlotsFollowPassOrder()
+	{
+		RecordScheduler scheduler(nullptr);
+		scheduler.SetMinItemsPerChunk(10);
+		scheduler.SetMaxChunksPerPass(4);
+
+		auto noop = [](const RecordTask&) {};
+
+		scheduler.BeginFrame();
+		CHECK(scheduler.AddPass(noop) == 0);
+		CHECK(scheduler.AddChunkedPass(100, noop) == 4);
+		CHECK(scheduler.AddChunkedPass(0, noop) == 0);
+		CHECK(scheduler.AddChunkedPass(1, noop) == 1);
+		CHECK(scheduler.AddPass(noop) == 6);
+		CHECK(scheduler.GetSlotCount() == 7);
+
+		const auto& tasks = scheduler.GetTasks();
+		bool slotsInOrder = true;
+		for(std::uint32_t i = 0; i < (std::uint32_t)tasks.size(); ++i)
+			slotsInOrder &= tasks[i].Slot == i;
+		CHECK(slotsInOrder);
+
+		const std::uint32_t passes[] = { 0, 1, 1, 1, 1, 3, 4 };
+		bool passesMatch = true;
+		for(std::uint32_t i = 0; i < 7; ++i)
+			passesMatch &= tasks[i].Pass == passes[i];
+		CHECK(passesMatch);
+		CHECK(tasks[1].First == 0 && tasks[4].First + tasks[4].Count == 100);
+		CHECK(tasks[5].First == 0 && tasks[5].Count == 1);
+
+		// A new frame starts over.
+		scheduler.BeginFrame();
+		CHECK(scheduler.GetSlotCount() == 0);
+		CHECK(scheduler.AddPass(noop) == 0);
+	}
+
+	// Records a frame of a clear, two chunked draw passes and a present barrier into
+	// per-slot command lists and returns them concatenated in slot order.  Earlier
+	// chunks sleep longer, so with a pool they finish last.
+	std::vector<std::uint32_t> RecordFrame(RecordScheduler& scheduler, std::uint32_t opaqueCount,
+		std::uint32_t transparentCount)
+	{
+		std::vector<std::vector<std::uint32_t>> lists;
+
+		scheduler.BeginFrame();
+		scheduler.AddPass([&lists](const RecordTask& task) { lists[task.Slot].push_back(Clear); });
+
+		auto drawChunk = [&lists](const RecordTask& task, std::uint32_t base)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(200 / (task.Slot + 1)));
+			for(std::uint32_t i = task.First; i < task.First + task.Count; ++i)
+				lists[task.Slot].push_back(base + i);
+		};
+		scheduler.AddChunkedPass(opaqueCount, [&drawChunk](const RecordTask& task) { drawChunk(task, 0); });
+		scheduler.AddChunkedPass(transparentCount, [&drawChunk](const RecordTask& task) { drawChunk(task, TransparentBase); });
+
+		scheduler.AddPass([&lists](const RecordTask& task) { lists[task.Slot].push_back(Present); });
+
+		lists.resize(scheduler.GetSlotCount());
+		scheduler.Execute();
+
+		std::vector<std::uint32_t> stream;
+		for(const auto& list : lists)
+			stream.insert(stream.end(), list.begin(), list.end());
+
+		return stream;
+	}
+
+	void SubmissionOrderMatchesSerialRecording()
+	{
+		ThreadPool pool(3);
+
+		RecordScheduler serial(nullptr);
+		RecordScheduler parallel(&pool);
+		parallel.SetMinItemsPerChunk(8);
+		CHECK(serial.GetTasks().empty());
+
+		bool sameStream = true;
+		bool usedChunks = false;
+		const std::uint32_t sizes[][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 7, 100 }, { 500, 33 }, { 2000, 2000 } };
+		for(int repeat = 0; repeat < 5; ++repeat)
+		{
+			for(const auto& size : sizes)
+			{
+				// The draw order: clear, every item of both passes in order, present.
+				std::vector<std::uint32_t> expected(1, Clear);
+				for(std::uint32_t i = 0; i < size[0]; ++i)
+					expected.push_back(i);
+				for(std::uint32_t i = 0; i < size[1]; ++i)
+					expected.push_back(TransparentBase + i);
+				expected.push_back(Present);
+
+				sameStream &= RecordFrame(serial, size[0], size[1]) == expected;
+				sameStream &= RecordFrame(parallel, size[0], size[1]) == expected;
+				usedChunks |= parallel.GetSlotCount() > serial.GetSlotCount();
+			}
+		}
+
+		CHECK(sameStream);
+		CHECK(usedChunks);
+	}
+}
+
+int main()
+{
+	RUN_TEST(PartitionCoversEveryItemOnce);
+	RUN_TEST(SlotsFollowPassOrder);
+	RUN_TEST(SubmissionOrderMatchesSerialRecording);
+
+	return TestResult();
+}
@@ -0,0 +1,366 @@
+//***************************************************************************************
+// RenderGraphTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/RenderGraph.h"
+
+#include <vector>
+
+namespace
+{
+	// The D3D12_RESOURCE_STATES values the tests use.
+	const std::uint32_t Common = 0x0;
+	const std::uint32_t RenderTarget = 0x4;
+	const std::uint32_t UnorderedAccess = 0x8;
+	const std::uint32_t DepthWrite = 0x10;
+	const std::uint32_t NonPixelShaderResource = 0x40;
+	const std::uint32_t PixelShaderResource = 0x80;
+	const std::uint32_t Present = 0x0;
+
+	bool IsTransition(const RenderGraphBarrier& b, RenderGraphResource resource, std::uint32_t before, std::uint32_t after)
+	{
+		return b.Type == RenderGraphBarrierType::Transition && b.Resource == resource &&
+			b.Before == before && b.After == after;
+	}
+
+	bool IsAliasing(const RenderGraphBarrier& b, RenderGraphResource resource, RenderGraphResource aliased)
+	{
+		return b.Type == RenderGraphBarrierType::Aliasing && b.Resource == resource && b.AliasedResource == aliased;
+	}
+
+	bool IsUnorderedAccess(const RenderGraphBarrier& b, RenderGraphResource resource)
+	{
+		return b.Type == RenderGraphBarrierType::UnorderedAccess && b.Resource == resource;
+	}
+
+	std::uint32_t BarrierCount(const RenderGraph& graph, std::uint32_t step)
+	{
+		const RenderGraphBarrier* barriers;
+		std::uint32_t count;
+		graph.GetBarriers(step, barriers, count);
+		return count;
+	}
+
+	const RenderGraphBarrier& Barrier(const RenderGraph& graph, std::uint32_t step, std::uint32_t index)
+	{
+		const RenderGraphBarrier* barriers;
+		std::uint32_t count;
+		graph.GetBarriers(step, barriers, count);
+		return barriers[index];
+	}
+
+	void CullsPassesThatReachNoOutput()
+	{
+		RenderGraph graph;
+		RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", Present, Present);
+		RenderGraphResource depth = graph.ImportResource("Depth", DepthWrite, DepthWrite);
+		RenderGraphResource unused = graph.CreateTransient("Unused", 1024, 256);
+		RenderGraphResource log = graph.CreateTransient("Log", 1024, 256);
+		graph.MarkOutput(backBuffer);
+
+		std::vector<std::uint32_t> ran;
+		std::uint32_t depthPass = graph.AddPass("Depth", [&ran]() { ran.push_back(0); });
+		std::uint32_t unusedPass = graph.AddPass("Unused", [&ran]() { ran.push_back(1); });
+		std::uint32_t colorPass = graph.AddPass("Color", [&ran]() { ran.push_back(2); });
+		std::uint32_t logPass = graph.AddPass("Log", [&ran]() { ran.push_back(3); });
+		graph.Write(depthPass, depth, DepthWrite);
+		graph.Write(unusedPass, unused, RenderTarget);
+		graph.Read(colorPass, depth, DepthWrite);
+		graph.Write(colorPass, backBuffer, RenderTarget);
+		graph.Write(logPass, log, UnorderedAccess);
+		graph.SetSideEffects(logPass);
+		graph.Compile();
+
+		CHECK(!graph.IsPassCulled(depthPass));
+		CHECK(graph.IsPassCulled(unusedPass));
+		CHECK(!graph.IsPassCulled(colorPass));
+		CHECK(!graph.IsPassCulled(logPass));
+		CHECK(graph.GetStats().PassCount == 4);
+		CHECK(graph.GetStats().CulledPassCount == 1);
+		CHECK((graph.GetExecutionOrder() == std::vector<std::uint32_t>{ depthPass, colorPass, logPass }));
+
+		// The culled pass's transient gets no memory.
+		CHECK(!graph.IsAllocated(unused));
+		CHECK(graph.IsAllocated(log));
+
+		std::uint32_t batchCount = 0;
+		graph.Execute([&batchCount](const RenderGraphBarrier*, std::uint32_t count)
+		{
+			CHECK(count > 0);
+			++batchCount;
+		});
+		CHECK((ran == std::vector<std::uint32_t>{ 0, 2, 3 }));
+		CHECK(batchCount == graph.GetStats().BarrierBatchCount);
+	}
+
+	void CullsWritesOverwrittenBeforeTheyAreRead()
+	{
+		// The second pass replaces the whole target without reading it.
+		RenderGraph graph;
+		RenderGraphResource target = graph.ImportResource("Target", RenderTarget, RenderTarget);
+		RenderGraphResource output = graph.ImportResource("Output", RenderTarget, RenderTarget);
+		graph.MarkOutput(output);
+
+		std::uint32_t first = graph.AddPass("First", nullptr);
+		std::uint32_t second = graph.AddPass("Second", nullptr);
+		std::uint32_t resolve = graph.AddPass("Resolve", nullptr);
+		graph.Write(first, target, RenderTarget);
+		graph.Write(second, target, RenderTarget);
+		graph.Read(resolve, target, PixelShaderResource);
+		graph.Write(resolve, output, RenderTarget);
+		graph.Compile();
+
+		CHECK(graph.IsPassCulled(first));
+		CHECK(!graph.IsPassCulled(second));
+		CHECK(!graph.IsPassCulled(resolve));
+	}
+
+	void MergesConsecutiveReads()
+	{
+		RenderGraph graph;
+		RenderGraphResource target = graph.ImportResource("Target", Common, PixelShaderResource);
+		RenderGraphResource a = graph.ImportResource("A", RenderTarget, RenderTarget);
+		RenderGraphResource b = graph.ImportResource("B", RenderTarget, RenderTarget);
+		graph.MarkOutput(a);
+		graph.MarkOutput(b);
+
+		std::uint32_t draw = graph.AddPass("Draw", nullptr);
+		std::uint32_t readA = graph.AddPass("ReadA", nullptr);
+		std::uint32_t readB = graph.AddPass("ReadB", nullptr);
+		graph.Write(draw, target, RenderTarget);
+		graph.Read(readA, target, PixelShaderResource);
+		graph.Write(readA, a, RenderTarget);
+		graph.Read(readB, target, NonPixelShaderResource);
+		graph.Write(readB, b, RenderTarget);
+		graph.Compile();
+
+		// One transition to both read states serves both readers.
+		CHECK(BarrierCount(graph, 0) == 1);
+		CHECK(IsTransition(Barrier(graph, 0, 0), target, Common, RenderTarget));
+		CHECK(BarrierCount(graph, 1) == 1);
+		CHECK(IsTransition(Barrier(graph, 1, 0), target, RenderTarget, PixelShaderResource | NonPixelShaderResource));
+		CHECK(BarrierCount(graph, 2) == 0);
+
+		const RenderGraphBarrier* barriers;
+		std::uint32_t count;
+		graph.GetFinalBarriers(barriers, count);
+		CHECK(count == 1);
+		CHECK(IsTransition(barriers[0], target, PixelShaderResource | NonPixelShaderResource, PixelShaderResource));
+
+		CHECK(graph.GetStats().BarrierCount == 3);
+		CHECK(graph.GetStats().BarrierBatchCount == 3);
+	}
+
+	void LeavesCoveringStatesAlone()
+	{
+		// Already readable in the state the resource starts in.
+		RenderGraph graph;
+		RenderGraphResource texture = graph.ImportResource("Texture",
+			PixelShaderResource | NonPixelShaderResource, PixelShaderResource | NonPixelShaderResource);
+		RenderGraphResource output = graph.ImportResource("Output", RenderTarget, RenderTarget);
+		graph.MarkOutput(output);
+
+		std::uint32_t pass = graph.AddPass("Pass", nullptr);
+		graph.Read(pass, texture, PixelShaderResource);
+		graph.Write(pass, output, RenderTarget);
+		graph.Compile();
+
+		CHECK(graph.GetStats().BarrierCount == 0);
+		CHECK(graph.GetStats().BarrierBatchCount == 0);
+	}
+
+	void RestoresFinalStates()
+	{
+		RenderGraph graph;
+		RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", Present, Present);
+		RenderGraphResource shadow = graph.ImportResource("Shadow", PixelShaderResource, PixelShaderResource | NonPixelShaderResource);
+		RenderGraphResource untouched = graph.ImportResource("Untouched", Common, PixelShaderResource);
+		graph.MarkOutput(backBuffer);
+
+		std::uint32_t shadowPass = graph.AddPass("Shadow", nullptr);
+		std::uint32_t colorPass = graph.AddPass("Color", nullptr);
+		graph.Write(shadowPass, shadow, DepthWrite);
+		graph.Read(colorPass, shadow, PixelShaderResource);
+		graph.Write(colorPass, backBuffer, RenderTarget);
+		graph.Compile();
+
+		// The shadow map's last reads go straight to its final state, which allows them.
+		CHECK(BarrierCount(graph, 0) == 1);
+		CHECK(IsTransition(Barrier(graph, 0, 0), shadow, PixelShaderResource, DepthWrite));
+		CHECK(BarrierCount(graph, 1) == 2);
+		CHECK(IsTransition(Barrier(graph, 1, 0), backBuffer, Present, RenderTarget));
+		CHECK(IsTransition(Barrier(graph, 1, 1), shadow, DepthWrite, PixelShaderResource | NonPixelShaderResource));
+
+		// The back buffer is presented, and a resource no pass uses still ends up in
+		// its final state.
+		const RenderGraphBarrier* barriers;
+		std::uint32_t count;
+		graph.GetFinalBarriers(barriers, count);
+		CHECK(count == 2);
+		CHECK(IsTransition(barriers[0], backBuffer, RenderTarget, Present));
+		CHECK(IsTransition(barriers[1], untouched, Common, PixelShaderResource));
+	}
+
+	void AliasesTransientsWithDisjointLifetimes()
+	{
+		// A chain of three passes over transients: the first and the third are never
+		// alive at the same time, so they share memory.
+		RenderGraph graph;
+		RenderGraphResource t0 = graph.CreateTransient("T0", 1024, 256);
+		RenderGraphResource t1 = graph.CreateTransient("T1", 1024, 256);
+		RenderGraphResource t2 = graph.CreateTransient("T2", 1024, 256);
+		RenderGraphResource output = graph.ImportResource("Output", RenderTarget, RenderTarget);
+		graph.MarkOutput(output);
+
+		std::uint32_t pass0 = graph.AddPass("Pass0", nullptr);
+		std::uint32_t pass1 = graph.AddPass("Pass1", nullptr);
+		std::uint32_t pass2 = graph.AddPass("Pass2", nullptr);
+		std::uint32_t pass3 = graph.AddPass("Pass3", nullptr);
+		graph.Write(pass0, t0, RenderTarget);
+		graph.Read(pass1, t0, PixelShaderResource);
+		graph.Write(pass1, t1, RenderTarget);
+		graph.Read(pass2, t1, PixelShaderResource);
+		graph.Write(pass2, t2, RenderTarget);
+		graph.Read(pass3, t2, PixelShaderResource);
+		graph.Write(pass3, output, RenderTarget);
+		graph.Compile();
+
+		CHECK(graph.IsTransient(t0) && !graph.IsTransient(output));
+		CHECK(graph.GetHeapOffset(t0) == 0);
+		CHECK(graph.GetHeapOffset(t1) == 1024);
+		CHECK(graph.GetHeapOffset(t2) == 0);
+		CHECK(graph.GetTransientHeapSize() == 2048);
+		CHECK(graph.GetStats().TransientBytes == 3072);
+		CHECK(graph.GetStats().TransientHeapSize == 2048);
+
+		// T0 takes the memory over from last frame's T2, T2 from T0, and both come
+		// before the transitions of their batch.  T1 shares with nothing.
+		CHECK(BarrierCount(graph, 0) == 2);
+		CHECK(IsAliasing(Barrier(graph, 0, 0), t0, InvalidRenderGraphResource));
+		CHECK(IsTransition(Barrier(graph, 0, 1), t0, PixelShaderResource, RenderTarget));
+		CHECK(BarrierCount(graph, 2) == 3);
+		CHECK(IsAliasing(Barrier(graph, 2, 0), t2, t0));
+		CHECK(IsTransition(Barrier(graph, 2, 1), t1, RenderTarget, PixelShaderResource));
+		CHECK(IsTransition(Barrier(graph, 2, 2), t2, PixelShaderResource, RenderTarget));
+
+		for(std::uint32_t step = 0; step < 4; ++step)
+		{
+			for(std::uint32_t i = 0; i < BarrierCount(graph, step); ++i)
+				CHECK(Barrier(graph, step, i).Type != RenderGraphBarrierType::Aliasing || Barrier(graph, step, i).Resource != t1);
+		}
+
+		// Transients start each frame in the state they were last used in.
+		CHECK(graph.GetInitialState(t0) == PixelShaderResource);
+		CHECK(graph.GetInitialState(t2) == PixelShaderResource);
+	}
+
+	void KeepsOverlappingLifetimesApart()
+	{
+		RenderGraph graph;
+		RenderGraphResource t0 = graph.CreateTransient("T0", 4096, 4096);
+		RenderGraphResource t1 = graph.CreateTransient("T1", 1000, 256);
+		RenderGraphResource output = graph.ImportResource("Output", RenderTarget, RenderTarget);
+		graph.MarkOutput(output);
+
+		std::uint32_t pass0 = graph.AddPass("Pass0", nullptr);
+		std::uint32_t pass1 = graph.AddPass("Pass1", nullptr);
+		graph.Write(pass0, t0, RenderTarget);
+		graph.Write(pass0, t1, RenderTarget);
+		graph.Read(pass1, t0, PixelShaderResource);
+		graph.Read(pass1, t1, PixelShaderResource);
+		graph.Write(pass1, output, RenderTarget);
+		graph.Compile();
+
+		// Placed one after the other, at T1's alignment, and no aliasing barriers.
+		CHECK(graph.GetHeapOffset(t0) == 0);
+		CHECK(graph.GetHeapOffset(t1) == 4096);
+		CHECK(graph.GetTransientHeapSize() == 5096);
+		for(std::uint32_t step = 0; step < 2; ++step)
+		{
+			for(std::uint32_t i = 0; i < BarrierCount(graph, step); ++i)
+				CHECK(Barrier(graph, step, i).Type == RenderGraphBarrierType::Transition);
+		}
+	}
+
+	void SeparatesUnorderedAccessWrites()
+	{
+		// A compute blur ping-ponging in place: every pass reads and writes the same
+		// texture as a UAV, so nothing changes state and only UAV barriers order them.
+		RenderGraph graph;
+		RenderGraphResource texture = graph.ImportResource("Texture", UnorderedAccess, UnorderedAccess);
+		RenderGraphResource output = graph.ImportResource("Output", RenderTarget, RenderTarget);
+		graph.MarkOutput(output);
+
+		std::uint32_t clear = graph.AddPass("Clear", nullptr);
+		std::uint32_t blurH = graph.AddPass("BlurH", nullptr);
+		std::uint32_t blurV = graph.AddPass("BlurV", nullptr);
+		std::uint32_t reduce0 = graph.AddPass("Reduce0", nullptr);
+		std::uint32_t reduce1 = graph.AddPass("Reduce1", nullptr);
+		std::uint32_t composite = graph.AddPass("Composite", nullptr);
+		graph.Write(clear, texture, UnorderedAccess);
+		graph.Read(blurH, texture, UnorderedAccess);
+		graph.Write(blurH, texture, UnorderedAccess);
+		graph.Read(blurV, texture, UnorderedAccess);
+		graph.Write(blurV, texture, UnorderedAccess);
+		graph.Read(reduce0, texture, UnorderedAccess);
+		graph.Write(reduce0, output, RenderTarget);
+		graph.Read(reduce1, texture, UnorderedAccess);
+		graph.Write(reduce1, output, RenderTarget);
+		graph.Read(composite, texture, PixelShaderResource);
+		graph.Write(composite, output, RenderTarget);
+		graph.Compile();
+
+		// The first access has nothing earlier in the frame to wait for.
+		CHECK(BarrierCount(graph, 0) == 0);
+
+		// Write after write, and read after write.
+		CHECK(BarrierCount(graph, 1) == 1);
+		CHECK(IsUnorderedAccess(Barrier(graph, 1, 0), texture));
+		CHECK(BarrierCount(graph, 2) == 1);
+		CHECK(IsUnorderedAccess(Barrier(graph, 2, 0), texture));
+		CHECK(BarrierCount(graph, 3) == 1);
+		CHECK(IsUnorderedAccess(Barrier(graph, 3, 0), texture));
+
+		// Reads after reads need nothing, and a transition out of the state waits on
+		// its own.
+		CHECK(BarrierCount(graph, 4) == 0);
+		CHECK(BarrierCount(graph, 5) == 1);
+		CHECK(IsTransition(Barrier(graph, 5, 0), texture, UnorderedAccess, PixelShaderResource));
+	}
+
+	void ClearEmptiesTheGraph()
+	{
+		RenderGraph graph;
+		RenderGraphResource output = graph.ImportResource("Output", Present, Present);
+		graph.MarkOutput(output);
+		graph.Write(graph.AddPass("Pass", nullptr), output, RenderTarget);
+		graph.Compile();
+		CHECK(graph.IsCompiled());
+
+		graph.Clear();
+		CHECK(!graph.IsCompiled());
+		CHECK(graph.GetPassCount() == 0);
+		CHECK(graph.GetResourceCount() == 0);
+
+		graph.Compile();
+		CHECK(graph.GetExecutionOrder().empty());
+		CHECK(graph.GetStats().BarrierCount == 0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(CullsPassesThatReachNoOutput);
+	RUN_TEST(CullsWritesOverwrittenBeforeTheyAreRead);
+	RUN_TEST(MergesConsecutiveReads);
+	RUN_TEST(LeavesCoveringStatesAlone);
+	RUN_TEST(RestoresFinalStates);
+	RUN_TEST(AliasesTransientsWithDisjointLifetimes);
+	RUN_TEST(KeepsOverlappingLifetimesApart);
+	RUN_TEST(SeparatesUnorderedAccessWrites);
+	RUN_TEST(ClearEmptiesTheGraph);
+
+	return TestResult();
+}
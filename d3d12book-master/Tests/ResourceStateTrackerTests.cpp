@@ -0,0 +1,214 @@
+//***************************************************************************************
+// ResourceStateTrackerTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/ResourceStateTracker.h"
+
+namespace
+{
+	// The D3D12_RESOURCE_STATES values the tests use.
+	const std::uint32_t Common = 0x0;
+	const std::uint32_t RenderTarget = 0x4;
+	const std::uint32_t UnorderedAccess = 0x8;
+	const std::uint32_t DepthWrite = 0x10;
+	const std::uint32_t PixelShaderResource = 0x80;
+	const std::uint32_t CopyDest = 0x400;
+
+	// Any distinct addresses do as resources.
+	int gTexture, gDepth, gBuffer;
+
+	bool IsTransition(const StateTransition& t, const void* resource, std::uint32_t subresource,
+		std::uint32_t before, std::uint32_t after)
+	{
+		return t.Resource == resource && t.Subresource == subresource && t.Before == before && t.After == after;
+	}
+
+	void TransitionsWholeResources()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 1, Common);
+		tracker.Register(&gDepth, 1, DepthWrite);
+
+		tracker.Transition(&gTexture, RenderTarget);
+		tracker.Transition(&gDepth, PixelShaderResource);
+		CHECK(tracker.GetState(&gTexture) == RenderTarget);
+		CHECK(tracker.HasPendingTransitions());
+
+		const std::vector<StateTransition>& transitions = tracker.Flush();
+		CHECK(transitions.size() == 2);
+		CHECK(IsTransition(transitions[0], &gTexture, AllSubresources, Common, RenderTarget));
+		CHECK(IsTransition(transitions[1], &gDepth, AllSubresources, DepthWrite, PixelShaderResource));
+		CHECK(!tracker.HasPendingTransitions());
+	}
+
+	void TransitionsSingleSubresources()
+	{
+		// A texture with 4 mips, one of them rendered to while another is read.
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 4, PixelShaderResource);
+
+		tracker.Transition(&gTexture, RenderTarget, 1);
+		tracker.Transition(&gTexture, CopyDest, 3);
+		CHECK(tracker.GetState(&gTexture, 0) == PixelShaderResource);
+		CHECK(tracker.GetState(&gTexture, 1) == RenderTarget);
+
+		const std::vector<StateTransition>& transitions = tracker.Flush();
+		CHECK(transitions.size() == 2);
+		CHECK(IsTransition(transitions[0], &gTexture, 1, PixelShaderResource, RenderTarget));
+		CHECK(IsTransition(transitions[1], &gTexture, 3, PixelShaderResource, CopyDest));
+	}
+
+	void GetStateReportsMixedStates()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 2, Common);
+		CHECK(tracker.GetState(&gTexture) == Common);
+
+		tracker.Transition(&gTexture, RenderTarget, 0);
+		CHECK(tracker.GetState(&gTexture) == MixedResourceState);
+		CHECK(tracker.GetState(&gTexture) != Common);
+
+		tracker.Transition(&gTexture, RenderTarget, 1);
+		CHECK(tracker.GetState(&gTexture) == RenderTarget);
+	}
+
+	void SplitsAllSubresourcesIntoSubresources()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 3, PixelShaderResource);
+
+		// Whole resource to RT, then one mip on to UAV: the subresources end up in
+		// different states, so each is transitioned on its own.
+		tracker.Transition(&gTexture, RenderTarget);
+		tracker.Transition(&gTexture, UnorderedAccess, 2);
+
+		const std::vector<StateTransition>& transitions = tracker.Flush();
+		CHECK(transitions.size() == 3);
+		CHECK(IsTransition(transitions[0], &gTexture, 0, PixelShaderResource, RenderTarget));
+		CHECK(IsTransition(transitions[1], &gTexture, 1, PixelShaderResource, RenderTarget));
+		CHECK(IsTransition(transitions[2], &gTexture, 2, PixelShaderResource, UnorderedAccess));
+	}
+
+	void MergesSubresourcesIntoAllSubresources()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 3, PixelShaderResource);
+
+		// Every subresource moved one by one from the same state to the same state.
+		for(std::uint32_t i = 0; i < 3; ++i)
+			tracker.Transition(&gTexture, RenderTarget, i);
+
+		const std::vector<StateTransition>& first = tracker.Flush();
+		CHECK(first.size() == 1);
+		CHECK(IsTransition(first[0], &gTexture, AllSubresources, PixelShaderResource, RenderTarget));
+
+		// Subresources that start out in different states cannot be merged, even if
+		// they all end in one.
+		tracker.Transition(&gTexture, CopyDest, 0);
+		tracker.Flush();
+		tracker.Transition(&gTexture, PixelShaderResource);
+
+		const std::vector<StateTransition>& second = tracker.Flush();
+		CHECK(second.size() == 3);
+		CHECK(IsTransition(second[0], &gTexture, 0, CopyDest, PixelShaderResource));
+		CHECK(IsTransition(second[1], &gTexture, 1, RenderTarget, PixelShaderResource));
+	}
+
+	void DropsRedundantTransitions()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 1, PixelShaderResource);
+		tracker.Register(&gBuffer, 1, Common);
+
+		// Already there.
+		tracker.Transition(&gTexture, PixelShaderResource);
+		CHECK(!tracker.HasPendingTransitions());
+
+		// There and back again between flushes.
+		tracker.Transition(&gTexture, RenderTarget);
+		tracker.Transition(&gTexture, PixelShaderResource);
+
+		// A -> B -> C collapses to A -> C.
+		tracker.Transition(&gBuffer, CopyDest);
+		tracker.Transition(&gBuffer, UnorderedAccess);
+
+		const std::vector<StateTransition>& transitions = tracker.Flush();
+		CHECK(transitions.size() == 1);
+		CHECK(IsTransition(transitions[0], &gBuffer, AllSubresources, Common, UnorderedAccess));
+
+		const StateTrackerStats& stats = tracker.GetStats();
+		CHECK(stats.RequestCount == 5);
+		CHECK(stats.RedundantCount == 1);
+		CHECK(stats.TransitionCount == 1);
+	}
+
+	// What StateTrackedCommandList does: transitions are requested as passes need them
+	// and flushed once before each draw or dispatch.
+	void FlushesOneBatchPerDraw()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 1, PixelShaderResource);
+		tracker.Register(&gDepth, 1, DepthWrite);
+		tracker.Register(&gBuffer, 1, Common);
+
+		// Draw 1: render target and depth buffer, two transitions in one batch.
+		tracker.Transition(&gTexture, RenderTarget);
+		tracker.Transition(&gDepth, DepthWrite);
+		tracker.Transition(&gBuffer, PixelShaderResource);
+		CHECK(tracker.Flush().size() == 2);
+
+		// Draw 2: same states, nothing to flush and no empty batch.
+		tracker.Transition(&gTexture, RenderTarget);
+		tracker.Transition(&gDepth, DepthWrite);
+		CHECK(!tracker.HasPendingTransitions());
+		CHECK(tracker.Flush().empty());
+
+		// Dispatch: three changes, one batch.
+		tracker.Transition(&gTexture, UnorderedAccess);
+		tracker.Transition(&gDepth, PixelShaderResource);
+		tracker.Transition(&gBuffer, UnorderedAccess);
+		CHECK(tracker.Flush().size() == 3);
+
+		const StateTrackerStats& stats = tracker.GetStats();
+		CHECK(stats.BatchCount == 2);
+		CHECK(stats.TransitionCount == 5);
+		CHECK(stats.RedundantCount == 3);
+
+		tracker.ResetStats();
+		CHECK(tracker.GetStats().BatchCount == 0);
+	}
+
+	void RegisterResetsAndUnregisterDropsPending()
+	{
+		ResourceStateTracker tracker;
+		tracker.Register(&gTexture, 1, Common);
+		tracker.Transition(&gTexture, RenderTarget);
+
+		// Registering again forgets the pending change.
+		tracker.Register(&gTexture, 2, CopyDest);
+		CHECK(!tracker.HasPendingTransitions());
+		CHECK(tracker.GetState(&gTexture) == CopyDest);
+
+		tracker.Transition(&gTexture, PixelShaderResource);
+		tracker.Unregister(&gTexture);
+		CHECK(!tracker.IsRegistered(&gTexture));
+		CHECK(!tracker.HasPendingTransitions());
+		CHECK(tracker.Flush().empty());
+	}
+}
+
+int main()
+{
+	RUN_TEST(TransitionsWholeResources);
+	RUN_TEST(TransitionsSingleSubresources);
+	RUN_TEST(GetStateReportsMixedStates);
+	RUN_TEST(SplitsAllSubresourcesIntoSubresources);
+	RUN_TEST(MergesSubresourcesIntoAllSubresources);
+	RUN_TEST(DropsRedundantTransitions);
+	RUN_TEST(FlushesOneBatchPerDraw);
+	RUN_TEST(RegisterResetsAndUnregisterDropsPending);
+
+	return TestResult();
+}
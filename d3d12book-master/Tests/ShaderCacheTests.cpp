@@ -0,0 +1,289 @@
+//***************************************************************************************
+// ShaderCacheTests.cpp
+//
+// The shaders are small files written to the working directory; the compiler is a
+// stub that turns a request into bytes naming its entry point.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/ShaderCache.h"
+#include "Common/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const char* MainFilename = "ShaderCacheTests_Main.hlsl";
+	const char* CommonFilename = "ShaderCacheTests_Common.hlsli";
+	const char* PackFilename = "ShaderCacheTests.pack";
+
+	void WriteFile(const std::string& filename, const std::string& contents)
+	{
+		std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+		fout << contents;
+	}
+
+	std::vector<std::uint8_t> ReadFile(const std::string& filename)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	void WriteShaders()
+	{
+		WriteFile(MainFilename, "#include \"ShaderCacheTests_Common.hlsli\"\nfloat4 VS() : SV_POSITION { return Scale; }\n");
+		WriteFile(CommonFilename, "static const float4 Scale = 1.0f;\n");
+	}
+
+	void RemoveShaders()
+	{
+		std::remove(MainFilename);
+		std::remove(CommonFilename);
+		std::remove(PackFilename);
+	}
+
+	ShaderCompileRequest MakeRequest(const std::string& entryPoint)
+	{
+		ShaderCompileRequest request;
+		request.Filename = MainFilename;
+		request.Defines = { { "FOG", "1" } };
+		request.EntryPoint = entryPoint;
+		request.Target = "vs_5_0";
+		return request;
+	}
+
+	bool StubCompile(const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode)
+	{
+		bytecode.assign(request.EntryPoint.begin(), request.EntryPoint.end());
+		return true;
+	}
+
+	bool FailCompile(const ShaderCompileRequest&, std::vector<std::uint8_t>&)
+	{
+		return false;
+	}
+
+	bool HasBytecode(const ShaderCache& cache, std::uint32_t request, const std::string& expected)
+	{
+		const std::vector<std::uint8_t>* bytecode = cache.GetBytecode(request);
+		return bytecode != nullptr && std::string(bytecode->begin(), bytecode->end()) == expected;
+	}
+
+	void KeyDependsOnEverythingTheCompilerSees()
+	{
+		WriteShaders();
+
+		ShaderCache cache(StubCompile);
+		ShaderCompileRequest request = MakeRequest("VS");
+		std::uint64_t key = cache.ComputeKey(request);
+		CHECK(cache.ComputeKey(request) == key);
+
+		std::set<std::uint64_t> keys = { key };
+		auto isNew = [&keys](std::uint64_t k) { return keys.insert(k).second; };
+
+		// Editing an included file changes the key, and undoing the edit restores it.
+		WriteFile(CommonFilename, "static const float4 Scale = 2.0f;\n");
+		CHECK(isNew(cache.ComputeKey(request)));
+		WriteShaders();
+		CHECK(cache.ComputeKey(request) == key);
+
+		// So does deleting it.
+		std::remove(CommonFilename);
+		CHECK(isNew(cache.ComputeKey(request)));
+		WriteShaders();
+
+		ShaderCompileRequest changed = request;
+		changed.Defines[0].Value = "0";
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		changed = request;
+		changed.Defines[0].Name = "FOG2";
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		changed = request;
+		changed.Defines.push_back({ "ALPHA_TEST", "1" });
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		changed = request;
+		changed.EntryPoint = "PS";
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		changed = request;
+		changed.Target = "vs_5_1";
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		changed = request;
+		changed.Flags = 1;
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		// Strings are length prefixed, so moving characters between fields matters.
+		changed = request;
+		changed.Defines[0].Name = "FOG1";
+		changed.Defines[0].Value = "";
+		CHECK(isNew(cache.ComputeKey(changed)));
+
+		cache.SetCompilerId("compiler 2");
+		CHECK(isNew(cache.ComputeKey(request)));
+
+		RemoveShaders();
+	}
+
+	void PackRoundTrips()
+	{
+		WriteShaders();
+
+		ShaderCache cache(StubCompile);
+		cache.Add(MakeRequest("VS"));
+		cache.Add(MakeRequest("PS"));
+		CHECK(cache.Resolve());
+		CHECK(cache.IsDirty());
+		CHECK(cache.SavePack(PackFilename));
+		CHECK(!cache.IsDirty());
+
+		// Everything comes from the pack; nothing is compiled.
+		std::vector<std::uint8_t> pack = ReadFile(PackFilename);
+		ShaderCache loaded(FailCompile);
+		CHECK(loaded.LoadPack(pack.data(), pack.size()));
+		CHECK(loaded.GetEntryCount() == 2);
+		CHECK(!loaded.IsDirty());
+
+		std::uint32_t ps = loaded.Add(MakeRequest("PS"));
+		std::uint32_t vs = loaded.Add(MakeRequest("VS"));
+		CHECK(loaded.Resolve());
+		CHECK(HasBytecode(loaded, vs, "VS"));
+		CHECK(HasBytecode(loaded, ps, "PS"));
+		CHECK(loaded.GetStats().HitCount == 2);
+		CHECK(loaded.GetStats().MissCount == 0);
+
+		// The same entries always make the same file.
+		CHECK(loaded.SavePack(PackFilename));
+		CHECK(ReadFile(PackFilename) == pack);
+
+		RemoveShaders();
+	}
+
+	void IgnoresCorruptPacks()
+	{
+		WriteShaders();
+
+		ShaderCache cache(StubCompile);
+		cache.Add(MakeRequest("VS"));
+		cache.Add(MakeRequest("PS"));
+		CHECK(cache.Resolve());
+		CHECK(cache.SavePack(PackFilename));
+		std::vector<std::uint8_t> pack = ReadFile(PackFilename);
+
+		ShaderCache loaded(StubCompile);
+
+		// Truncated in the header, in the index and in the bytecode.
+		CHECK(!loaded.LoadPack(pack.data(), 8));
+		CHECK(!loaded.LoadPack(pack.data(), 24));
+		CHECK(!loaded.LoadPack(pack.data(), pack.size() - 1));
+		CHECK(loaded.GetEntryCount() == 0);
+
+		// Another magic or version.
+		std::vector<std::uint8_t> corrupt = pack;
+		corrupt[0] ^= 0xff;
+		CHECK(!loaded.LoadPack(corrupt.data(), corrupt.size()));
+		corrupt = pack;
+		corrupt[4] ^= 0xff;
+		CHECK(!loaded.LoadPack(corrupt.data(), corrupt.size()));
+
+		// An entry pointing into the index.
+		corrupt = pack;
+		std::uint64_t offset = 0;
+		std::memcpy(&corrupt[16 + 8], &offset, sizeof(offset));
+		CHECK(!loaded.LoadPack(corrupt.data(), corrupt.size()));
+		CHECK(loaded.GetEntryCount() == 0);
+
+		// The cache then fills up again.
+		std::uint32_t vs = loaded.Add(MakeRequest("VS"));
+		CHECK(loaded.Resolve());
+		CHECK(HasBytecode(loaded, vs, "VS"));
+		CHECK(loaded.GetStats().MissCount == 1);
+		CHECK(loaded.IsDirty());
+
+		RemoveShaders();
+	}
+
+	void CompilesMissesInParallel()
+	{
+		WriteShaders();
+
+		ThreadPool pool(3);
+
+		std::atomic<int> compileCount(0);
+		std::mutex mutex;
+		std::set<std::thread::id> threads;
+		ShaderCache cache([&](const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode)
+		{
+			++compileCount;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.insert(std::this_thread::get_id());
+			}
+
+			// Slow enough for the workers to pick up their share.
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+			if(request.EntryPoint == "Broken")
+				return false;
+
+			return StubCompile(request, bytecode);
+		}, &pool);
+
+		// 32 distinct shaders, each asked for twice, and one that fails.
+		const std::uint32_t shaderCount = 32;
+		std::vector<std::uint32_t> requests;
+		for(std::uint32_t copy = 0; copy < 2; ++copy)
+		{
+			for(std::uint32_t i = 0; i < shaderCount; ++i)
+				requests.push_back(cache.Add(MakeRequest("Entry" + std::to_string(i))));
+		}
+		std::uint32_t broken = cache.Add(MakeRequest("Broken"));
+
+		CHECK(!cache.Resolve());
+		CHECK(compileCount == shaderCount + 1);
+		CHECK(threads.size() > 1);
+		CHECK(cache.GetStats().MissCount == shaderCount + 1);
+		CHECK(cache.GetStats().FailedCount == 1);
+		CHECK(cache.GetEntryCount() == shaderCount);
+		CHECK(cache.GetBytecode(broken) == nullptr);
+
+		bool allMatch = true;
+		for(std::uint32_t i = 0; i < requests.size(); ++i)
+			allMatch &= HasBytecode(cache, requests[i], "Entry" + std::to_string(i % shaderCount));
+		CHECK(allMatch);
+
+		// A second batch only compiles what failed before.
+		compileCount = 0;
+		cache.Add(MakeRequest("Entry0"));
+		cache.Add(MakeRequest("Broken"));
+		CHECK(!cache.Resolve());
+		CHECK(compileCount == 1);
+		CHECK(cache.GetStats().HitCount == 1);
+
+		RemoveShaders();
+	}
+}
+
+int main()
+{
+	RUN_TEST(KeyDependsOnEverythingTheCompilerSees);
+	RUN_TEST(PackRoundTrips);
+	RUN_TEST(IgnoresCorruptPacks);
+	RUN_TEST(CompilesMissesInParallel);
+
+	return TestResult();
+}
@@ -0,0 +1,321 @@
+//***************************************************************************************
+// ShadowCascadesTests.cpp
+//
+// A cascade is stable when the shadow map texel grid stays put in the world: a fixed
+// world point must then land at the same position inside its texel in every frame,
+// however the camera moves.
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/ShadowCascades.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const float FovY = 0.25f*XM_PI;
+	const float Aspect = 4.0f / 3.0f;
+	const float NearZ = 1.0f;
+	const float FarZ = 1000.0f;
+
+	// Large enough that the slice spheres are always the smaller fit.
+	const BoundingSphere Scene(XMFLOAT3(0.0f, 0.0f, 0.0f), 1000.0f);
+
+	XMVECTOR LightDir()
+	{
+		return XMVector3Normalize(XMVectorSet(0.5f, -1.0f, 0.3f, 0.0f));
+	}
+
+	XMMATRIX CameraView(FXMVECTOR pos, float yaw, float pitch)
+	{
+		XMVECTOR look = XMVectorSet(std::cos(pitch)*std::sin(yaw), std::sin(pitch), std::cos(pitch)*std::cos(yaw), 0.0f);
+		return XMMatrixLookToLH(pos, look, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	}
+
+	// Shadow map texel coordinates of a world point in a cascade.
+	XMFLOAT2 TexelOf(const ShadowCascades& cascades, std::uint32_t cascade, FXMVECTOR pointW)
+	{
+		XMVECTOR uv = XMVector3TransformCoord(pointW,
+			XMLoadFloat4x4(&cascades.GetCascade(cascade).ShadowTransform));
+
+		float size = (float)cascades.GetShadowMapSize();
+		return XMFLOAT2(XMVectorGetX(uv)*size, XMVectorGetY(uv)*size);
+	}
+
+	// Distance of a - b from the nearest whole number.
+	float OffGrid(float a, float b)
+	{
+		float d = a - b;
+		return std::fabs(d - std::round(d));
+	}
+
+	void SplitsBlendLogAndUniform()
+	{
+		float splits[ShadowCascades::MaxCascades + 1];
+
+		ShadowCascades::ComputeSplits(1.0f, 101.0f, 4, 0.0f, splits);
+		CHECK(splits[0] == 1.0f && splits[4] == 101.0f);
+		CHECK(std::fabs(splits[1] - 26.0f) < 1e-4f);
+		CHECK(std::fabs(splits[2] - 51.0f) < 1e-4f);
+		CHECK(std::fabs(splits[3] - 76.0f) < 1e-4f);
+
+		ShadowCascades::ComputeSplits(1.0f, 10000.0f, 4, 1.0f, splits);
+		CHECK(std::fabs(splits[1] - 10.0f) < 1e-3f);
+		CHECK(std::fabs(splits[2] - 100.0f) < 1e-2f);
+		CHECK(std::fabs(splits[3] - 1000.0f) < 1e-1f);
+
+		// In between, each split lies between its logarithmic and uniform positions and
+		// the slices tile [near, far] in order.
+		for(float lambda : { 0.25f, 0.5f, 0.75f })
+		{
+			for(std::uint32_t count = 1; count <= ShadowCascades::MaxCascades; ++count)
+			{
+				float logSplits[ShadowCascades::MaxCascades + 1];
+				float uniformSplits[ShadowCascades::MaxCascades + 1];
+				ShadowCascades::ComputeSplits(0.5f, 300.0f, count, lambda, splits);
+				ShadowCascades::ComputeSplits(0.5f, 300.0f, count, 1.0f, logSplits);
+				ShadowCascades::ComputeSplits(0.5f, 300.0f, count, 0.0f, uniformSplits);
+
+				CHECK(splits[0] == 0.5f && splits[count] == 300.0f);
+				for(std::uint32_t i = 1; i < count; ++i)
+				{
+					CHECK(splits[i - 1] < splits[i]);
+					CHECK(logSplits[i] <= splits[i] && splits[i] <= uniformSplits[i]);
+				}
+				CHECK(splits[count - 1] < splits[count]);
+			}
+		}
+	}
+
+	void CascadesCoverShadowDistance()
+	{
+		ShadowCascades cascades(4, 1024);
+		cascades.SetShadowDistance(150.0f);
+		cascades.Update(CameraView(XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), 0.3f, -0.1f),
+			FovY, Aspect, NearZ, FarZ, LightDir(), Scene);
+
+		CHECK(cascades.GetCascade(0).SplitNear == NearZ);
+		CHECK(cascades.GetCascade(3).SplitFar == 150.0f);
+		for(std::uint32_t i = 1; i < cascades.GetCascadeCount(); ++i)
+			CHECK(cascades.GetCascade(i).SplitNear == cascades.GetCascade(i - 1).SplitFar);
+
+		// Square volumes, growing with the slices.
+		for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			const ShadowCascade& c = cascades.GetCascade(i);
+			CHECK(c.Right - c.Left == c.Top - c.Bottom);
+			CHECK(c.LightNearZ < c.LightFarZ);
+			if(i > 0)
+				CHECK(c.Right - c.Left > cascades.GetCascade(i - 1).Right - cascades.GetCascade(i - 1).Left);
+		}
+	}
+
+	void TexelGridHoldsUnderSubTexelTranslation()
+	{
+		ShadowCascades cascades(4, 1024);
+		const XMVECTOR pointW = XMVectorSet(3.3f, 0.7f, 12.9f, 1.0f);
+
+		cascades.Update(CameraView(XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), 0.3f, -0.1f),
+			FovY, Aspect, NearZ, FarZ, LightDir(), Scene);
+
+		ShadowCascade first[ShadowCascades::MaxCascades];
+		XMFLOAT2 firstTexel[ShadowCascades::MaxCascades];
+		for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			first[i] = cascades.GetCascade(i);
+			firstTexel[i] = TexelOf(cascades, i, pointW);
+		}
+
+		// Steps of a tenth of the smallest cascade's texel, in a direction that moves
+		// the window along both light space axes.
+		float texel0 = (first[0].Right - first[0].Left) / cascades.GetShadowMapSize();
+		XMVECTOR step = XMVectorScale(XMVector3Normalize(XMVectorSet(1.0f, 0.2f, 0.6f, 0.0f)), 0.1f*texel0);
+
+		bool sameSize = true;
+		bool wholeTexels = true;
+		bool pointStays = true;
+		bool moved = false;
+		for(int frame = 1; frame <= 200; ++frame)
+		{
+			XMVECTOR pos = XMVectorAdd(XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), XMVectorScale(step, (float)frame));
+			cascades.Update(CameraView(pos, 0.3f, -0.1f), FovY, Aspect, NearZ, FarZ, LightDir(), Scene);
+
+			for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+			{
+				const ShadowCascade& c = cascades.GetCascade(i);
+				float texel = (first[i].Right - first[i].Left) / cascades.GetShadowMapSize();
+
+				sameSize &= c.Right - c.Left == first[i].Right - first[i].Left;
+				wholeTexels &= OffGrid(c.Left / texel, first[i].Left / texel) < 1e-2f;
+				wholeTexels &= OffGrid(c.Bottom / texel, first[i].Bottom / texel) < 1e-2f;
+				moved |= c.Left != first[i].Left || c.Bottom != first[i].Bottom;
+
+				XMFLOAT2 t = TexelOf(cascades, i, pointW);
+				pointStays &= OffGrid(t.x, firstTexel[i].x) < 1e-2f && OffGrid(t.y, firstTexel[i].y) < 1e-2f;
+			}
+		}
+
+		CHECK(sameSize);
+		CHECK(wholeTexels);
+		CHECK(pointStays);
+
+		// 20 texels of motion do move the windows, by whole texels.
+		CHECK(moved);
+	}
+
+	void TexelGridHoldsUnderRotation()
+	{
+		ShadowCascades cascades(4, 2048);
+		const XMVECTOR pos = XMVectorSet(10.0f, 3.0f, -4.0f, 1.0f);
+		const XMVECTOR pointW = XMVectorSet(11.1f, 0.3f, -2.6f, 1.0f);
+
+		cascades.Update(CameraView(pos, 0.0f, 0.0f), FovY, Aspect, NearZ, FarZ, LightDir(), Scene);
+
+		float width[ShadowCascades::MaxCascades];
+		XMFLOAT2 firstTexel[ShadowCascades::MaxCascades];
+		for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			width[i] = cascades.GetCascade(i).Right - cascades.GetCascade(i).Left;
+			firstTexel[i] = TexelOf(cascades, i, pointW);
+		}
+
+		// A full turn with some pitch: the fitted spheres only move, they never resize.
+		bool sameSize = true;
+		bool pointStays = true;
+		for(int frame = 1; frame <= 360; ++frame)
+		{
+			float yaw = XMConvertToRadians((float)frame);
+			float pitch = 0.4f*std::sin(0.05f*frame);
+			cascades.Update(CameraView(pos, yaw, pitch), FovY, Aspect, NearZ, FarZ, LightDir(), Scene);
+
+			for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+			{
+				const ShadowCascade& c = cascades.GetCascade(i);
+				sameSize &= c.Right - c.Left == width[i] && c.Top - c.Bottom == width[i];
+
+				XMFLOAT2 t = TexelOf(cascades, i, pointW);
+				pointStays &= OffGrid(t.x, firstTexel[i].x) < 1e-2f && OffGrid(t.y, firstTexel[i].y) < 1e-2f;
+			}
+		}
+
+		CHECK(sameSize);
+		CHECK(pointStays);
+	}
+
+	// Light space AABB of the box's corners against the cascade volume.
+	std::uint32_t ReferenceCasterMask(const ShadowCascades& cascades, const BoundingBox& box)
+	{
+		XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+		box.GetCorners(corners);
+
+		XMMATRIX lightView = XMLoadFloat4x4(&cascades.GetCascade(0).LightView);
+		XMVECTOR vMin = XMVectorReplicate(+1e30f);
+		XMVECTOR vMax = XMVectorReplicate(-1e30f);
+		for(const XMFLOAT3& corner : corners)
+		{
+			XMVECTOR p = XMVector3TransformCoord(XMLoadFloat3(&corner), lightView);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		XMFLOAT3 lo, hi;
+		XMStoreFloat3(&lo, vMin);
+		XMStoreFloat3(&hi, vMax);
+
+		std::uint32_t mask = 0;
+		for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			const ShadowCascade& c = cascades.GetCascade(i);
+			if(hi.x >= c.Left && lo.x <= c.Right && hi.y >= c.Bottom && lo.y <= c.Top &&
+			   hi.z >= c.LightNearZ && lo.z <= c.LightFarZ)
+			{
+				mask |= 1u << i;
+			}
+		}
+
+		return mask;
+	}
+
+	void CullsCastersPerCascade()
+	{
+		ShadowCascades cascades(4, 1024);
+		const BoundingSphere scene(XMFLOAT3(0.0f, 0.0f, 0.0f), 200.0f);
+		cascades.Update(CameraView(XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), 0.0f, 0.0f),
+			FovY, Aspect, NearZ, FarZ, LightDir(), scene);
+
+		// Boxes placed in light space: in the middle of cascade 0, off to its side, in
+		// front of it towards the light, and beyond the far side of every cascade.
+		const ShadowCascade& c0 = cascades.GetCascade(0);
+		XMMATRIX lightView = XMLoadFloat4x4(&c0.LightView);
+		XMMATRIX invLightView = XMMatrixTranspose(lightView);
+		float midX = 0.5f*(c0.Left + c0.Right);
+		float midY = 0.5f*(c0.Bottom + c0.Top);
+		float midZ = 0.5f*(c0.LightNearZ + c0.LightFarZ);
+
+		auto boxAt = [&](float x, float y, float z)
+		{
+			BoundingBox box;
+			XMStoreFloat3(&box.Center, XMVector3TransformCoord(XMVectorSet(x, y, z, 1.0f), invLightView));
+			box.Extents = XMFLOAT3(0.2f, 0.2f, 0.2f);
+			return box;
+		};
+
+		CHECK((cascades.GetCasterMask(boxAt(midX, midY, midZ)) & 1u) != 0);
+		CHECK((cascades.GetCasterMask(boxAt(c0.Right + 5.0f, midY, midZ)) & 1u) == 0);
+		CHECK((cascades.GetCasterMask(boxAt(midX, midY, c0.LightNearZ + 1.0f)) & 1u) != 0);
+
+		float farthest = 0.0f;
+		for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+			farthest = std::fmax(farthest, cascades.GetCascade(i).LightFarZ);
+		CHECK(cascades.GetCasterMask(boxAt(midX, midY, farthest + 5.0f)) == 0);
+
+		// Every cascade contains the slice it covers, so a box on the view axis inside a
+		// slice casts into that cascade.
+		for(std::uint32_t i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			const ShadowCascade& c = cascades.GetCascade(i);
+			float z = 0.5f*(c.SplitNear + c.SplitFar);
+			BoundingBox box(XMFLOAT3(0.0f, 5.0f, z), XMFLOAT3(0.1f, 0.1f, 0.1f));
+			CHECK((cascades.GetCasterMask(box) & (1u << i)) != 0);
+		}
+
+		// Scattered boxes agree with the corner by corner test, one at a time and in a batch.
+		std::vector<BoundingBox> boxes;
+		for(int z = -10; z < 30; ++z)
+		{
+			for(int x = -20; x < 20; ++x)
+				boxes.emplace_back(XMFLOAT3(7.3f*x, 1.0f + 0.5f*(x & 3), 6.1f*z), XMFLOAT3(0.5f, 1.5f, 0.7f));
+		}
+
+		std::vector<std::uint32_t> masks(boxes.size());
+		cascades.CullCasters(boxes.data(), (std::uint32_t)boxes.size(), masks.data());
+
+		bool agree = true;
+		bool batchAgrees = true;
+		bool someCulled = false;
+		for(std::size_t i = 0; i < boxes.size(); ++i)
+		{
+			agree &= cascades.GetCasterMask(boxes[i]) == ReferenceCasterMask(cascades, boxes[i]);
+			batchAgrees &= masks[i] == cascades.GetCasterMask(boxes[i]);
+			someCulled |= masks[i] != 0 && masks[i] != 0xfu;
+		}
+		CHECK(agree);
+		CHECK(batchAgrees);
+		CHECK(someCulled);
+	}
+}
+
+int main()
+{
+	RUN_TEST(SplitsBlendLogAndUniform);
+	RUN_TEST(CascadesCoverShadowDistance);
+	RUN_TEST(TexelGridHoldsUnderSubTexelTranslation);
+	RUN_TEST(TexelGridHoldsUnderRotation);
+	RUN_TEST(CullsCastersPerCascade);
+
+	return TestResult();
+}
@@ -0,0 +1,112 @@
+//***************************************************************************************
+// TaskGraphTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/TaskGraph.h"
+#include "Common/ThreadPool.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// a -> b, a -> c, (b, c) -> d
+	void RunsAfterDependencies(ThreadPool* pool)
+	{
+		std::mutex mutex;
+		std::vector<int> order;
+		auto record = [&mutex, &order](int task)
+		{
+			return [&mutex, &order, task]()
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				order.push_back(task);
+			};
+		};
+
+		TaskGraph graph;
+		std::uint32_t a = graph.AddTask("a", record(0));
+		std::uint32_t b = graph.AddTask("b", record(1));
+		std::uint32_t c = graph.AddTask("c", record(2));
+		std::uint32_t d = graph.AddTask("d", record(3));
+		graph.AddDependency(b, a);
+		graph.AddDependency(c, a);
+		graph.AddDependency(d, b);
+		graph.AddDependency(d, c);
+
+		graph.Run(pool);
+
+		CHECK(order.size() == 4);
+		CHECK(order.front() == 0 && order.back() == 3);
+		CHECK(graph.GetCriticalPathSeconds() <= graph.GetSerialSeconds());
+	}
+
+	void RunsInOrderWithoutPool()
+	{
+		RunsAfterDependencies(nullptr);
+	}
+
+	void RunsInOrderOnPool()
+	{
+		ThreadPool pool(3);
+		RunsAfterDependencies(&pool);
+	}
+
+	void MainThreadTasksRunOnCaller()
+	{
+		ThreadPool pool(2);
+		std::thread::id caller = std::this_thread::get_id();
+		std::atomic<bool> onCaller(false);
+
+		TaskGraph graph;
+		std::uint32_t load = graph.AddTask("load", []() {});
+		std::uint32_t upload = graph.AddTask("upload",
+			[&onCaller, caller]() { onCaller = std::this_thread::get_id() == caller; },
+			TaskAffinity::MainThread);
+		graph.AddDependency(upload, load);
+
+		graph.Run(&pool);
+
+		CHECK(onCaller);
+		CHECK(graph.GetTiming(upload).RanOnMainThread);
+	}
+
+	void ErrorSkipsDependentsAndRethrows()
+	{
+		ThreadPool pool(2);
+		std::atomic<bool> dependentRan(false);
+
+		TaskGraph graph;
+		std::uint32_t fail = graph.AddTask("fail", []() { throw std::runtime_error("fail"); });
+		std::uint32_t after = graph.AddTask("after", [&dependentRan]() { dependentRan = true; });
+		graph.AddDependency(after, fail);
+
+		bool thrown = false;
+		try
+		{
+			graph.Run(&pool);
+		}
+		catch(const std::runtime_error&)
+		{
+			thrown = true;
+		}
+
+		CHECK(thrown);
+		CHECK(!dependentRan);
+	}
+}
+
+int main()
+{
+	RUN_TEST(RunsInOrderWithoutPool);
+	RUN_TEST(RunsInOrderOnPool);
+	RUN_TEST(MainThreadTasksRunOnCaller);
+	RUN_TEST(ErrorSkipsDependentsAndRethrows);
+
+	return TestResult();
+}
@@ -0,0 +1,86 @@
+//***************************************************************************************
+// ThreadPoolTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/ThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+	void ParallelForVisitsEveryIndexOnce()
+	{
+		ThreadPool pool(3);
+
+		const std::uint32_t count = 10007;
+		for(std::uint32_t grainSize : { 1u, 7u, 64u, 20000u })
+		{
+			std::vector<std::atomic<int>> visits(count);
+			for(auto& v : visits)
+				v = 0;
+
+			pool.ParallelFor(count, [&visits](std::uint32_t i) { ++visits[i]; }, grainSize);
+
+			bool once = true;
+			for(auto& v : visits)
+				once &= (v == 1);
+			CHECK(once);
+		}
+	}
+
+	void ParallelForRunsOneBatchOnOneThread()
+	{
+		ThreadPool pool(2);
+
+		// A single batch, so the plain sum is not raced.
+		std::uint32_t sum = 0;
+		pool.ParallelFor(100, [&sum](std::uint32_t i) { sum += i; }, 100);
+		CHECK(sum == 4950);
+	}
+
+	void ParallelForRunsInsideJobs()
+	{
+		// Every worker is busy with a job calling ParallelFor, so nobody is free to
+		// help; each call has to get through its indices on its own.
+		ThreadPool pool(2);
+
+		std::atomic<std::uint32_t> sums[2];
+		for(int job = 0; job < 2; ++job)
+		{
+			sums[job] = 0;
+			pool.Enqueue([&pool, &sums, job]()
+			{
+				pool.ParallelFor(1000, [&sums, job](std::uint32_t i) { sums[job] += i; });
+			});
+		}
+
+		pool.Wait();
+		CHECK(sums[0] == 499500);
+		CHECK(sums[1] == 499500);
+	}
+
+	void WaitDrainsTheQueue()
+	{
+		ThreadPool pool(2);
+
+		std::atomic<int> done(0);
+		for(int i = 0; i < 100; ++i)
+			pool.Enqueue([&done]() { ++done; });
+
+		pool.Wait();
+		CHECK(done == 100);
+	}
+}
+
+int main()
+{
+	RUN_TEST(ParallelForVisitsEveryIndexOnce);
+	RUN_TEST(ParallelForRunsOneBatchOnOneThread);
+	RUN_TEST(ParallelForRunsInsideJobs);
+	RUN_TEST(WaitDrainsTheQueue);
+
+	return TestResult();
+}
@@ -0,0 +1,139 @@
+//***************************************************************************************
+// UploadRingTests.cpp
+//***************************************************************************************
+
+#include "Check.h"
+
+#include "Common/UploadRing.h"
+
+namespace
+{
+	void AllocationsAreAligned()
+	{
+		SystemUploadRingMemory memory(4096);
+		UploadRing ring(&memory);
+
+		UploadAllocation a = ring.Allocate(10);
+		UploadAllocation b = ring.Allocate(10);
+		UploadAllocation c = ring.Allocate(10, 16);
+		UploadAllocation d = ring.Allocate(1, 512);
+
+		CHECK(a.Offset == 0 && b.Offset == 256 && c.Offset == 272 && d.Offset == 512);
+		CHECK(b.CpuAddress == memory.GetCpuAddress() + 256);
+
+		// Padding counts as used until the frame retires.
+		CHECK(ring.GetUsedBytes() == 513 && ring.GetFrameBytes() == 513);
+	}
+
+	void AllocateConstantsCopies()
+	{
+		SystemUploadRingMemory memory(1024);
+		UploadRing ring(&memory);
+
+		struct Constants { float Values[3]; };
+		Constants constants = { { 1.0f, 2.0f, 3.0f } };
+
+		UploadAllocation alloc = ring.AllocateConstants(constants);
+		CHECK(alloc.IsValid() && alloc.Size == 256);
+		CHECK(reinterpret_cast<const Constants*>(alloc.CpuAddress)->Values[2] == 3.0f);
+	}
+
+	void RetiresFramesInFenceOrder()
+	{
+		SystemUploadRingMemory memory(1024);
+		UploadRing ring(&memory);
+
+		ring.Allocate(512);
+		ring.FinishFrame(1);
+		ring.Allocate(256);
+		ring.FinishFrame(2);
+
+		CHECK(ring.HasPendingFrames() && ring.GetOldestPendingFence() == 1);
+
+		ring.Retire(0);
+		CHECK(ring.GetUsedBytes() == 768);
+
+		ring.Retire(1);
+		CHECK(ring.GetUsedBytes() == 256 && ring.GetOldestPendingFence() == 2);
+
+		ring.Retire(5);
+		CHECK(ring.GetUsedBytes() == 0 && !ring.HasPendingFrames());
+		CHECK(ring.GetOldestPendingFence() == 0);
+	}
+
+	void FullRingFailsUntilRetired()
+	{
+		SystemUploadRingMemory memory(1024);
+		UploadRing ring(&memory);
+
+		CHECK(ring.Allocate(1024).IsValid());
+		CHECK(!ring.Allocate(1).IsValid());
+		CHECK(!ring.Allocate(2048).IsValid());
+		ring.FinishFrame(1);
+
+		ring.Retire(1);
+		CHECK(ring.Allocate(1024).IsValid());
+	}
+
+	void WrapsAroundSkippingTheEnd()
+	{
+		SystemUploadRingMemory memory(1024);
+		UploadRing ring(&memory);
+
+		ring.Allocate(512);
+		ring.FinishFrame(1);
+		ring.Allocate(256);
+		ring.FinishFrame(2);
+		ring.Retire(1);
+
+		// [768, 1024) is too small, so the block goes to the start and the end of the
+		// ring is used up with it.
+		UploadAllocation wrapped = ring.Allocate(512);
+		CHECK(wrapped.IsValid() && wrapped.Offset == 0);
+		CHECK(ring.GetUsedBytes() == 1024 && ring.GetFrameBytes() == 768);
+		CHECK(!ring.Allocate(1).IsValid());
+		ring.FinishFrame(3);
+
+		// Frame 2 frees [512, 768), which is between head and tail now.
+		ring.Retire(2);
+		UploadAllocation between = ring.Allocate(256);
+		CHECK(between.IsValid() && between.Offset == 512);
+		CHECK(!ring.Allocate(1).IsValid());
+		ring.FinishFrame(4);
+
+		ring.Retire(4);
+		CHECK(ring.GetUsedBytes() == 0);
+
+		// Empty again, so the ring starts over at 0.
+		CHECK(ring.Allocate(1024).Offset == 0);
+	}
+
+	void DoesNotFitAtEndOrStart()
+	{
+		SystemUploadRingMemory memory(1024);
+		UploadRing ring(&memory);
+
+		ring.Allocate(256);
+		ring.FinishFrame(1);
+		ring.Allocate(512);
+		ring.FinishFrame(2);
+		ring.Retire(1);
+
+		// 256 bytes free at each end, none of them contiguous with 512.
+		CHECK(!ring.Allocate(512).IsValid());
+		CHECK(ring.Allocate(256).Offset == 768);
+		CHECK(ring.Allocate(256).Offset == 0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(AllocationsAreAligned);
+	RUN_TEST(AllocateConstantsCopies);
+	RUN_TEST(RetiresFramesInFenceOrder);
+	RUN_TEST(FullRingFailsUntilRetired);
+	RUN_TEST(WrapsAroundSkippingTheEnd);
+	RUN_TEST(DoesNotFitAtEndOrStart);
+
+	return TestResult();
+}
@@ -69,6 +69,12 @@ int d3d_application::run()
 
 	m_timer.reset();
 
+	m_frame_stats_csv.open("frame_stats.csv", std::ios::trunc);
+	if (m_frame_stats_csv)
+	{
+		frame_stats::write_csv_header(m_frame_stats_csv);
+	}
+
 	while (msg.message != WM_QUIT)
 	{
 		// If there are Window messages then process them.
@@ -94,6 +100,12 @@ int d3d_application::run()
 		}
 	}
 
+	std::ofstream frame_stats_json("frame_stats.json", std::ios::trunc);
+	if (frame_stats_json)
+	{
+		m_frame_stats.write_json(frame_stats_json);
+	}
+
 	return static_cast<int>(msg.wParam);
 }
 
@@ -447,6 +459,7 @@ bool d3d_application::initialize_direct3d()
 
 	ThrowIfFailed(m_d3d_device->CreateFence(0, D3D12_FENCE_FLAG_NONE,
 		IID_PPV_ARGS(&m_fence)));
+	m_fence_wait_policy = std::make_unique<d3d12_fence_wait_policy>(m_fence.Get());
 
 	m_rtv_descriptor_size = m_d3d_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	m_dsv_descriptor_size = m_d3d_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
@@ -544,41 +557,29 @@ void d3d_application::flush_command_queue()
 	ThrowIfFailed(m_command_queue->Signal(m_fence.Get(), m_current_fence));
 
 	// Wait until the GPU has completed commands up to this fence point.
-	if (m_fence->GetCompletedValue() < m_current_fence)
-	{
-		HANDLE event_handle = CreateEventEx(nullptr, nullptr, FALSE, EVENT_ALL_ACCESS);
-
-		// Fire event when GPU hits current fence.  
-		ThrowIfFailed(m_fence->SetEventOnCompletion(m_current_fence, event_handle));
-
-		// Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(event_handle, INFINITE);
-		
-		CloseHandle(event_handle);
-	}
+	m_fence_wait_policy->wait_for(m_current_fence);
 }
 
 void d3d_application::calculate_frame_stats()
 {
-	static int frame_count = 0;
-	static float time_elapsed = .0f;
-
-	++frame_count;
+	m_frame_stats.add_frame(m_timer.delta_time());
 
-	if (m_timer.total_time() - time_elapsed >= 1.0f)
+	frame_time_summary summary;
+	if (m_frame_stats.collect(m_timer.total_time(), summary))
 	{
-		auto fps = static_cast<float>(frame_count); // fps = frameCnt / 1
-		auto mspf = 1000.0f / fps;
-
 		std::wstring window_text = m_main_window_caption +
-			L"    fps: " + std::to_wstring(fps) +
-			L"   mspf: " + std::to_wstring(mspf);
+			L"    fps: " + std::to_wstring(summary.fps) +
+			L"   mspf: " + std::to_wstring(summary.mean_ms) +
+			L"   p99: " + std::to_wstring(summary.p99_ms) +
+			L"   max: " + std::to_wstring(summary.max_ms);
 
 		SetWindowText(m_main_window, window_text.c_str());
 
-		// Reset for next average.
-		frame_count = 0;
-		time_elapsed += 1.0f;
+		if (m_frame_stats_csv)
+		{
+			m_frame_stats.write_interval_csv(m_frame_stats_csv);
+			m_frame_stats_csv.flush();
+		}
 	}
 }
 
@@ -1,7 +1,10 @@
 #pragma once
 #include "framework.h"
 #include "d3d_utility.h"
+#include "frame_stats.h"
 #include "game_timer.h"
+#include <fstream>
+#include <memory>
 #include <string>
 
 #pragma comment(lib, "d3dcompiler.lib")
@@ -70,12 +73,17 @@ protected:
 
 	game_timer m_timer;
 
+	// One csv row per second while running, the whole run's histogram as json at exit.
+	frame_stats m_frame_stats;
+	std::ofstream m_frame_stats_csv;
+
 	ComPtr<IDXGIFactory4> m_dxgi_factory;
 	ComPtr<IDXGISwapChain> m_swap_chain;
 	ComPtr<ID3D12Device> m_d3d_device;
 
 	ComPtr<ID3D12Fence> m_fence;
 	UINT64 m_current_fence = 0;
+	std::unique_ptr<d3d12_fence_wait_policy> m_fence_wait_policy;
 
 	ComPtr<ID3D12CommandQueue> m_command_queue;
 	ComPtr<ID3D12CommandAllocator> m_direct_cmd_list_allocator;
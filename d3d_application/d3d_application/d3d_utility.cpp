@@ -1,5 +1,6 @@
 #include "d3d_utility.h"
 #include <comdef.h>
+#include <emmintrin.h>
 
 hresult_error::hresult_error(HRESULT code, std::wstring func_name, std::wstring file_name, int line_num) : 
 	m_error_code(code), m_function_name(std::move(func_name)), 
@@ -15,6 +16,76 @@ std::wstring hresult_error::what() const
 	return m_function_name + L" failed in " + m_file_name + L"; line " + std::to_wstring(m_line_number) + L"; error: " + msg;
 }
 
+namespace
+{
+	// Below this the copy stays in the write-combining buffers anyway.
+	constexpr size_t streaming_copy_threshold = 16 * 1024;
+
+	// dst must be 16-byte aligned and byte_size a multiple of 16.
+	void stream_aligned16(BYTE* dst, BYTE const* src, size_t byte_size)
+	{
+		for (size_t i = 0; i < byte_size; i += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v);
+		}
+	}
+}
+
+void streaming_copy_strided(void* dst, size_t dst_stride, void const* src, size_t src_stride,
+	size_t element_size, size_t element_count)
+{
+	auto d = static_cast<BYTE*>(dst);
+	auto s = static_cast<BYTE const*>(src);
+
+	bool const packed = dst_stride == element_size && src_stride == element_size;
+	size_t const total = element_size * element_count;
+
+	if (total < streaming_copy_threshold)
+	{
+		if (packed)
+		{
+			std::memcpy(d, s, total);
+		}
+		else
+		{
+			for (size_t i = 0; i < element_count; ++i)
+			{
+				std::memcpy(d + i * dst_stride, s + i * src_stride, element_size);
+			}
+		}
+		return;
+	}
+
+	if (packed)
+	{
+		// Plain stores up to the first 16-byte boundary and for the tail, streaming stores in between.
+		size_t const head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+		size_t const body = (total - head) & ~size_t(15);
+
+		std::memcpy(d, s, head);
+		stream_aligned16(d + head, s + head, body);
+		std::memcpy(d + head + body, s + head + body, total - head - body);
+	}
+	else if (element_size % 16 == 0 && dst_stride % 16 == 0 && (reinterpret_cast<uintptr_t>(d) & 15) == 0)
+	{
+		for (size_t i = 0; i < element_count; ++i)
+		{
+			stream_aligned16(d + i * dst_stride, s + i * src_stride, element_size);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < element_count; ++i)
+		{
+			std::memcpy(d + i * dst_stride, s + i * src_stride, element_size);
+		}
+	}
+
+	// Streaming stores are weakly ordered; flush them before the GPU can read the data.
+	_mm_sfence();
+}
+
 ComPtr<ID3D12Resource> create_default_buffer(ID3D12Device* device, ID3D12GraphicsCommandList* command_list, void* init_data, UINT64 byte_size, ComPtr<ID3D12Resource>& upload_buffer)
 {
 	ComPtr<ID3D12Resource> defaultBuffer;
@@ -92,3 +163,40 @@ ComPtr<ID3DBlob> compile_shader(
 
 	return byteCode;
 }
+
+d3d12_fence_wait_policy::d3d12_fence_wait_policy(ID3D12Fence* fence) : m_fence(fence)
+{
+	m_event = CreateEventEx(nullptr, nullptr, FALSE, EVENT_ALL_ACCESS);
+	if (m_event == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+d3d12_fence_wait_policy::~d3d12_fence_wait_policy()
+{
+	if (m_event != nullptr)
+	{
+		CloseHandle(m_event);
+	}
+}
+
+std::uint64_t d3d12_fence_wait_policy::completed_value() const
+{
+	m_completed_value = m_fence->GetCompletedValue();
+	return m_completed_value;
+}
+
+void d3d12_fence_wait_policy::wait_for(std::uint64_t value)
+{
+	// The last value read is often already enough.
+	if (m_completed_value >= value || completed_value() >= value)
+	{
+		return;
+	}
+
+	// Fire event when GPU hits the fence value, then wait for it.
+	ThrowIfFailed(m_fence->SetEventOnCompletion(value, m_event));
+	WaitForSingleObject(m_event, INFINITE);
+	m_completed_value = value;
+}
@@ -1,9 +1,13 @@
 #pragma once
 #include "framework.h"
+#include "frame_resource_ring.h"
 #include <d3d12.h>
 #include <cstdlib>
 #include <string>
 #include <unordered_map>
+#if _HAS_CXX20
+#include <span>
+#endif
 
 #ifndef ThrowIfFailed
 #define ThrowIfFailed(x)                                              \
@@ -45,6 +49,30 @@ inline constexpr UINT calculate_constant_buffer_byte_size(UINT size)
     return (size + 255) & ~255;
 }
 
+// Copies element_count elements of element_size bytes from src (src_stride apart) to
+// dst (dst_stride apart).  Large copies into upload heaps use non-temporal SSE2
+// stores, which fill the write-combined memory without going through the cache.
+void streaming_copy_strided(void* dst, size_t dst_stride, void const* src, size_t src_stride,
+    size_t element_size, size_t element_count);
+
+// Waits on an ID3D12Fence.  The event is created once and reused for every wait.
+class d3d12_fence_wait_policy : public fence_wait_policy
+{
+public:
+    explicit d3d12_fence_wait_policy(ID3D12Fence* fence);
+    d3d12_fence_wait_policy(d3d12_fence_wait_policy const&) = delete;
+    d3d12_fence_wait_policy& operator=(d3d12_fence_wait_policy const&) = delete;
+    ~d3d12_fence_wait_policy();
+
+    std::uint64_t completed_value() const override;
+    void wait_for(std::uint64_t value) override;
+
+private:
+    ID3D12Fence* m_fence = nullptr;
+    HANDLE m_event = nullptr;
+    mutable std::uint64_t m_completed_value = 0;
+};
+
 ComPtr<ID3D12Resource> create_default_buffer(ID3D12Device*, ID3D12GraphicsCommandList*, void*, UINT64, ComPtr<ID3D12Resource>&);
 
 ComPtr<ID3DBlob> compile_shader(std::wstring const&, D3D_SHADER_MACRO const*, std::string const&, std::string const&);
@@ -173,4 +201,52 @@ public:
     {
         std::memcpy(&m_mapped_data[element_index * m_element_byte_size], &data, sizeof(T));
     }
+
+    // Copies count consecutive elements; one contiguous (streamed, if large) copy
+    // unless the elements are padded to the constant buffer stride.
+    void copy_data(UINT first_element, T const* data, UINT count)
+    {
+        streaming_copy_strided(&m_mapped_data[first_element * m_element_byte_size], m_element_byte_size,
+            data, sizeof(T), sizeof(T), count);
+    }
+
+#if _HAS_CXX20
+    void copy_data(UINT first_element, std::span<T const> data)
+    {
+        copy_data(first_element, data.data(), static_cast<UINT>(data.size()));
+    }
+#endif
+
+    // Copies data[i] to element element_indices[i].
+    void scatter_data(UINT const* element_indices, T const* data, UINT count)
+    {
+        for (UINT i = 0; i < count; ++i)
+        {
+            std::memcpy(&m_mapped_data[element_indices[i] * m_element_byte_size], &data[i], sizeof(T));
+        }
+    }
+
+    // Hands out consecutive elements to construct in place.  The memory is
+    // write-combined: write each element front to back and never read it.
+    class write_cursor
+    {
+    private:
+        BYTE* m_data;
+        UINT m_stride;
+
+    public:
+        write_cursor(BYTE* data, UINT stride) : m_data(data), m_stride(stride) {}
+
+        T* next()
+        {
+            T* element = reinterpret_cast<T*>(m_data);
+            m_data += m_stride;
+            return element;
+        }
+    };
+
+    write_cursor begin_write(UINT first_element)
+    {
+        return write_cursor(&m_mapped_data[first_element * m_element_byte_size], m_element_byte_size);
+    }
 };
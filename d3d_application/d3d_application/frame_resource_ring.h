@@ -0,0 +1,158 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// How the CPU learns about, and waits for, GPU progress.  d3d12_fence_wait_policy
+// (d3d_utility.h) waits on an ID3D12Fence; simulated_fence_wait_policy stands in for
+// the GPU so the ring can be driven without a device.
+class fence_wait_policy
+{
+public:
+	virtual ~fence_wait_policy() = default;
+
+	virtual std::uint64_t completed_value() const = 0;
+
+	// Blocks until completed_value() >= value.
+	virtual void wait_for(std::uint64_t value) = 0;
+};
+
+// A GPU that completes work only when told to (complete()) or when the CPU blocks on
+// it, in which case it finishes exactly up to the value waited for.
+class simulated_fence_wait_policy : public fence_wait_policy
+{
+public:
+	std::uint64_t completed_value() const override
+	{
+		return m_completed_value;
+	}
+
+	void wait_for(std::uint64_t value) override
+	{
+		++m_wait_count;
+		complete(value);
+	}
+
+	void complete(std::uint64_t value)
+	{
+		if (value > m_completed_value)
+		{
+			m_completed_value = value;
+		}
+	}
+
+	std::uint32_t wait_count() const
+	{
+		return m_wait_count;
+	}
+
+private:
+	std::uint64_t m_completed_value = 0;
+	std::uint32_t m_wait_count = 0;
+};
+
+// N sets of per-frame resources (command allocators, upload buffers) used round-robin
+// so the CPU can record frame i+1.. while the GPU still works on frame i.  A set is
+// handed out again only once the fence value it was submitted with has completed;
+// until then the CPU runs up to N frames ahead of the GPU.
+//
+//     auto& frame = ring.begin_frame();   // waits if the GPU is N frames behind
+//     ... reset frame's allocator, write its buffers, record, execute ...
+//     queue->Signal(fence, ++fence_value);
+//     ring.end_frame(fence_value);
+template<typename T>
+class frame_resource_ring
+{
+public:
+	using factory = std::function<std::unique_ptr<T>(std::uint32_t)>;
+
+	// create is called with the indices 0..count-1.
+	frame_resource_ring(fence_wait_policy& wait_policy, std::uint32_t count, factory const& create) :
+		m_wait_policy(wait_policy),
+		m_fence_values(count, 0)
+	{
+		assert(count > 0);
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			m_resources.push_back(create(i));
+		}
+
+		// The first begin_frame() moves to index 0.
+		m_current_index = count - 1;
+	}
+
+	frame_resource_ring(frame_resource_ring const&) = delete;
+	frame_resource_ring& operator=(frame_resource_ring const&) = delete;
+
+	// Moves to the next set of resources and waits until the GPU has finished the
+	// frame that last used it.
+	T& begin_frame()
+	{
+		m_current_index = (m_current_index + 1) % size();
+
+		auto const fence_value = m_fence_values[m_current_index];
+		if (fence_value != 0 && m_wait_policy.completed_value() < fence_value)
+		{
+			++m_stall_count;
+			m_wait_policy.wait_for(fence_value);
+		}
+
+		return *m_resources[m_current_index];
+	}
+
+	// Records the fence value signaled after the current frame's commands.
+	void end_frame(std::uint64_t fence_value)
+	{
+		m_fence_values[m_current_index] = fence_value;
+	}
+
+	// Waits until the GPU is done with every set, e.g. before the resources go away.
+	void wait_idle()
+	{
+		for (auto const fence_value : m_fence_values)
+		{
+			if (fence_value != 0 && m_wait_policy.completed_value() < fence_value)
+			{
+				m_wait_policy.wait_for(fence_value);
+			}
+		}
+	}
+
+	T& current()
+	{
+		return *m_resources[m_current_index];
+	}
+
+	T& operator[](std::uint32_t index)
+	{
+		return *m_resources[index];
+	}
+
+	std::uint32_t current_index() const
+	{
+		return m_current_index;
+	}
+
+	std::uint32_t size() const
+	{
+		return static_cast<std::uint32_t>(m_resources.size());
+	}
+
+	// Number of begin_frame() calls that had to wait for the GPU.
+	std::uint32_t stall_count() const
+	{
+		return m_stall_count;
+	}
+
+private:
+	fence_wait_policy& m_wait_policy;
+
+	std::vector<std::unique_ptr<T>> m_resources;
+	std::vector<std::uint64_t> m_fence_values;
+
+	std::uint32_t m_current_index = 0;
+	std::uint32_t m_stall_count = 0;
+};
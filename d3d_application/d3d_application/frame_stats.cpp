@@ -0,0 +1,365 @@
+#include "frame_stats.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr std::uint32_t sub_bucket_count = 1u << frame_time_histogram::sub_bucket_bits;
+	constexpr std::uint32_t sub_bucket_half_count = sub_bucket_count / 2;
+	constexpr std::uint64_t max_value = (std::uint64_t(1) << frame_time_histogram::max_magnitude) - 1;
+
+	std::uint32_t floor_log2(std::uint64_t value)
+	{
+		std::uint32_t result = 0;
+		while (value >>= 1)
+		{
+			++result;
+		}
+		return result;
+	}
+
+	double to_ms(std::uint64_t microseconds)
+	{
+		return static_cast<double>(microseconds) / 1000.0;
+	}
+}
+
+frame_time_histogram::frame_time_histogram() :
+	m_buckets(sub_bucket_count + (max_magnitude - frame_time_histogram::sub_bucket_bits) * sub_bucket_half_count)
+{
+}
+
+std::uint32_t frame_time_histogram::bucket_index(std::uint64_t microseconds)
+{
+	microseconds = std::min(microseconds, max_value);
+	if (microseconds < sub_bucket_count)
+	{
+		return static_cast<std::uint32_t>(microseconds);
+	}
+
+	// The top sub_bucket_bits - 1 bits below the leading one pick the bucket.
+	std::uint32_t magnitude = floor_log2(microseconds);
+	std::uint32_t shift = magnitude - (sub_bucket_bits - 1);
+	std::uint32_t sub_bucket = static_cast<std::uint32_t>(microseconds >> shift) - sub_bucket_half_count;
+
+	return sub_bucket_count + (magnitude - sub_bucket_bits) * sub_bucket_half_count + sub_bucket;
+}
+
+std::uint64_t frame_time_histogram::bucket_lowest_value(std::uint32_t bucket) const
+{
+	if (bucket < sub_bucket_count)
+	{
+		return bucket;
+	}
+
+	std::uint32_t octave = (bucket - sub_bucket_count) / sub_bucket_half_count;
+	std::uint32_t sub_bucket = (bucket - sub_bucket_count) % sub_bucket_half_count + sub_bucket_half_count;
+	return std::uint64_t(sub_bucket) << (octave + 1);
+}
+
+std::uint64_t frame_time_histogram::bucket_highest_value(std::uint32_t bucket) const
+{
+	if (bucket < sub_bucket_count)
+	{
+		return bucket;
+	}
+
+	std::uint32_t octave = (bucket - sub_bucket_count) / sub_bucket_half_count;
+	return bucket_lowest_value(bucket) + (std::uint64_t(1) << (octave + 1)) - 1;
+}
+
+void frame_time_histogram::record(std::uint64_t microseconds)
+{
+	microseconds = std::min(microseconds, max_value);
+
+	++m_buckets[bucket_index(microseconds)];
+
+	m_min = m_count == 0 ? microseconds : std::min(m_min, microseconds);
+	m_max = std::max(m_max, microseconds);
+	m_sum += microseconds;
+	++m_count;
+}
+
+void frame_time_histogram::reset()
+{
+	std::fill(m_buckets.begin(), m_buckets.end(), 0);
+	m_count = 0;
+	m_sum = 0;
+	m_min = 0;
+	m_max = 0;
+}
+
+std::uint64_t frame_time_histogram::count() const
+{
+	return m_count;
+}
+
+std::uint64_t frame_time_histogram::min() const
+{
+	return m_min;
+}
+
+std::uint64_t frame_time_histogram::max() const
+{
+	return m_max;
+}
+
+double frame_time_histogram::mean() const
+{
+	return m_count == 0 ? 0.0 : static_cast<double>(m_sum) / static_cast<double>(m_count);
+}
+
+std::uint64_t frame_time_histogram::value_at_percentile(double percentile) const
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	percentile = std::min(std::max(percentile, 0.0), 100.0);
+	auto target = static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(m_count)));
+	target = std::max<std::uint64_t>(target, 1);
+
+	std::uint64_t seen = 0;
+	for (std::uint32_t i = 0; i < bucket_count(); ++i)
+	{
+		seen += m_buckets[i];
+		if (seen >= target)
+		{
+			// The exact extremes are known, so never report past them.
+			return std::max(m_min, std::min(bucket_highest_value(i), m_max));
+		}
+	}
+
+	return m_max;
+}
+
+std::uint32_t frame_time_histogram::bucket_count() const
+{
+	return static_cast<std::uint32_t>(m_buckets.size());
+}
+
+std::uint64_t frame_time_histogram::bucket_frames(std::uint32_t bucket) const
+{
+	return m_buckets[bucket];
+}
+
+bool frame_time_ring::push(std::uint64_t microseconds)
+{
+	std::uint64_t head = m_head.load(std::memory_order_relaxed);
+	if (head - m_tail.load(std::memory_order_acquire) == capacity)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_values[head % capacity] = microseconds;
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+bool frame_time_ring::pop(std::uint64_t& microseconds)
+{
+	std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+	if (tail == m_head.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	microseconds = m_values[tail % capacity];
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+std::uint64_t frame_time_ring::dropped_count() const
+{
+	return m_dropped.load(std::memory_order_relaxed);
+}
+
+frame_stats::frame_stats(double report_interval_seconds) :
+	m_report_interval(report_interval_seconds)
+{
+	add_series("cpu_frame");
+}
+
+std::uint32_t frame_stats::add_series(std::string const& name)
+{
+	for (std::uint32_t i = 0; i < series_count(); ++i)
+	{
+		if (m_series[i]->name == name)
+		{
+			return i;
+		}
+	}
+
+	m_series.push_back(std::make_unique<series_data>());
+	m_series.back()->name = name;
+	m_series.back()->interval_summary.series = name;
+	return series_count() - 1;
+}
+
+std::uint32_t frame_stats::series_count() const
+{
+	return static_cast<std::uint32_t>(m_series.size());
+}
+
+std::string const& frame_stats::series_name(std::uint32_t series) const
+{
+	return m_series[series]->name;
+}
+
+void frame_stats::add_frame(double seconds)
+{
+	add_sample(frame_series, seconds);
+}
+
+void frame_stats::add_sample(std::uint32_t series, double seconds)
+{
+	auto microseconds = seconds > 0.0 ? static_cast<std::uint64_t>(seconds * 1e6 + 0.5) : 0;
+	m_series[series]->ring.push(microseconds);
+}
+
+bool frame_stats::collect(double now_seconds, frame_time_summary& summary)
+{
+	for (auto& series : m_series)
+	{
+		std::uint64_t microseconds = 0;
+		while (series->ring.pop(microseconds))
+		{
+			series->interval.record(microseconds);
+			series->total.record(microseconds);
+		}
+	}
+
+	if (!m_started)
+	{
+		m_started = true;
+		m_start = now_seconds;
+		m_interval_start = now_seconds;
+	}
+	m_last_collect = now_seconds;
+
+	double duration = now_seconds - m_interval_start;
+	if (duration < m_report_interval)
+	{
+		return false;
+	}
+
+	for (auto& series : m_series)
+	{
+		series->interval_summary = summarize(series->name, series->interval, m_interval_start, duration);
+		series->interval.reset();
+	}
+	m_interval_start = now_seconds;
+
+	summary = m_series[frame_series]->interval_summary;
+	return true;
+}
+
+frame_time_summary const& frame_stats::interval_summary(std::uint32_t series) const
+{
+	return m_series[series]->interval_summary;
+}
+
+frame_time_summary frame_stats::total_summary(std::uint32_t series) const
+{
+	return summarize(m_series[series]->name, m_series[series]->total, m_start, m_last_collect - m_start);
+}
+
+frame_time_histogram const& frame_stats::total_histogram(std::uint32_t series) const
+{
+	return m_series[series]->total;
+}
+
+std::uint64_t frame_stats::dropped_count(std::uint32_t series) const
+{
+	return m_series[series]->ring.dropped_count();
+}
+
+frame_time_summary frame_stats::summarize(std::string const& name,
+	frame_time_histogram const& histogram, double start_seconds, double duration_seconds)
+{
+	frame_time_summary summary;
+	summary.series = name;
+	summary.start_seconds = start_seconds;
+	summary.duration_seconds = duration_seconds;
+
+	summary.frame_count = histogram.count();
+	if (duration_seconds > 0.0)
+	{
+		summary.fps = static_cast<double>(summary.frame_count) / duration_seconds;
+	}
+
+	summary.mean_ms = histogram.mean() / 1000.0;
+	summary.p50_ms = to_ms(histogram.value_at_percentile(50.0));
+	summary.p95_ms = to_ms(histogram.value_at_percentile(95.0));
+	summary.p99_ms = to_ms(histogram.value_at_percentile(99.0));
+	summary.max_ms = to_ms(histogram.max());
+
+	return summary;
+}
+
+void frame_stats::write_csv_header(std::ostream& out)
+{
+	out << "series,start_s,duration_s,frames,fps,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+}
+
+void frame_stats::write_csv_row(std::ostream& out, frame_time_summary const& summary)
+{
+	out << summary.series << ',' << summary.start_seconds << ',' << summary.duration_seconds << ',' <<
+		summary.frame_count << ',' << summary.fps << ',' << summary.mean_ms << ',' <<
+		summary.p50_ms << ',' << summary.p95_ms << ',' << summary.p99_ms << ',' <<
+		summary.max_ms << '\n';
+}
+
+void frame_stats::write_interval_csv(std::ostream& out) const
+{
+	for (auto const& series : m_series)
+	{
+		write_csv_row(out, series->interval_summary);
+	}
+}
+
+void frame_stats::write_json(std::ostream& out) const
+{
+	out << "{\n";
+	out << "\t\"duration_s\": " << (m_last_collect - m_start) << ",\n";
+	out << "\t\"series\": [";
+
+	for (std::uint32_t s = 0; s < series_count(); ++s)
+	{
+		frame_time_summary summary = total_summary(s);
+		frame_time_histogram const& histogram = total_histogram(s);
+
+		out << (s == 0 ? "\n" : ",\n") << "\t\t{\n";
+		out << "\t\t\t\"name\": \"" << summary.series << "\",\n";
+		out << "\t\t\t\"frames\": " << summary.frame_count << ",\n";
+		out << "\t\t\t\"dropped_frames\": " << dropped_count(s) << ",\n";
+		out << "\t\t\t\"fps\": " << summary.fps << ",\n";
+		out << "\t\t\t\"mean_ms\": " << summary.mean_ms << ",\n";
+		out << "\t\t\t\"p50_ms\": " << summary.p50_ms << ",\n";
+		out << "\t\t\t\"p95_ms\": " << summary.p95_ms << ",\n";
+		out << "\t\t\t\"p99_ms\": " << summary.p99_ms << ",\n";
+		out << "\t\t\t\"max_ms\": " << summary.max_ms << ",\n";
+
+		// [lowest_us, highest_us, frames] for every bucket with frames in it.
+		out << "\t\t\t\"histogram_us\": [";
+		bool first = true;
+		for (std::uint32_t i = 0; i < histogram.bucket_count(); ++i)
+		{
+			if (histogram.bucket_frames(i) == 0)
+			{
+				continue;
+			}
+
+			out << (first ? "\n" : ",\n") << "\t\t\t\t[" << histogram.bucket_lowest_value(i) << ", " <<
+				histogram.bucket_highest_value(i) << ", " << histogram.bucket_frames(i) << "]";
+			first = false;
+		}
+		out << (first ? "]\n" : "\n\t\t\t]\n");
+		out << "\t\t}";
+	}
+
+	out << (series_count() == 0 ? "]\n" : "\n\t]\n");
+	out << "}\n";
+}
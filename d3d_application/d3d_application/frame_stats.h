@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Frame time distribution with bounded relative error, in the style of HdrHistogram:
+// values (microseconds) below 2^sub_bucket_bits are counted exactly, and every power
+// of two above is split into 2^(sub_bucket_bits - 1) equal buckets, so a value is
+// never off by more than 1/64 of itself.  Recording is a few shifts and an increment,
+// and the memory is fixed (16 KB) no matter how many frames are seen.
+class frame_time_histogram
+{
+public:
+	static constexpr std::uint32_t sub_bucket_bits = 7;
+
+	// Values are clamped to 2^max_magnitude - 1 us (over a day).
+	static constexpr std::uint32_t max_magnitude = 37;
+
+	frame_time_histogram();
+
+	void record(std::uint64_t microseconds);
+	void reset();
+
+	std::uint64_t count() const;
+	std::uint64_t min() const;
+	std::uint64_t max() const;
+	double mean() const;
+
+	// Smallest recorded value (up to the bucket precision) that percentile percent of
+	// the frames do not exceed.  0 if nothing was recorded.
+	std::uint64_t value_at_percentile(double percentile) const;
+
+	std::uint32_t bucket_count() const;
+	std::uint64_t bucket_frames(std::uint32_t bucket) const;
+	std::uint64_t bucket_lowest_value(std::uint32_t bucket) const;
+	std::uint64_t bucket_highest_value(std::uint32_t bucket) const;
+
+	static std::uint32_t bucket_index(std::uint64_t microseconds);
+
+private:
+	std::vector<std::uint64_t> m_buckets;
+	std::uint64_t m_count = 0;
+	std::uint64_t m_sum = 0;
+	std::uint64_t m_min = 0;
+	std::uint64_t m_max = 0;
+};
+
+// Single producer, single consumer ring of frame times (microseconds), so the frame
+// loop can hand its timings to whoever collects them without locking.  When the
+// consumer falls behind by a whole ring, new frames are dropped and counted.
+class frame_time_ring
+{
+public:
+	static constexpr std::uint32_t capacity = 1024;
+
+	// Producer side.
+	bool push(std::uint64_t microseconds);
+
+	// Consumer side.
+	bool pop(std::uint64_t& microseconds);
+
+	std::uint64_t dropped_count() const;
+
+private:
+	static constexpr std::size_t cache_line_size = 64;
+
+	std::uint64_t m_values[capacity] = {};
+
+	// Written by the producer and the consumer respectively, kept a cache line apart
+	// so they do not bounce between the two threads.  Padded rather than alignas, so
+	// rings can be allocated with new before C++17.
+	std::atomic<std::uint64_t> m_head{ 0 };
+	std::atomic<std::uint64_t> m_dropped{ 0 };
+	char m_padding[cache_line_size] = {};
+	std::atomic<std::uint64_t> m_tail{ 0 };
+};
+
+struct frame_time_summary
+{
+	std::string series;
+
+	double start_seconds = 0.0;
+	double duration_seconds = 0.0;
+
+	std::uint64_t frame_count = 0;
+	double fps = 0.0;
+
+	double mean_ms = 0.0;
+	double p50_ms = 0.0;
+	double p95_ms = 0.0;
+	double p99_ms = 0.0;
+	double max_ms = 0.0;
+};
+
+// Per-frame timings reduced to percentiles over fixed report intervals and over the
+// whole run.  Series 0 is the CPU frame time; other series, e.g. the GPU time of each
+// pass, are reported the same way next to it.
+//
+//     stats.add_frame(timer.delta_time());
+//     stats.add_sample(stats.add_series("gpu_frame"), gpu_seconds);
+//     ...
+//     if (stats.collect(timer.total_time(), summary))
+//         stats.write_interval_csv(csv);
+class frame_stats
+{
+public:
+	static constexpr std::uint32_t frame_series = 0;
+
+	explicit frame_stats(double report_interval_seconds = 1.0);
+	frame_stats(frame_stats const&) = delete;
+	frame_stats& operator=(frame_stats const&) = delete;
+
+	// Index of the series called name, added first if there is none.  Not synchronized
+	// with the producer: call it from the consumer thread, or before any samples.
+	std::uint32_t add_series(std::string const& name);
+
+	std::uint32_t series_count() const;
+	std::string const& series_name(std::uint32_t series) const;
+
+	// Producer side.  One producer per series.
+	void add_frame(double seconds);
+	void add_sample(std::uint32_t series, double seconds);
+
+	// Consumer side: takes in the samples added since the last call.  Returns true, with
+	// the frame series' summary of the interval, when a report interval has passed at
+	// now_seconds; the other series' summaries are then in interval_summary().
+	bool collect(double now_seconds, frame_time_summary& summary);
+
+	// The last report interval that collect() completed.
+	frame_time_summary const& interval_summary(std::uint32_t series) const;
+
+	// Everything collected so far.
+	frame_time_summary total_summary(std::uint32_t series = frame_series) const;
+	frame_time_histogram const& total_histogram(std::uint32_t series = frame_series) const;
+
+	std::uint64_t dropped_count(std::uint32_t series = frame_series) const;
+
+	static void write_csv_header(std::ostream& out);
+	static void write_csv_row(std::ostream& out, frame_time_summary const& summary);
+
+	// One row per series for the last report interval.
+	void write_interval_csv(std::ostream& out) const;
+
+	// Every series' summary over the run and its non-empty histogram buckets.
+	void write_json(std::ostream& out) const;
+
+private:
+	struct series_data
+	{
+		std::string name;
+		frame_time_ring ring;
+		frame_time_histogram interval;
+		frame_time_histogram total;
+		frame_time_summary interval_summary;
+	};
+
+	static frame_time_summary summarize(std::string const& name,
+		frame_time_histogram const& histogram, double start_seconds, double duration_seconds);
+
+	std::vector<std::unique_ptr<series_data>> m_series;
+
+	double m_report_interval;
+	bool m_started = false;
+	double m_start = 0.0;
+	double m_interval_start = 0.0;
+	double m_last_collect = 0.0;
+};
@@ -1,14 +1,18 @@
 #include "game_timer.h"
-#include <Windows.h>
+#include <chrono>
 
 game_timer::game_timer() :
 	m_secconds_per_count(.0), m_delta_time(-1.0),
 	m_base_time(0), m_pause_time(0), m_stop_time(0),
 	m_previous_time(0), m_current_time(0), m_stopped(false)
 {
-	__int64 counts_per_sec{};
-	QueryPerformanceFrequency((LARGE_INTEGER*)&counts_per_sec);
-	m_secconds_per_count = 1.0 / (double)counts_per_sec;
+	using period = std::chrono::steady_clock::period;
+	m_secconds_per_count = static_cast<double>(period::num) / static_cast<double>(period::den);
+}
+
+std::int64_t game_timer::current_count()
+{
+	return static_cast<std::int64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
 }
 
 float game_timer::delta_time() const
@@ -30,8 +34,7 @@ float game_timer::total_time() const
 
 void game_timer::reset()
 {
-	__int64 curr_time{};
-	QueryPerformanceCounter((LARGE_INTEGER*)&curr_time);
+	std::int64_t curr_time = current_count();
 
 	m_base_time = curr_time;
 	m_previous_time = curr_time;
@@ -43,8 +46,7 @@ void game_timer::start()
 {
 	if (m_stopped)
 	{
-		__int64 curr_time{};
-		QueryPerformanceCounter((LARGE_INTEGER*)&curr_time);
+		std::int64_t curr_time = current_count();
 
 		m_pause_time += curr_time - m_stop_time;
 
@@ -59,8 +61,7 @@ void game_timer::stop()
 {
 	if (!m_stopped)
 	{
-		__int64 curr_time{};
-		QueryPerformanceCounter((LARGE_INTEGER*)&curr_time);
+		std::int64_t curr_time = current_count();
 
 		m_stop_time = curr_time;
 		m_stopped = true;
@@ -75,8 +76,7 @@ void game_timer::tick()
 		return;
 	}
 
-	__int64 curr_time{};
-	QueryPerformanceCounter((LARGE_INTEGER*)&curr_time);
+	std::int64_t curr_time = current_count();
 	m_current_time = curr_time;
 
 	m_delta_time = (m_current_time - m_previous_time) * m_secconds_per_count;
@@ -1,5 +1,8 @@
 #pragma once
+#include <cstdint>
 
+// Measures time with std::chrono::steady_clock (QueryPerformanceCounter on Windows),
+// so the timer works, and can be tested, on any platform.
 class game_timer
 {
 public:
@@ -14,14 +17,16 @@ public:
 	void tick();
 
 private:
+	static std::int64_t current_count();
+
 	double m_secconds_per_count;
 	double m_delta_time;
 
-	__int64 m_base_time;
-	__int64 m_pause_time;
-	__int64 m_stop_time;
-	__int64 m_previous_time;
-	__int64 m_current_time;
+	std::int64_t m_base_time;
+	std::int64_t m_pause_time;
+	std::int64_t m_stop_time;
+	std::int64_t m_previous_time;
+	std::int64_t m_current_time;
 
 	bool m_stopped;
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdio>
+
+// The few macros the tests need.  Every test is an executable whose main() runs its
+// cases through RUN_TEST and returns test_result(), which is non-zero once any CHECK
+// has failed, so ctest reports it.
+
+inline int& test_failure_count()
+{
+	static int count = 0;
+	return count;
+}
+
+inline int test_result()
+{
+	if (test_failure_count() > 0)
+	{
+		std::printf("%d check(s) failed\n", test_failure_count());
+	}
+	return test_failure_count() > 0 ? 1 : 0;
+}
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			++test_failure_count(); \
+		} \
+	} while (false)
+
+#define RUN_TEST(test) \
+	do \
+	{ \
+		int failures_before = test_failure_count(); \
+		test(); \
+		std::printf("%-48s %s\n", #test, test_failure_count() == failures_before ? "passed" : "FAILED"); \
+	} while (false)
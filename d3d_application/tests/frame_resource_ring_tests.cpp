@@ -0,0 +1,124 @@
+#include "check.h"
+#include "frame_resource_ring.h"
+
+namespace
+{
+	struct frame_resource
+	{
+		std::uint32_t index;
+	};
+
+	frame_resource_ring<frame_resource>::factory make_resource()
+	{
+		return [](std::uint32_t index) { return std::make_unique<frame_resource>(frame_resource{ index }); };
+	}
+
+	void hands_out_sets_round_robin()
+	{
+		simulated_fence_wait_policy gpu;
+		frame_resource_ring<frame_resource> ring(gpu, 3, make_resource());
+
+		CHECK(ring.size() == 3);
+		for (std::uint32_t frame = 0; frame < 7; ++frame)
+		{
+			CHECK(ring.begin_frame().index == frame % 3);
+			CHECK(ring.current_index() == frame % 3);
+
+			// The GPU keeps up: every frame is done before the next one starts.
+			ring.end_frame(frame + 1);
+			gpu.complete(frame + 1);
+		}
+
+		CHECK(ring.stall_count() == 0);
+		CHECK(gpu.wait_count() == 0);
+	}
+
+	void reuse_waits_for_the_sets_fence()
+	{
+		simulated_fence_wait_policy gpu;
+		frame_resource_ring<frame_resource> ring(gpu, 3, make_resource());
+
+		// Three frames in flight, none complete.
+		for (std::uint64_t fence = 1; fence <= 3; ++fence)
+		{
+			ring.begin_frame();
+			ring.end_frame(fence);
+		}
+		CHECK(ring.stall_count() == 0);
+
+		// Set 0 was submitted with fence 1; once that completes it is reused at once.
+		gpu.complete(1);
+		CHECK(ring.begin_frame().index == 0);
+		ring.end_frame(4);
+		CHECK(ring.stall_count() == 0 && gpu.wait_count() == 0);
+
+		// Set 1 still waits for fence 2, so the CPU blocks until exactly fence 2.
+		CHECK(ring.begin_frame().index == 1);
+		ring.end_frame(5);
+		CHECK(ring.stall_count() == 1 && gpu.wait_count() == 1);
+		CHECK(gpu.completed_value() == 2);
+	}
+
+	void counts_every_stall()
+	{
+		simulated_fence_wait_policy gpu;
+		frame_resource_ring<frame_resource> ring(gpu, 2, make_resource());
+
+		// A GPU that never finishes on its own: from the third frame on, every frame
+		// waits.
+		for (std::uint64_t fence = 1; fence <= 10; ++fence)
+		{
+			ring.begin_frame();
+			ring.end_frame(fence);
+		}
+
+		CHECK(ring.stall_count() == 8);
+		CHECK(gpu.completed_value() == 8);
+	}
+
+	void wait_idle_waits_for_every_set()
+	{
+		simulated_fence_wait_policy gpu;
+		frame_resource_ring<frame_resource> ring(gpu, 3, make_resource());
+
+		for (std::uint64_t fence = 1; fence <= 3; ++fence)
+		{
+			ring.begin_frame();
+			ring.end_frame(fence);
+		}
+		gpu.complete(1);
+
+		ring.wait_idle();
+		CHECK(gpu.completed_value() == 3);
+
+		// Fence 1 was already done, so only the others needed a wait.
+		CHECK(gpu.wait_count() == 2);
+
+		// wait_idle is not a begin_frame stall.
+		CHECK(ring.stall_count() == 0);
+
+		// Nothing in flight: no more waits.
+		ring.wait_idle();
+		CHECK(gpu.wait_count() == 2);
+	}
+
+	void wait_idle_on_unused_ring()
+	{
+		simulated_fence_wait_policy gpu;
+		frame_resource_ring<frame_resource> ring(gpu, 3, make_resource());
+
+		ring.wait_idle();
+		CHECK(gpu.wait_count() == 0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(hands_out_sets_round_robin);
+	RUN_TEST(reuse_waits_for_the_sets_fence);
+	RUN_TEST(counts_every_stall);
+	RUN_TEST(wait_idle_waits_for_every_set);
+	RUN_TEST(wait_idle_on_unused_ring);
+
+	return test_result();
+}
@@ -0,0 +1,310 @@
+#include "check.h"
+#include "frame_stats.h"
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+	bool is_within_precision(std::uint64_t reported, std::uint64_t expected)
+	{
+		std::uint64_t error = reported > expected ? reported - expected : expected - reported;
+		return error * 64 <= expected;
+	}
+
+	std::uint32_t count_lines(std::string const& text)
+	{
+		std::uint32_t lines = 0;
+		for (char c : text)
+		{
+			lines += c == '\n' ? 1 : 0;
+		}
+		return lines;
+	}
+
+	void buckets_tile_the_range()
+	{
+		frame_time_histogram histogram;
+
+		// Every bucket starts where the one before it ends.
+		bool contiguous = true;
+		for (std::uint32_t i = 1; i < histogram.bucket_count(); ++i)
+		{
+			contiguous &= histogram.bucket_lowest_value(i) == histogram.bucket_highest_value(i - 1) + 1;
+		}
+		CHECK(contiguous);
+		CHECK(histogram.bucket_lowest_value(0) == 0);
+		CHECK(histogram.bucket_highest_value(histogram.bucket_count() - 1) ==
+			(std::uint64_t(1) << frame_time_histogram::max_magnitude) - 1);
+
+		// Values below 2^sub_bucket_bits have a bucket each.
+		CHECK(frame_time_histogram::bucket_index(0) == 0);
+		CHECK(frame_time_histogram::bucket_index(127) == 127);
+		CHECK(histogram.bucket_lowest_value(127) == histogram.bucket_highest_value(127));
+	}
+
+	void buckets_bound_the_relative_error()
+	{
+		frame_time_histogram histogram;
+
+		bool contained = true;
+		bool narrow = true;
+		for (std::uint64_t value = 1; value < (std::uint64_t(1) << 36); value = value * 3 / 2 + 1)
+		{
+			for (std::uint64_t v : { value - 1, value, value + 1 })
+			{
+				std::uint32_t bucket = frame_time_histogram::bucket_index(v);
+				std::uint64_t lowest = histogram.bucket_lowest_value(bucket);
+				std::uint64_t highest = histogram.bucket_highest_value(bucket);
+
+				contained &= lowest <= v && v <= highest;
+				narrow &= (highest - lowest) * 64 <= v;
+			}
+		}
+		CHECK(contained);
+		CHECK(narrow);
+
+		// Values past the top are clamped into the last bucket.
+		CHECK(frame_time_histogram::bucket_index(~std::uint64_t(0)) == histogram.bucket_count() - 1);
+	}
+
+	void percentiles_of_small_values_are_exact()
+	{
+		frame_time_histogram histogram;
+		CHECK(histogram.value_at_percentile(50.0) == 0);
+
+		for (std::uint64_t us = 100; us >= 1; --us)
+		{
+			histogram.record(us);
+		}
+
+		CHECK(histogram.count() == 100);
+		CHECK(histogram.min() == 1);
+		CHECK(histogram.max() == 100);
+		CHECK(histogram.mean() == 50.5);
+		CHECK(histogram.value_at_percentile(0.0) == 1);
+		CHECK(histogram.value_at_percentile(50.0) == 50);
+		CHECK(histogram.value_at_percentile(95.0) == 95);
+		CHECK(histogram.value_at_percentile(99.0) == 99);
+		CHECK(histogram.value_at_percentile(100.0) == 100);
+
+		histogram.reset();
+		CHECK(histogram.count() == 0);
+		CHECK(histogram.value_at_percentile(99.0) == 0);
+	}
+
+	void percentiles_of_large_values_are_within_precision()
+	{
+		frame_time_histogram histogram;
+
+		// 1 ms to 100 ms in 10 us steps.
+		for (std::uint64_t us = 1000; us <= 100000; us += 10)
+		{
+			histogram.record(us);
+		}
+
+		CHECK(is_within_precision(histogram.value_at_percentile(50.0), 50500));
+		CHECK(is_within_precision(histogram.value_at_percentile(95.0), 95050));
+		CHECK(is_within_precision(histogram.value_at_percentile(99.0), 99010));
+
+		CHECK(is_within_precision(histogram.value_at_percentile(0.0), 1000));
+
+		// The maximum is tracked exactly, so the top percentile never overshoots it.
+		CHECK(histogram.min() == 1000);
+		CHECK(histogram.max() == 100000);
+		CHECK(histogram.value_at_percentile(100.0) == 100000);
+
+		// A single long frame shows up in the tail, not in the median.
+		frame_time_histogram spiky;
+		for (int i = 0; i < 99; ++i)
+		{
+			spiky.record(16667);
+		}
+		spiky.record(250000);
+		CHECK(is_within_precision(spiky.value_at_percentile(50.0), 16667));
+		CHECK(is_within_precision(spiky.value_at_percentile(99.0), 16667));
+		CHECK(spiky.value_at_percentile(99.5) == 250000);
+	}
+
+	void ring_drops_new_values_when_full()
+	{
+		frame_time_ring ring;
+
+		for (std::uint64_t i = 0; i < frame_time_ring::capacity; ++i)
+		{
+			CHECK(ring.push(i));
+		}
+		CHECK(!ring.push(1000000));
+		CHECK(!ring.push(1000001));
+		CHECK(ring.dropped_count() == 2);
+
+		// One slot free again.
+		std::uint64_t value = 0;
+		CHECK(ring.pop(value));
+		CHECK(value == 0);
+		CHECK(ring.push(frame_time_ring::capacity));
+
+		// First in, first out; the dropped values never appear.
+		bool in_order = true;
+		for (std::uint64_t i = 1; i <= frame_time_ring::capacity; ++i)
+		{
+			in_order &= ring.pop(value) && value == i;
+		}
+		CHECK(in_order);
+		CHECK(!ring.pop(value));
+		CHECK(ring.dropped_count() == 2);
+	}
+
+	void ring_hands_values_across_threads()
+	{
+		frame_time_ring ring;
+		const std::uint64_t value_count = 200000;
+
+		std::thread producer([&ring, value_count]()
+		{
+			for (std::uint64_t i = 1; i <= value_count; ++i)
+			{
+				while (!ring.push(i))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+
+		bool in_order = true;
+		std::uint64_t expected = 1;
+		while (expected <= value_count)
+		{
+			std::uint64_t value = 0;
+			if (ring.pop(value))
+			{
+				in_order &= value == expected;
+				++expected;
+			}
+		}
+		producer.join();
+
+		CHECK(in_order);
+
+		std::uint64_t value = 0;
+		CHECK(!ring.pop(value));
+	}
+
+	void collects_report_intervals()
+	{
+		frame_stats stats(1.0);
+		frame_time_summary summary;
+
+		// The first collect starts the clock.
+		CHECK(!stats.collect(10.0, summary));
+
+		for (int i = 0; i < 50; ++i)
+		{
+			stats.add_frame(0.010);
+		}
+		stats.add_frame(0.050);
+		CHECK(!stats.collect(10.5, summary));
+
+		for (int i = 0; i < 49; ++i)
+		{
+			stats.add_frame(0.010);
+		}
+		CHECK(stats.collect(11.0, summary));
+
+		CHECK(summary.series == "cpu_frame");
+		CHECK(summary.start_seconds == 10.0);
+		CHECK(summary.duration_seconds == 1.0);
+		CHECK(summary.frame_count == 100);
+		CHECK(summary.fps == 100.0);
+		CHECK(is_within_precision(static_cast<std::uint64_t>(summary.p50_ms * 1000.0 + 0.5), 10000));
+		CHECK(summary.max_ms == 50.0);
+
+		// The next interval starts empty; the total keeps everything.
+		stats.add_frame(0.020);
+		CHECK(!stats.collect(11.5, summary));
+		CHECK(stats.collect(12.0, summary));
+		CHECK(summary.frame_count == 1);
+		CHECK(summary.p50_ms == 20.0);
+
+		frame_time_summary total = stats.total_summary();
+		CHECK(total.frame_count == 101);
+		CHECK(total.duration_seconds == 2.0);
+		CHECK(total.max_ms == 50.0);
+	}
+
+	void reports_every_series()
+	{
+		frame_stats stats(1.0);
+		CHECK(stats.series_count() == 1);
+		CHECK(stats.series_name(frame_stats::frame_series) == "cpu_frame");
+
+		std::uint32_t gpu = stats.add_series("gpu_frame");
+		CHECK(gpu == 1);
+		CHECK(stats.add_series("gpu_frame") == gpu);
+		CHECK(stats.add_series("cpu_frame") == frame_stats::frame_series);
+		CHECK(stats.series_count() == 2);
+
+		frame_time_summary summary;
+		CHECK(!stats.collect(0.0, summary));
+		for (int i = 0; i < 10; ++i)
+		{
+			stats.add_frame(0.016);
+			stats.add_sample(gpu, 0.004);
+		}
+		CHECK(stats.collect(1.0, summary));
+
+		CHECK(summary.frame_count == 10);
+		CHECK(stats.interval_summary(gpu).series == "gpu_frame");
+		CHECK(stats.interval_summary(gpu).frame_count == 10);
+		CHECK(stats.interval_summary(gpu).p50_ms == 4.0);
+		CHECK(stats.total_summary(gpu).mean_ms == 4.0);
+		CHECK(stats.total_histogram(gpu).count() == 10);
+
+		std::ostringstream csv;
+		frame_stats::write_csv_header(csv);
+		stats.write_interval_csv(csv);
+		CHECK(count_lines(csv.str()) == 3);
+		CHECK(csv.str().find("\ngpu_frame,0,1,10,") != std::string::npos);
+
+		std::ostringstream json;
+		stats.write_json(json);
+		CHECK(json.str().find("\"name\": \"cpu_frame\"") != std::string::npos);
+		CHECK(json.str().find("\"name\": \"gpu_frame\"") != std::string::npos);
+	}
+
+	void counts_frames_dropped_between_collects()
+	{
+		frame_stats stats(1.0);
+		frame_time_summary summary;
+		CHECK(!stats.collect(0.0, summary));
+
+		for (std::uint32_t i = 0; i < frame_time_ring::capacity + 5; ++i)
+		{
+			stats.add_frame(0.001);
+		}
+		CHECK(stats.collect(1.0, summary));
+
+		CHECK(summary.frame_count == frame_time_ring::capacity);
+		CHECK(stats.dropped_count() == 5);
+
+		std::ostringstream json;
+		stats.write_json(json);
+		CHECK(json.str().find("\"dropped_frames\": 5") != std::string::npos);
+	}
+}
+
+int main()
+{
+	RUN_TEST(buckets_tile_the_range);
+	RUN_TEST(buckets_bound_the_relative_error);
+	RUN_TEST(percentiles_of_small_values_are_exact);
+	RUN_TEST(percentiles_of_large_values_are_within_precision);
+	RUN_TEST(ring_drops_new_values_when_full);
+	RUN_TEST(ring_hands_values_across_threads);
+	RUN_TEST(collects_report_intervals);
+	RUN_TEST(reports_every_series);
+	RUN_TEST(counts_frames_dropped_between_collects);
+
+	return test_result();
+}
@@ -1,10 +1,25 @@
 #include "d3d_box.h"
 #include <array>
 
+frame_resource::frame_resource(ID3D12Device* device)
+{
+	ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+		IID_PPV_ARGS(command_allocator.GetAddressOf())));
+
+	object_constant_buffer = std::make_unique<upload_buffer<object_constant>>(device, 1, true);
+}
+
 d3d_box::d3d_box(HINSTANCE hinstance) : d3d_application(hinstance)
 {}
 
-d3d_box::~d3d_box() {}
+d3d_box::~d3d_box()
+{
+	// The frame resources may still be in use by the GPU.
+	if (m_d3d_device)
+	{
+		flush_command_queue();
+	}
+}
 
 bool d3d_box::initialize()
 {
@@ -16,6 +31,7 @@ bool d3d_box::initialize()
 	// Reset the command list to prep for initialization commands.
 	ThrowIfFailed(m_command_list->Reset(m_direct_cmd_list_allocator.Get(), nullptr));
 
+	build_frame_resources();
 	build_descriptor_heaps();
 	build_constant_buffer();
 	build_root_signature();
@@ -45,6 +61,10 @@ void d3d_box::on_resize()
 
 void d3d_box::update(game_timer const& timer)
 {
+	// Cycle through the frame resources, waiting only if the GPU has not finished the
+	// frame that last used the next one.
+	m_current_frame_resource = &m_frame_resources->begin_frame();
+
 	// Convert Spherical to Cartesian coordinates.
 	auto x = m_radious * std::sinf(m_phi) * std::cosf(m_theta);
 	auto z = m_radious * std::sinf(m_phi) * std::sinf(m_theta);
@@ -66,19 +86,20 @@ void d3d_box::update(game_timer const& timer)
 	object_constant obj_constant{};
 	DirectX::XMStoreFloat4x4(&obj_constant.world_view_projection,
 		DirectX::XMMatrixTranspose(world_view_projection));
-	m_object_constant_buffer->copy_data(0, obj_constant);
+	m_current_frame_resource->object_constant_buffer->copy_data(0, obj_constant);
 }
 
 void d3d_box::draw(game_timer const& timer)
 {
 	// Reuse the memory associated with command recording.
 	// We can only reset when the associated command lists have finished execution on the GPU.
-	//flush_command_queue();
-	ThrowIfFailed(m_direct_cmd_list_allocator->Reset());
+	// update() waited for that, so the current frame's allocator is free.
+	auto command_allocator = m_current_frame_resource->command_allocator;
+	ThrowIfFailed(command_allocator->Reset());
 
 	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
 	// Reusing the command list reuses memory.
-	ThrowIfFailed(m_command_list->Reset(m_direct_cmd_list_allocator.Get(), m_pso.Get()));
+	ThrowIfFailed(m_command_list->Reset(command_allocator.Get(), m_pso.Get()));
 
 	m_command_list->RSSetViewports(1, &m_screen_viewport);
 	m_command_list->RSSetScissorRects(1, &m_scissor_rect);
@@ -108,7 +129,10 @@ void d3d_box::draw(game_timer const& timer)
 	m_command_list->IASetIndexBuffer(&ibv);
 	m_command_list->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	m_command_list->SetGraphicsRootDescriptorTable(0, m_cbv_heap->GetGPUDescriptorHandleForHeapStart());
+	// One CBV per frame resource, in frame resource order.
+	auto const cbv = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_cbv_heap->GetGPUDescriptorHandleForHeapStart(),
+		m_frame_resources->current_index(), m_cbv_srv_uav_descriptor_size);
+	m_command_list->SetGraphicsRootDescriptorTable(0, cbv);
 
 	m_command_list->DrawIndexedInstanced(m_box_geometry->draw_args["box"].index_count, 1, 0, 0, 0);
 
@@ -128,8 +152,11 @@ void d3d_box::draw(game_timer const& timer)
 	ThrowIfFailed(m_swap_chain->Present(0, 0));
 	m_current_back_buffer = (m_current_back_buffer + 1) % SwapChainBufferCount;
 
-	// Wait until frame commands are complete.
-	flush_command_queue();
+	// Mark the frame's commands with a new fence point.  Instead of waiting for it here,
+	// the frame resource is not reused until the GPU has reached it.
+	++m_current_fence;
+	ThrowIfFailed(m_command_queue->Signal(m_fence.Get(), m_current_fence));
+	m_frame_resources->end_frame(m_current_fence);
 }
 
 void d3d_box::on_mouse_down(WPARAM wparam, int x, int y)
@@ -177,10 +204,18 @@ void d3d_box::on_mouse_move(WPARAM button_state, int x, int y)
 	m_last_mouse_position.y = y;
 }
 
+void d3d_box::build_frame_resources()
+{
+	auto device = m_d3d_device.Get();
+	m_frame_resources = std::make_unique<frame_resource_ring<frame_resource>>(
+		*m_fence_wait_policy, frame_resource_count,
+		[device](std::uint32_t) { return std::make_unique<frame_resource>(device); });
+}
+
 void d3d_box::build_descriptor_heaps()
 {
 	D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc{};
-	cbvHeapDesc.NumDescriptors = 1;
+	cbvHeapDesc.NumDescriptors = frame_resource_count;
 	cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	cbvHeapDesc.NodeMask = 0;
@@ -190,22 +225,25 @@ void d3d_box::build_descriptor_heaps()
 
 void d3d_box::build_constant_buffer()
 {
-	m_object_constant_buffer = std::make_unique<upload_buffer<object_constant>>(m_d3d_device.Get(), 1, true);
-
 	UINT constexpr objCBByteSize = calculate_constant_buffer_byte_size(sizeof(object_constant));
 
-	D3D12_GPU_VIRTUAL_ADDRESS cbAddress = m_object_constant_buffer->resource()->GetGPUVirtualAddress();
-	// Offset to the ith object constant buffer in the buffer.
-	int boxCBufIndex = 0;
-	cbAddress += boxCBufIndex * objCBByteSize;
-
-	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
-	cbvDesc.BufferLocation = cbAddress;
-	cbvDesc.SizeInBytes = calculate_constant_buffer_byte_size(sizeof(object_constant));
-
-	m_d3d_device->CreateConstantBufferView(
-		&cbvDesc,
-		m_cbv_heap->GetCPUDescriptorHandleForHeapStart());
+	// The box's constant buffer lives in each frame resource; descriptor i views the
+	// buffer of frame resource i.
+	for (std::uint32_t i = 0; i < frame_resource_count; ++i)
+	{
+		D3D12_GPU_VIRTUAL_ADDRESS cbAddress = (*m_frame_resources)[i].object_constant_buffer->resource()->GetGPUVirtualAddress();
+		// Offset to the ith object constant buffer in the buffer.
+		int boxCBufIndex = 0;
+		cbAddress += boxCBufIndex * objCBByteSize;
+
+		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
+		cbvDesc.BufferLocation = cbAddress;
+		cbvDesc.SizeInBytes = objCBByteSize;
+
+		auto const handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cbv_heap->GetCPUDescriptorHandleForHeapStart(),
+			i, m_cbv_srv_uav_descriptor_size);
+		m_d3d_device->CreateConstantBufferView(&cbvDesc, handle);
+	}
 }
 
 void d3d_box::build_root_signature()
@@ -14,6 +14,18 @@ struct object_constant
 	DirectX::XMFLOAT4X4 world_view_projection = math_helper::identity4x4;
 };
 
+// Everything a frame writes or records into that the GPU may still be reading while
+// the CPU works on the next frames.
+struct frame_resource
+{
+	frame_resource(ID3D12Device*);
+	frame_resource(frame_resource const&) = delete;
+	frame_resource& operator=(frame_resource const&) = delete;
+
+	ComPtr<ID3D12CommandAllocator> command_allocator;
+	std::unique_ptr<upload_buffer<object_constant>> object_constant_buffer;
+};
+
 class d3d_box : public d3d_application
 {
 public:
@@ -33,6 +45,7 @@ private:
 	virtual void on_mouse_up(WPARAM, int, int) override;
 	virtual void on_mouse_move(WPARAM, int, int) override;
 
+	void build_frame_resources();
 	void build_descriptor_heaps();
 	void build_constant_buffer();
 	void build_root_signature();
@@ -43,7 +56,10 @@ private:
 	ComPtr<ID3D12RootSignature> m_root_signature = nullptr;
 	ComPtr<ID3D12DescriptorHeap> m_cbv_heap = nullptr;
 
-	std::unique_ptr<upload_buffer<object_constant>> m_object_constant_buffer = nullptr;
+	static constexpr std::uint32_t frame_resource_count = 3;
+
+	std::unique_ptr<frame_resource_ring<frame_resource>> m_frame_resources = nullptr;
+	frame_resource* m_current_frame_resource = nullptr;
 	std::unique_ptr<mesh_geometry> m_box_geometry = nullptr;
 
 	ComPtr<ID3DBlob> m_vs_bytecode = nullptr;
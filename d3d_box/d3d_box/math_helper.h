@@ -1,27 +1,98 @@
 #pragma once
 
-#include <Windows.h>
 #include <DirectXMath.h>
+#include <cfloat>
 #include <cstdint>
-#include <cstdlib>
+#include <type_traits>
 #include <concepts>
 
 namespace math_helper
 {
+	// xoshiro128**, seeded through splitmix64.  Same seed, same sequence.
+	class random_engine
+	{
+	public:
+		explicit random_engine(std::uint64_t seed = 0x2545f4914f6cdd1dull)
+		{
+			this->seed(seed);
+		}
+
+		void seed(std::uint64_t seed)
+		{
+			for (int i = 0; i < 4; i += 2)
+			{
+				std::uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+				z ^= z >> 31;
+				state[i] = static_cast<std::uint32_t>(z);
+				state[i + 1] = static_cast<std::uint32_t>(z >> 32);
+			}
+		}
+
+		std::uint32_t next()
+		{
+			std::uint32_t const result = rotl(state[1] * 5, 7) * 9;
+			std::uint32_t const t = state[1] << 9;
+
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = rotl(state[3], 11);
+
+			return result;
+		}
+
+	private:
+		static constexpr std::uint32_t rotl(std::uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		std::uint32_t state[4];
+	};
+
+	// The calling thread's engine; no shared state, unlike std::rand().
+	inline random_engine& thread_random()
+	{
+		thread_local random_engine engine;
+		return engine;
+	}
+
+	// In [0, 1).
 	inline float randf()
 	{
-		return static_cast<float>(std::rand()) / RAND_MAX;
+		return static_cast<float>(thread_random().next() >> 8) * (1.0f / 16777216.0f);
 	}
 
+	// In [min, max).
 	inline float randf(float min, float max)
 	{
-		return min + randf() * max;
+		return min + randf() * (max - min);
 	}
 
+	// In [min, max].
 	template<std::integral T>
 	inline T rand(T min, T max)
 	{
-		return min + std::rand() % (max - min + static_cast<T>(1));
+		using U = std::make_unsigned_t<T>;
+		U const range = static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+
+		U offset;
+		if constexpr (sizeof(T) <= sizeof(std::uint32_t))
+		{
+			// Multiply-shift maps the 32 random bits onto [0, range].
+			offset = static_cast<U>((static_cast<std::uint64_t>(thread_random().next()) * (static_cast<std::uint64_t>(range) + 1)) >> 32);
+		}
+		else
+		{
+			std::uint64_t const bits = (static_cast<std::uint64_t>(thread_random().next()) << 32) | thread_random().next();
+			offset = range == static_cast<U>(-1) ? static_cast<U>(bits) : static_cast<U>(bits % (static_cast<std::uint64_t>(range) + 1));
+		}
+
+		return static_cast<T>(static_cast<U>(min) + offset);
 	}
 
 	template<typename T>